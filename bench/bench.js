@@ -0,0 +1,189 @@
+#!/usr/bin/env node
+
+/**
+ * Offline benchmark of process path
+ *
+ * Starts private jackd with dummy driver (no audio hardware needed) for every
+ * buffer size and runs bench client for every ports count and callback style.
+ * Prints throughput (processed cycles against expected ones) and per-cycle
+ * timings from getStatsSync().
+ *
+ * Usage:
+ *   node bench/bench.js [--duration=5] [--ports=2,16,64]
+ *     [--buffers=64,256,1024] [--styles=ports,arrays,...] [--rate=48000]
+ *     [--json] [--max-xruns=N] [--realtime]
+ *
+ * jackd is started without realtime scheduling by default (CI containers
+ * usually have no permissions for it), use --realtime to measure with it.
+ * With --max-xruns exits with code 1 if any configuration has more xruns
+ * (for CI).
+ *
+ * @author Viacheslav Lotsmanov
+ */
+
+var spawn = require('child_process').spawn;
+
+var options = {
+	duration: 5,
+	ports: [2, 16, 64],
+	buffers: [64, 256, 1024],
+	styles: ['ports', 'arrays', 'interleaved', 'ringBuffer', 'worker', 'dspGraph'],
+	rate: 48000,
+	json: false,
+	maxXruns: -1,
+	realtime: false
+};
+
+process.argv.slice(2).forEach(function (arg) {
+	var m = arg.match(/^--([a-z-]+)(?:=(.*))?$/);
+	if (!m) {
+		console.error('Unknown argument: ' + arg);
+		process.exit(1);
+	}
+	var list = function () { return m[2].split(',').map(Number); };
+	switch (m[1]) {
+		case 'duration': options.duration = Number(m[2]); break;
+		case 'ports': options.ports = list(); break;
+		case 'buffers': options.buffers = list(); break;
+		case 'styles': options.styles = m[2].split(','); break;
+		case 'rate': options.rate = Number(m[2]); break;
+		case 'json': options.json = true; break;
+		case 'max-xruns': options.maxXruns = Number(m[2]); break;
+		case 'realtime': options.realtime = true; break;
+		default:
+			console.error('Unknown argument: ' + arg);
+			process.exit(1);
+	}
+});
+
+var serverName = 'jack-connector-bench-' + process.pid;
+var results = [];
+
+function startServer(bufferSize) {
+	var args = options.realtime ? [] : ['--no-realtime'];
+	args = args.concat([
+		'-n', serverName,
+		'-d', 'dummy', '-r', String(options.rate), '-p', String(bufferSize)
+	]);
+	var jackd = spawn('jackd', args, { stdio: 'ignore' });
+	jackd.on('error', function (err) {
+		console.error('Couldn\'t start jackd: ' + err.message);
+		process.exit(1);
+	});
+	return jackd;
+}
+
+function runClient(config, attempt, callback) {
+	var env = Object.create(process.env);
+	env.JACK_DEFAULT_SERVER = serverName;
+	env.JACK_NO_START_SERVER = '1';
+
+	var child = spawn(process.execPath, [__dirname + '/client.js', JSON.stringify(config)], {
+		env: env,
+		stdio: ['ignore', 'pipe', 'inherit']
+	});
+	var out = '';
+	child.stdout.on('data', function (chunk) { out += chunk; });
+	child.on('exit', function (code) {
+		// server may be not ready yet
+		if (code === 2 && attempt < 20) {
+			setTimeout(function () { runClient(config, attempt + 1, callback); }, 250);
+			return;
+		}
+		if (code !== 0) return callback(new Error('Client exited with code ' + code));
+		callback(null, JSON.parse(out));
+	});
+}
+
+function pad(str, len) {
+	str = String(str);
+	while (str.length < len) str = ' ' + str;
+	return str;
+}
+
+function printHeader() {
+	console.log([
+		pad('buffer', 6), pad('ports', 5), pad('style', 11), pad('cycles/s', 9),
+		pad('of', 7), pad('xruns', 5), pad('skip', 5), pad('load%', 6),
+		pad('cyc p50', 8), pad('cyc p99', 8), pad('cyc max', 8),
+		pad('cb p99', 8), pad('wait p99', 8)
+	].join(' '));
+}
+
+function printResult(r) {
+	var s = r.stats;
+	console.log([
+		pad(r.buffer, 6), pad(r.ports, 5), pad(r.style, 11),
+		pad((s.cycles / options.duration).toFixed(1), 9),
+		pad((options.rate / r.buffer).toFixed(1), 7),
+		pad(s.xruns, 5), pad(s.skippedCycles, 5), pad(s.cpuLoad.toFixed(1), 6),
+		pad(s.cycle.p50.toFixed(1), 8), pad(s.cycle.p99.toFixed(1), 8),
+		pad(s.cycle.max.toFixed(1), 8), pad(s.callback.p99.toFixed(1), 8),
+		pad(s.wait.p99.toFixed(1), 8)
+	].join(' '));
+}
+
+// list of all configurations grouped by buffer size (one jackd per size)
+var queue = [];
+options.buffers.forEach(function (buffer) {
+	options.ports.forEach(function (ports) {
+		options.styles.forEach(function (style) {
+			queue.push({ buffer: buffer, ports: ports, style: style });
+		});
+	});
+});
+
+var jackd = null;
+var jackdBuffer = null;
+
+function stopServer(callback) {
+	if (!jackd) return callback();
+	jackd.on('exit', function () { jackd = null; callback(); });
+	jackd.kill('SIGTERM');
+}
+
+function finish() {
+	stopServer(function () {
+		if (options.json) console.log(JSON.stringify(results, null, '\t'));
+		var failed = options.maxXruns >= 0 && results.some(function (r) {
+			return r.stats.xruns > options.maxXruns;
+		});
+		process.exit(failed ? 1 : 0);
+	});
+}
+
+function next() {
+	var item = queue.shift();
+	if (!item) return finish();
+
+	if (jackdBuffer !== item.buffer) {
+		return stopServer(function () {
+			jackd = startServer(item.buffer);
+			jackdBuffer = item.buffer;
+			run(item);
+		});
+	}
+	run(item);
+}
+
+function run(item) {
+	var config = { ports: item.ports, style: item.style, duration: options.duration };
+	runClient(config, 0, function (err, stats) {
+		if (err) {
+			console.error(item.style + ' (' + item.ports + ' ports, buffer '
+				+ item.buffer + '): ' + err.message);
+			return stopServer(function () { process.exit(1); });
+		}
+		item.stats = stats;
+		results.push(item);
+		if (!options.json) printResult(item);
+		next();
+	});
+}
+
+process.on('SIGINT', function () {
+	stopServer(function () { process.exit(130); });
+});
+
+if (!options.json) printHeader();
+next();
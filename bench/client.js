@@ -0,0 +1,117 @@
+#!/usr/bin/env node
+
+/**
+ * Benchmark client, runs one configuration and prints stats as JSON
+ *
+ * Usage: client.js '{"ports":16,"style":"ports","duration":5}'
+ * It's started by bench.js with JACK_DEFAULT_SERVER of dummy jackd.
+ *
+ * @author Viacheslav Lotsmanov
+ */
+
+var jackConnector = require('../index.js');
+var config = JSON.parse(process.argv[2]);
+var clientName = 'jack-connector-bench';
+var gain = 0.5;
+var i;
+
+try {
+	jackConnector.openClientSync(clientName);
+} catch (err) {
+	// server is not started yet, runner retries
+	process.exit(2);
+}
+
+var inNames = [];
+var outNames = [];
+for (i=0; i<config.ports; i++) {
+	inNames.push('in_' + i);
+	outNames.push('out_' + i);
+	jackConnector.registerInPortSync(inNames[i]);
+	jackConnector.registerOutPortSync(outNames[i]);
+}
+
+function checkErr(err) {
+	if (err) {
+		console.error(err);
+		process.exit(1);
+	}
+}
+
+// every style does the same work: playback = capture * gain
+function processPorts(err, nframes, capture, playback) {
+	checkErr(err);
+	for (var p=0; p<inNames.length; p++) {
+		var inBuf = capture[inNames[p]];
+		var outBuf = playback[outNames[p]];
+		for (var n=0; n<nframes; n++) outBuf[n] = inBuf[n] * gain;
+	}
+	return playback;
+}
+
+var styles = {
+	ports: function () {
+		jackConnector.bindProcessSync(processPorts);
+	},
+	ringBuffer: function () {
+		jackConnector.bindProcessSync(processPorts, { ringBuffer: true });
+	},
+	arrays: function () {
+		jackConnector.bindProcessSync(function (err, nframes, capture) {
+			checkErr(err);
+			var ret = {};
+			for (var p=0; p<inNames.length; p++) {
+				var inBuf = capture[inNames[p]];
+				var outBuf = new Array(nframes);
+				for (var n=0; n<nframes; n++) outBuf[n] = inBuf[n] * gain;
+				ret[outNames[p]] = outBuf;
+			}
+			return ret;
+		});
+	},
+	interleaved: function () {
+		jackConnector.bindProcessSync(function (err, nframes, capture, playback) {
+			checkErr(err);
+			for (var n=0; n<capture.length; n++) playback[n] = capture[n] * gain;
+			return playback;
+		}, { layout: 'interleaved' });
+	},
+	worker: function () {
+		jackConnector.bindProcessSync(__dirname + '/worker.js');
+	},
+	dspGraph: function () {
+		for (var p=0; p<inNames.length; p++) {
+			var node = jackConnector.addDspNodeSync('gain', { gain: gain });
+			jackConnector.connectDspSync(inNames[p], node);
+			jackConnector.connectDspSync(node, outNames[p]);
+		}
+	}
+};
+
+if (!styles[config.style]) {
+	console.error('Unknown callback style: ' + config.style);
+	process.exit(1);
+}
+styles[config.style]();
+
+jackConnector.activateSync();
+
+// loop every own output port back to input, so buffers carry real data
+for (i=0; i<config.ports; i++) {
+	jackConnector.connectPortSync(
+		clientName + ':' + outNames[i], clientName + ':' + inNames[i]);
+}
+
+// skip warm-up (JIT, page faults) before measuring
+setTimeout(function () {
+	jackConnector.resetStatsSync();
+	setTimeout(function () {
+		var stats = jackConnector.getStatsSync();
+		jackConnector.deactivateSync();
+		jackConnector.closeClient(function (err) {
+			checkErr(err);
+			process.stdout.write(JSON.stringify(stats) + '\n');
+			process.exit(0);
+		});
+	}, config.duration * 1000);
+}, 500);
@@ -0,0 +1,15 @@
+/**
+ * Worker script of benchmark ("worker" style), see client.js
+ *
+ * @author Viacheslav Lotsmanov
+ */
+
+var gain = 0.5;
+
+function process(nframes, capture, playback) {
+	for (var name in capture) {
+		var inBuf = capture[name];
+		var outBuf = playback['out_' + name.substr(3)];
+		for (var n=0; n<nframes; n++) outBuf[n] = inBuf[n] * gain;
+	}
+}
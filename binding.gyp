@@ -2,8 +2,37 @@
     "targets": [
         {
             "target_name": "jack_connector",
-            "sources": [ "src/jack_connector.cc" ],
+            "sources": [
+                "src/jack_connector.cc",
+                "src/analyzer.cc",
+                "src/dsp_graph.cc",
+                "src/dsp_kernels.cc",
+                "src/dsp_pool.cc",
+                "src/meters.cc",
+                "src/notify_queue.cc",
+                "src/player.cc",
+                "src/port_graph.cc",
+                "src/recorder.cc",
+                "src/resampler.cc",
+                "src/rt_section.cc",
+                "src/stats.cc",
+                "src/stream.cc",
+                "src/transport.cc"
+            ],
             "libraries": [ "-ljack" ]
+        },
+        {
+            "target_name": "native_test",
+            "type": "executable",
+            "include_dirs": [ "src" ],
+            "sources": [
+                "test/native_test.cc",
+                "src/analyzer.cc",
+                "src/dsp_graph.cc",
+                "src/dsp_kernels.cc",
+                "src/player.cc"
+            ],
+            "libraries": [ "-ljack", "-lpthread" ]
         }
     ]
 }
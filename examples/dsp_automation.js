@@ -0,0 +1,59 @@
+#!/usr/bin/env node
+
+/**
+ * Sample-accurate DSP node automation demonstration
+ * (capture is faded out and in every two seconds, scheduled ahead of time)
+ *
+ * @author Viacheslav Lotsmanov
+ */
+
+var jackConnector = require('../index.js');
+var jackClientName = 'JACK connector - DSP automation example';
+
+console.log('Opening JACK client...');
+jackConnector.openClientSync(jackClientName);
+
+console.log('Registering JACK ports...');
+jackConnector.registerInPortSync('in');
+jackConnector.registerOutPortSync('out');
+
+console.log('Building DSP graph...');
+var gain = jackConnector.addDspNodeSync('gain', { gain: 1 });
+jackConnector.connectDspSync('in', gain);
+jackConnector.connectDspSync(gain, 'out');
+
+console.log('Activating JACK client...');
+jackConnector.activateSync();
+
+console.log('Auto-connecting to hardware ports...');
+jackConnector.connectPortSync('system:capture_1', jackClientName + ':in');
+jackConnector.connectPortSync(jackClientName + ':out', 'system:playback_1');
+jackConnector.connectPortSync(jackClientName + ':out', 'system:playback_2');
+
+var rate = jackConnector.getSampleRateSync();
+// schedule one second ahead, so JS timers jitter doesn't matter
+var next = (jackConnector.getFrameTimeSync() + rate) >>> 0;
+
+(function mainLoop() {
+	jackConnector.automateDspNodeSync(gain, 'exponential', 0.01, next, rate / 2);
+	jackConnector.automateDspNodeSync(gain, 'set', 0, (next + rate / 2) >>> 0);
+	jackConnector.automateDspNodeSync(gain, 'linear', 1, (next + rate) >>> 0, rate / 2);
+	next = (next + rate * 2) >>> 0;
+	setTimeout(mainLoop, 2000);
+})();
+
+process.on('SIGTERM', function () {
+	console.log('Deactivating JACK client...');
+	jackConnector.deactivateSync();
+	console.log('Closing JACK client...');
+	jackConnector.closeClient(function (err) {
+		if (err) {
+			console.error(err);
+			process.exit(1);
+			return;
+		}
+
+		console.log('Exiting...');
+		process.exit(0);
+	});
+});
@@ -0,0 +1,50 @@
+#!/usr/bin/env node
+
+/**
+ * Native DSP graph on several realtime threads demonstration
+ * (many independent channels of gain and delay)
+ *
+ * @author Viacheslav Lotsmanov
+ */
+
+var jackConnector = require('../index.js');
+var jackClientName = 'JACK connector - DSP threads example';
+var channels = 64;
+
+console.log('Opening JACK client...');
+jackConnector.openClientSync(jackClientName);
+
+console.log('Registering JACK ports and building DSP graph...');
+for (var i = 0; i < channels; i++) {
+	jackConnector.registerInPortSync('in_' + i);
+	jackConnector.registerOutPortSync('out_' + i);
+
+	// every channel is independent group
+	var gain = jackConnector.addDspNodeSync('gain', { gain: 0.8 });
+	var delay = jackConnector.addDspNodeSync('delay', { frames: 100 + i });
+	jackConnector.connectDspSync('in_' + i, gain);
+	jackConnector.connectDspSync(gain, delay);
+	jackConnector.connectDspSync(delay, 'out_' + i);
+}
+
+console.log('Starting DSP threads...');
+jackConnector.setDspThreadsSync(3, { cpus: [1, 2, 3] });
+
+console.log('Activating JACK client...');
+jackConnector.activateSync();
+
+process.on('SIGTERM', function () {
+	console.log('Deactivating JACK client...');
+	jackConnector.deactivateSync();
+	console.log('Closing JACK client...');
+	jackConnector.closeClient(function (err) {
+		if (err) {
+			console.error(err);
+			process.exit(1);
+			return;
+		}
+
+		console.log('Exiting...');
+		process.exit(0);
+	});
+});
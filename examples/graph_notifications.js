@@ -0,0 +1,74 @@
+#!/usr/bin/env node
+
+/**
+ * JACK graph notifications demonstration
+ *
+ * Prints every change of JACK graph (clients, ports, connections),
+ * bursts of changes come as one batch.
+ *
+ * @author Viacheslav Lotsmanov
+ */
+
+var jackConnector = require('../index.js');
+var jackClientName = 'JACK connector - graph notifications example';
+
+console.log('Opening JACK client...');
+jackConnector.openClientSync(jackClientName);
+
+console.log('Binding notifications callback...');
+jackConnector.bindNotificationsSync(function (events) {
+	console.log('Batch of ' + events.length + ' events:');
+	events.forEach(function (e) {
+		switch (e.type) {
+		case 'clientRegistered':
+		case 'clientUnregistered':
+			console.log('  ' + e.type + ': ' + e.client);
+			break;
+		case 'portRegistered':
+		case 'portUnregistered':
+			console.log('  ' + e.type + ': ' + e.port);
+			break;
+		case 'portRenamed':
+			console.log('  ' + e.type + ': ' + e.oldName + ' -> ' + e.port);
+			break;
+		case 'connected':
+		case 'disconnected':
+			console.log('  ' + e.type + ': ' + e.source + ' -> ' + e.destination);
+			break;
+		case 'xrun':
+			console.log('  ' + e.count + ' xrun(s), max delay ' + e.maxDelay + ' us');
+			break;
+		case 'overflow':
+			console.log('  ' + e.lost + ' events lost, rereading ports');
+			console.log(jackConnector.getAllPortsSync());
+			break;
+		default:
+			console.log('  ' + e.type + ':', e);
+		}
+	});
+});
+
+console.log('Activating JACK client...');
+jackConnector.activateSync();
+
+(function mainLoop() {
+	console.log('Main loop is started.');
+	setTimeout(mainLoop, 1000000000);
+})();
+
+process.on('SIGTERM', function () {
+	jackConnector.unbindNotificationsSync();
+	console.log('Deactivating JACK client...');
+	jackConnector.deactivateSync();
+	console.log('Closing JACK client...');
+	jackConnector.closeClient(function (err) {
+		if (err) {
+			console.error(err);
+			process.exit(1);
+			return;
+		}
+
+		console.log('Exiting...');
+		process.exit(0);
+	});
+});
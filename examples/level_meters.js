@@ -0,0 +1,61 @@
+#!/usr/bin/env node
+
+/**
+ * Native level meters demonstration (prints levels of capture ports)
+ *
+ * @author Viacheslav Lotsmanov
+ */
+
+var jackConnector = require('../index.js');
+var jackClientName = 'JACK connector - level meters example';
+
+console.log('Opening JACK client...');
+jackConnector.openClientSync(jackClientName);
+
+console.log('Registering JACK ports...');
+jackConnector.registerInPortSync('in_l');
+jackConnector.registerInPortSync('in_r');
+
+console.log('Enabling meters...');
+jackConnector.enableMetersSync({ truePeak: true, holdTime: 2 });
+
+console.log('Activating JACK client...');
+jackConnector.activateSync();
+
+console.log('Auto-connecting to hardware ports...');
+jackConnector.connectPortSync('system:capture_1', jackClientName + ':in_l');
+jackConnector.connectPortSync('system:capture_2', jackClientName + ':in_r');
+
+function dB(level) {
+	if (level <= 0) return '-inf';
+	return (20 * Math.log(level) / Math.LN10).toFixed(1);
+}
+
+(function mainLoop() {
+	var meters = jackConnector.getMetersSync();
+	var line = [];
+	Object.keys(meters).forEach(function (port) {
+		var m = meters[port];
+		line.push(port + ': peak ' + dB(m.peak) + ' hold ' + dB(m.peakHold)
+			+ ' rms ' + dB(m.rms) + ' true ' + dB(m.truePeak));
+	});
+	console.log(line.join(' | '));
+	setTimeout(mainLoop, 1000 / 30);
+})();
+
+process.on('SIGTERM', function () {
+	jackConnector.disableMetersSync();
+	console.log('Deactivating JACK client...');
+	jackConnector.deactivateSync();
+	console.log('Closing JACK client...');
+	jackConnector.closeClient(function (err) {
+		if (err) {
+			console.error(err);
+			process.exit(1);
+			return;
+		}
+
+		console.log('Exiting...');
+		process.exit(0);
+	});
+});
@@ -0,0 +1,90 @@
+#!/usr/bin/env node
+
+/**
+ * Multiple JACK clients in one process demonstration
+ *
+ * Module itself is first client (noise generator),
+ * JackClient instance is second one (forwards its input to output).
+ * Every client has its own ports and own "process" callback.
+ *
+ * @author Viacheslav Lotsmanov
+ */
+
+var jackConnector = require('../index.js');
+var generatorName = 'JACK connector - generator';
+var forwarderName = 'JACK connector - forwarder';
+
+console.log('Opening JACK clients...');
+jackConnector.openClientSync(generatorName);
+var forwarder = new jackConnector.JackClient();
+forwarder.openClientSync(forwarderName);
+
+console.log('Registering JACK ports...');
+jackConnector.registerOutPortSync('out');
+forwarder.registerInPortSync('in');
+forwarder.registerOutPortSync('out');
+
+function generatorProcess(err, nframes) {
+	if (err) {
+		console.error(err);
+		process.exit(1);
+		return;
+	}
+
+	var out = new Float32Array(nframes);
+	for (var i=0; i<nframes; i++) out[i] = ((Math.random() * 2) - 1) * 0.1;
+	return { out: out };
+}
+
+function forwarderProcess(err, nframes, capture) {
+	if (err) {
+		console.error(err);
+		process.exit(1);
+		return;
+	}
+
+	return { out: capture.in };
+}
+
+console.log('Binding process callbacks...');
+jackConnector.bindProcessSync(generatorProcess);
+forwarder.bindProcessSync(forwarderProcess);
+
+console.log('Activating JACK clients...');
+jackConnector.activateSync();
+forwarder.activateSync();
+
+console.log('Connecting ports...');
+jackConnector.connectPortSync(generatorName + ':out', forwarderName + ':in');
+forwarder.connectPortSync(forwarderName + ':out', 'system:playback_1');
+forwarder.connectPortSync(forwarderName + ':out', 'system:playback_2');
+
+(function mainLoop() {
+	console.log('Main loop is started.');
+	setTimeout(mainLoop, 1000000000);
+})();
+
+process.on('SIGTERM', function () {
+	console.log('Deactivating JACK clients...');
+	forwarder.deactivateSync();
+	jackConnector.deactivateSync();
+	console.log('Closing JACK clients...');
+	forwarder.closeClient(function (err) {
+		if (err) {
+			console.error(err);
+			process.exit(1);
+			return;
+		}
+
+		jackConnector.closeClient(function (err) {
+			if (err) {
+				console.error(err);
+				process.exit(1);
+				return;
+			}
+
+			console.log('Exiting...');
+			process.exit(0);
+		});
+	});
+});
@@ -0,0 +1,71 @@
+#!/usr/bin/env node
+
+/**
+ * Native DSP graph demonstration (capture is panned and mixed with delayed copy)
+ *
+ * @author Viacheslav Lotsmanov
+ */
+
+var jackConnector = require('../index.js');
+var jackClientName = 'JACK connector - native DSP graph example';
+
+console.log('Opening JACK client...');
+jackConnector.openClientSync(jackClientName);
+
+console.log('Registering JACK ports...');
+jackConnector.registerInPortSync('in');
+jackConnector.registerOutPortSync('out_l');
+jackConnector.registerOutPortSync('out_r');
+
+console.log('Building DSP graph...');
+var gain = jackConnector.addDspNodeSync('gain', { gain: 0.7 });
+var delay = jackConnector.addDspNodeSync('delay', { frames: 12000 });
+var echo = jackConnector.addDspNodeSync('gain', { gain: 0.3 });
+var mix = jackConnector.addDspNodeSync('mix');
+var pan = jackConnector.addDspNodeSync('pan', { pan: 0 });
+
+jackConnector.connectDspSync('in', gain);
+jackConnector.connectDspSync('in', delay);
+jackConnector.connectDspSync(delay, echo);
+jackConnector.connectDspSync(gain, mix);
+jackConnector.connectDspSync(echo, mix);
+jackConnector.connectDspSync(mix, pan);
+jackConnector.connectDspSync([pan, 0], 'out_l');
+jackConnector.connectDspSync([pan, 1], 'out_r');
+
+console.log('Activating JACK client...');
+jackConnector.activateSync();
+
+console.log('Auto-connecting to hardware ports...');
+jackConnector.connectPortSync('system:capture_1', jackClientName + ':in');
+jackConnector.connectPortSync(jackClientName + ':out_l', 'system:playback_1');
+jackConnector.connectPortSync(jackClientName + ':out_r', 'system:playback_2');
+
+var panPosition = 0;
+var panStep = 0.05;
+
+(function mainLoop() {
+	panPosition += panStep;
+	if (panPosition > 1 || panPosition < -1) {
+		panStep = -panStep;
+		panPosition += panStep * 2;
+	}
+	jackConnector.setDspNodeParamSync(pan, panPosition);
+	setTimeout(mainLoop, 50);
+})();
+
+process.on('SIGTERM', function () {
+	console.log('Deactivating JACK client...');
+	jackConnector.deactivateSync();
+	console.log('Closing JACK client...');
+	jackConnector.closeClient(function (err) {
+		if (err) {
+			console.error(err);
+			process.exit(1);
+			return;
+		}
+
+		console.log('Exiting...');
+		process.exit(0);
+	});
+});
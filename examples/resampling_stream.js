@@ -0,0 +1,75 @@
+#!/usr/bin/env node
+
+/**
+ * Resampling stream demonstration
+ * (44.1 kHz sine generated by JS timer clock is played on JACK ports)
+ *
+ * @author Viacheslav Lotsmanov
+ */
+
+var jackConnector = require('../index.js');
+var jackClientName = 'JACK connector - resampling stream example';
+var sampleRate = 44100;
+var packetFrames = 882; // 20 ms, like network packet
+
+console.log('Opening JACK client...');
+jackConnector.openClientSync(jackClientName);
+
+console.log('Registering JACK ports...');
+jackConnector.registerOutPortSync('out_l');
+jackConnector.registerOutPortSync('out_r');
+
+console.log('Activating JACK client...');
+jackConnector.activateSync();
+
+console.log('Auto-connecting to hardware ports...');
+jackConnector.connectPortSync(jackClientName + ':out_l', 'system:playback_1');
+jackConnector.connectPortSync(jackClientName + ':out_r', 'system:playback_2');
+
+var stream = jackConnector.createStreamSync('playback', ['out_l', 'out_r'], {
+	sampleRate: sampleRate,
+	latency: 0.2
+});
+
+var phase = 0;
+var started = Date.now();
+var sent = 0;
+
+// packets is sent by wall clock, so average rate is
+// 44100 Hz of this clock, not of JACK sound card
+(function mainLoop() {
+	var due = Math.floor((Date.now() - started) / 1000 * sampleRate);
+	while (sent + packetFrames <= due) {
+		var packet = new Float32Array(packetFrames);
+		for (var i = 0; i < packetFrames; i++) {
+			packet[i] = Math.sin(phase) * 0.3;
+			phase += 2 * Math.PI * 440 / sampleRate;
+		}
+		jackConnector.writeStreamSync(stream, [packet, packet]);
+		sent += packetFrames;
+	}
+	setTimeout(mainLoop, 5);
+})();
+
+setInterval(function () {
+	var status = jackConnector.getStreamStatusSync(stream);
+	console.log('fill: %d/%d frames, drift: %d ppm, underruns: %d',
+		Math.round(status.fill), status.latency,
+		Math.round(status.drift * 1e6), status.underruns);
+}, 5000);
+
+process.on('SIGTERM', function () {
+	console.log('Deactivating JACK client...');
+	jackConnector.deactivateSync();
+	console.log('Closing JACK client...');
+	jackConnector.closeClient(function (err) {
+		if (err) {
+			console.error(err);
+			process.exit(1);
+			return;
+		}
+
+		console.log('Exiting...');
+		process.exit(0);
+	});
+});
@@ -0,0 +1,65 @@
+#!/usr/bin/env node
+
+/**
+ * Native spectrum analyzer demonstration (prints loudest frequency of capture port)
+ *
+ * @author Viacheslav Lotsmanov
+ */
+
+var jackConnector = require('../index.js');
+var jackClientName = 'JACK connector - spectrum analyzer example';
+
+console.log('Opening JACK client...');
+jackConnector.openClientSync(jackClientName);
+
+console.log('Registering JACK port...');
+jackConnector.registerInPortSync('in_1');
+
+console.log('Creating analyzer...');
+var analyzer = jackConnector.createAnalyzerSync(['in_1'], {
+	size: 4096,
+	overlap: 0.75,
+	averaging: 0.5
+});
+
+console.log('Activating JACK client...');
+jackConnector.activateSync();
+
+console.log('Auto-connecting to hardware port...');
+jackConnector.connectPortSync('system:capture_1', jackClientName + ':in_1');
+
+var lastCount = 0;
+
+(function mainLoop() {
+	var frame = jackConnector.getAnalyzerFrameSync(analyzer);
+	if (frame.count !== lastCount) {
+		lastCount = frame.count;
+		var bins = frame.spectra[0];
+		var loudest = 1;
+		for (var k = 2; k < bins.length; k++) {
+			if (bins[k] > bins[loudest]) loudest = k;
+		}
+		var level = bins[loudest] > 0
+			? (20 * Math.log(bins[loudest]) / Math.LN10).toFixed(1) : '-inf';
+		console.log('loudest: ' + Math.round(loudest * frame.sampleRate / frame.size)
+			+ ' Hz, ' + level + ' dBFS (overruns: ' + frame.overruns + ')');
+	}
+	setTimeout(mainLoop, 1000 / 20);
+})();
+
+process.on('SIGTERM', function () {
+	jackConnector.destroyAnalyzerSync(analyzer);
+	console.log('Deactivating JACK client...');
+	jackConnector.deactivateSync();
+	console.log('Closing JACK client...');
+	jackConnector.closeClient(function (err) {
+		if (err) {
+			console.error(err);
+			process.exit(1);
+			return;
+		}
+
+		console.log('Exiting...');
+		process.exit(0);
+	});
+});
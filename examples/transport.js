@@ -0,0 +1,89 @@
+#!/usr/bin/env node
+
+/**
+ * Transport and timebase master demonstration (metronome clicks on beats)
+ *
+ * @author Viacheslav Lotsmanov
+ */
+
+var jackConnector = require('../index.js');
+var jackClientName = 'JACK connector - transport example';
+
+console.log('Opening JACK client...');
+jackConnector.openClientSync(jackClientName);
+
+console.log('Registering JACK port...');
+jackConnector.registerOutPortSync('click');
+
+console.log('Becoming timebase master...');
+jackConnector.setTimebaseMasterSync({ bpm: 100, beatsPerBar: 4 });
+
+var clickLeft = 0; // frames of click left to write
+
+function processCallback(err, nframes, capture, playback, midiIn, midiOut, transport) {
+	if (err) {
+		console.error(err);
+		process.exit(1);
+		return;
+	}
+
+	var buf = playback.click;
+	var bbt = transport.bbt;
+	var nextBeat = nframes; // offset of next beat in this cycle
+
+	// position is of first frame of the cycle, find where next beat starts
+	if (transport.state === 'rolling' && bbt) {
+		var framesPerTick = transport.frameRate * 60 / (bbt.bpm * bbt.ticksPerBeat);
+		nextBeat = bbt.tick === 0 ? 0
+			: Math.round((bbt.ticksPerBeat - bbt.tick) * framesPerTick);
+	}
+
+	for (var i=0; i<nframes; i++) {
+		if (i === nextBeat) clickLeft = 400;
+		buf[i] = clickLeft-- > 0 ? 0.5 : 0;
+	}
+
+	return playback;
+}
+
+console.log('Binding process callback...');
+jackConnector.bindProcessSync(processCallback);
+
+console.log('Activating JACK client...');
+jackConnector.activateSync();
+
+console.log('Auto-connecting to hardware ports...');
+jackConnector.connectPortSync(jackClientName + ':click', 'system:playback_1');
+jackConnector.connectPortSync(jackClientName + ':click', 'system:playback_2');
+
+console.log('Starting transport...');
+jackConnector.locateTransportSync(0);
+jackConnector.startTransportSync();
+
+(function mainLoop() {
+	var transport = jackConnector.getTransportSync();
+	if (transport.bbt) {
+		console.log(transport.state + ' ' + transport.bbt.bar + '|'
+			+ transport.bbt.beat + '|' + transport.bbt.tick
+			+ ' (frame ' + transport.frame + ')');
+	}
+	setTimeout(mainLoop, 500);
+})();
+
+process.on('SIGTERM', function () {
+	jackConnector.stopTransportSync();
+	jackConnector.releaseTimebaseSync();
+	console.log('Deactivating JACK client...');
+	jackConnector.deactivateSync();
+	console.log('Closing JACK client...');
+	jackConnector.closeClient(function (err) {
+		if (err) {
+			console.error(err);
+			process.exit(1);
+			return;
+		}
+
+		console.log('Exiting...');
+		process.exit(0);
+	});
+});
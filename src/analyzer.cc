@@ -0,0 +1,424 @@
+/**
+ * JACK Connector
+ * Spectrum analyzer, RT thread pushes frames to ring, analysis thread does FFT
+ *
+ * RT thread only interleaves own ports buffers to lock-free ring.
+ * Analysis thread collects windows of "size" frames with "hop" step,
+ * applies window function and real FFT (packed to complex FFT of half size),
+ * averages magnitudes and publishes them through two snapshots with
+ * sequence numbers, same way as level meters.
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "analyzer.h"
+#include "dsp_kernels.h"
+#include <math.h>
+#include <string.h>
+
+#define ANALYZER_READ_TRIES 16
+
+// FFT {{{1
+
+/**
+ * In-place radix-2 complex FFT of size / 2 points
+ *
+ * @private
+ */
+static void analyzer_fft(analyzer_t *analyzer) // {{{2
+{
+    uint32_t m = analyzer->size / 2;
+    float *re = analyzer->fft_re;
+    float *im = analyzer->fft_im;
+
+    for (uint32_t i=0; i<m; i++) {
+        uint32_t j = analyzer->bitrev[i];
+        if (j > i) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (uint32_t len=2; len<=m; len<<=1) {
+        uint32_t half = len / 2;
+        uint32_t step = m / len;
+        for (uint32_t i=0; i<m; i+=len) {
+            for (uint32_t j=0; j<half; j++) {
+                float w_re = analyzer->fft_twiddle_re[j * step];
+                float w_im = analyzer->fft_twiddle_im[j * step];
+                uint32_t a = i + j;
+                uint32_t b = a + half;
+                float v_re = re[b] * w_re - im[b] * w_im;
+                float v_im = re[b] * w_im + im[b] * w_re;
+                re[b] = re[a] - v_re;
+                im[b] = im[a] - v_im;
+                re[a] += v_re;
+                im[a] += v_im;
+            }
+        }
+    }
+} // analyzer_fft() }}}2
+
+/**
+ * Windowed real FFT of one channel, magnitudes is averaged to "dst"
+ *
+ * @private
+ */
+static void analyzer_spectrum(analyzer_t *analyzer, const float *input, float *dst) // {{{2
+{
+    uint32_t m = analyzer->size / 2;
+
+    // even samples to real part, odd samples to imaginary part
+    for (uint32_t i=0; i<m; i++) {
+        analyzer->fft_re[i] = input[2 * i] * analyzer->window[2 * i];
+        analyzer->fft_im[i] = input[2 * i + 1] * analyzer->window[2 * i + 1];
+    }
+
+    analyzer_fft(analyzer);
+
+    float keep = analyzer->averaging;
+    for (uint32_t k=0; k<=m; k++) {
+        uint32_t a = k == m ? 0 : k;
+        uint32_t b = k == 0 ? 0 : m - k;
+        float e_re = (analyzer->fft_re[a] + analyzer->fft_re[b]) / 2;
+        float e_im = (analyzer->fft_im[a] - analyzer->fft_im[b]) / 2;
+        float o_re = (analyzer->fft_im[a] + analyzer->fft_im[b]) / 2;
+        float o_im = (analyzer->fft_re[b] - analyzer->fft_re[a]) / 2;
+        float w_re = analyzer->real_twiddle_re[k];
+        float w_im = analyzer->real_twiddle_im[k];
+        float x_re = e_re + o_re * w_re - o_im * w_im;
+        float x_im = e_im + o_re * w_im + o_im * w_re;
+
+        float magnitude = sqrtf(x_re * x_re + x_im * x_im) * analyzer->scale;
+        if (k == 0 || k == m) magnitude /= 2; // DC and Nyquist have no mirrored half
+        dst[k] = dst[k] * keep + magnitude * (1 - keep);
+    }
+} // analyzer_spectrum() }}}2
+
+// FFT }}}1
+
+// analysis thread {{{1
+
+/**
+ * Compute spectra of all channels and publish them
+ *
+ * @private
+ */
+static void analyzer_publish(analyzer_t *analyzer) // {{{2
+{
+    for (uint32_t c=0; c<analyzer->channels; c++) {
+        analyzer_spectrum(analyzer, analyzer->inputs[c],
+            analyzer->averaged + c * analyzer->bins_count);
+    }
+
+    analyzer_snapshot_t *snapshot = &analyzer->snapshots[analyzer->published ^ 1];
+    snapshot->sequence++; // odd
+    __sync_synchronize();
+    memcpy(snapshot->bins, analyzer->averaged,
+        analyzer->channels * analyzer->bins_count * sizeof(float));
+    __sync_synchronize();
+    snapshot->sequence++; // even
+    analyzer->published ^= 1;
+    analyzer->spectra_count++;
+} // analyzer_publish() }}}2
+
+/**
+ * Take frames from ring, run FFT every "hop" frames
+ *
+ * @private
+ */
+static void analyzer_drain(analyzer_t *analyzer) // {{{2
+{
+    size_t frame_size = analyzer->channels * sizeof(jack_default_audio_sample_t);
+
+    for (;;) {
+        uint32_t available = jack_ringbuffer_read_space(analyzer->ring) / frame_size;
+        if (available == 0) return;
+
+        uint32_t frames = analyzer->size - analyzer->input_fill;
+        if (frames > available) frames = available;
+
+        jack_ringbuffer_read(analyzer->ring, (char *)analyzer->read_buf, frames * frame_size);
+        for (uint32_t c=0; c<analyzer->channels; c++)
+            analyzer->input_ptrs[c] = analyzer->inputs[c] + analyzer->input_fill;
+        dsp_kernels.deinterleave(analyzer->input_ptrs, analyzer->read_buf, analyzer->channels, frames);
+        analyzer->input_fill += frames;
+
+        if (analyzer->input_fill < analyzer->size) continue;
+
+        analyzer_publish(analyzer);
+
+        // keep overlapping part for next window
+        uint32_t keep = analyzer->size - analyzer->hop;
+        for (uint32_t c=0; c<analyzer->channels; c++) {
+            memmove(analyzer->inputs[c], analyzer->inputs[c] + analyzer->hop,
+                keep * sizeof(float));
+        }
+        analyzer->input_fill = keep;
+    }
+} // analyzer_drain() }}}2
+
+static void analyzer_thread_main(void *arg) // {{{2
+{
+    analyzer_t *analyzer = (analyzer_t *)arg;
+
+    for (;;) {
+        uv_sem_wait(&analyzer->wakeup);
+        if (analyzer->stop) break;
+        analyzer_drain(analyzer);
+    }
+} // analyzer_thread_main() }}}2
+
+// analysis thread }}}1
+
+/**
+ * Create ring for frames of two windows and few periods
+ * (analysis thread may be late)
+ *
+ * @private
+ */
+static jack_ringbuffer_t* analyzer_ring_create( // {{{1
+    uint32_t channels,
+    uint32_t size,
+    jack_nframes_t max_frames)
+{
+    size_t frame_size = channels * sizeof(jack_default_audio_sample_t);
+    size_t ring_frames = 2 * (size_t)size + 4 * (size_t)max_frames;
+    jack_ringbuffer_t *ring = jack_ringbuffer_create(ring_frames * frame_size);
+    jack_ringbuffer_mlock(ring);
+    return ring;
+} // analyzer_ring_create() }}}1
+
+/**
+ * Allocate analyzer and start analysis thread
+ *
+ * @param {uint32_t} channels
+ * @param {uint32_t} size FFT size, power of 2 (ANALYZER_MIN_SIZE..ANALYZER_MAX_SIZE)
+ * @param {float} overlap Part of window shared with previous one (0..0.95)
+ * @param {float} averaging Weight of previous magnitudes (0..0.99)
+ * @param {analyzer_window_t} window
+ * @param {jack_nframes_t} max_frames Max buffer size of JACK cycle
+ * @returns {analyzer_t} analyzer
+ */
+analyzer_t* analyzer_create( // {{{1
+    uint32_t channels,
+    uint32_t size,
+    float overlap,
+    float averaging,
+    analyzer_window_t window,
+    jack_nframes_t max_frames)
+{
+    analyzer_t *analyzer = new analyzer_t();
+    analyzer->channels = channels;
+    analyzer->size = size;
+    analyzer->hop = size * (1 - overlap);
+    if (analyzer->hop < 1) analyzer->hop = 1;
+    if (analyzer->hop > size) analyzer->hop = size;
+    analyzer->bins_count = size / 2 + 1;
+    analyzer->averaging = averaging;
+
+    analyzer->port_names = new char*[channels];
+    analyzer->port_outputs = new bool[channels];
+    for (uint32_t i=0; i<channels; i++) {
+        analyzer->port_names[i] = 0;
+        analyzer->port_outputs[i] = false;
+    }
+
+    analyzer->ring = analyzer_ring_create(channels, size, max_frames);
+
+    analyzer->max_frames = max_frames;
+    analyzer->frame_buf = new jack_default_audio_sample_t[max_frames * channels];
+    analyzer->channel_bufs = new jack_default_audio_sample_t*[channels];
+    analyzer->silence = new jack_default_audio_sample_t[max_frames];
+    memset(analyzer->silence, 0, max_frames * sizeof(jack_default_audio_sample_t));
+    analyzer->overruns = 0;
+
+    float window_sum = 0;
+    analyzer->window = new float[size];
+    for (uint32_t i=0; i<size; i++) {
+        double phase = 2 * M_PI * i / size; // periodic window
+        switch (window) {
+            case ANALYZER_WINDOW_HANN:
+                analyzer->window[i] = 0.5 - 0.5 * cos(phase);
+                break;
+            case ANALYZER_WINDOW_BLACKMAN:
+                analyzer->window[i] = 0.42 - 0.5 * cos(phase) + 0.08 * cos(2 * phase);
+                break;
+            default:
+                analyzer->window[i] = 1;
+        }
+        window_sum += analyzer->window[i];
+    }
+    analyzer->scale = 2 / window_sum;
+
+    analyzer->inputs = new float*[channels];
+    for (uint32_t c=0; c<channels; c++) analyzer->inputs[c] = new float[size];
+    analyzer->input_ptrs = new float*[channels];
+    analyzer->read_buf = new float[size * channels];
+    analyzer->input_fill = 0;
+
+    uint32_t m = size / 2;
+    analyzer->fft_re = new float[m];
+    analyzer->fft_im = new float[m];
+    analyzer->fft_twiddle_re = new float[m / 2];
+    analyzer->fft_twiddle_im = new float[m / 2];
+    for (uint32_t k=0; k<m/2; k++) {
+        analyzer->fft_twiddle_re[k] = cos(2 * M_PI * k / m);
+        analyzer->fft_twiddle_im[k] = -sin(2 * M_PI * k / m);
+    }
+    analyzer->real_twiddle_re = new float[m + 1];
+    analyzer->real_twiddle_im = new float[m + 1];
+    for (uint32_t k=0; k<=m; k++) {
+        analyzer->real_twiddle_re[k] = cos(2 * M_PI * k / size);
+        analyzer->real_twiddle_im[k] = -sin(2 * M_PI * k / size);
+    }
+    uint32_t bits = 0;
+    while ((1u << bits) < m) bits++;
+    analyzer->bitrev = new uint32_t[m];
+    for (uint32_t i=0; i<m; i++) {
+        uint32_t r = 0;
+        for (uint32_t b=0; b<bits; b++) if (i & (1u << b)) r |= 1u << (bits - 1 - b);
+        analyzer->bitrev[i] = r;
+    }
+
+    size_t bins_size = channels * analyzer->bins_count;
+    analyzer->averaged = new float[bins_size];
+    memset(analyzer->averaged, 0, bins_size * sizeof(float));
+    for (uint32_t i=0; i<2; i++) {
+        analyzer->snapshots[i].sequence = 0;
+        analyzer->snapshots[i].bins = new float[bins_size];
+        memset(analyzer->snapshots[i].bins, 0, bins_size * sizeof(float));
+    }
+    analyzer->published = 0;
+    analyzer->spectra_count = 0;
+
+    analyzer->stop = false;
+    uv_sem_init(&analyzer->wakeup, 0);
+    uv_thread_create(&analyzer->thread, analyzer_thread_main, analyzer);
+
+    return analyzer;
+} // analyzer_create() }}}1
+
+/**
+ * Push one cycle of frames (call it from RT thread only)
+ *
+ * @param {analyzer_t} analyzer
+ * @param {jack_default_audio_sample_t} bufs Channels buffers, 0 is silence
+ *   (it's modified, analyzer->channel_bufs may be used as storage)
+ * @param {jack_nframes_t} nframes
+ */
+void analyzer_push( // {{{1
+    analyzer_t *analyzer,
+    jack_default_audio_sample_t **bufs,
+    jack_nframes_t nframes)
+{
+    size_t size = nframes * analyzer->channels * sizeof(jack_default_audio_sample_t);
+
+    if (nframes > analyzer->max_frames || jack_ringbuffer_write_space(analyzer->ring) < size) {
+        __sync_fetch_and_add(&analyzer->overruns, 1);
+        return;
+    }
+
+    for (uint32_t i=0; i<analyzer->channels; i++) {
+        if (bufs[i] == 0) bufs[i] = analyzer->silence;
+    }
+    dsp_kernels.interleave(analyzer->frame_buf, bufs, analyzer->channels, nframes);
+    jack_ringbuffer_write(analyzer->ring, (const char *)analyzer->frame_buf, size);
+
+    uv_sem_post(&analyzer->wakeup);
+} // analyzer_push() }}}1
+
+/**
+ * Grow cycle buffers and ring for new JACK buffer size
+ *
+ * Call it while analyzer is detached from RT thread. Analysis thread is
+ * restarted with new ring, frames of old one is analyzed before.
+ *
+ * @param {analyzer_t} analyzer
+ * @param {jack_nframes_t} max_frames New max buffer size of JACK cycle
+ */
+void analyzer_reserve_frames(analyzer_t *analyzer, jack_nframes_t max_frames) // {{{1
+{
+    if (max_frames <= analyzer->max_frames) return;
+
+    analyzer->stop = true;
+    uv_sem_post(&analyzer->wakeup);
+    uv_thread_join(&analyzer->thread);
+    analyzer_drain(analyzer);
+    jack_ringbuffer_free(analyzer->ring);
+    analyzer->ring = analyzer_ring_create(analyzer->channels, analyzer->size, max_frames);
+    analyzer->stop = false;
+    uv_thread_create(&analyzer->thread, analyzer_thread_main, analyzer);
+
+    delete [] analyzer->frame_buf;
+    delete [] analyzer->silence;
+    analyzer->frame_buf = new jack_default_audio_sample_t[max_frames * analyzer->channels];
+    analyzer->silence = new jack_default_audio_sample_t[max_frames];
+    memset(analyzer->silence, 0, max_frames * sizeof(jack_default_audio_sample_t));
+    analyzer->max_frames = max_frames;
+} // analyzer_reserve_frames() }}}1
+
+/**
+ * Copy last published spectra
+ *
+ * Copy is retried if analysis thread started to rewrite it meanwhile.
+ *
+ * @param {analyzer_t} analyzer
+ * @param {float} dst Magnitudes of all channels one after another
+ */
+void analyzer_read(analyzer_t *analyzer, float *dst) // {{{1
+{
+    size_t size = analyzer->channels * analyzer->bins_count * sizeof(float);
+
+    for (uint32_t i=0; i<ANALYZER_READ_TRIES; i++) {
+        analyzer_snapshot_t *snapshot = &analyzer->snapshots[analyzer->published];
+        uint32_t sequence = snapshot->sequence;
+        if (sequence & 1) continue;
+        __sync_synchronize();
+        memcpy(dst, snapshot->bins, size);
+        __sync_synchronize();
+        if (snapshot->sequence == sequence) break;
+    }
+} // analyzer_read() }}}1
+
+/**
+ * Stop analysis thread and free analyzer
+ *
+ * @param {analyzer_t} analyzer
+ */
+void analyzer_destroy(analyzer_t *analyzer) // {{{1
+{
+    analyzer->stop = true;
+    uv_sem_post(&analyzer->wakeup);
+    uv_thread_join(&analyzer->thread);
+    uv_sem_destroy(&analyzer->wakeup);
+
+    jack_ringbuffer_free(analyzer->ring);
+    for (uint32_t i=0; i<analyzer->channels; i++) {
+        delete [] analyzer->port_names[i];
+        delete [] analyzer->inputs[i];
+    }
+    delete [] analyzer->port_names;
+    delete [] analyzer->port_outputs;
+    delete [] analyzer->frame_buf;
+    delete [] analyzer->channel_bufs;
+    delete [] analyzer->silence;
+    delete [] analyzer->window;
+    delete [] analyzer->inputs;
+    delete [] analyzer->input_ptrs;
+    delete [] analyzer->read_buf;
+    delete [] analyzer->fft_re;
+    delete [] analyzer->fft_im;
+    delete [] analyzer->fft_twiddle_re;
+    delete [] analyzer->fft_twiddle_im;
+    delete [] analyzer->real_twiddle_re;
+    delete [] analyzer->real_twiddle_im;
+    delete [] analyzer->bitrev;
+    delete [] analyzer->averaged;
+    delete [] analyzer->snapshots[0].bins;
+    delete [] analyzer->snapshots[1].bins;
+    delete analyzer;
+} // analyzer_destroy() }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,92 @@
+/**
+ * JACK Connector
+ * Spectrum analyzer, RT thread pushes frames to ring, analysis thread does FFT
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef ANALYZER_H
+#define ANALYZER_H
+
+#include <jack/jack.h>
+#include <jack/ringbuffer.h>
+#include <stdint.h>
+#include <uv.h>
+
+#define ANALYZER_MIN_SIZE 64
+#define ANALYZER_MAX_SIZE 65536
+
+typedef enum {
+    ANALYZER_WINDOW_HANN = 0,
+    ANALYZER_WINDOW_BLACKMAN,
+    ANALYZER_WINDOW_RECT
+} analyzer_window_t;
+
+typedef struct {
+    volatile uint32_t sequence; // odd while analysis thread writes it
+    float *bins; // channels * bins_count magnitudes
+} analyzer_snapshot_t;
+
+typedef struct {
+    uint32_t channels;
+    uint32_t size; // FFT size, power of 2
+    uint32_t hop; // frames between two FFTs (size * (1 - overlap))
+    uint32_t bins_count; // size / 2 + 1
+    float averaging; // 0 - no averaging, closer to 1 - slower
+
+    // set and read by owner (JS thread), RT thread gets ports resolved by names
+    char **port_names; // own ports short names
+    bool *port_outputs; // port is own output port
+
+    // RT thread side
+    jack_ringbuffer_t *ring; // interleaved frames
+    jack_default_audio_sample_t *frame_buf; // interleaving scratch
+    jack_default_audio_sample_t **channel_bufs;
+    jack_default_audio_sample_t *silence;
+    jack_nframes_t max_frames;
+    volatile uint32_t overruns; // periods dropped because ring is full
+
+    // analysis thread side
+    uv_thread_t thread;
+    uv_sem_t wakeup;
+    volatile bool stop;
+    float *window;
+    float scale; // full scale sine gives magnitude 1
+    float **inputs; // last "size" frames of every channel
+    float **input_ptrs; // deinterleaving destinations
+    float *read_buf; // interleaved frames from ring
+    uint32_t input_fill;
+    float *fft_re; // size / 2 complex work buffer
+    float *fft_im;
+    float *fft_twiddle_re; // size / 4 twiddles of complex FFT
+    float *fft_twiddle_im;
+    float *real_twiddle_re; // size / 2 + 1 twiddles of real FFT unpacking
+    float *real_twiddle_im;
+    uint32_t *bitrev;
+    float *averaged; // channels * bins_count
+
+    // published spectra
+    analyzer_snapshot_t snapshots[2];
+    volatile uint32_t published;
+    volatile uint32_t spectra_count; // count of computed spectra
+} analyzer_t;
+
+analyzer_t* analyzer_create(
+    uint32_t channels,
+    uint32_t size,
+    float overlap,
+    float averaging,
+    analyzer_window_t window,
+    jack_nframes_t max_frames);
+void analyzer_push( // call it from RT thread only
+    analyzer_t *analyzer,
+    jack_default_audio_sample_t **bufs,
+    jack_nframes_t nframes);
+void analyzer_reserve_frames(analyzer_t *analyzer, jack_nframes_t max_frames);
+void analyzer_read(analyzer_t *analyzer, float *dst); // channels * bins_count, never waits
+void analyzer_destroy(analyzer_t *analyzer);
+
+#endif // ANALYZER_H
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,868 @@
+/**
+ * JACK Connector
+ * Native DSP graph executed in JACK realtime thread
+ *
+ * Graph is edited in JS thread and compiled to flat program (steps in
+ * topological order with preallocated buffers). RT thread only runs compiled
+ * program, it never allocates and never touches graph definition.
+ * Steps that don't share buffers is compiled to independent groups,
+ * so groups may run on several threads (see dsp_pool.cc).
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "dsp_graph.h"
+#include "dsp_kernels.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+char* dsp_strdup(const char *str) // {{{1
+{
+    if (str == 0) return 0;
+    size_t len = strlen(str);
+    char *retval = new char[len + 1];
+    memcpy(retval, str, len + 1);
+    return retval;
+} // dsp_strdup() }}}1
+
+bool dsp_streq(const char *a, const char *b) // {{{1
+{
+    if (a == 0 || b == 0) return a == b;
+    return strcmp(a, b) == 0;
+} // dsp_streq() }}}1
+
+/**
+ * Grow array of any type by doubling its capacity
+ *
+ * @private
+ */
+template <typename T>
+void dsp_reserve(T *&arr, uint32_t size, uint32_t &capacity) // {{{1
+{
+    if (size < capacity) return;
+    uint32_t new_capacity = capacity ? capacity * 2 : 16;
+    T *new_arr = new T[new_capacity];
+    for (uint32_t i=0; i<size; i++) new_arr[i] = arr[i];
+    delete [] arr;
+    arr = new_arr;
+    capacity = new_capacity;
+} // dsp_reserve() }}}1
+
+// graph definition {{{1
+
+uint8_t dsp_node_outputs_count(dsp_node_type_t type) // {{{2
+{
+    return type == DSP_NODE_PAN ? 2 : 1;
+} // dsp_node_outputs_count() }}}2
+
+/**
+ * Add new node to graph
+ *
+ * @param {dsp_node_type_t} type
+ * @param {float} param Gain, pan position or constant value
+ * @param {uint32_t} delay_frames Delay of DSP_NODE_DELAY node
+ * @returns {int32_t} node_id
+ */
+int32_t dsp_graph_add_node( // {{{2
+    dsp_graph_t *graph,
+    dsp_node_type_t type,
+    float param,
+    uint32_t delay_frames)
+{
+    dsp_node_t *node = new dsp_node_t;
+    node->type = type;
+    node->param = param;
+    node->param_current = param;
+    node->delay_frames = type == DSP_NODE_DELAY ? delay_frames : 0;
+    node->delay_line = 0;
+    node->delay_pos = 0;
+    node->param_version = 0;
+    node->param_version_seen = 0;
+    node->automated = false;
+    node->events_count = 0;
+    node->ramp_left = 0;
+    if (node->delay_frames > 0) {
+        node->delay_line = new jack_default_audio_sample_t[node->delay_frames];
+        memset(node->delay_line, 0,
+            node->delay_frames * sizeof(jack_default_audio_sample_t));
+    }
+
+    dsp_reserve(graph->nodes, graph->nodes_size, graph->nodes_capacity);
+    graph->nodes[graph->nodes_size] = node;
+    return graph->nodes_size++;
+} // dsp_graph_add_node() }}}2
+
+bool dsp_graph_node_exists(dsp_graph_t *graph, int32_t id) // {{{2
+{
+    return id >= 0 && (uint32_t)id < graph->nodes_size && graph->nodes[id] != 0;
+} // dsp_graph_node_exists() }}}2
+
+/**
+ * Remove node and all its connections
+ *
+ * Node memory is freed by dsp_graph_collect_garbage() after new program
+ * is published to RT thread.
+ *
+ * @param {int32_t} id
+ * @returns {bool} false if there is no such node
+ */
+bool dsp_graph_remove_node(dsp_graph_t *graph, int32_t id) // {{{2
+{
+    if (!dsp_graph_node_exists(graph, id)) return false;
+
+    uint32_t n = 0;
+    for (uint32_t i=0; i<graph->edges_size; i++) {
+        dsp_edge_t *edge = &graph->edges[i];
+        if (edge->src.node == id || edge->dst.node == id) {
+            delete [] edge->src.port;
+            delete [] edge->dst.port;
+            continue;
+        }
+        graph->edges[n++] = *edge;
+    }
+    graph->edges_size = n;
+
+    dsp_reserve(graph->garbage, graph->garbage_size, graph->garbage_capacity);
+    graph->garbage[graph->garbage_size++] = graph->nodes[id];
+    graph->nodes[id] = 0;
+
+    return true;
+} // dsp_graph_remove_node() }}}2
+
+/**
+ * Set node parameter, RT thread picks it up on next cycle
+ * (gain, pan and constant values is smoothed across one period)
+ *
+ * @param {int32_t} id
+ * @param {float} value
+ * @returns {bool} false if there is no such node
+ */
+bool dsp_graph_set_param(dsp_graph_t *graph, int32_t id, float value) // {{{2
+{
+    if (!dsp_graph_node_exists(graph, id)) return false;
+    graph->nodes[id]->param = value;
+    __sync_fetch_and_add(&graph->nodes[id]->param_version, 1);
+    return true;
+} // dsp_graph_set_param() }}}2
+
+/**
+ * Check node has parameter to automate (gain, mix, pan and constant nodes)
+ *
+ * @param {int32_t} id
+ * @returns {bool}
+ */
+bool dsp_graph_node_automatable(dsp_graph_t *graph, int32_t id) // {{{2
+{
+    if (!dsp_graph_node_exists(graph, id)) return false;
+    dsp_node_type_t type = graph->nodes[id]->type;
+    return type != DSP_NODE_PASS && type != DSP_NODE_DELAY;
+} // dsp_graph_node_automatable() }}}2
+
+/**
+ * Post automation event to RT thread (JS thread is the only writer)
+ *
+ * @param {jack_ringbuffer_t} queue
+ * @param {dsp_automation_event_t} event
+ * @returns {bool} false if queue is full
+ */
+bool dsp_automation_post(jack_ringbuffer_t *queue, const dsp_automation_event_t *event) // {{{2
+{
+    if (jack_ringbuffer_write_space(queue) < sizeof(dsp_automation_event_t)) return false;
+    jack_ringbuffer_write(queue, (const char *)event, sizeof(dsp_automation_event_t));
+    return true;
+} // dsp_automation_post() }}}2
+
+bool dsp_graph_connect(dsp_graph_t *graph, dsp_source_t src, dsp_destination_t dst) // {{{2
+{
+    if (src.node != -1) {
+        if (!dsp_graph_node_exists(graph, src.node)) return false;
+        if (src.output >= dsp_node_outputs_count(graph->nodes[src.node]->type)) return false;
+    } else if (src.port == 0) return false;
+
+    if (dst.node != -1) {
+        if (!dsp_graph_node_exists(graph, dst.node)) return false;
+    } else if (dst.port == 0) return false;
+
+    for (uint32_t i=0; i<graph->edges_size; i++) {
+        dsp_edge_t *edge = &graph->edges[i];
+        if (edge->src.node == src.node && edge->src.output == src.output
+        && dsp_streq(edge->src.port, src.port)
+        && edge->dst.node == dst.node && dsp_streq(edge->dst.port, dst.port))
+            return true; // already connected
+    }
+
+    dsp_reserve(graph->edges, graph->edges_size, graph->edges_capacity);
+    dsp_edge_t *edge = &graph->edges[graph->edges_size++];
+    edge->src = src;
+    edge->src.port = dsp_strdup(src.port);
+    edge->dst = dst;
+    edge->dst.port = dsp_strdup(dst.port);
+
+    return true;
+} // dsp_graph_connect() }}}2
+
+bool dsp_graph_disconnect(dsp_graph_t *graph, dsp_source_t src, dsp_destination_t dst) // {{{2
+{
+    for (uint32_t i=0; i<graph->edges_size; i++) {
+        dsp_edge_t *edge = &graph->edges[i];
+        if (edge->src.node == src.node && edge->src.output == src.output
+        && dsp_streq(edge->src.port, src.port)
+        && edge->dst.node == dst.node && dsp_streq(edge->dst.port, dst.port)) {
+            delete [] edge->src.port;
+            delete [] edge->dst.port;
+            graph->edges[i] = graph->edges[--graph->edges_size];
+            return true;
+        }
+    }
+    return false;
+} // dsp_graph_disconnect() }}}2
+
+void dsp_graph_clear(dsp_graph_t *graph) // {{{2
+{
+    for (uint32_t i=0; i<graph->edges_size; i++) {
+        delete [] graph->edges[i].src.port;
+        delete [] graph->edges[i].dst.port;
+    }
+    graph->edges_size = 0;
+
+    for (uint32_t i=0; i<graph->nodes_size; i++) {
+        if (graph->nodes[i] != 0) dsp_graph_remove_node(graph, i);
+    }
+} // dsp_graph_clear() }}}2
+
+bool dsp_graph_is_empty(dsp_graph_t *graph) // {{{2
+{
+    return graph->edges_size == 0;
+} // dsp_graph_is_empty() }}}2
+
+/**
+ * Free removed nodes, call it only when RT thread can't use old program
+ */
+void dsp_graph_collect_garbage(dsp_graph_t *graph) // {{{2
+{
+    for (uint32_t i=0; i<graph->garbage_size; i++) {
+        delete [] graph->garbage[i]->delay_line;
+        delete graph->garbage[i];
+    }
+    graph->garbage_size = 0;
+} // dsp_graph_collect_garbage() }}}2
+
+/**
+ * Free graph definition, call it only when RT thread can't use its program
+ */
+void dsp_graph_destroy(dsp_graph_t *graph) // {{{2
+{
+    dsp_graph_clear(graph);
+    dsp_graph_collect_garbage(graph);
+
+    delete [] graph->nodes;
+    delete [] graph->edges;
+    delete [] graph->garbage;
+    graph->nodes = 0;
+    graph->nodes_size = 0;
+    graph->nodes_capacity = 0;
+    graph->edges = 0;
+    graph->edges_capacity = 0;
+    graph->garbage = 0;
+    graph->garbage_capacity = 0;
+} // dsp_graph_destroy() }}}2
+
+// graph definition }}}1
+
+// compiling {{{1
+
+#define DSP_NO_GROUP ((uint32_t)-1)
+
+/**
+ * Root of node in disjoint set of connected nodes
+ *
+ * @private
+ */
+uint32_t dsp_find(uint32_t *root, uint32_t id) // {{{2
+{
+    while (root[id] != id) {
+        root[id] = root[root[id]];
+        id = root[id];
+    }
+    return id;
+} // dsp_find() }}}2
+
+void dsp_union(uint32_t *root, uint32_t a, uint32_t b) // {{{2
+{
+    a = dsp_find(root, a);
+    b = dsp_find(root, b);
+    if (a != b) root[b] = a;
+} // dsp_union() }}}2
+
+/**
+ * Compile graph definition to program for RT thread
+ *
+ * Connections to/from ports that is not registered yet are ignored,
+ * so graph must be recompiled after own ports list is changed.
+ *
+ * @param {dsp_port_resolver_t} resolver Own port name to index
+ * @param {uint32_t} in_ports_count Count of own input ports
+ * @param {jack_nframes_t} max_frames Max buffer size
+ * @param {dsp_program_t} program Compiled program (0 for empty graph)
+ * @returns {char} err Error message or 0
+ */
+const char* dsp_graph_compile( // {{{2
+    dsp_graph_t *graph,
+    dsp_port_resolver_t resolver,
+    uint32_t in_ports_count,
+    jack_nframes_t max_frames,
+    dsp_program_t **program)
+{
+    *program = 0;
+    if (dsp_graph_is_empty(graph)) return 0;
+
+    // buffers indexes of nodes outputs {{{3
+    uint32_t *out_base = new uint32_t[graph->nodes_size];
+    uint32_t bufs_count = 1 + in_ports_count; // zero buffer and own input ports
+    for (uint32_t i=0; i<graph->nodes_size; i++) {
+        out_base[i] = bufs_count;
+        if (graph->nodes[i] != 0) bufs_count += dsp_node_outputs_count(graph->nodes[i]->type);
+    }
+    // }}}3
+
+    // resolve sources of connections {{{3
+    int32_t *src_buf = new int32_t[graph->edges_size];
+    for (uint32_t i=0; i<graph->edges_size; i++) {
+        dsp_edge_t *edge = &graph->edges[i];
+        if (edge->src.node == -1) {
+            int32_t port = resolver(false, edge->src.port);
+            src_buf[i] = port == -1 ? -1 : 1 + port;
+        } else {
+            src_buf[i] = out_base[edge->src.node] + edge->src.output;
+        }
+    }
+    // }}}3
+
+    // topological sort (Kahn's algorithm) {{{3
+    uint32_t *in_degree = new uint32_t[graph->nodes_size];
+    uint32_t *order = new uint32_t[graph->nodes_size];
+    uint32_t order_size = 0, nodes_count = 0;
+    for (uint32_t i=0; i<graph->nodes_size; i++) in_degree[i] = 0;
+    for (uint32_t i=0; i<graph->edges_size; i++) {
+        if (graph->edges[i].src.node != -1 && graph->edges[i].dst.node != -1)
+            in_degree[graph->edges[i].dst.node]++;
+    }
+    for (uint32_t i=0; i<graph->nodes_size; i++) {
+        if (graph->nodes[i] == 0) continue;
+        nodes_count++;
+        if (in_degree[i] == 0) order[order_size++] = i;
+    }
+    for (uint32_t n=0; n<order_size; n++) {
+        for (uint32_t i=0; i<graph->edges_size; i++) {
+            dsp_edge_t *edge = &graph->edges[i];
+            if ((uint32_t)edge->src.node != order[n] || edge->dst.node == -1) continue;
+            if (--in_degree[edge->dst.node] == 0) order[order_size++] = edge->dst.node;
+        }
+    }
+    delete [] in_degree;
+    if (order_size != nodes_count) {
+        delete [] out_base;
+        delete [] src_buf;
+        delete [] order;
+        return "DSP graph must not have cycles";
+    }
+    // }}}3
+
+    // resolve own output ports of connections {{{3
+    int32_t *dst_port = new int32_t[graph->edges_size];
+    for (uint32_t i=0; i<graph->edges_size; i++) {
+        dst_port[i] = graph->edges[i].dst.node == -1 && src_buf[i] != -1
+            ? resolver(true, graph->edges[i].dst.port) : -1;
+    }
+    // }}}3
+
+    // independent groups {{{3
+    // nodes connected to each other or to the same own output port
+    // is in the same group, own input ports is only read so they're shared
+    uint32_t *root = new uint32_t[graph->nodes_size];
+    for (uint32_t i=0; i<graph->nodes_size; i++) root[i] = i;
+    for (uint32_t i=0; i<graph->edges_size; i++) {
+        dsp_edge_t *edge = &graph->edges[i];
+        if (edge->src.node == -1) continue;
+        if (edge->dst.node != -1) {
+            dsp_union(root, edge->src.node, edge->dst.node);
+            continue;
+        }
+        if (dst_port[i] == -1) continue;
+        for (uint32_t n=0; n<i; n++) {
+            if (dst_port[n] == dst_port[i] && graph->edges[n].src.node != -1) {
+                dsp_union(root, edge->src.node, graph->edges[n].src.node);
+                break;
+            }
+        }
+    }
+
+    // groups is numbered in order of their first node in topological order
+    uint32_t *node_group = new uint32_t[graph->nodes_size];
+    uint32_t groups_count = 0;
+    for (uint32_t i=0; i<graph->nodes_size; i++) node_group[i] = DSP_NO_GROUP;
+    for (uint32_t n=0; n<order_size; n++) {
+        uint32_t r = dsp_find(root, order[n]);
+        if (node_group[r] == DSP_NO_GROUP) node_group[r] = groups_count++;
+    }
+    for (uint32_t n=0; n<order_size; n++) {
+        node_group[order[n]] = node_group[dsp_find(root, order[n])];
+    }
+    delete [] root;
+    // }}}3
+
+    dsp_program_t *p = new dsp_program_t;
+    p->in_ports_count = in_ports_count;
+    p->max_frames = max_frames;
+    p->nodes = new dsp_node_t*[graph->nodes_size];
+    for (uint32_t i=0; i<graph->nodes_size; i++) p->nodes[i] = graph->nodes[i];
+    p->nodes_size = graph->nodes_size;
+    p->bufs = new jack_default_audio_sample_t*[bufs_count];
+    p->scratch = new jack_default_audio_sample_t[
+        (bufs_count - in_ports_count) * max_frames];
+    memset(p->scratch, 0,
+        (bufs_count - in_ports_count) * max_frames * sizeof(jack_default_audio_sample_t));
+    p->bufs[0] = p->scratch;
+    for (uint32_t i=0, n=1; i<bufs_count; i++) {
+        if (i == 0 || i > in_ports_count) p->bufs[i] = p->scratch + (n++ - 1) * max_frames;
+        else p->bufs[i] = 0; // set by RT thread every cycle
+    }
+
+    // own output ports steps {{{3
+    dsp_port_step_t *ports = new dsp_port_step_t[graph->edges_size];
+    uint32_t *port_group = new uint32_t[graph->edges_size];
+    uint32_t ports_count = 0;
+    for (uint32_t i=0; i<graph->edges_size; i++) {
+        if (dst_port[i] == -1) continue;
+        bool done = false;
+        for (uint32_t n=0; n<ports_count; n++) {
+            if (ports[n].port == (uint32_t)dst_port[i]) { done = true; break; }
+        }
+        if (done) continue;
+
+        // port fed only by own input ports is group of its own
+        port_group[ports_count] = DSP_NO_GROUP;
+        dsp_port_step_t *step = &ports[ports_count++];
+        step->port = dst_port[i];
+        step->inputs_count = 0;
+        for (uint32_t n=i; n<graph->edges_size; n++) {
+            if (dst_port[n] != dst_port[i]) continue;
+            step->inputs_count++;
+            if (port_group[ports_count - 1] == DSP_NO_GROUP && graph->edges[n].src.node != -1)
+                port_group[ports_count - 1] = node_group[graph->edges[n].src.node];
+        }
+        if (port_group[ports_count - 1] == DSP_NO_GROUP)
+            port_group[ports_count - 1] = groups_count++;
+        step->inputs = new uint32_t[step->inputs_count];
+        for (uint32_t n=i, m=0; n<graph->edges_size; n++) {
+            if (dst_port[n] == dst_port[i]) step->inputs[m++] = src_buf[n];
+        }
+    }
+    // }}}3
+
+    p->groups = new dsp_group_t[groups_count];
+    p->groups_count = groups_count;
+    p->params = new float[groups_count * max_frames];
+    for (uint32_t g=0; g<groups_count; g++) {
+        dsp_group_t *group = &p->groups[g];
+        group->steps_count = 0;
+        group->ports_count = 0;
+        group->params = p->params + g * max_frames;
+    }
+    for (uint32_t n=0; n<order_size; n++) p->groups[node_group[order[n]]].steps_count++;
+    for (uint32_t n=0; n<ports_count; n++) p->groups[port_group[n]].ports_count++;
+    for (uint32_t g=0, steps_begin=0, ports_begin=0; g<groups_count; g++) {
+        p->groups[g].steps_begin = steps_begin;
+        p->groups[g].ports_begin = ports_begin;
+        steps_begin += p->groups[g].steps_count;
+        ports_begin += p->groups[g].ports_count;
+    }
+
+    // nodes steps (topological order is kept inside group) {{{3
+    uint32_t *cursor = new uint32_t[groups_count];
+    for (uint32_t g=0; g<groups_count; g++) cursor[g] = p->groups[g].steps_begin;
+    p->steps = new dsp_step_t[order_size];
+    p->steps_count = order_size;
+    for (uint32_t n=0; n<order_size; n++) {
+        uint32_t id = order[n];
+        dsp_step_t *step = &p->steps[cursor[node_group[id]]++];
+        step->node = graph->nodes[id];
+        step->inputs_count = 0;
+        for (uint32_t i=0; i<graph->edges_size; i++) {
+            if (graph->edges[i].dst.node == (int32_t)id && src_buf[i] != -1) step->inputs_count++;
+        }
+        step->inputs = new uint32_t[step->inputs_count];
+        for (uint32_t i=0, m=0; i<graph->edges_size; i++) {
+            if (graph->edges[i].dst.node == (int32_t)id && src_buf[i] != -1)
+                step->inputs[m++] = src_buf[i];
+        }
+        for (uint8_t o=0; o<DSP_NODE_MAX_OUTPUTS; o++) step->outputs[o] = out_base[id] + o;
+    }
+    // }}}3
+
+    for (uint32_t g=0; g<groups_count; g++) cursor[g] = p->groups[g].ports_begin;
+    p->ports = new dsp_port_step_t[ports_count];
+    p->ports_count = ports_count;
+    for (uint32_t n=0; n<ports_count; n++) p->ports[cursor[port_group[n]]++] = ports[n];
+    delete [] cursor;
+    delete [] ports;
+    delete [] port_group;
+
+    delete [] node_group;
+    delete [] dst_port;
+    delete [] out_base;
+    delete [] src_buf;
+    delete [] order;
+
+    *program = p;
+    return 0;
+} // dsp_graph_compile() }}}2
+
+void dsp_program_free(dsp_program_t *program) // {{{2
+{
+    if (program == 0) return;
+    for (uint32_t i=0; i<program->steps_count; i++) delete [] program->steps[i].inputs;
+    for (uint32_t i=0; i<program->ports_count; i++) delete [] program->ports[i].inputs;
+    delete [] program->steps;
+    delete [] program->ports;
+    delete [] program->groups;
+    delete [] program->bufs;
+    delete [] program->scratch;
+    delete [] program->nodes;
+    delete [] program->params;
+    delete program;
+} // dsp_program_free() }}}2
+
+// compiling }}}1
+
+// running (RT thread) {{{1
+
+/**
+ * Sum input buffers to output buffer
+ *
+ * @private
+ */
+inline void dsp_sum_inputs( // {{{2
+    jack_default_audio_sample_t *out,
+    jack_default_audio_sample_t **bufs,
+    uint32_t *inputs,
+    uint32_t inputs_count,
+    jack_nframes_t nframes)
+{
+    if (inputs_count == 0) {
+        memset(out, 0, nframes * sizeof(jack_default_audio_sample_t));
+        return;
+    }
+    dsp_kernels.copy(out, bufs[inputs[0]], nframes);
+    for (uint32_t i=1; i<inputs_count; i++) {
+        dsp_kernels.mix(out, bufs[inputs[i]], nframes);
+    }
+} // dsp_sum_inputs() }}}2
+
+// equal-power pan law, position is -1..1 {{{2
+inline float dsp_pan_angle(float pos)
+{
+    if (pos < -1) pos = -1;
+    else if (pos > 1) pos = 1;
+    return (pos + 1) * (float)M_PI / 4;
+}
+inline float dsp_pan_left(float pos) { return cosf(dsp_pan_angle(pos)); }
+inline float dsp_pan_right(float pos) { return sinf(dsp_pan_angle(pos)); }
+// }}}2
+
+/**
+ * Move posted automation events to pending events of their nodes
+ *
+ * Events of nodes that is not in the program (removed nodes) is dropped.
+ * Cancel event drops pending events from its time on here, in posting order,
+ * so events posted after it (even for the same time) is kept.
+ *
+ * @param {dsp_program_t} program
+ * @param {jack_ringbuffer_t} queue
+ * @returns {uint32_t} Count of events dropped because node has too many pending events
+ */
+uint32_t dsp_program_schedule(dsp_program_t *program, jack_ringbuffer_t *queue) // {{{2
+{
+    uint32_t dropped = 0;
+    dsp_automation_event_t event;
+
+    while (jack_ringbuffer_read_space(queue) >= sizeof(event)) {
+        jack_ringbuffer_read(queue, (char *)&event, sizeof(event));
+        if (event.node >= program->nodes_size || program->nodes[event.node] == 0) continue;
+
+        dsp_node_t *node = program->nodes[event.node];
+        if (event.type == DSP_AUTOMATION_CANCEL) {
+            uint32_t kept = 0;
+            for (uint32_t i=0; i<node->events_count; i++) {
+                if ((int32_t)(node->events[i].time - event.time) < 0)
+                    node->events[kept++] = node->events[i];
+            }
+            node->events_count = kept;
+        }
+        if (node->events_count >= DSP_NODE_MAX_EVENTS) {
+            dropped++;
+            continue;
+        }
+
+        // events with the same time keep posting order
+        uint32_t i = node->events_count++;
+        for (; i > 0 && (int32_t)(event.time - node->events[i - 1].time) < 0; i--) {
+            node->events[i] = node->events[i - 1];
+        }
+        node->events[i] = event;
+    }
+
+    return dropped;
+} // dsp_program_schedule() }}}2
+
+/**
+ * Start automation event, "value" is current value of parameter
+ *
+ * @private
+ */
+inline void dsp_node_start_event( // {{{2
+    dsp_node_t *node,
+    const dsp_automation_event_t *event,
+    float &value)
+{
+    switch (event->type) {
+    case DSP_AUTOMATION_LINEAR:
+    case DSP_AUTOMATION_EXPONENTIAL:
+        if (event->duration > 0) {
+            node->ramp_target = event->value;
+            node->ramp_left = event->duration;
+            if (event->type == DSP_AUTOMATION_EXPONENTIAL && value * event->value > 0) {
+                node->ramp_type = DSP_AUTOMATION_EXPONENTIAL;
+                node->ramp_step = powf(event->value / value, 1.0f / event->duration);
+            } else {
+                node->ramp_type = DSP_AUTOMATION_LINEAR;
+                node->ramp_step = (event->value - value) / event->duration;
+            }
+            break;
+        }
+        // ramp of zero length is just a jump
+    case DSP_AUTOMATION_SET:
+        value = event->value;
+        node->ramp_left = 0;
+        break;
+    case DSP_AUTOMATION_CANCEL:
+        // pending events is already dropped by dsp_program_schedule()
+        node->ramp_left = 0;
+        break;
+    }
+} // dsp_node_start_event() }}}2
+
+/**
+ * Parameter of node for the cycle
+ *
+ * Without automation parameter is smoothed from previous value to "param"
+ * across the cycle. Automated parameter follows events at exact frames,
+ * direct "param" change takes over automation again.
+ *
+ * @private
+ * @param {float} params Per frame values, filled if true is returned
+ * @param {float} from Value of first frame (if false is returned)
+ * @param {float} inc Increment per frame (if false is returned)
+ * @returns {bool} Parameter is rendered to "params"
+ */
+inline bool dsp_node_param( // {{{2
+    dsp_node_t *node,
+    float *params,
+    jack_nframes_t nframes,
+    jack_nframes_t cycle_start,
+    float &from,
+    float &inc)
+{
+    uint32_t version = node->param_version;
+    float param = node->param;
+    if (version != node->param_version_seen) {
+        node->param_version_seen = version;
+        node->automated = false;
+        node->ramp_left = 0;
+    }
+
+    bool due = node->events_count > 0
+        && (int32_t)(node->events[0].time - cycle_start) < (int32_t)nframes;
+    if (!node->automated && !due) {
+        from = node->param_current;
+        inc = (param - from) / nframes;
+        node->param_current = param;
+        return false;
+    }
+
+    float value = node->param_current;
+    bool varies = false;
+    jack_nframes_t n = 0;
+
+    for (;;) {
+        jack_nframes_t next = nframes;
+        if (node->events_count > 0) {
+            // late events start right now
+            int32_t offset = (int32_t)(node->events[0].time - cycle_start);
+            if (offset < (int32_t)n) offset = n;
+            if (offset < (int32_t)nframes) next = offset;
+        }
+
+        for (; n<next; n++) {
+            params[n] = value;
+            if (node->ramp_left > 0) {
+                varies = true;
+                if (node->ramp_type == DSP_AUTOMATION_EXPONENTIAL) value *= node->ramp_step;
+                else value += node->ramp_step;
+                if (--node->ramp_left == 0) value = node->ramp_target;
+            }
+        }
+        if (n >= nframes) break;
+
+        dsp_automation_event_t event = node->events[0];
+        node->events_count--;
+        memmove(node->events, node->events + 1,
+            node->events_count * sizeof(dsp_automation_event_t));
+        dsp_node_start_event(node, &event, value);
+        node->automated = true;
+        if (n > 0) varies = true;
+    }
+
+    node->param_current = value;
+    from = value;
+    inc = 0;
+    return varies;
+} // dsp_node_param() }}}2
+
+/**
+ * Set own input ports buffers of cycle
+ *
+ * @param {dsp_program_t} program
+ * @param {jack_nframes_t} nframes
+ * @param {jack_default_audio_sample_t} capture_bufs Own input ports buffers
+ * @returns {bool} false if program can't run this cycle
+ */
+bool dsp_program_prepare( // {{{2
+    dsp_program_t *program,
+    jack_nframes_t nframes,
+    jack_default_audio_sample_t **capture_bufs)
+{
+    if (nframes > program->max_frames) return false;
+
+    jack_default_audio_sample_t **bufs = program->bufs;
+    for (uint32_t i=0; i<program->in_ports_count; i++) {
+        bufs[1 + i] = capture_bufs[i] ? capture_bufs[i] : bufs[0];
+    }
+    return true;
+} // dsp_program_prepare() }}}2
+
+/**
+ * Run one group of prepared program
+ *
+ * Different groups may run on different threads at the same time.
+ *
+ * @param {dsp_program_t} program
+ * @param {uint32_t} group_index
+ * @param {jack_nframes_t} nframes
+ * @param {jack_nframes_t} cycle_start JACK frame time of first frame (for automation)
+ * @param {jack_default_audio_sample_t} playback_bufs Own output ports buffers
+ */
+void dsp_program_run_group( // {{{2
+    dsp_program_t *program,
+    uint32_t group_index,
+    jack_nframes_t nframes,
+    jack_nframes_t cycle_start,
+    jack_default_audio_sample_t **playback_bufs)
+{
+    jack_default_audio_sample_t **bufs = program->bufs;
+    dsp_group_t *group = &program->groups[group_index];
+
+    uint32_t steps_end = group->steps_begin + group->steps_count;
+    for (uint32_t s=group->steps_begin; s<steps_end; s++) {
+        dsp_step_t *step = &program->steps[s];
+        dsp_node_t *node = step->node;
+        jack_default_audio_sample_t *out = bufs[step->outputs[0]];
+
+        float from, inc;
+        float *params = group->params;
+        bool curve = dsp_node_param(node, params, nframes, cycle_start, from, inc);
+        float to = from + inc * nframes;
+
+        switch (node->type) {
+        case DSP_NODE_PASS:
+            dsp_sum_inputs(out, bufs, step->inputs, step->inputs_count, nframes);
+            break;
+        case DSP_NODE_GAIN:
+        case DSP_NODE_MIX:
+            dsp_sum_inputs(out, bufs, step->inputs, step->inputs_count, nframes);
+            if (curve) dsp_kernels.gain_curve(out, out, params, nframes);
+            else if (inc == 0) dsp_kernels.gain(out, out, to, nframes);
+            else dsp_kernels.gain_ramp(out, out, from, inc, nframes);
+            break;
+        case DSP_NODE_PAN: {
+            jack_default_audio_sample_t *out_r = bufs[step->outputs[1]];
+            dsp_sum_inputs(out, bufs, step->inputs, step->inputs_count, nframes);
+            if (curve) {
+                for (jack_nframes_t n=0; n<nframes; n++) {
+                    float angle = dsp_pan_angle(params[n]);
+                    out_r[n] = out[n] * sinf(angle);
+                    out[n] *= cosf(angle);
+                }
+                break;
+            }
+            // gains is interpolated linearly between positions of period edges
+            float l = dsp_pan_left(from), l_inc = (dsp_pan_left(to) - l) / nframes;
+            float r = dsp_pan_right(from), r_inc = (dsp_pan_right(to) - r) / nframes;
+            dsp_kernels.gain_ramp(out_r, out, r, r_inc, nframes);
+            dsp_kernels.gain_ramp(out, out, l, l_inc, nframes);
+            break;
+        }
+        case DSP_NODE_DELAY:
+            dsp_sum_inputs(out, bufs, step->inputs, step->inputs_count, nframes);
+            if (node->delay_frames > 0) {
+                for (jack_nframes_t n=0; n<nframes; n++) {
+                    jack_default_audio_sample_t sample = node->delay_line[node->delay_pos];
+                    node->delay_line[node->delay_pos] = out[n];
+                    out[n] = sample;
+                    if (++node->delay_pos >= node->delay_frames) node->delay_pos = 0;
+                }
+            }
+            break;
+        case DSP_NODE_CONSTANT:
+            if (curve) dsp_kernels.copy(out, params, nframes);
+            else for (jack_nframes_t n=0; n<nframes; n++, from += inc) out[n] = from;
+            break;
+        }
+    }
+
+    uint32_t ports_end = group->ports_begin + group->ports_count;
+    for (uint32_t i=group->ports_begin; i<ports_end; i++) {
+        dsp_port_step_t *step = &program->ports[i];
+        jack_default_audio_sample_t *out = playback_bufs[step->port];
+        if (out == 0) continue;
+        dsp_sum_inputs(out, bufs, step->inputs, step->inputs_count, nframes);
+    }
+} // dsp_program_run_group() }}}2
+
+/**
+ * Run compiled program (all groups in current thread)
+ *
+ * @param {dsp_program_t} program
+ * @param {jack_nframes_t} nframes
+ * @param {jack_nframes_t} cycle_start JACK frame time of first frame (for automation)
+ * @param {jack_default_audio_sample_t} capture_bufs Own input ports buffers
+ * @param {jack_default_audio_sample_t} playback_bufs Own output ports buffers
+ */
+void dsp_program_run( // {{{2
+    dsp_program_t *program,
+    jack_nframes_t nframes,
+    jack_nframes_t cycle_start,
+    jack_default_audio_sample_t **capture_bufs,
+    jack_default_audio_sample_t **playback_bufs)
+{
+    if (!dsp_program_prepare(program, nframes, capture_bufs)) return;
+    for (uint32_t g=0; g<program->groups_count; g++) {
+        dsp_program_run_group(program, g, nframes, cycle_start, playback_bufs);
+    }
+} // dsp_program_run() }}}2
+
+// running }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,191 @@
+/**
+ * JACK Connector
+ * Native DSP graph executed in JACK realtime thread
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef DSP_GRAPH_H
+#define DSP_GRAPH_H
+
+#include <jack/jack.h>
+#include <jack/ringbuffer.h>
+#include <stdint.h>
+
+#define DSP_NODE_MAX_OUTPUTS 2
+#define DSP_NODE_MAX_EVENTS 64 // pending automation events of one node
+#define DSP_AUTOMATION_QUEUE_SIZE 1024 // events JS thread may post ahead of RT thread
+
+typedef enum {
+    DSP_NODE_PASS = 0, // sum of inputs
+    DSP_NODE_GAIN, // sum of inputs multiplied by "param"
+    DSP_NODE_MIX, // same as gain, for many inputs
+    DSP_NODE_PAN, // equal-power panner, "param" is position -1..1, two outputs
+    DSP_NODE_DELAY, // sum of inputs delayed by "delay_frames"
+    DSP_NODE_CONSTANT // "param" value on output, inputs is ignored
+} dsp_node_type_t;
+
+typedef enum {
+    DSP_AUTOMATION_SET = 0, // jump to value
+    DSP_AUTOMATION_LINEAR, // linear ramp from current value to value
+    DSP_AUTOMATION_EXPONENTIAL, // exponential ramp (linear if it crosses zero)
+    DSP_AUTOMATION_CANCEL // drop events posted before it from its time on, hold current value
+} dsp_automation_type_t;
+
+// automation event, posted by JS thread to RT thread through lock-free queue
+typedef struct {
+    uint32_t node; // node id
+    dsp_automation_type_t type;
+    jack_nframes_t time; // JACK frame time the event starts at
+    jack_nframes_t duration; // frames of ramp
+    float value;
+} dsp_automation_event_t;
+
+typedef struct {
+    dsp_node_type_t type;
+    volatile float param; // target value, written by JS thread
+    volatile uint32_t param_version; // incremented on every "param" write
+    float param_current; // value reached by RT thread (for smoothing)
+    uint32_t delay_frames;
+    jack_default_audio_sample_t *delay_line;
+    uint32_t delay_pos;
+
+    // automation, RT thread only
+    uint32_t param_version_seen; // "param" write takes over automation
+    bool automated; // param_current is driven by automation events
+    dsp_automation_event_t events[DSP_NODE_MAX_EVENTS]; // pending, in time order
+    uint32_t events_count;
+    dsp_automation_type_t ramp_type;
+    jack_nframes_t ramp_left; // frames to end of current ramp
+    float ramp_step; // per frame increment (linear) or ratio (exponential)
+    float ramp_target;
+} dsp_node_t;
+
+// connection source: own input port (node is -1) or output of node
+typedef struct {
+    int32_t node;
+    uint8_t output;
+    char *port; // own input port short name
+} dsp_source_t;
+
+// connection destination: own output port (node is -1) or node
+typedef struct {
+    int32_t node;
+    char *port; // own output port short name
+} dsp_destination_t;
+
+typedef struct {
+    dsp_source_t src;
+    dsp_destination_t dst;
+} dsp_edge_t;
+
+// graph definition, edited by JS thread only
+typedef struct {
+    dsp_node_t **nodes; // index is node id, 0 for removed nodes
+    uint32_t nodes_size;
+    uint32_t nodes_capacity;
+
+    dsp_edge_t *edges;
+    uint32_t edges_size;
+    uint32_t edges_capacity;
+
+    // removed nodes that still may be used by current program
+    dsp_node_t **garbage;
+    uint32_t garbage_size;
+    uint32_t garbage_capacity;
+} dsp_graph_t;
+
+// resolves own port short name to index in own ports list (or -1)
+typedef int32_t (*dsp_port_resolver_t)(bool output, const char *short_name);
+
+// compiled graph, the only part that is touched by RT thread {{{1
+
+typedef struct {
+    dsp_node_t *node;
+    uint32_t *inputs; // buffers indexes
+    uint32_t inputs_count;
+    uint32_t outputs[DSP_NODE_MAX_OUTPUTS]; // buffers indexes
+} dsp_step_t;
+
+typedef struct {
+    uint32_t port; // own output port index
+    uint32_t *inputs; // buffers indexes
+    uint32_t inputs_count;
+} dsp_port_step_t;
+
+// steps of nodes and own output ports that don't share buffers with other
+// groups, so different groups can run on different threads at the same time
+typedef struct {
+    uint32_t steps_begin;
+    uint32_t steps_count;
+    uint32_t ports_begin;
+    uint32_t ports_count;
+    float *params; // per frame values of automated node parameter
+} dsp_group_t;
+
+typedef struct {
+    dsp_step_t *steps; // in topological order, grouped
+    uint32_t steps_count;
+    dsp_port_step_t *ports; // grouped
+    uint32_t ports_count;
+    dsp_group_t *groups;
+    uint32_t groups_count;
+    // buffers table: [zero buffer][own input ports][nodes outputs]
+    jack_default_audio_sample_t **bufs;
+    uint32_t in_ports_count;
+    jack_default_audio_sample_t *scratch;
+    jack_nframes_t max_frames;
+    dsp_node_t **nodes; // index is node id, to find node of automation event
+    uint32_t nodes_size;
+    float *params; // max_frames for every group
+} dsp_program_t;
+
+// compiled graph }}}1
+
+int32_t dsp_graph_add_node(
+    dsp_graph_t *graph, dsp_node_type_t type, float param, uint32_t delay_frames);
+bool dsp_graph_remove_node(dsp_graph_t *graph, int32_t id);
+bool dsp_graph_set_param(dsp_graph_t *graph, int32_t id, float value);
+bool dsp_graph_node_exists(dsp_graph_t *graph, int32_t id);
+uint8_t dsp_node_outputs_count(dsp_node_type_t type);
+bool dsp_graph_connect(dsp_graph_t *graph, dsp_source_t src, dsp_destination_t dst);
+bool dsp_graph_disconnect(dsp_graph_t *graph, dsp_source_t src, dsp_destination_t dst);
+void dsp_graph_clear(dsp_graph_t *graph);
+bool dsp_graph_is_empty(dsp_graph_t *graph);
+void dsp_graph_destroy(dsp_graph_t *graph);
+
+const char* dsp_graph_compile(
+    dsp_graph_t *graph,
+    dsp_port_resolver_t resolver,
+    uint32_t in_ports_count,
+    jack_nframes_t max_frames,
+    dsp_program_t **program);
+void dsp_program_free(dsp_program_t *program);
+void dsp_graph_collect_garbage(dsp_graph_t *graph);
+
+bool dsp_graph_node_automatable(dsp_graph_t *graph, int32_t id);
+bool dsp_automation_post(jack_ringbuffer_t *queue, const dsp_automation_event_t *event);
+
+// RT thread
+uint32_t dsp_program_schedule(dsp_program_t *program, jack_ringbuffer_t *queue);
+bool dsp_program_prepare(
+    dsp_program_t *program,
+    jack_nframes_t nframes,
+    jack_default_audio_sample_t **capture_bufs);
+void dsp_program_run_group( // any thread, after dsp_program_prepare()
+    dsp_program_t *program,
+    uint32_t group_index,
+    jack_nframes_t nframes,
+    jack_nframes_t cycle_start,
+    jack_default_audio_sample_t **playback_bufs);
+void dsp_program_run(
+    dsp_program_t *program,
+    jack_nframes_t nframes,
+    jack_nframes_t cycle_start,
+    jack_default_audio_sample_t **capture_bufs,
+    jack_default_audio_sample_t **playback_bufs);
+
+#endif // DSP_GRAPH_H
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,487 @@
+/**
+ * JACK Connector
+ * Vectorized sample kernels (copy, gain, mix, interleave, clip, peak/RMS)
+ *
+ * Every kernel has scalar version and SSE/AVX versions on x86. Versions is
+ * compiled with per-function target attributes, so one build works on any
+ * x86 host, best available version is picked at runtime by dsp_kernels_init().
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "dsp_kernels.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#   define DSP_KERNELS_X86
+#   include <immintrin.h>
+#   define DSP_TARGET_SSE __attribute__((target("sse2")))
+#   define DSP_TARGET_AVX __attribute__((target("avx")))
+#endif
+
+// scalar {{{1
+
+void scalar_copy(dsp_sample_t *dst, const dsp_sample_t *src, uint32_t n) // {{{2
+{
+    if (dst != src) memmove(dst, src, n * sizeof(dsp_sample_t));
+} // scalar_copy() }}}2
+
+void scalar_gain( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, float gain, uint32_t n)
+{
+    for (uint32_t i=0; i<n; i++) dst[i] = src[i] * gain;
+} // scalar_gain() }}}2
+
+void scalar_gain_ramp( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, float from, float inc, uint32_t n)
+{
+    for (uint32_t i=0; i<n; i++) dst[i] = src[i] * (from + inc * i);
+} // scalar_gain_ramp() }}}2
+
+void scalar_gain_curve( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, const float *gains, uint32_t n)
+{
+    for (uint32_t i=0; i<n; i++) dst[i] = src[i] * gains[i];
+} // scalar_gain_curve() }}}2
+
+void scalar_mix(dsp_sample_t *dst, const dsp_sample_t *src, uint32_t n) // {{{2
+{
+    for (uint32_t i=0; i<n; i++) dst[i] += src[i];
+} // scalar_mix() }}}2
+
+void scalar_mix_gain( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, float gain, uint32_t n)
+{
+    for (uint32_t i=0; i<n; i++) dst[i] += src[i] * gain;
+} // scalar_mix_gain() }}}2
+
+void scalar_interleave( // {{{2
+    dsp_sample_t *dst, dsp_sample_t * const *src, uint32_t channels, uint32_t n)
+{
+    for (uint32_t c=0; c<channels; c++) {
+        const dsp_sample_t *in = src[c];
+        dsp_sample_t *out = dst + c;
+        for (uint32_t i=0; i<n; i++, out += channels) *out = in[i];
+    }
+} // scalar_interleave() }}}2
+
+void scalar_deinterleave( // {{{2
+    dsp_sample_t * const *dst, const dsp_sample_t *src, uint32_t channels, uint32_t n)
+{
+    for (uint32_t c=0; c<channels; c++) {
+        const dsp_sample_t *in = src + c;
+        dsp_sample_t *out = dst[c];
+        for (uint32_t i=0; i<n; i++, in += channels) out[i] = *in;
+    }
+} // scalar_deinterleave() }}}2
+
+void scalar_clip( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, float limit, uint32_t n)
+{
+    for (uint32_t i=0; i<n; i++) {
+        dsp_sample_t sample = src[i];
+        if (sample > limit) sample = limit;
+        else if (sample < -limit) sample = -limit;
+        dst[i] = sample;
+    }
+} // scalar_clip() }}}2
+
+float scalar_peak(const dsp_sample_t *src, uint32_t n) // {{{2
+{
+    float peak = 0;
+    for (uint32_t i=0; i<n; i++) {
+        float sample = src[i] < 0 ? -src[i] : src[i];
+        if (sample > peak) peak = sample;
+    }
+    return peak;
+} // scalar_peak() }}}2
+
+float scalar_sum_squares(const dsp_sample_t *src, uint32_t n) // {{{2
+{
+    float sum = 0;
+    for (uint32_t i=0; i<n; i++) sum += src[i] * src[i];
+    return sum;
+} // scalar_sum_squares() }}}2
+
+// scalar }}}1
+
+#ifdef DSP_KERNELS_X86
+
+// SSE {{{1
+
+DSP_TARGET_SSE
+void sse_copy(dsp_sample_t *dst, const dsp_sample_t *src, uint32_t n) // {{{2
+{
+    if (dst == src) return;
+    // buffers may overlap only when they're the same
+    uint32_t i = 0;
+    for (; i+4<=n; i+=4) _mm_storeu_ps(dst + i, _mm_loadu_ps(src + i));
+    for (; i<n; i++) dst[i] = src[i];
+} // sse_copy() }}}2
+
+DSP_TARGET_SSE
+void sse_gain( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, float gain, uint32_t n)
+{
+    __m128 g = _mm_set1_ps(gain);
+    uint32_t i = 0;
+    for (; i+4<=n; i+=4) _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+    for (; i<n; i++) dst[i] = src[i] * gain;
+} // sse_gain() }}}2
+
+DSP_TARGET_SSE
+void sse_gain_ramp( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, float from, float inc, uint32_t n)
+{
+    __m128 g = _mm_add_ps(_mm_set1_ps(from),
+        _mm_mul_ps(_mm_set1_ps(inc), _mm_set_ps(3, 2, 1, 0)));
+    __m128 g_inc = _mm_set1_ps(inc * 4);
+    uint32_t i = 0;
+    for (; i+4<=n; i+=4) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), g));
+        g = _mm_add_ps(g, g_inc);
+    }
+    for (; i<n; i++) dst[i] = src[i] * (from + inc * i);
+} // sse_gain_ramp() }}}2
+
+DSP_TARGET_SSE
+void sse_gain_curve( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, const float *gains, uint32_t n)
+{
+    uint32_t i = 0;
+    for (; i+4<=n; i+=4) {
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(src + i), _mm_loadu_ps(gains + i)));
+    }
+    for (; i<n; i++) dst[i] = src[i] * gains[i];
+} // sse_gain_curve() }}}2
+
+DSP_TARGET_SSE
+void sse_mix(dsp_sample_t *dst, const dsp_sample_t *src, uint32_t n) // {{{2
+{
+    uint32_t i = 0;
+    for (; i+4<=n; i+=4) {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+    }
+    for (; i<n; i++) dst[i] += src[i];
+} // sse_mix() }}}2
+
+DSP_TARGET_SSE
+void sse_mix_gain( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, float gain, uint32_t n)
+{
+    __m128 g = _mm_set1_ps(gain);
+    uint32_t i = 0;
+    for (; i+4<=n; i+=4) {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i),
+            _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+    }
+    for (; i<n; i++) dst[i] += src[i] * gain;
+} // sse_mix_gain() }}}2
+
+// only stereo is vectorized, it's the most common case
+DSP_TARGET_SSE
+void sse_interleave( // {{{2
+    dsp_sample_t *dst, dsp_sample_t * const *src, uint32_t channels, uint32_t n)
+{
+    if (channels != 2) return scalar_interleave(dst, src, channels, n);
+
+    const dsp_sample_t *l = src[0], *r = src[1];
+    uint32_t i = 0;
+    for (; i+4<=n; i+=4) {
+        __m128 a = _mm_loadu_ps(l + i);
+        __m128 b = _mm_loadu_ps(r + i);
+        _mm_storeu_ps(dst + i*2, _mm_unpacklo_ps(a, b));
+        _mm_storeu_ps(dst + i*2 + 4, _mm_unpackhi_ps(a, b));
+    }
+    for (; i<n; i++) {
+        dst[i*2] = l[i];
+        dst[i*2 + 1] = r[i];
+    }
+} // sse_interleave() }}}2
+
+DSP_TARGET_SSE
+void sse_deinterleave( // {{{2
+    dsp_sample_t * const *dst, const dsp_sample_t *src, uint32_t channels, uint32_t n)
+{
+    if (channels != 2) return scalar_deinterleave(dst, src, channels, n);
+
+    dsp_sample_t *l = dst[0], *r = dst[1];
+    uint32_t i = 0;
+    for (; i+4<=n; i+=4) {
+        __m128 a = _mm_loadu_ps(src + i*2);
+        __m128 b = _mm_loadu_ps(src + i*2 + 4);
+        _mm_storeu_ps(l + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(r + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    for (; i<n; i++) {
+        l[i] = src[i*2];
+        r[i] = src[i*2 + 1];
+    }
+} // sse_deinterleave() }}}2
+
+DSP_TARGET_SSE
+void sse_clip( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, float limit, uint32_t n)
+{
+    __m128 hi = _mm_set1_ps(limit);
+    __m128 lo = _mm_set1_ps(-limit);
+    uint32_t i = 0;
+    for (; i+4<=n; i+=4) {
+        _mm_storeu_ps(dst + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), lo), hi));
+    }
+    scalar_clip(dst + i, src + i, limit, n - i);
+} // sse_clip() }}}2
+
+DSP_TARGET_SSE
+float sse_hmax(__m128 v) // {{{2
+{
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_max_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(v);
+} // sse_hmax() }}}2
+
+DSP_TARGET_SSE
+float sse_hsum(__m128 v) // {{{2
+{
+    v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(v);
+} // sse_hsum() }}}2
+
+DSP_TARGET_SSE
+float sse_peak(const dsp_sample_t *src, uint32_t n) // {{{2
+{
+    __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 peak = _mm_setzero_ps();
+    uint32_t i = 0;
+    for (; i+4<=n; i+=4) {
+        peak = _mm_max_ps(peak, _mm_and_ps(_mm_loadu_ps(src + i), abs_mask));
+    }
+    float retval = sse_hmax(peak);
+    float tail = scalar_peak(src + i, n - i);
+    return tail > retval ? tail : retval;
+} // sse_peak() }}}2
+
+DSP_TARGET_SSE
+float sse_sum_squares(const dsp_sample_t *src, uint32_t n) // {{{2
+{
+    __m128 sum = _mm_setzero_ps();
+    uint32_t i = 0;
+    for (; i+4<=n; i+=4) {
+        __m128 v = _mm_loadu_ps(src + i);
+        sum = _mm_add_ps(sum, _mm_mul_ps(v, v));
+    }
+    return sse_hsum(sum) + scalar_sum_squares(src + i, n - i);
+} // sse_sum_squares() }}}2
+
+// SSE }}}1
+
+// AVX {{{1
+
+DSP_TARGET_AVX
+void avx_copy(dsp_sample_t *dst, const dsp_sample_t *src, uint32_t n) // {{{2
+{
+    if (dst == src) return;
+    uint32_t i = 0;
+    for (; i+8<=n; i+=8) _mm256_storeu_ps(dst + i, _mm256_loadu_ps(src + i));
+    for (; i<n; i++) dst[i] = src[i];
+} // avx_copy() }}}2
+
+DSP_TARGET_AVX
+void avx_gain( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, float gain, uint32_t n)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    uint32_t i = 0;
+    for (; i+8<=n; i+=8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+    }
+    for (; i<n; i++) dst[i] = src[i] * gain;
+} // avx_gain() }}}2
+
+DSP_TARGET_AVX
+void avx_gain_ramp( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, float from, float inc, uint32_t n)
+{
+    __m256 g = _mm256_add_ps(_mm256_set1_ps(from),
+        _mm256_mul_ps(_mm256_set1_ps(inc), _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0)));
+    __m256 g_inc = _mm256_set1_ps(inc * 8);
+    uint32_t i = 0;
+    for (; i+8<=n; i+=8) {
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(src + i), g));
+        g = _mm256_add_ps(g, g_inc);
+    }
+    for (; i<n; i++) dst[i] = src[i] * (from + inc * i);
+} // avx_gain_ramp() }}}2
+
+DSP_TARGET_AVX
+void avx_gain_curve( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, const float *gains, uint32_t n)
+{
+    uint32_t i = 0;
+    for (; i+8<=n; i+=8) {
+        _mm256_storeu_ps(dst + i,
+            _mm256_mul_ps(_mm256_loadu_ps(src + i), _mm256_loadu_ps(gains + i)));
+    }
+    for (; i<n; i++) dst[i] = src[i] * gains[i];
+} // avx_gain_curve() }}}2
+
+DSP_TARGET_AVX
+void avx_mix(dsp_sample_t *dst, const dsp_sample_t *src, uint32_t n) // {{{2
+{
+    uint32_t i = 0;
+    for (; i+8<=n; i+=8) {
+        _mm256_storeu_ps(dst + i,
+            _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+    }
+    for (; i<n; i++) dst[i] += src[i];
+} // avx_mix() }}}2
+
+DSP_TARGET_AVX
+void avx_mix_gain( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, float gain, uint32_t n)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    uint32_t i = 0;
+    for (; i+8<=n; i+=8) {
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i),
+            _mm256_mul_ps(_mm256_loadu_ps(src + i), g)));
+    }
+    for (; i<n; i++) dst[i] += src[i] * gain;
+} // avx_mix_gain() }}}2
+
+DSP_TARGET_AVX
+void avx_clip( // {{{2
+    dsp_sample_t *dst, const dsp_sample_t *src, float limit, uint32_t n)
+{
+    __m256 hi = _mm256_set1_ps(limit);
+    __m256 lo = _mm256_set1_ps(-limit);
+    uint32_t i = 0;
+    for (; i+8<=n; i+=8) {
+        _mm256_storeu_ps(dst + i,
+            _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), lo), hi));
+    }
+    scalar_clip(dst + i, src + i, limit, n - i);
+} // avx_clip() }}}2
+
+DSP_TARGET_AVX
+float avx_peak(const dsp_sample_t *src, uint32_t n) // {{{2
+{
+    __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 peak = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i+8<=n; i+=8) {
+        peak = _mm256_max_ps(peak, _mm256_and_ps(_mm256_loadu_ps(src + i), abs_mask));
+    }
+    __m128 half = _mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1));
+    float retval = sse_hmax(half);
+    float tail = scalar_peak(src + i, n - i);
+    return tail > retval ? tail : retval;
+} // avx_peak() }}}2
+
+DSP_TARGET_AVX
+float avx_sum_squares(const dsp_sample_t *src, uint32_t n) // {{{2
+{
+    __m256 sum = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i+8<=n; i+=8) {
+        __m256 v = _mm256_loadu_ps(src + i);
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(v, v));
+    }
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    return sse_hsum(half) + scalar_sum_squares(src + i, n - i);
+} // avx_sum_squares() }}}2
+
+// AVX }}}1
+
+#endif // DSP_KERNELS_X86
+
+dsp_kernels_t dsp_kernels = {
+    "scalar",
+    scalar_copy,
+    scalar_gain,
+    scalar_gain_ramp,
+    scalar_gain_curve,
+    scalar_mix,
+    scalar_mix_gain,
+    scalar_interleave,
+    scalar_deinterleave,
+    scalar_clip,
+    scalar_peak,
+    scalar_sum_squares
+};
+
+/**
+ * Get kernels of version by name if current CPU supports it
+ *
+ * @param {char} name "scalar", "sse" or "avx"
+ * @param {dsp_kernels_t} kernels Filled if true is returned
+ * @returns {bool} false if version is unknown or not supported
+ */
+bool dsp_kernels_get(const char *name, dsp_kernels_t *kernels) // {{{1
+{
+    kernels->name = "scalar";
+    kernels->copy = scalar_copy;
+    kernels->gain = scalar_gain;
+    kernels->gain_ramp = scalar_gain_ramp;
+    kernels->gain_curve = scalar_gain_curve;
+    kernels->mix = scalar_mix;
+    kernels->mix_gain = scalar_mix_gain;
+    kernels->interleave = scalar_interleave;
+    kernels->deinterleave = scalar_deinterleave;
+    kernels->clip = scalar_clip;
+    kernels->peak = scalar_peak;
+    kernels->sum_squares = scalar_sum_squares;
+    if (strcmp(name, "scalar") == 0) return true;
+
+#ifdef DSP_KERNELS_X86
+    __builtin_cpu_init();
+    bool avx = strcmp(name, "avx") == 0;
+    if (!avx && strcmp(name, "sse") != 0) return false;
+
+    if (!__builtin_cpu_supports("sse2")) return false;
+    kernels->name = "sse";
+    kernels->copy = sse_copy;
+    kernels->gain = sse_gain;
+    kernels->gain_ramp = sse_gain_ramp;
+    kernels->gain_curve = sse_gain_curve;
+    kernels->mix = sse_mix;
+    kernels->mix_gain = sse_mix_gain;
+    kernels->interleave = sse_interleave;
+    kernels->deinterleave = sse_deinterleave;
+    kernels->clip = sse_clip;
+    kernels->peak = sse_peak;
+    kernels->sum_squares = sse_sum_squares;
+    if (!avx) return true;
+
+    // interleave/deinterleave is left from SSE, AVX lanes don't help there
+    if (!__builtin_cpu_supports("avx")) return false;
+    kernels->name = "avx";
+    kernels->copy = avx_copy;
+    kernels->gain = avx_gain;
+    kernels->gain_ramp = avx_gain_ramp;
+    kernels->gain_curve = avx_gain_curve;
+    kernels->mix = avx_mix;
+    kernels->mix_gain = avx_mix_gain;
+    kernels->clip = avx_clip;
+    kernels->peak = avx_peak;
+    kernels->sum_squares = avx_sum_squares;
+    return true;
+#else
+    return false;
+#endif
+} // dsp_kernels_get() }}}1
+
+/**
+ * Pick best kernels for current CPU
+ *
+ * Call it once on module initialization, before any kernel is used.
+ */
+void dsp_kernels_init() // {{{1
+{
+    // unsupported version leaves scalar kernels
+    if (!dsp_kernels_get("avx", &dsp_kernels)) dsp_kernels_get("sse", &dsp_kernels);
+} // dsp_kernels_init() }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
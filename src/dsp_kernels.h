@@ -0,0 +1,61 @@
+/**
+ * JACK Connector
+ * Vectorized sample kernels (copy, gain, mix, interleave, clip, peak/RMS)
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+#include <jack/jack.h>
+#include <stdint.h>
+
+typedef jack_default_audio_sample_t dsp_sample_t;
+
+/**
+ * Kernels table, selected once by dsp_kernels_init() for current CPU
+ *
+ * All kernels accept unaligned buffers. "dst" may be the same as "src"
+ * (except interleave/deinterleave).
+ */
+typedef struct {
+    const char *name; // "scalar", "sse" or "avx"
+
+    // dst = src
+    void (*copy)(dsp_sample_t *dst, const dsp_sample_t *src, uint32_t n);
+    // dst = src * gain
+    void (*gain)(dsp_sample_t *dst, const dsp_sample_t *src, float gain, uint32_t n);
+    // dst[i] = src[i] * (from + inc * i)
+    void (*gain_ramp)(dsp_sample_t *dst, const dsp_sample_t *src,
+        float from, float inc, uint32_t n);
+    // dst[i] = src[i] * gains[i]
+    void (*gain_curve)(dsp_sample_t *dst, const dsp_sample_t *src,
+        const float *gains, uint32_t n);
+    // dst += src
+    void (*mix)(dsp_sample_t *dst, const dsp_sample_t *src, uint32_t n);
+    // dst += src * gain
+    void (*mix_gain)(dsp_sample_t *dst, const dsp_sample_t *src, float gain, uint32_t n);
+    // dst[i * channels + c] = src[c][i]
+    void (*interleave)(dsp_sample_t *dst, dsp_sample_t * const *src,
+        uint32_t channels, uint32_t n);
+    // dst[c][i] = src[i * channels + c]
+    void (*deinterleave)(dsp_sample_t * const *dst, const dsp_sample_t *src,
+        uint32_t channels, uint32_t n);
+    // dst = src limited to -limit..limit
+    void (*clip)(dsp_sample_t *dst, const dsp_sample_t *src, float limit, uint32_t n);
+    // max(abs(src))
+    float (*peak)(const dsp_sample_t *src, uint32_t n);
+    // sum(src * src), RMS is sqrt(sum_squares / n)
+    float (*sum_squares)(const dsp_sample_t *src, uint32_t n);
+} dsp_kernels_t;
+
+extern dsp_kernels_t dsp_kernels;
+
+void dsp_kernels_init();
+bool dsp_kernels_get(const char *name, dsp_kernels_t *kernels); // for tests of every version
+
+#endif // DSP_KERNELS_H
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,163 @@
+/**
+ * JACK Connector
+ * Realtime threads that run independent groups of native DSP graph
+ *
+ * JACK realtime thread wakes pool threads, claims groups of compiled program
+ * together with them and spins until every group is done, so all output
+ * is ready before process callback returns. Pool threads is created by JACK
+ * with the same realtime priority as process thread and may be pinned to CPUs.
+ * If pool thread wakes up late, JACK thread just runs the rest of groups itself.
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "dsp_pool.h"
+#include <pthread.h>
+#include <sched.h>
+
+inline void dsp_pool_relax() // {{{1
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__ ("pause" ::: "memory");
+#else
+    __asm__ __volatile__ ("" ::: "memory");
+#endif
+} // dsp_pool_relax() }}}1
+
+/**
+ * Claim and run groups of current cycle until all of them is claimed
+ *
+ * Claim is a single atomic decrement, so thread that woke up late
+ * (after cycle is finished) gets negative index and does nothing.
+ *
+ * @private
+ */
+void dsp_pool_work(dsp_pool_t *pool) // {{{1
+{
+    for (;;) {
+        int32_t group = __sync_sub_and_fetch(&pool->groups_left, 1);
+        if (group < 0) return;
+        dsp_program_run_group(
+            pool->program, group, pool->nframes, pool->cycle_start, pool->playback_bufs);
+        __sync_fetch_and_add(&pool->groups_done, 1);
+    }
+} // dsp_pool_work() }}}1
+
+void* dsp_pool_thread_main(void *arg) // {{{1
+{
+    dsp_pool_t *pool = (dsp_pool_t *)arg;
+
+    for (;;) {
+        uv_sem_wait(&pool->wakeup);
+        if (pool->stop) break;
+        dsp_pool_work(pool);
+    }
+
+    return 0;
+} // dsp_pool_thread_main() }}}1
+
+/**
+ * Create pool threads
+ *
+ * @param {jack_client_t} client Threads is created by this client
+ * @param {uint32_t} threads_count
+ * @param {uint32_t} cpus CPU indexes, thread N is pinned to cpus[N % cpus_count]
+ * @param {uint32_t} cpus_count 0 to not pin threads
+ * @returns {dsp_pool_t} pool or 0 if threads couldn't be created
+ */
+dsp_pool_t* dsp_pool_create( // {{{1
+    jack_client_t *client,
+    uint32_t threads_count,
+    const uint32_t *cpus,
+    uint32_t cpus_count)
+{
+    dsp_pool_t *pool = new dsp_pool_t();
+    pool->threads = new jack_native_thread_t[threads_count];
+    pool->groups_left = -1;
+    uv_sem_init(&pool->wakeup, 0);
+
+    for (uint32_t i=0; i<threads_count; i++) {
+        if (jack_client_create_thread(client, &pool->threads[i],
+            jack_client_real_time_priority(client), jack_is_realtime(client),
+            dsp_pool_thread_main, pool) != 0) {
+            dsp_pool_destroy(pool);
+            return 0;
+        }
+        pool->threads_count++;
+
+#ifdef __linux__
+        if (cpus_count > 0 && cpus[i % cpus_count] < CPU_SETSIZE) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpus[i % cpus_count], &set);
+            // not fatal, thread just isn't pinned
+            pthread_setaffinity_np(pool->threads[i], sizeof(cpu_set_t), &set);
+        }
+#endif
+    }
+
+    return pool;
+} // dsp_pool_create() }}}1
+
+/**
+ * Stop pool threads and free pool
+ *
+ * @param {dsp_pool_t} pool
+ */
+void dsp_pool_destroy(dsp_pool_t *pool) // {{{1
+{
+    if (pool == 0) return;
+
+    pool->stop = true;
+    for (uint32_t i=0; i<pool->threads_count; i++) uv_sem_post(&pool->wakeup);
+    for (uint32_t i=0; i<pool->threads_count; i++) pthread_join(pool->threads[i], NULL);
+
+    uv_sem_destroy(&pool->wakeup);
+    delete [] pool->threads;
+    delete pool;
+} // dsp_pool_destroy() }}}1
+
+/**
+ * Run compiled program on JACK thread and pool threads
+ *
+ * @param {dsp_pool_t} pool
+ * @param {dsp_program_t} program
+ * @param {jack_nframes_t} nframes
+ * @param {jack_nframes_t} cycle_start JACK frame time of first frame (for automation)
+ * @param {jack_default_audio_sample_t} capture_bufs Own input ports buffers
+ * @param {jack_default_audio_sample_t} playback_bufs Own output ports buffers
+ */
+void dsp_pool_run( // {{{1
+    dsp_pool_t *pool,
+    dsp_program_t *program,
+    jack_nframes_t nframes,
+    jack_nframes_t cycle_start,
+    jack_default_audio_sample_t **capture_bufs,
+    jack_default_audio_sample_t **playback_bufs)
+{
+    if (program->groups_count < 2 || pool->threads_count == 0) {
+        dsp_program_run(program, nframes, cycle_start, capture_bufs, playback_bufs);
+        return;
+    }
+    if (!dsp_program_prepare(program, nframes, capture_bufs)) return;
+
+    pool->program = program;
+    pool->nframes = nframes;
+    pool->cycle_start = cycle_start;
+    pool->playback_bufs = playback_bufs;
+    pool->groups_done = 0;
+    __sync_synchronize();
+    pool->groups_left = program->groups_count; // open groups for claiming
+
+    // JACK thread takes a group too, so one less thread is enough
+    uint32_t wake = program->groups_count - 1;
+    if (wake > pool->threads_count) wake = pool->threads_count;
+    for (uint32_t i=0; i<wake; i++) uv_sem_post(&pool->wakeup);
+
+    dsp_pool_work(pool);
+    while (pool->groups_done < program->groups_count) dsp_pool_relax();
+    __sync_synchronize();
+} // dsp_pool_run() }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,55 @@
+/**
+ * JACK Connector
+ * Realtime threads that run independent groups of native DSP graph
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef DSP_POOL_H
+#define DSP_POOL_H
+
+#include <jack/jack.h>
+#include <stdint.h>
+#include <uv.h>
+#include "dsp_graph.h"
+
+#define DSP_POOL_MAX_THREADS 64
+
+typedef struct {
+    jack_native_thread_t *threads;
+    uint32_t threads_count;
+    uv_sem_t wakeup; // RT thread -> pool threads, groups of cycle is ready
+    volatile bool stop;
+
+    // current cycle, written by RT thread before groups is opened
+    dsp_program_t *program;
+    jack_nframes_t nframes;
+    jack_nframes_t cycle_start;
+    jack_default_audio_sample_t **playback_bufs;
+
+    // groups is claimed from the end, negative when all is claimed
+    volatile int32_t groups_left;
+    volatile uint32_t groups_done;
+} dsp_pool_t;
+
+// cpus is CPU indexes to pin threads to (cpus_count may be 0)
+dsp_pool_t* dsp_pool_create(
+    jack_client_t *client,
+    uint32_t threads_count,
+    const uint32_t *cpus,
+    uint32_t cpus_count);
+void dsp_pool_destroy(dsp_pool_t *pool); // RT thread must not run pool
+
+// RT thread, returns after all groups of cycle is done
+void dsp_pool_run(
+    dsp_pool_t *pool,
+    dsp_program_t *program,
+    jack_nframes_t nframes,
+    jack_nframes_t cycle_start,
+    jack_default_audio_sample_t **capture_bufs,
+    jack_default_audio_sample_t **playback_bufs);
+
+#endif // DSP_POOL_H
+
+// vim:set ts=4 sts=4 sw=4 et:
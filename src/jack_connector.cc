@@ -31,10 +31,31 @@
 #define VERSION "0.1.4"
 
 #include <node.h>
+#include <node_buffer.h>
 #include <jack/jack.h>
+#include <jack/midiport.h>
+#include <jack/ringbuffer.h>
+#include <jack/statistics.h>
 #include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
 #include <uv.h>
 
+#include "analyzer.h"
+#include "dsp_graph.h"
+#include "dsp_kernels.h"
+#include "dsp_pool.h"
+#include "meters.h"
+#include "notify_queue.h"
+#include "player.h"
+#include "port_graph.h"
+#include "recorder.h"
+#include "rt_section.h"
+#include "stats.h"
+#include "stream.h"
+#include "transport.h"
+
 #define ERR_MSG_NEED_TO_OPEN_JACK_CLIENT "JACK-client is not opened, need to open JACK-client"
 #define THROW_ERR(Message) \
         { \
@@ -42,47 +63,430 @@
             return scope.Close(Undefined()); \
         }
 #define STR_SIZE 256
-#define MAX_PORTS 64
+#define PORT_HANDLE_SLOT_BITS 16 // rest of port handle bits is generation of slot
+#define CACHE_LINE_SIZE 64
+#define MIDI_BUFFER_SIZE 65536
+#define DEFAULT_RINGBUFFER_PERIODS 2
+#define MAX_RINGBUFFER_PERIODS 64
 #define NEED_JACK_CLIENT_OPENED() \
         { \
-        if (client == 0 && !closing) \
+        if (cs->client == 0 && !cs->closing) \
             THROW_ERR(ERR_MSG_NEED_TO_OPEN_JACK_CLIENT); \
         }
 
 using namespace v8;
 
-jack_client_t *client = 0;
-short client_active = 0;
-char client_name[STR_SIZE];
+// own audio ports of one direction for RT thread (struct of cache-aligned arrays)
+typedef struct {
+    jack_port_t **ports; // in order of own ports list
+    jack_default_audio_sample_t **bufs; // port buffers of current cycle
+    char **short_names; // copies, for views of DSP worker
+    uint32_t size;
+} port_table_t;
+
+// ring buffers of ring buffer process mode, replaced as a whole
+typedef struct {
+    jack_nframes_t period_frames;
+    uint32_t in_size;
+    uint32_t out_size;
+    jack_ringbuffer_t **capture_rb;
+    jack_ringbuffer_t **playback_rb;
+    jack_default_audio_sample_t **capture_rb_buf; // JS-side period buffers
+    jack_default_audio_sample_t **playback_rb_buf;
+    jack_ringbuffer_t *transport_rb; // transport_cycle_t of every captured period
+    uint32_t ports_version; // own ports list buffers belongs to
+} ringbuffers_t;
+
+// native processor and own ports of its channels (0 for missing port)
+typedef struct {
+    void *processor;
+    jack_port_t **ports;
+} rt_binding_t;
+
+/**
+ * Everything RT thread reads, main thread never changes published snapshot
+ *
+ * New snapshot is built on every change and swapped by pointer (see
+ * publish_rt_snapshot()), so RT thread never locks. Buffers tables belongs
+ * to snapshot, they're never reallocated while a cycle uses them.
+ */
+typedef struct {
+    uint32_t ports_version; // own ports list snapshot is built for
+
+    port_table_t capture;
+    port_table_t playback;
+
+    jack_port_t **midi_in_ports;
+    jack_port_t **midi_out_ports;
+    void **midi_in_bufs; // MIDI ports buffers of current cycle
+    void **midi_out_bufs;
+    uint32_t midi_in_size;
+    uint32_t midi_out_size;
+
+    ringbuffers_t *ringbuffers; // 0 if ring buffer mode is off
+    dsp_program_t *dsp_program;
+    dsp_pool_t *dsp_pool;
+    meters_t *meters;
+
+    rt_binding_t *players;
+    uint32_t players_size;
+    rt_binding_t *recorders;
+    uint32_t recorders_size;
+    rt_binding_t *analyzers;
+    uint32_t analyzers_size;
+    rt_binding_t *streams;
+    uint32_t streams_size;
+} rt_snapshot_t;
+
+typedef void (*rt_free_t)(void *ptr);
+
+// data RT thread may still read, freed by rt_reclaim()
+typedef struct rt_garbage_t {
+    rt_free_t free;
+    void *ptr;
+    bool callback_visible; // used by "process" callback section or its JS side
+    bool pending; // still may be published, epochs is taken on next publishing
+    uint32_t callback_epoch;
+    uint32_t native_epoch;
+    struct rt_garbage_t *next;
+} rt_garbage_t;
+
+// open-addressing hash table of own ports short names
+typedef struct {
+    int32_t *slots; // index in own ports list or -1 for empty slot
+    uint32_t mask; // slots count - 1, slots count is power of 2
+} own_ports_hash_t;
+
+// stable port handles returned by register*PortSync(), slots of
+// unregistered ports is reused with next generation, so old handles fail
+typedef struct {
+    jack_port_t *port; // 0 if port is unregistered
+    bool output;
+    bool midi;
+    int32_t index; // index in own in/out ports list (audio ports only)
+    uint32_t generation;
+    int32_t next_free; // next free slot or -1
+} port_handle_t;
+
+// buffers layout of "process" callback
+typedef enum {
+    PROCESS_LAYOUT_PORTS = 0, // object of port name:Float32Array
+    PROCESS_LAYOUT_INTERLEAVED, // single Float32Array of frames of all channels
+    PROCESS_LAYOUT_PLANAR // single Float32Array of channels one after another
+} process_layout_t;
+
+class JackClient;
+
+/**
+ * Everything that belongs to one JACK-client
+ *
+ * Module-level functions works with default client, every JackClient
+ * instance has its own state. All the code below accesses it by "cs"
+ * pointer of current thread, see client_scope_t.
+ */
+typedef struct {
+    JackClient *wrap; // 0 for default client
+
+    jack_client_t *client;
+    short client_active;
+    char client_name[STR_SIZE];
+
+    char **own_in_ports;
+    char **own_in_ports_short_names;
+    uint32_t own_in_ports_size;
+    char **own_out_ports;
+    char **own_out_ports_short_names;
+    uint32_t own_out_ports_size;
+
+    jack_port_t **own_in_jack_ports; // in order of own ports lists
+    jack_port_t **own_out_jack_ports;
+
+    // everything RT thread reads, see publish_rt_snapshot()
+    rt_snapshot_t * volatile rt_snapshot;
+    rt_snapshot_t *cycle_snapshot; // of the cycle that waits for "process" callback
+    rt_section_t callback_section; // waits for JS thread, so JS thread never waits for it
+    rt_section_t native_section; // rest of the cycle
+    rt_garbage_t *rt_garbage;
+    bool in_process_callback; // JS side of "process" callback is running
+
+    own_ports_hash_t own_in_ports_hash;
+    own_ports_hash_t own_out_ports_hash;
+
+    port_handle_t *port_handles;
+    uint32_t port_handles_size;
+    uint32_t port_handles_capacity;
+    int32_t port_handles_free; // first free slot or -1
+    jack_port_t *unregistering_port; // skipped by get_own_ports(), see unregister_own_port()
+
+    Persistent<Function> processCallback;
+    Persistent<Function> closeCallback;
+
+    // pooled capture/playback objects of "process" callback
+    Persistent<Object> capturePool;
+    Persistent<Object> playbackPool;
+    Persistent<Object> *capturePoolBufs;
+    Persistent<Object> *playbackPoolBufs;
+    jack_default_audio_sample_t **capture_pool_data;
+    jack_default_audio_sample_t **playback_pool_data;
+    uint32_t process_pool_in_size;
+    uint32_t process_pool_out_size;
+    jack_nframes_t process_pool_frames;
+
+    // transport object of "process" callback, updated in place every cycle
+    Persistent<Object> transportPool;
+    Persistent<Object> transportBbtPool;
+
+    process_layout_t process_layout;
+    // interleaved layout only: buffers of pooled array, silence for missing
+    // capture buffers and scratch for missing playback buffers
+    jack_default_audio_sample_t *capture_frames_data;
+    jack_default_audio_sample_t *playback_frames_data;
+    jack_default_audio_sample_t *process_pool_silence;
+    jack_default_audio_sample_t **process_pool_in_bufs;
+    jack_default_audio_sample_t **process_pool_out_bufs;
+
+    // own MIDI ports (audio own ports tables have only audio ports)
+    jack_port_t **own_midi_in_ports;
+    char **own_midi_in_short_names;
+    uint32_t own_midi_in_size;
+    jack_port_t **own_midi_out_ports;
+    char **own_midi_out_short_names;
+    uint32_t own_midi_out_size;
+
+    // pooled packed MIDI events buffers of "process" callback
+    Persistent<Object> midiInPool;
+    Persistent<Object> midiOutPool;
+    Persistent<Object> *midiInPoolBufs;
+    Persistent<Object> *midiOutPoolBufs;
+    char **midi_in_pool_data;
+    char **midi_out_pool_data;
+    uint32_t midi_pool_in_size;
+    uint32_t midi_pool_out_size;
+    volatile uint32_t midi_lost_events;
+
+    bool hasProcessCallback; // TODO unbind process callback and check for memory leak
+    bool hasCloseCallback;
+    bool process;
+    bool closing;
+    uv_work_t *baton;
+    jack_nframes_t baton_nframes;
+    jack_nframes_t buffer_size; // period size that all buffers is allocated for
+    volatile jack_nframes_t buffer_size_pending; // announced by JACK, not applied yet
+    uv_work_t *close_baton;
+    uint32_t port_batches_pending; // client can't be closed until 0
+    uv_sem_t semaphore;
+
+    // ring buffer process mode (RT thread never waits for JS)
+    bool ringbuffer_mode;
+    uint16_t ringbuffer_periods;
+    ringbuffers_t *ringbuffers;
+    volatile uint32_t ringbuffer_pending; // periods captured but not processed yet
+    volatile uint32_t ringbuffer_overruns;
+    volatile uint32_t ringbuffer_underruns;
+    bool ringbuffer_inited;
+    uv_async_t ringbuffer_async;
+
+    // DSP worker mode (user script in separate V8 isolate on its own thread)
+    bool dsp_worker_mode;
+    volatile bool dsp_worker_stop;
+    bool dsp_worker_failed;
+    jack_native_thread_t dsp_worker_thread;
+    uv_sem_t dsp_worker_request; // RT thread -> worker, cycle buffers is ready
+    uv_sem_t dsp_worker_done; // worker -> RT thread, cycle is processed
+    char *dsp_worker_source;
+    char dsp_worker_script_path[STR_SIZE];
+    char dsp_worker_error[STR_SIZE];
+    jack_nframes_t dsp_worker_nframes;
+    rt_snapshot_t *dsp_worker_snapshot; // of the cycle worker is processing
+    volatile uint32_t dsp_worker_errors;
+    uint32_t own_ports_version; // incremented on every own ports list change
+
+    // native DSP graph, compiled program is published with RT snapshot
+    dsp_graph_t dsp_graph;
+    dsp_program_t *dsp_program;
+    jack_ringbuffer_t *dsp_automation_queue; // dsp_automation_event_t, JS -> RT thread
+    volatile uint32_t dsp_automation_dropped; // node had too many pending events
+    dsp_pool_t *dsp_pool; // threads for independent groups, published with RT snapshot
+
+    // native recorders, index is recording id (0 for finished recordings)
+    recorder_t **recorders;
+    uint32_t recorders_size;
+    uint32_t recorders_capacity;
+
+    // native file players, index is player id (0 for destroyed players)
+    player_t **players;
+    uint32_t players_size;
+    uint32_t players_capacity;
+
+    // native level meters of own audio ports, 0 if disabled
+    meters_t *meters;
+
+    // native spectrum analyzers, index is analyzer id (0 for destroyed analyzers)
+    analyzer_t **analyzers;
+    uint32_t analyzers_size;
+    uint32_t analyzers_capacity;
+
+    // native resampling streams, index is stream id (0 for destroyed streams)
+    stream_t **streams;
+    uint32_t streams_size;
+    uint32_t streams_capacity;
+
+    // processors is detached from RT thread while they grow for new buffer size
+    bool processors_detached;
+    bool players_detached; // with other processors, on client close
+
+    // transport position of cycles, timebase master tempo
+    transport_t transport;
+    bool timebase_master;
+
+    // realtime instrumentation, see getStatsSync()
+    stats_histogram_t cycle_stats; // whole jack_process()
+    stats_histogram_t callback_stats; // "process" callback (JS thread)
+    stats_histogram_t wait_stats; // RT thread waiting for JS callback or worker
+    volatile uint32_t stats_cycles;
+    volatile uint32_t stats_skipped_cycles; // "process" callback skipped, buffer size was changing
+    volatile uint32_t stats_xruns;
+    volatile float stats_max_xrun_delay; // microseconds
+
+    // cached mirror of JACK ports graph
+    port_graph_t port_graph;
+
+    // JACK notifications for JS (see bindNotificationsSync())
+    Persistent<Function> notifyCallback;
+    volatile bool hasNotifyCallback;
+    bool notify_inited;
+    uv_async_t notify_async;
+    volatile uint32_t notify_wakeup_pending;
+    notify_queue_t notify_queue;
+
+    uint32_t handles_closing; // uv handles to wait for before freeing state
+} client_state_t;
+
+// state of client current thread works with
+__thread client_state_t *cs = 0;
+client_state_t *default_client_state = 0;
+
+/**
+ * Make state current until the end of block
+ *
+ * Restores previous one, so JS callback of one client may call
+ * methods of another one.
+ *
+ * @private
+ */
+class client_scope_t { // {{{1
+public:
+    client_scope_t(client_state_t *state) : previous(cs) { cs = state; }
+    ~client_scope_t() { cs = previous; }
+private:
+    client_state_t *previous;
+}; // client_scope_t }}}1
+
+/**
+ * Additional JACK-client for JS, has the same methods as module
+ *
+ * @public
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   var second = new jackConnector.JackClient();
+ *   second.openClientSync('second_client');
+ *   second.registerOutPortSync('out_1');
+ *   second.activateSync();
+ */
+class JackClient : public node::ObjectWrap { // {{{1
+public:
+    client_state_t *state;
+
+    JackClient();
+    ~JackClient();
+    static Handle<Value> New(const Arguments &args);
+
+    // keep JS object alive while client is opened
+    void Hold() { Ref(); }
+    void Release() { Unref(); }
+}; // JackClient }}}1
 
-char **own_in_ports;
-char **own_in_ports_short_names;
-uint8_t own_in_ports_size = 0;
-char **own_out_ports;
-char **own_out_ports_short_names;
-uint8_t own_out_ports_size = 0;
+client_state_t* new_client_state();
+void free_client_state(client_state_t *state);
+client_state_t* get_client_state(const Arguments &args);
 
-jack_port_t *capture_ports[MAX_PORTS];
-jack_port_t *playback_ports[MAX_PORTS];
-jack_default_audio_sample_t *capture_buf[MAX_PORTS];
-jack_default_audio_sample_t *playback_buf[MAX_PORTS];
+#define USE_CLIENT_STATE() client_scope_t client_scope(get_client_state(args))
+
+Persistent<Function> float32ArrayConstructor;
+Persistent<FunctionTemplate> jackClientTemplate;
+
+uint32_t add_port_handle(jack_port_t *port, bool output, bool midi);
+void remove_port_handle(uint32_t handle);
+port_handle_t* get_port_handle(uint32_t handle);
+bool find_port_handle(jack_port_t *port, uint32_t *handle);
+jack_port_t* get_port_by_handle(uint32_t handle);
+bool is_audio_port_handle(uint32_t handle);
 
 Handle<Array> get_ports(bool withOwn, unsigned long flags);
 int check_port_connection(const char *src_port_name, const char *dst_port_name);
 bool check_port_exists(char *check_port_name, unsigned long flags);
 void get_own_ports();
 void reset_own_ports_list();
+void build_own_ports_hash(own_ports_hash_t *hash, char **short_names, uint32_t size);
+void reset_port_handles_indexes();
+void free_own_ports_registry();
+int32_t find_own_port_index(
+    own_ports_hash_t *hash, char **short_names, const char *short_name);
 int jack_process(jack_nframes_t nframes, void *arg);
 
-Persistent<Function> processCallback;
-Persistent<Function> closeCallback;
-bool hasProcessCallback = false; // TODO unbind process callback and check for memory leak
-bool hasCloseCallback = false;
-bool process = false;
-bool closing = false;
-uv_work_t *baton;
-uv_work_t *close_baton;
-static uv_sem_t semaphore;
+void publish_rt_snapshot();
+void free_rt_snapshot(void *ptr);
+void rt_retire(rt_free_t free_fn, void *ptr, bool callback_visible);
+void rt_reclaim();
+void rt_synchronize();
+
+Local<Object> new_float32_array(uint32_t length);
+bool is_float32_array(Local<Value> val);
+
+void reset_process_pool(jack_nframes_t nframes);
+void reset_process_frames_pool(jack_nframes_t nframes);
+void reset_midi_pool();
+void free_midi_pool();
+void free_process_pool();
+
+void reset_ringbuffers(); // publish RT snapshot after it
+void free_ringbuffers(void *ptr);
+
+bool start_dsp_worker(const char *script_path);
+void stop_dsp_worker();
+
+const char* update_dsp_program(); // publish RT snapshot after it
+void rt_free_dsp_program(void *ptr);
+void rt_free_dsp_pool(void *ptr);
+
+void detach_all_processors();
+
+void reserve_recorders_frames(jack_nframes_t nframes); // call it with detached processors
+void finish_all_recorders(); // call it with detached processors
+
+void destroy_all_players(); // call it with detached processors
+
+void reset_meters(); // publish RT snapshot after it
+void rt_free_meters(void *ptr);
+
+void reserve_analyzers_frames(jack_nframes_t nframes); // call it with detached processors
+void destroy_all_analyzers(); // call it with detached processors
+
+void reserve_streams_frames(jack_nframes_t nframes); // call it with detached processors
+void destroy_all_streams(); // call it with detached processors
+
+int jack_xrun(void *arg);
+
+void post_notification(
+    notify_type_t type,
+    const char *name,
+    const char *other,
+    uint32_t value,
+    float delay);
+void set_notification_callbacks();
+void init_notifications();
+void wake_notifications();
+void apply_buffer_size(jack_nframes_t nframes);
 
 Handle<Value> deactivateSync(const Arguments &args);
 void uv_work_plug(uv_work_t* task) {}
@@ -116,7 +520,8 @@ Handle<Value> getVersion(const Arguments &args) // {{{1
 Handle<Value> checkClientOpenedSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
-    return scope.Close(Boolean::New(client != 0 && !closing));
+    USE_CLIENT_STATE();
+    return scope.Close(Boolean::New(cs->client != 0 && !cs->closing));
 } // checkClientOpenedSync() }}}1
 
 /**
@@ -131,35 +536,45 @@ Handle<Value> checkClientOpenedSync(const Arguments &args) // {{{1
 Handle<Value> openClientSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
 
-    if (client != 0 || closing)
+    if (cs->client != 0 || cs->closing)
         THROW_ERR("You need close old JACK-client before open new");
 
     String::AsciiValue arg_client_name(args[0]->ToString());
-    char *client_name = *arg_client_name;
+    char *new_client_name = *arg_client_name;
 
     for (unsigned int i=0; ; i++) {
-        if (client_name[i] == '\0' || i>=STR_SIZE-1) {
+        if (new_client_name[i] == '\0' || i>=STR_SIZE-1) {
             if (i==0) {
-                client_name[0] = '\0';
+                new_client_name[0] = '\0';
                 THROW_ERR("Empty JACK-client name");
             }
-            client_name[i] = '\0';
+            new_client_name[i] = '\0';
             break;
         }
 
-        ::client_name[i] = client_name[i];
+        cs->client_name[i] = new_client_name[i];
     }
 
-    client = jack_client_open(client_name, JackNullOption, 0);
-    if (client == 0) {
-        client_name[0] = '\0';
-        ::client_name[0] = '\0';
+    cs->client = jack_client_open(new_client_name, JackNullOption, 0);
+    if (cs->client == 0) {
+        new_client_name[0] = '\0';
+        cs->client_name[0] = '\0';
         THROW_ERR("Couldn't create JACK-client");
     }
 
-    jack_set_process_callback(client, jack_process, 0);
-    process = true;
+    transport_init(&cs->transport);
+    cs->timebase_master = false;
+    jack_set_process_callback(cs->client, jack_process, cs);
+    jack_set_xrun_callback(cs->client, jack_xrun, cs);
+    port_graph_set_client(&cs->port_graph, cs->client);
+    cs->buffer_size = jack_get_buffer_size(cs->client);
+    cs->buffer_size_pending = 0;
+    init_notifications();
+    set_notification_callbacks();
+    cs->process = true;
+    if (cs->wrap) cs->wrap->Hold();
 
     return scope.Close(Undefined());
 } // openClientSync() }}}1
@@ -170,16 +585,16 @@ Handle<Value> openClientSync(const Arguments &args) // {{{1
         { \
             scope.Close(Undefined()); \
             delete task; \
-            close_baton = NULL; \
+            cs->close_baton = NULL; \
         }
 #define UV_CLOSE_TASK_CLEANUP_CALLBACKS() \
         { \
-            if (hasCloseCallback) { \
-                closeCallback->Call(Context::GetCurrent()->Global(), 0, NULL); \
-                hasCloseCallback = false; \
+            if (cs->hasCloseCallback) { \
+                cs->closeCallback->Call(Context::GetCurrent()->Global(), 0, NULL); \
+                cs->hasCloseCallback = false; \
             } \
-            if (hasProcessCallback) { \
-                hasProcessCallback = false; \
+            if (cs->hasProcessCallback) { \
+                cs->hasProcessCallback = false; \
             } \
         }
 #define UV_CLOSE_TASK_STOP() \
@@ -190,13 +605,13 @@ Handle<Value> openClientSync(const Arguments &args) // {{{1
         }
 #define UV_CLOSE_TASK_EXCEPTION(err) \
         { \
-            if (hasCloseCallback) { \
+            if (cs->hasCloseCallback) { \
                 const uint8_t argc = 1; \
                 Local<Value> argv[argc] = { \
                     Local<Value>::New( err ), \
                 }; \
-                closeCallback->Call(Context::GetCurrent()->Global(), argc, argv); \
-                hasCloseCallback = false; \
+                cs->closeCallback->Call(Context::GetCurrent()->Global(), argc, argv); \
+                cs->hasCloseCallback = false; \
             } \
             UV_CLOSE_TASK_STOP(); \
         }
@@ -204,39 +619,99 @@ Handle<Value> openClientSync(const Arguments &args) // {{{1
 void uv_close_task(uv_work_t* task, int status)
 {
     HandleScope scope;
+    client_scope_t client_scope((client_state_t *)task->data);
 
-    if (baton) {
+    // wait for "process" callback and for connectPorts()/disconnectPorts()
+    if (cs->baton || cs->port_batches_pending > 0) {
         UV_CLOSE_TASK_CLEANUP();
         // TODO fix memory leak
-        close_baton = new uv_work_t();
-        uv_queue_work(uv_default_loop(), close_baton, uv_work_plug, uv_close_task);
+        cs->close_baton = new uv_work_t();
+        cs->close_baton->data = cs;
+        uv_queue_work(uv_default_loop(), cs->close_baton, uv_work_plug, uv_close_task);
         return;
     }
 
     // deactivate first if client activated
-    if (client_active) {
-        if (jack_deactivate(client) != 0)
+    if (cs->client_active) {
+        if (jack_deactivate(cs->client) != 0)
             UV_CLOSE_TASK_EXCEPTION(
                 Exception::Error(String::New("Couldn't deactivate JACK-client")));
 
-        client_active = 0;
+        cs->client_active = 0;
     }
 
-    if (jack_client_close(client) != 0)
+    // pool threads is created by the client
+    rt_retire(rt_free_dsp_pool, cs->dsp_pool, false);
+    cs->dsp_pool = 0;
+    publish_rt_snapshot();
+
+    if (jack_client_close(cs->client) != 0)
         UV_CLOSE_TASK_EXCEPTION(
             Exception::Error(String::New("Couldn't close JACK-client")));
 
-    client = 0;
+    cs->client = 0;
+    cs->timebase_master = false; // released by jack_client_close()
+    port_graph_reset(&cs->port_graph);
+
+    if (cs->dsp_worker_mode) stop_dsp_worker();
+    detach_all_processors();
+    finish_all_recorders();
+    destroy_all_players();
+    destroy_all_analyzers();
+    destroy_all_streams();
+    cs->processors_detached = false;
+    cs->players_detached = false;
+
+    if (cs->ringbuffer_mode) {
+        cs->ringbuffer_mode = false;
+        rt_retire(free_ringbuffers, cs->ringbuffers, true);
+        cs->ringbuffers = 0;
+    }
+    cs->own_in_ports_size = 0;
+    cs->own_out_ports_size = 0;
+    delete [] cs->own_in_jack_ports;
+    delete [] cs->own_out_jack_ports;
+    cs->own_in_jack_ports = 0;
+    cs->own_out_jack_ports = 0;
+    for (uint32_t i=0; i<cs->own_midi_in_size; i++) delete [] cs->own_midi_in_short_names[i];
+    for (uint32_t i=0; i<cs->own_midi_out_size; i++) delete [] cs->own_midi_out_short_names[i];
+    delete [] cs->own_midi_in_ports;
+    delete [] cs->own_midi_in_short_names;
+    delete [] cs->own_midi_out_ports;
+    delete [] cs->own_midi_out_short_names;
+    cs->own_midi_in_ports = 0;
+    cs->own_midi_in_short_names = 0;
+    cs->own_midi_out_ports = 0;
+    cs->own_midi_out_short_names = 0;
+    cs->own_midi_in_size = 0;
+    cs->own_midi_out_size = 0;
+    dsp_graph_clear(&cs->dsp_graph);
+    rt_retire(rt_free_dsp_program, cs->dsp_program, false);
+    cs->dsp_program = 0;
+    rt_retire(rt_free_meters, cs->meters, false);
+    cs->meters = 0;
+    // RT thread is stopped, so everything is freed right now
+    publish_rt_snapshot();
+
+    free_process_pool();
+    if (!cs->transportPool.IsEmpty()) {
+        cs->transportPool.Dispose();
+        cs->transportPool.Clear();
+        cs->transportBbtPool.Dispose();
+        cs->transportBbtPool.Clear();
+    }
+    free_own_ports_registry();
 
     UV_CLOSE_TASK_CLEANUP_CALLBACKS();
 
     // TODO cleanup stuff
 
-    closing = false;
+    cs->closing = false;
 
     scope.Close(Undefined());
     delete task;
-    close_baton = NULL;
+    cs->close_baton = NULL;
+    if (cs->wrap) cs->wrap->Release();
 } // uv_close_task() }}}1
 
 /**
@@ -255,25 +730,27 @@ void uv_close_task(uv_work_t* task, int status)
 Handle<Value> closeClient(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
 
-    if (closing) {
+    if (cs->closing) {
         THROW_ERR("Already started closing JACK-client");
     } else {
-        closing = true;
+        cs->closing = true;
     }
 
-    if (client == 0) THROW_ERR("JACK-client already closed");
+    if (cs->client == 0) THROW_ERR("JACK-client already closed");
 
-    process = false;
+    cs->process = false;
 
     if (args[0]->IsFunction()) {
         Local<Function> callback = Local<Function>::Cast( args[0] );
-        closeCallback = Persistent<Function>::New( callback );
-        hasCloseCallback = true;
+        cs->closeCallback = Persistent<Function>::New( callback );
+        cs->hasCloseCallback = true;
     }
 
-    close_baton = new uv_work_t();
-    uv_queue_work(uv_default_loop(), close_baton, uv_work_plug, uv_close_task);
+    cs->close_baton = new uv_work_t();
+    cs->close_baton->data = cs;
+    uv_queue_work(uv_default_loop(), cs->close_baton, uv_work_plug, uv_close_task);
 
     return scope.Close(Undefined());
 } // closeClient() }}}1
@@ -283,7 +760,7 @@ Handle<Value> closeClient(const Arguments &args) // {{{1
  *
  * @public
  * @param {v8::String} port_name Full port name
- * @param {v8::Integer} port_type See: enum jack_flags
+ * @returns {v8::Integer} handle Stable port handle
  * @example
  *   var jackConnector = require('jack-connector');
  *   jackConnector.openClientSync('JACK_connector_client_name');
@@ -293,86 +770,216 @@ Handle<Value> closeClient(const Arguments &args) // {{{1
 Handle<Value> registerInPortSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
     String::AsciiValue port_name(args[0]->ToString());
 
-    capture_ports[own_in_ports_size] = jack_port_register(
-        client,
+    jack_port_t *port = jack_port_register(
+        cs->client,
         *port_name,
         JACK_DEFAULT_AUDIO_TYPE,
         JackPortIsInput,
         0
     );
+    if (port == 0) THROW_ERR("Couldn't register JACK-port");
+
+    uint32_t handle = add_port_handle(port, false, false);
 
     reset_own_ports_list();
 
-    return scope.Close(Undefined());
+    return scope.Close(Integer::NewFromUnsigned(handle));
 } // registerInPortSync() }}}1
 
+/**
+ * Register new MIDI input port for this client
+ *
+ * Events of MIDI input ports is passed to "process" callback (5th argument)
+ * as packed buffers, see bindProcessSync().
+ *
+ * @public
+ * @param {v8::String} port_name Port name
+ * @returns {v8::Integer} handle Stable port handle (for unregisterPortSync())
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   jackConnector.openClientSync('JACK_connector_client_name');
+ *   jackConnector.registerMidiInPortSync('midi_in');
+ */
+Handle<Value> registerMidiInPortSync(const Arguments &args) // {{{1
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    String::AsciiValue port_name(args[0]->ToString());
+
+    jack_port_t *port = jack_port_register(
+        cs->client,
+        *port_name,
+        JACK_DEFAULT_MIDI_TYPE,
+        JackPortIsInput,
+        0
+    );
+    if (port == 0) THROW_ERR("Couldn't register JACK-port");
+
+    uint32_t handle = add_port_handle(port, false, true);
+
+    reset_own_ports_list();
+
+    return scope.Close(Integer::NewFromUnsigned(handle));
+} // registerMidiInPortSync() }}}1
+
+/**
+ * Register new MIDI output port for this client
+ *
+ * Events for MIDI output ports is written by "process" callback to packed
+ * buffers (6th argument), see bindProcessSync().
+ *
+ * @public
+ * @param {v8::String} port_name Port name
+ * @returns {v8::Integer} handle Stable port handle (for unregisterPortSync())
+ */
+Handle<Value> registerMidiOutPortSync(const Arguments &args) // {{{1
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    String::AsciiValue port_name(args[0]->ToString());
+
+    jack_port_t *port = jack_port_register(
+        cs->client,
+        *port_name,
+        JACK_DEFAULT_MIDI_TYPE,
+        JackPortIsOutput,
+        0
+    );
+    if (port == 0) THROW_ERR("Couldn't register JACK-port");
+
+    uint32_t handle = add_port_handle(port, true, true);
+
+    reset_own_ports_list();
+
+    return scope.Close(Integer::NewFromUnsigned(handle));
+} // registerMidiOutPortSync() }}}1
+
 /**
  * Register new port for this client
  *
+ * Returned handle may be used instead of port name as key of object
+ * returned from "process" callback and for unregisterPortSync().
+ *
  * @public
  * @param {v8::String} port_name Full port name
+ * @returns {v8::Integer} handle Stable port handle
  * @example
  *   var jackConnector = require('jack-connector');
  *   jackConnector.openClientSync('JACK_connector_client_name');
- *   jackConnector.registerOutPortSync('out_1');
- *   jackConnector.registerOutPortSync('out_2');
+ *   var out1 = jackConnector.registerOutPortSync('out_1');
+ *   var out2 = jackConnector.registerOutPortSync('out_2');
  */
 Handle<Value> registerOutPortSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
     String::AsciiValue port_name(args[0]->ToString());
 
-    playback_ports[own_out_ports_size] = jack_port_register(
-        client,
+    jack_port_t *port = jack_port_register(
+        cs->client,
         *port_name,
         JACK_DEFAULT_AUDIO_TYPE,
         JackPortIsOutput,
         0
     );
+    if (port == 0) THROW_ERR("Couldn't register JACK-port");
+
+    uint32_t handle = add_port_handle(port, true, false);
 
     reset_own_ports_list();
 
-    return scope.Close(Undefined());
+    return scope.Close(Integer::NewFromUnsigned(handle));
 } // registerOutPortSync() }}}1
 
+/**
+ * Remove own port from RT thread and unregister it
+ *
+ * JACK may free port right away, so RT snapshot without the port is
+ * published and RT thread is waited for before unregistering.
+ * Port handle is freed only if port is unregistered.
+ *
+ * @private
+ * @param {jack_port_t} port
+ * @param {bool} has_handle
+ * @param {uint32_t} handle Handle of the port (if it has one)
+ * @returns {bool} false if JACK couldn't unregister it (nothing is changed then)
+ */
+bool unregister_own_port(jack_port_t *port, bool has_handle, uint32_t handle) // {{{1
+{
+    port_handle_t *port_handle = has_handle ? get_port_handle(handle) : 0;
+    if (port_handle != 0) port_handle->port = 0;
+
+    cs->unregistering_port = port;
+    reset_own_ports_list();
+    // "process" callback section gets port buffers in native section too
+    rt_synchronize();
+
+    bool unregistered = jack_port_unregister(cs->client, port) == 0;
+    cs->unregistering_port = 0;
+
+    if (port_handle != 0) {
+        port_handle->port = port;
+        if (unregistered) remove_port_handle(handle);
+    }
+    if (!unregistered) reset_own_ports_list();
+
+    return unregistered;
+} // unregister_own_port() }}}1
+
 /**
  * Unregister port for this client
  *
  * @public
- * @param {v8::String} port_name Full port name
+ * @param {v8::String|v8::Integer} port_name Own port name or port handle
  * @example
  *   var jackConnector = require('jack-connector');
  *   jackConnector.openClientSync('JACK_connector_client_name');
  *   jackConnector.registerOutPortSync('out_1');
- *   jackConnector.registerOutPortSync('out_2');
+ *   var out2 = jackConnector.registerOutPortSync('out_2');
  *   jackConnector.unregisterPortSync('out_1');
- *   jackConnector.unregisterPortSync('out_2');
+ *   jackConnector.unregisterPortSync(out2);
  * @TODO deactivating (for stop processing before update ports list)
  * @TODO remove port from ports list
  */
 Handle<Value> unregisterPortSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
+    if (args[0]->IsNumber()) {
+        uint32_t handle = args[0]->Uint32Value();
+        jack_port_t *port = get_port_by_handle(handle);
+        if (port == 0) THROW_ERR("Unknown JACK-port handle");
+
+        if (!unregister_own_port(port, true, handle)) THROW_ERR("Couldn't unregister JACK-port");
+
+        return scope.Close(Undefined());
+    }
+
     String::AsciiValue arg_port_name(args[0]->ToString());
     char full_port_name[STR_SIZE];
     char *port_name = *arg_port_name;
 
     for (int i=0, n=0, m=0; ; i++, m++) {
         if (n == 0) {
-            if (::client_name[m] == '\0') {
+            if (cs->client_name[m] == '\0') {
                 full_port_name[i] = ':';
                 m = -1;
                 n = 1;
             } else {
-                full_port_name[i] = ::client_name[m];
+                full_port_name[i] = cs->client_name[m];
             }
         } else {
             if (port_name[m] == '\0') {
@@ -384,14 +991,12 @@ Handle<Value> unregisterPortSync(const Arguments &args) // {{{1
         }
     }
 
-    jack_port_t *port = jack_port_by_name(client, full_port_name);
-
-    if (jack_port_unregister(client, port) != 0)
-        THROW_ERR("Couldn't unregister JACK-port");
-
-    // .....
+    jack_port_t *port = jack_port_by_name(cs->client, full_port_name);
+    if (port == 0) THROW_ERR("Non existing JACK-port");
 
-    reset_own_ports_list();
+    uint32_t handle;
+    bool has_handle = find_port_handle(port, &handle);
+    if (!unregister_own_port(port, has_handle, handle)) THROW_ERR("Couldn't unregister JACK-port");
 
     return scope.Close(Undefined());
 } // unregisterPortSync() }}}1
@@ -411,9 +1016,10 @@ Handle<Value> unregisterPortSync(const Arguments &args) // {{{1
 Handle<Value> checkActiveSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
-    if (::client_active > 0) {
+    if (cs->client_active > 0) {
         return scope.Close(Boolean::New(true));
     } else {
         return scope.Close(Boolean::New(false));
@@ -432,13 +1038,17 @@ Handle<Value> checkActiveSync(const Arguments &args) // {{{1
 Handle<Value> activateSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
-    if (client_active) THROW_ERR("JACK-client already activated");
+    if (cs->client_active) THROW_ERR("JACK-client already activated");
+
+    if (jack_activate(cs->client) != 0) THROW_ERR("Couldn't activate JACK-client");
 
-    if (jack_activate(client) != 0) THROW_ERR("Couldn't activate JACK-client");
+    cs->client_active = 1;
 
-    client_active = 1;
+    // graph notifications is delivered to active client only
+    port_graph_sync(&cs->port_graph);
 
     return scope.Close(Undefined());
 } // activateSync() }}}1
@@ -456,13 +1066,15 @@ Handle<Value> activateSync(const Arguments &args) // {{{1
 Handle<Value> deactivateSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
-    if (! client_active) THROW_ERR("JACK-client is not active");
+    if (! cs->client_active) THROW_ERR("JACK-client is not active");
 
-    if (jack_deactivate(client) != 0) THROW_ERR("Couldn't deactivate JACK-client");
+    if (jack_deactivate(cs->client) != 0) THROW_ERR("Couldn't deactivate JACK-client");
 
-    client_active = 0;
+    cs->client_active = 0;
+    port_graph_reset(&cs->port_graph);
 
     return scope.Close(Undefined());
 } // deactivateSync() }}}1
@@ -482,24 +1094,25 @@ Handle<Value> deactivateSync(const Arguments &args) // {{{1
 Handle<Value> connectPortSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
-    if (! client_active) THROW_ERR("JACK-client is not active");
+    if (! cs->client_active) THROW_ERR("JACK-client is not active");
 
     String::AsciiValue src_port_name(args[0]->ToString());
-    jack_port_t *src_port = jack_port_by_name(client, *src_port_name);
+    jack_port_t *src_port = jack_port_by_name(cs->client, *src_port_name);
     if (! src_port) THROW_ERR("Non existing source port");
 
     String::AsciiValue dst_port_name(args[1]->ToString());
-    jack_port_t *dst_port = jack_port_by_name(client, *dst_port_name);
+    jack_port_t *dst_port = jack_port_by_name(cs->client, *dst_port_name);
     if (! dst_port) THROW_ERR("Non existing destination port");
 
-    if (! client_active
-    && (jack_port_is_mine(client, src_port) || jack_port_is_mine(client, dst_port))) {
+    if (! cs->client_active
+    && (jack_port_is_mine(cs->client, src_port) || jack_port_is_mine(cs->client, dst_port))) {
         THROW_ERR("Jack client must be activated to connect own ports");
     }
 
-    int error = jack_connect(client, *src_port_name, *dst_port_name);
+    int error = jack_connect(cs->client, *src_port_name, *dst_port_name);
     if (error != 0 && error != EEXIST) THROW_ERR("Failed to connect ports");
 
     return scope.Close(Undefined());
@@ -520,26 +1133,258 @@ Handle<Value> connectPortSync(const Arguments &args) // {{{1
 Handle<Value> disconnectPortSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
-    if (! client_active) THROW_ERR("JACK-client is not active");
+    if (! cs->client_active) THROW_ERR("JACK-client is not active");
 
     String::AsciiValue src_port_name(args[0]->ToString());
-    jack_port_t *src_port = jack_port_by_name(client, *src_port_name);
+    jack_port_t *src_port = jack_port_by_name(cs->client, *src_port_name);
     if (! src_port) THROW_ERR("Non existing source port");
 
     String::AsciiValue dst_port_name(args[1]->ToString());
-    jack_port_t *dst_port = jack_port_by_name(client, *dst_port_name);
+    jack_port_t *dst_port = jack_port_by_name(cs->client, *dst_port_name);
     if (! dst_port) THROW_ERR("Non existing destination port");
 
-    if (check_port_connection(*src_port_name, *dst_port_name)) {
-        if (jack_disconnect(client, *src_port_name, *dst_port_name))
+    if (jack_port_connected_to(src_port, *dst_port_name)) {
+        if (jack_disconnect(cs->client, *src_port_name, *dst_port_name))
             THROW_ERR("Failed to disconnect ports");
     }
 
     return scope.Close(Undefined());
 } // disconnectPortSync() }}}1
 
+// connectPorts(), disconnectPorts() {{{1
+
+typedef enum {
+    PORT_BATCH_OK = 0,
+    PORT_BATCH_NO_SOURCE,
+    PORT_BATCH_NO_DESTINATION,
+    PORT_BATCH_FAILED
+} port_batch_result_t;
+
+typedef struct {
+    bool disconnect;
+    uint32_t count;
+    char **src_names;
+    char **dst_names;
+    port_batch_result_t *results;
+    Persistent<Function> callback;
+    client_state_t *state;
+} port_batch_t;
+
+/**
+ * Connect/disconnect all pairs of batch (in libuv thread pool)
+ *
+ * Pairs that already in requested state is skipped,
+ * so JACK graph is reordered only for real changes.
+ *
+ * @private
+ */
+void uv_port_batch_work(uv_work_t* task) // {{{2
+{
+    port_batch_t *batch = (port_batch_t *)task->data;
+    client_scope_t client_scope(batch->state);
+
+    for (uint32_t i=0; i<batch->count; i++) {
+        jack_port_t *src_port = jack_port_by_name(cs->client, batch->src_names[i]);
+        if (! src_port) {
+            batch->results[i] = PORT_BATCH_NO_SOURCE;
+            continue;
+        }
+
+        if (! jack_port_by_name(cs->client, batch->dst_names[i])) {
+            batch->results[i] = PORT_BATCH_NO_DESTINATION;
+            continue;
+        }
+
+        bool connected = jack_port_connected_to(src_port, batch->dst_names[i]);
+        if (batch->disconnect) {
+            if (connected
+            && jack_disconnect(cs->client, batch->src_names[i], batch->dst_names[i]) != 0) {
+                batch->results[i] = PORT_BATCH_FAILED;
+                continue;
+            }
+        } else if (! connected) {
+            int error = jack_connect(cs->client, batch->src_names[i], batch->dst_names[i]);
+            if (error != 0 && error != EEXIST) {
+                batch->results[i] = PORT_BATCH_FAILED;
+                continue;
+            }
+        }
+
+        batch->results[i] = PORT_BATCH_OK;
+    }
+} // uv_port_batch_work() }}}2
+
+/**
+ * Report results of batch to callback (in main thread)
+ *
+ * @private
+ */
+void uv_port_batch_done(uv_work_t* task, int status) // {{{2
+{
+    HandleScope scope;
+
+    port_batch_t *batch = (port_batch_t *)task->data;
+    client_scope_t client_scope(batch->state);
+
+    Local<Array> results = Array::New(batch->count);
+    for (uint32_t i=0; i<batch->count; i++) {
+        Local<Value> result;
+        switch (batch->results[i]) {
+            case PORT_BATCH_OK:
+                result = Local<Value>::New(Null());
+                break;
+            case PORT_BATCH_NO_SOURCE:
+                result = Exception::Error(String::New("Non existing source port"));
+                break;
+            case PORT_BATCH_NO_DESTINATION:
+                result = Exception::Error(String::New("Non existing destination port"));
+                break;
+            default:
+                result = Exception::Error(String::New(batch->disconnect
+                    ? "Failed to disconnect ports"
+                    : "Failed to connect ports"));
+        }
+        results->Set(i, result);
+    }
+
+    for (uint32_t i=0; i<batch->count; i++) {
+        delete [] batch->src_names[i];
+        delete [] batch->dst_names[i];
+    }
+    delete [] batch->src_names;
+    delete [] batch->dst_names;
+    delete [] batch->results;
+
+    Persistent<Function> callback = batch->callback;
+    delete batch;
+    delete task;
+    cs->port_batches_pending--;
+
+    if (! callback.IsEmpty()) {
+        const uint8_t argc = 2;
+        Local<Value> argv[argc] = {
+            Local<Value>::New( Null() ),
+            results
+        };
+        TryCatch try_catch;
+        callback->Call(Context::GetCurrent()->Global(), argc, argv);
+        callback.Dispose();
+        if (try_catch.HasCaught()) node::FatalException(try_catch);
+    }
+
+    scope.Close(Undefined());
+} // uv_port_batch_done() }}}2
+
+char* copy_port_name(Local<Value> val) // {{{2
+{
+    String::Utf8Value name(val->ToString());
+    char *copy = new char[name.length() + 1];
+    memcpy(copy, *name, name.length() + 1);
+    return copy;
+} // copy_port_name() }}}2
+
+/**
+ * Start batch of connect/disconnect in libuv thread pool
+ *
+ * @private
+ */
+Handle<Value> queue_port_batch(const Arguments &args, bool disconnect) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    if (cs->closing) THROW_ERR("JACK-client is closing");
+    if (! cs->client_active) THROW_ERR("JACK-client is not active");
+    if (! args[0]->IsArray()) THROW_ERR("Pairs must be an array");
+
+    Local<Array> pairs = Local<Array>::Cast( args[0] );
+    for (uint32_t i=0; i<pairs->Length(); i++) {
+        Local<Value> pair = pairs->Get(i);
+        if (! pair->IsArray() || Local<Array>::Cast(pair)->Length() != 2)
+            THROW_ERR("Every pair must be an array of source and destination ports names");
+    }
+
+    port_batch_t *batch = new port_batch_t();
+    batch->state = cs;
+    batch->disconnect = disconnect;
+    batch->count = pairs->Length();
+    batch->src_names = new char*[batch->count];
+    batch->dst_names = new char*[batch->count];
+    batch->results = new port_batch_result_t[batch->count];
+    for (uint32_t i=0; i<batch->count; i++) {
+        Local<Array> pair = Local<Array>::Cast( pairs->Get(i) );
+        batch->src_names[i] = copy_port_name(pair->Get(0));
+        batch->dst_names[i] = copy_port_name(pair->Get(1));
+    }
+    if (args[1]->IsFunction()) {
+        batch->callback = Persistent<Function>::New( Local<Function>::Cast(args[1]) );
+    }
+
+    uv_work_t *task = new uv_work_t();
+    task->data = batch;
+    cs->port_batches_pending++;
+    uv_queue_work(uv_default_loop(), task, uv_port_batch_work, uv_port_batch_done);
+
+    return scope.Close(Undefined());
+} // queue_port_batch() }}}2
+
+/**
+ * Connect many pairs of ports asynchronously
+ *
+ * All pairs is connected by one task in libuv thread pool,
+ * so event loop is not blocked by JACK server requests.
+ * Callback receives per-pair results: null for connected pair
+ * (or already connected) or Error.
+ *
+ * @public
+ * @param {v8::Array} pairs Array of [sourcePort, destinationPort] full names
+ * @param {v8::Function} [callback] function (err, results)
+ * @async
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   jackConnector.openClientSync('JACK_connector_client_name');
+ *   jackConnector.activateSync();
+ *   jackConnector.connectPorts([
+ *     ['system:capture_1', 'system:playback_1'],
+ *     ['system:capture_2', 'system:playback_2']
+ *   ], function (err, results) {
+ *     results.forEach(function (err, i) {
+ *       if (err) console.error('pair #' + i + ':', err.message);
+ *     });
+ *   });
+ */
+Handle<Value> connectPorts(const Arguments &args) // {{{2
+{
+    return queue_port_batch(args, false);
+} // connectPorts() }}}2
+
+/**
+ * Disconnect many pairs of ports asynchronously
+ *
+ * @public
+ * @param {v8::Array} pairs Array of [sourcePort, destinationPort] full names
+ * @param {v8::Function} [callback] function (err, results)
+ * @async
+ * @see connectPorts()
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   jackConnector.openClientSync('JACK_connector_client_name');
+ *   jackConnector.activateSync();
+ *   jackConnector.disconnectPorts([
+ *     ['system:capture_1', 'system:playback_1']
+ *   ], function (err, results) {});
+ */
+Handle<Value> disconnectPorts(const Arguments &args) // {{{2
+{
+    return queue_port_batch(args, true);
+} // disconnectPorts() }}}2
+
+// connectPorts(), disconnectPorts() }}}1
+
 /**
  * Get all JACK-ports list
  *
@@ -556,6 +1401,7 @@ Handle<Value> disconnectPortSync(const Arguments &args) // {{{1
 Handle<Value> getAllPortsSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
     bool withOwn = true;
@@ -583,6 +1429,7 @@ Handle<Value> getAllPortsSync(const Arguments &args) // {{{1
 Handle<Value> getOutPortsSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
     bool withOwn = true;
@@ -610,6 +1457,7 @@ Handle<Value> getOutPortsSync(const Arguments &args) // {{{1
 Handle<Value> getInPortsSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
     bool withOwn = true;
@@ -639,6 +1487,7 @@ Handle<Value> getInPortsSync(const Arguments &args) // {{{1
 Handle<Value> portExistsSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
     String::AsciiValue checkPortName_arg(args[0]->ToString());
@@ -664,6 +1513,7 @@ Handle<Value> portExistsSync(const Arguments &args) // {{{1
 Handle<Value> outPortExistsSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
     String::AsciiValue checkPortName_arg(args[0]->ToString());
@@ -689,6 +1539,7 @@ Handle<Value> outPortExistsSync(const Arguments &args) // {{{1
 Handle<Value> inPortExistsSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
     String::AsciiValue checkPortName_arg(args[0]->ToString());
@@ -698,89 +1549,2763 @@ Handle<Value> inPortExistsSync(const Arguments &args) // {{{1
 } // inPortExistsSync() }}}1
 
 /**
- * Bind callback for JACK process
+ * Get full names of ports connected to port
  *
  * @public
- * @param {v8::Function} callback
+ * @param {v8::String} portName Full port name
+ * @returns {v8::Array} connections Array of full ports names strings
  * @example
  *   var jackConnector = require('jack-connector');
  *   jackConnector.openClientSync('JACK_connector_client_name');
- *   jackConnector.registerOutPortSync('output');
- *   function process(nframes, playback, capture) {
- *     for (var i=0; i<nframes; i++) playback['output'].write(i, 0);
- *   }
- *   jackConnector.bindProcessSync(process);
  *   jackConnector.activateSync();
- * @returns {v8::Undefined}
+ *   console.log(jackConnector.getPortConnectionsSync('system:capture_1'));
+ *     // prints: [ "system:playback_1" ]
  */
-Handle<Value> bindProcessSync(const Arguments &args) // {{{1
+Handle<Value> getPortConnectionsSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
 
-    if ( ! args[0]->IsFunction()) {
-        ThrowException(Exception::TypeError(String::New("Callback argument must be a function")));
-        return scope.Close(Undefined());
+    String::Utf8Value port_name(args[0]->ToString());
+    Local<Array> connections = Array::New();
+
+    if (port_graph_update(&cs->port_graph)) {
+        int32_t index = port_graph_find(&cs->port_graph, *port_name);
+        if (index == -1) THROW_ERR("Non existing port");
+        port_graph_entry_t *entry = port_graph_entry(&cs->port_graph, index);
+        for (uint32_t i=0; i<entry->connections_count; i++) {
+            int32_t other = port_graph_find_port(&cs->port_graph, entry->connections[i]);
+            if (other == -1) continue;
+            connections->Set(connections->Length(),
+                String::NewSymbol(port_graph_entry(&cs->port_graph, other)->name));
+        }
+        return scope.Close(connections);
     }
 
-    Local<Function> callback = Local<Function>::Cast( args[0] );
-    processCallback = Persistent<Function>::New( callback );
-    hasProcessCallback = true;
-
-    return scope.Close(Undefined());
-} // bindProcessSync() }}}1
+    jack_port_t *port = jack_port_by_name(cs->client, *port_name);
+    if (! port) THROW_ERR("Non existing port");
 
+    const char **names = jack_port_get_all_connections(cs->client, port);
+    for (uint32_t i=0; names && names[i]; i++) {
+        connections->Set(i, String::NewSymbol(names[i]));
+    }
+    jack_free(names);
 
-/* System functions */
+    return scope.Close(connections);
+} // getPortConnectionsSync() }}}1
 
 /**
- * Get JACK-ports
+ * Bind callback for JACK notifications
  *
- * @private
- * @param {bool} withOwn Get ports of this client too
- * @param {unsigned long} flags Sum of ports filter
- * @returns {v8::Array} allPortsList Array of full ports names strings
- * @example Handle<Array> portsList = get_ports(true, 0);
- * @example Handle<Array> outPortsList = get_ports(false, JackPortIsOutput);
+ * Notifications is queued by JACK threads and delivered to callback
+ * in batches: one call with array of events for every wakeup of event loop.
+ * Sample rate and buffer size changes is reduced to last value
+ * and xruns to one event per batch. If queue is overflowed
+ * (event loop is blocked for long time) "overflow" event is delivered,
+ * ports graph should be reread then.
+ *
+ * Event types: "clientRegistered", "clientUnregistered" (client),
+ * "portRegistered", "portUnregistered" (port), "portRenamed" (port, oldName),
+ * "connected", "disconnected" (source, destination),
+ * "sampleRate" (sampleRate), "bufferSize" (bufferSize, buffers is already
+ * resized for it when callback is called),
+ * "xrun" (count, maxDelay in microseconds), "overflow" (lost),
+ * "workerError" (message, first exception of worker script "process",
+ * next ones is only counted, see getStatsSync()).
+ *
+ * Notifications is delivered to active client only.
+ *
+ * @public
+ * @param {v8::Function} callback function (events)
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   jackConnector.openClientSync('JACK_connector_client_name');
+ *   jackConnector.bindNotificationsSync(function (events) {
+ *     events.forEach(function (e) {
+ *       if (e.type === 'portRegistered') console.log('new port:', e.port);
+ *     });
+ *   });
+ *   jackConnector.activateSync();
  */
-Handle<Array> get_ports(bool withOwn, unsigned long flags) // {{{1
+Handle<Value> bindNotificationsSync(const Arguments &args) // {{{1
 {
-    unsigned int ports_count = 0;
-    const char** jack_ports_list;
-    jack_ports_list = jack_get_ports(::client, NULL, NULL, flags);
-    while (jack_ports_list[ports_count]) ports_count++;
-
-    unsigned int parsed_ports_count = 0;
-    if (withOwn) {
-        parsed_ports_count = ports_count;
-    } else {
-        for (unsigned int i=0; i<ports_count; i++) {
-            for (unsigned int n=0; ; n++) {
-                if (n>=STR_SIZE-1) {
-                    parsed_ports_count++;
-                    break;
-                }
+    HandleScope scope;
+    USE_CLIENT_STATE();
 
-                if (client_name[n] == '\0' && jack_ports_list[i][n] == ':') {
-                    break;
-                }
+    if (! args[0]->IsFunction()) THROW_ERR("Callback must be a function");
 
-                if (client_name[n] != jack_ports_list[i][n]) {
-                    parsed_ports_count++;
-                    break;
-                }
-            }
-        }
+    if (cs->hasNotifyCallback) {
+        cs->hasNotifyCallback = false;
+        cs->notifyCallback.Dispose();
     }
+    notify_queue_clear(&cs->notify_queue);
 
-    Local<Array> allPortsList;
-    if (withOwn) {
-        allPortsList = Array::New(ports_count);
-        for (unsigned int i=0; i<ports_count; i++) {
-            allPortsList->Set(i, String::NewSymbol(jack_ports_list[i]));
-        }
-    } else {
-        allPortsList = Array::New(parsed_ports_count);
+    cs->notifyCallback = Persistent<Function>::New( Local<Function>::Cast(args[0]) );
+    __sync_synchronize();
+    cs->hasNotifyCallback = true;
+
+    return scope.Close(Undefined());
+} // bindNotificationsSync() }}}1
+
+/**
+ * Unbind callback for JACK notifications
+ *
+ * @public
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   jackConnector.unbindNotificationsSync();
+ */
+Handle<Value> unbindNotificationsSync(const Arguments &args) // {{{1
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+
+    if (cs->hasNotifyCallback) {
+        cs->hasNotifyCallback = false;
+        cs->notifyCallback.Dispose();
+        cs->notifyCallback.Clear();
+        notify_queue_clear(&cs->notify_queue);
+    }
+
+    return scope.Close(Undefined());
+} // unbindNotificationsSync() }}}1
+
+/**
+ * Bind callback for JACK process
+ *
+ * Callback receives capture buffers as Float32Array's and may return
+ * playback buffers as Float32Array's (copied by vectorized kernel)
+ * or as plain arrays of numbers.
+ * Capture, playback and transport objects (and its buffers) are reused every cycle,
+ * so do not keep references to them after callback returns. Fill buffers of
+ * "playback" object and return it to output without any allocation, its keys
+ * is not walked then. Pooled buffers returned in other object under its own
+ * port names or handles (for example {out_1: playback.out_1}) is copied
+ * without type and size checks, other buffers is checked and copied (plain
+ * arrays sample by sample).
+ *
+ * By default JACK realtime thread waits for callback result every cycle.
+ * With "ringBuffer" option realtime thread only copies port buffers to/from
+ * lock-free ring buffers and returns immediately, callback is called
+ * asynchronously with "periods" periods of playback lookahead
+ * (it adds "periods" periods of latency to output).
+ *
+ * If path to worker script is passed instead of callback, the script is
+ * evaluated in separate V8 isolate on its own realtime thread, so main event
+ * loop does not affect audio at all. The script must define global function
+ * "process(nframes, capture, playback, transport)", capture and playback buffers are
+ * array-like views of JACK ports buffers (write output samples to playback
+ * buffers directly). There is no "require" or node API in worker script,
+ * first exception is printed to stderr, all of them is counted in
+ * "workerErrors" of getStatsSync().
+ *
+ * MIDI events is passed as 5th and 6th arguments of callback: objects of
+ * own MIDI input/output port name:Buffer. Buffers is pooled and packed:
+ * events count (UInt32LE), then for every event frame offset (UInt32LE),
+ * size (UInt32LE) and bytes of event. Write events for output ports to
+ * its buffers (in order of frame offset), there is no need to return them.
+ * MIDI is processed in default mode only (not in ring buffer mode).
+ *
+ * Transport of the cycle is passed as 7th argument of callback (see
+ * getTransportSync() for its fields). "frameTime" is JACK frame time of
+ * first frame of the cycle, so events may be scheduled sample-accurately.
+ * In ring buffer mode it's transport of the cycle the capture was taken in.
+ *
+ * With "layout" option set to "interleaved" or "planar" callback receives
+ * single Float32Array of (nframes * own input ports count) samples instead of
+ * object of ports buffers and must return single Float32Array of
+ * (nframes * own output ports count) samples in the same layout. Channels is
+ * in order of own ports registration. "interleaved" is frame after frame
+ * (L R L R ...), "planar" is whole channel after channel (L L ... R R ...).
+ *
+ * @public
+ * @param {v8::Function|v8::String} callback Callback or path to worker script
+ * @param {v8::Object} [options]
+ * @param {v8::Boolean} [options.ringBuffer] Default: false
+ * @param {v8::Number} [options.periods] Periods of lookahead for ring buffer mode.
+ *   Default: 2 (see DEFAULT_RINGBUFFER_PERIODS macros)
+ * @param {v8::String} [options.layout] "ports", "interleaved" or "planar".
+ *   Default: "ports"
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   jackConnector.openClientSync('JACK_connector_client_name');
+ *   jackConnector.registerOutPortSync('output');
+ *   function process(err, nframes, capture, playback) {
+ *     var buf = playback.output;
+ *     for (var i=0; i<nframes; i++) buf[i] = (Math.random() * 2) - 1;
+ *     return playback;
+ *   }
+ *   jackConnector.bindProcessSync(process, { ringBuffer: true, periods: 3 });
+ *   jackConnector.activateSync();
+ * @example
+ *   // stereo pass-through, capture and playback are interleaved frames
+ *   jackConnector.bindProcessSync(function (err, nframes, capture, playback) {
+ *     return capture;
+ *   }, { layout: 'interleaved' });
+ * @example
+ *   // MIDI thru, transposed by an octave
+ *   jackConnector.bindProcessSync(function (err, nframes, c, p, midiIn, midiOut) {
+ *     var src = midiIn.midi_in, dst = midiOut.midi_out;
+ *     src.copy(dst, 0, 0, src.length);
+ *     for (var i=0, pos=4, n=src.readUInt32LE(0); i<n; i++) {
+ *       var size = src.readUInt32LE(pos + 4);
+ *       if ((dst[pos + 8] & 0xE0) === 0x80) dst[pos + 9] += 12; // note on/off
+ *       pos += 8 + size;
+ *     }
+ *   });
+ * @example
+ *   // dsp.js:
+ *   //   function process(nframes, capture, playback) {
+ *   //     for (var i=0; i<nframes; i++) playback.output[i] = capture.input[i];
+ *   //   }
+ *   jackConnector.bindProcessSync(__dirname + '/dsp.js');
+ * @returns {v8::Undefined}
+ */
+Handle<Value> bindProcessSync(const Arguments &args) // {{{1
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    bool new_worker_mode = args[0]->IsString();
+
+    if ( ! args[0]->IsFunction() && ! new_worker_mode) {
+        ThrowException(Exception::TypeError(String::New(
+            "Callback argument must be a function or a worker script path")));
+        return scope.Close(Undefined());
+    }
+
+    bool new_ringbuffer_mode = false;
+    uint16_t new_ringbuffer_periods = DEFAULT_RINGBUFFER_PERIODS;
+    process_layout_t new_process_layout = PROCESS_LAYOUT_PORTS;
+
+    if (args.Length() > 1 && args[1]->IsObject()) {
+        Local<Object> options = args[1]->ToObject();
+
+        Local<Value> opt_ringbuffer = options->Get(String::NewSymbol("ringBuffer"));
+        if (!opt_ringbuffer->IsUndefined())
+            new_ringbuffer_mode = opt_ringbuffer->BooleanValue();
+
+        Local<Value> opt_periods = options->Get(String::NewSymbol("periods"));
+        if (!opt_periods->IsUndefined()) {
+            if (!opt_periods->IsNumber()) {
+                ThrowException(Exception::TypeError(String::New("\"periods\" option must be a number")));
+                return scope.Close(Undefined());
+            }
+            int32_t periods = opt_periods->Int32Value();
+            if (periods < 1 || periods > MAX_RINGBUFFER_PERIODS) {
+                ThrowException(Exception::RangeError(String::New("Incorrect \"periods\" option value")));
+                return scope.Close(Undefined());
+            }
+            new_ringbuffer_periods = periods;
+        }
+
+        Local<Value> opt_layout = options->Get(String::NewSymbol("layout"));
+        if (!opt_layout->IsUndefined()) {
+            String::AsciiValue layout(opt_layout->ToString());
+            if (strcmp(*layout, "ports") == 0) {
+                new_process_layout = PROCESS_LAYOUT_PORTS;
+            } else if (strcmp(*layout, "interleaved") == 0) {
+                new_process_layout = PROCESS_LAYOUT_INTERLEAVED;
+            } else if (strcmp(*layout, "planar") == 0) {
+                new_process_layout = PROCESS_LAYOUT_PLANAR;
+            } else {
+                ThrowException(Exception::RangeError(String::New("Incorrect \"layout\" option value")));
+                return scope.Close(Undefined());
+            }
+        }
+    }
+
+    if (cs->client_active && new_ringbuffer_mode != cs->ringbuffer_mode)
+        THROW_ERR("Couldn't change process mode while JACK-client is active");
+
+    if (new_worker_mode && new_ringbuffer_mode)
+        THROW_ERR("Ring buffer mode is not supported for worker script");
+
+    if (new_worker_mode && new_process_layout != PROCESS_LAYOUT_PORTS)
+        THROW_ERR("Buffers layout is not supported for worker script");
+
+    if (cs->dsp_worker_mode) stop_dsp_worker();
+
+    if (new_worker_mode) {
+        String::Utf8Value script_path(args[0]);
+        if (!start_dsp_worker(*script_path)) THROW_ERR(cs->dsp_worker_error);
+        // cycle that is already queued doesn't call it, see uv_process()
+        cs->hasProcessCallback = false;
+        if (!cs->processCallback.IsEmpty()) {
+            cs->processCallback.Dispose();
+            cs->processCallback.Clear();
+        }
+        return scope.Close(Undefined());
+    }
+
+    Local<Function> callback = Local<Function>::Cast( args[0] );
+    if (!cs->processCallback.IsEmpty()) cs->processCallback.Dispose();
+    cs->processCallback = Persistent<Function>::New( callback );
+    cs->hasProcessCallback = true;
+
+    // pool is rebuilt here, so RT thread never waits for allocation
+    if (new_process_layout != cs->process_layout || cs->process_pool_frames != cs->buffer_size) {
+        cs->process_layout = new_process_layout;
+        reset_process_pool(cs->buffer_size);
+    }
+
+    if (new_ringbuffer_mode) {
+        cs->ringbuffer_periods = new_ringbuffer_periods;
+        cs->ringbuffer_mode = true;
+        reset_ringbuffers();
+        publish_rt_snapshot();
+    } else if (cs->ringbuffer_mode) {
+        cs->ringbuffer_mode = false;
+        rt_retire(free_ringbuffers, cs->ringbuffers, true);
+        cs->ringbuffers = 0;
+        publish_rt_snapshot();
+    }
+
+    return scope.Close(Undefined());
+} // bindProcessSync() }}}1
+
+// native DSP graph {{{1
+
+/**
+ * Parse source of DSP graph connection
+ *
+ * @private
+ * @param {v8::Value} val Own input port name, node id or [node id, output index]
+ * @param {dsp_source_t} src
+ * @param {char} port_name Buffer of STR_SIZE for port name
+ * @returns {bool} false if value is incorrect
+ */
+bool parse_dsp_source(Local<Value> val, dsp_source_t *src, char *port_name) // {{{2
+{
+    src->node = -1;
+    src->output = 0;
+    src->port = 0;
+
+    if (val->IsString()) {
+        String::AsciiValue name(val);
+        strncpy(port_name, *name, STR_SIZE);
+        port_name[STR_SIZE-1] = '\0';
+        src->port = port_name;
+    } else if (val->IsNumber()) {
+        src->node = val->Int32Value();
+    } else if (val->IsArray() && val.As<Array>()->Length() == 2) {
+        src->node = val.As<Array>()->Get(0)->Int32Value();
+        src->output = val.As<Array>()->Get(1)->Uint32Value();
+    } else {
+        return false;
+    }
+    return true;
+} // parse_dsp_source() }}}2
+
+/**
+ * Parse destination of DSP graph connection
+ *
+ * @private
+ * @param {v8::Value} val Own output port name or node id
+ * @param {dsp_destination_t} dst
+ * @param {char} port_name Buffer of STR_SIZE for port name
+ * @returns {bool} false if value is incorrect
+ */
+bool parse_dsp_destination(Local<Value> val, dsp_destination_t *dst, char *port_name) // {{{2
+{
+    dst->node = -1;
+    dst->port = 0;
+
+    if (val->IsString()) {
+        String::AsciiValue name(val);
+        strncpy(port_name, *name, STR_SIZE);
+        port_name[STR_SIZE-1] = '\0';
+        dst->port = port_name;
+    } else if (val->IsNumber()) {
+        dst->node = val->Int32Value();
+    } else {
+        return false;
+    }
+    return true;
+} // parse_dsp_destination() }}}2
+
+/**
+ * Resolve own port short name for DSP graph compiler
+ *
+ * @private
+ */
+int32_t dsp_port_resolver(bool output, const char *short_name) // {{{2
+{
+    if (output) {
+        return find_own_port_index(
+            &cs->own_out_ports_hash, cs->own_out_ports_short_names, short_name);
+    } else {
+        return find_own_port_index(
+            &cs->own_in_ports_hash, cs->own_in_ports_short_names, short_name);
+    }
+} // dsp_port_resolver() }}}2
+
+/**
+ * Free DSP program and nodes removed before it's unpublished
+ *
+ * @private
+ */
+void rt_free_dsp_program(void *ptr) // {{{2
+{
+    dsp_program_free((dsp_program_t *)ptr);
+    dsp_graph_collect_garbage(&cs->dsp_graph);
+} // rt_free_dsp_program() }}}2
+
+/**
+ * Stop threads of DSP pool retired from RT snapshot
+ *
+ * @private
+ */
+void rt_free_dsp_pool(void *ptr) // {{{2
+{
+    dsp_pool_destroy((dsp_pool_t *)ptr);
+} // rt_free_dsp_pool() }}}2
+
+/**
+ * Compile DSP graph for RT thread
+ *
+ * Old program is freed when new RT snapshot is published
+ * and RT thread can't run old program anymore.
+ *
+ * @private
+ * @returns {char} err Error message or 0
+ */
+const char* update_dsp_program() // {{{2
+{
+    dsp_program_t *program;
+    const char *err = dsp_graph_compile(
+        &cs->dsp_graph,
+        dsp_port_resolver, cs->own_in_ports_size, cs->buffer_size, &program);
+    if (err) return err;
+
+    // removed nodes isn't used by RT thread if there was no program
+    if (cs->dsp_program == 0) dsp_graph_collect_garbage(&cs->dsp_graph);
+    rt_retire(rt_free_dsp_program, cs->dsp_program, false);
+    cs->dsp_program = program;
+
+    return 0;
+} // update_dsp_program() }}}2
+
+/**
+ * Add node to native DSP graph
+ *
+ * Graph is executed directly in JACK realtime thread without JS,
+ * own output ports connected to the graph are overwritten by it.
+ *
+ * @public
+ * @param {v8::String} type "pass", "gain", "mix", "pan", "delay" or "constant"
+ * @param {v8::Object} [options]
+ * @param {v8::Number} [options.gain] Gain of "gain" and "mix" nodes. Default: 1
+ * @param {v8::Number} [options.pan] Position (-1..1) of "pan" node. Default: 0
+ * @param {v8::Number} [options.value] Value of "constant" node. Default: 0
+ * @param {v8::Number} [options.frames] Delay of "delay" node in frames. Default: 0
+ * @returns {v8::Integer} nodeId
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   jackConnector.openClientSync('JACK_connector_client_name');
+ *   jackConnector.registerInPortSync('in');
+ *   jackConnector.registerOutPortSync('out_l');
+ *   jackConnector.registerOutPortSync('out_r');
+ *   var gain = jackConnector.addDspNodeSync('gain', { gain: 0.5 });
+ *   var pan = jackConnector.addDspNodeSync('pan', { pan: -0.3 });
+ *   jackConnector.connectDspSync('in', gain);
+ *   jackConnector.connectDspSync(gain, pan);
+ *   jackConnector.connectDspSync([pan, 0], 'out_l');
+ *   jackConnector.connectDspSync([pan, 1], 'out_r');
+ *   jackConnector.activateSync();
+ */
+Handle<Value> addDspNodeSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    String::AsciiValue type_arg(args[0]->ToString());
+    const char *type_name = *type_arg;
+    dsp_node_type_t type;
+    const char *param_name = 0;
+    float param = 0;
+
+    if (strcmp(type_name, "pass") == 0) {
+        type = DSP_NODE_PASS;
+    } else if (strcmp(type_name, "gain") == 0) {
+        type = DSP_NODE_GAIN;
+        param_name = "gain";
+        param = 1;
+    } else if (strcmp(type_name, "mix") == 0) {
+        type = DSP_NODE_MIX;
+        param_name = "gain";
+        param = 1;
+    } else if (strcmp(type_name, "pan") == 0) {
+        type = DSP_NODE_PAN;
+        param_name = "pan";
+    } else if (strcmp(type_name, "delay") == 0) {
+        type = DSP_NODE_DELAY;
+    } else if (strcmp(type_name, "constant") == 0) {
+        type = DSP_NODE_CONSTANT;
+        param_name = "value";
+    } else {
+        THROW_ERR("Unknown DSP node type");
+    }
+
+    uint32_t delay_frames = 0;
+    if (args.Length() > 1 && args[1]->IsObject()) {
+        Local<Object> options = args[1]->ToObject();
+        if (param_name) {
+            Local<Value> val = options->Get(String::NewSymbol(param_name));
+            if (!val->IsUndefined()) param = val->NumberValue();
+        }
+        if (type == DSP_NODE_DELAY) {
+            Local<Value> val = options->Get(String::NewSymbol("frames"));
+            if (!val->IsUndefined()) delay_frames = val->Uint32Value();
+        }
+    }
+
+    int32_t id = dsp_graph_add_node(&cs->dsp_graph, type, param, delay_frames);
+
+    // RT thread finds node of automation event in the program, so node is
+    // there before it's connected and automateDspNodeSync() only posts
+    if (cs->dsp_program != 0) {
+        update_dsp_program();
+        publish_rt_snapshot();
+    }
+
+    return scope.Close(Integer::New(id));
+} // addDspNodeSync() }}}2
+
+/**
+ * Remove node from native DSP graph with all its connections
+ *
+ * @public
+ * @param {v8::Integer} nodeId
+ */
+Handle<Value> removeDspNodeSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    bool removed = dsp_graph_remove_node(&cs->dsp_graph, args[0]->Int32Value());
+    if (removed) {
+        update_dsp_program();
+        publish_rt_snapshot();
+    }
+
+    if (!removed) THROW_ERR("Unknown DSP node");
+
+    return scope.Close(Undefined());
+} // removeDspNodeSync() }}}2
+
+/**
+ * Set parameter of native DSP graph node (gain, pan position or constant value)
+ *
+ * Value is changed smoothly across one period, without clicks.
+ *
+ * @public
+ * @param {v8::Integer} nodeId
+ * @param {v8::Number} value
+ * @example
+ *   jackConnector.setDspNodeParamSync(gain, 0.8);
+ */
+Handle<Value> setDspNodeParamSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    if (!args[1]->IsNumber()) {
+        ThrowException(Exception::TypeError(String::New("Value must be a number")));
+        return scope.Close(Undefined());
+    }
+
+    if (!dsp_graph_set_param(&cs->dsp_graph, args[0]->Int32Value(), args[1]->NumberValue()))
+        THROW_ERR("Unknown DSP node");
+
+    return scope.Close(Undefined());
+} // setDspNodeParamSync() }}}2
+
+/**
+ * Schedule sample-accurate automation of DSP node parameter
+ *
+ * Events is passed to JACK realtime thread through lock-free queue and
+ * applied at exact frame of the cycle, so fades and ducking is click-free
+ * without JS touching samples. Ramps start at "time" from value parameter
+ * has at that moment. Events in the past start immediately.
+ * setDspNodeParamSync() takes over automation until next event starts.
+ *
+ * @public
+ * @param {v8::Integer} nodeId Node of "gain", "mix", "pan" or "constant" type
+ * @param {v8::String} type "set", "linear" (ramp), "exponential" (ramp,
+ *   linear if it crosses zero) or "cancel" (drop events posted before it
+ *   from its time on, hold value)
+ * @param {v8::Number} value Target value (ignored by "cancel")
+ * @param {v8::Integer} time JACK frame time (see getFrameTimeSync() or
+ *   "frameTime" of transport of "process" callback)
+ * @param {v8::Integer} [duration] Frames of ramp. Default: 0
+ * @example
+ *   // fade out for one second, starting after 100ms
+ *   var now = jackConnector.getFrameTimeSync();
+ *   var rate = jackConnector.getSampleRateSync();
+ *   jackConnector.automateDspNodeSync(gain, 'exponential', 0.001, now + rate / 10, rate);
+ *   jackConnector.automateDspNodeSync(gain, 'set', 0, now + rate / 10 + rate);
+ */
+Handle<Value> automateDspNodeSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    int32_t id = args[0]->Int32Value();
+    if (!dsp_graph_node_exists(&cs->dsp_graph, id)) THROW_ERR("Unknown DSP node");
+    if (!dsp_graph_node_automatable(&cs->dsp_graph, id))
+        THROW_ERR("DSP node has no parameter to automate");
+
+    dsp_automation_event_t event;
+    event.node = id;
+
+    String::AsciiValue type_name(args[1]->ToString());
+    if (strcmp(*type_name, "set") == 0) event.type = DSP_AUTOMATION_SET;
+    else if (strcmp(*type_name, "linear") == 0) event.type = DSP_AUTOMATION_LINEAR;
+    else if (strcmp(*type_name, "exponential") == 0) event.type = DSP_AUTOMATION_EXPONENTIAL;
+    else if (strcmp(*type_name, "cancel") == 0) event.type = DSP_AUTOMATION_CANCEL;
+    else {
+        ThrowException(Exception::RangeError(String::New("Unknown automation event type")));
+        return scope.Close(Undefined());
+    }
+
+    if (event.type != DSP_AUTOMATION_CANCEL && !args[2]->IsNumber()) {
+        ThrowException(Exception::TypeError(String::New("Value must be a number")));
+        return scope.Close(Undefined());
+    }
+    event.value = args[2]->IsNumber() ? args[2]->NumberValue() : 0;
+
+    if (!args[3]->IsNumber()) {
+        ThrowException(Exception::TypeError(String::New("Time must be a JACK frame time")));
+        return scope.Close(Undefined());
+    }
+    event.time = args[3]->Uint32Value();
+
+    event.duration = 0;
+    if (args.Length() > 4 && !args[4]->IsUndefined()) {
+        if (!args[4]->IsNumber() || args[4]->NumberValue() < 0) {
+            ThrowException(Exception::TypeError(String::New(
+                "Duration must be a non-negative number of frames")));
+            return scope.Close(Undefined());
+        }
+        event.duration = args[4]->Uint32Value();
+    }
+
+    if (!dsp_automation_post(cs->dsp_automation_queue, &event))
+        THROW_ERR("DSP automation queue is full");
+
+    return scope.Close(Undefined());
+} // automateDspNodeSync() }}}2
+
+/**
+ * Connect own input port or DSP node output to DSP node or own output port
+ *
+ * @public
+ * @param {v8::String|v8::Integer|v8::Array} source Own input port name,
+ *   node id or [node id, output index] ("pan" node has 2 outputs: left, right)
+ * @param {v8::String|v8::Integer} destination Own output port name or node id
+ */
+Handle<Value> connectDspSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    char src_port[STR_SIZE], dst_port[STR_SIZE];
+    dsp_source_t src;
+    dsp_destination_t dst;
+
+    if (!parse_dsp_source(args[0], &src, src_port)) {
+        ThrowException(Exception::TypeError(String::New("Incorrect DSP connection source")));
+        return scope.Close(Undefined());
+    }
+    if (!parse_dsp_destination(args[1], &dst, dst_port)) {
+        ThrowException(Exception::TypeError(String::New("Incorrect DSP connection destination")));
+        return scope.Close(Undefined());
+    }
+
+    if (!dsp_graph_connect(&cs->dsp_graph, src, dst))
+        THROW_ERR("Unknown DSP node or node output");
+    const char *err = update_dsp_program();
+    if (err) {
+        dsp_graph_disconnect(&cs->dsp_graph, src, dst);
+        THROW_ERR(err);
+    }
+    publish_rt_snapshot();
+
+    return scope.Close(Undefined());
+} // connectDspSync() }}}2
+
+/**
+ * Disconnect DSP graph connection
+ *
+ * @public
+ * @param {v8::String|v8::Integer|v8::Array} source See connectDspSync()
+ * @param {v8::String|v8::Integer} destination See connectDspSync()
+ */
+Handle<Value> disconnectDspSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    char src_port[STR_SIZE], dst_port[STR_SIZE];
+    dsp_source_t src;
+    dsp_destination_t dst;
+
+    if (!parse_dsp_source(args[0], &src, src_port)
+    || !parse_dsp_destination(args[1], &dst, dst_port)) {
+        ThrowException(Exception::TypeError(String::New("Incorrect DSP connection")));
+        return scope.Close(Undefined());
+    }
+
+    if (dsp_graph_disconnect(&cs->dsp_graph, src, dst)) {
+        update_dsp_program();
+        publish_rt_snapshot();
+    }
+
+    return scope.Close(Undefined());
+} // disconnectDspSync() }}}2
+
+/**
+ * Remove all nodes and connections of native DSP graph
+ *
+ * @public
+ */
+Handle<Value> clearDspGraphSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    dsp_graph_clear(&cs->dsp_graph);
+    update_dsp_program();
+    publish_rt_snapshot();
+
+    return scope.Close(Undefined());
+} // clearDspGraphSync() }}}2
+
+/**
+ * Run independent parts of native DSP graph on several realtime threads
+ *
+ * Nodes that is connected to each other (or to the same own output port)
+ * is one group, different groups run in parallel within JACK cycle.
+ * JACK thread runs groups too and waits for the rest of them before
+ * cycle ends. Threads is stopped when client is closed.
+ *
+ * @public
+ * @param {v8::Integer} count Additional threads, 0 to run graph in JACK thread only
+ * @param {v8::Object} [options]
+ * @param {v8::Array} [options.cpus] CPU indexes to pin threads to (in turn)
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   jackConnector.openClientSync('JACK_connector_client_name');
+ *   // ... 64 independent "in_N" -> gain -> delay -> "out_N" chains
+ *   jackConnector.setDspThreadsSync(3, { cpus: [1, 2, 3] });
+ */
+Handle<Value> setDspThreadsSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    if (args.Length() < 1 || !args[0]->IsNumber()
+        || args[0]->Int32Value() < 0 || args[0]->Int32Value() > DSP_POOL_MAX_THREADS)
+        THROW_ERR("Threads count must be a number from 0 to 64");
+    uint32_t count = args[0]->Uint32Value();
+
+    uint32_t cpus[DSP_POOL_MAX_THREADS];
+    uint32_t cpus_count = 0;
+    if (args.Length() > 1 && args[1]->IsObject()) {
+        Local<Value> opt_cpus = args[1]->ToObject()->Get(String::NewSymbol("cpus"));
+        if (!opt_cpus->IsUndefined()) {
+            if (!opt_cpus->IsArray()) THROW_ERR("\"cpus\" option must be an array");
+            Local<Array> arr = opt_cpus.As<Array>();
+            for (uint32_t i=0; i<arr->Length() && i<DSP_POOL_MAX_THREADS; i++) {
+                Local<Value> cpu = arr->Get(i);
+                if (!cpu->IsNumber() || cpu->Int32Value() < 0)
+                    THROW_ERR("\"cpus\" option must be an array of CPU indexes");
+                cpus[cpus_count++] = cpu->Uint32Value();
+            }
+        }
+    }
+
+    dsp_pool_t *pool = 0;
+    if (count > 0) {
+        pool = dsp_pool_create(cs->client, count, cpus, cpus_count);
+        if (pool == 0) THROW_ERR("Couldn't create DSP threads");
+    }
+
+    rt_retire(rt_free_dsp_pool, cs->dsp_pool, false);
+    cs->dsp_pool = pool;
+    publish_rt_snapshot();
+
+    return scope.Close(Undefined());
+} // setDspThreadsSync() }}}2
+
+// native DSP graph }}}1
+
+// recording {{{1
+
+/**
+ * Grow recorders cycle buffers for new buffer size
+ *
+ * Call it while processors is detached from RT thread.
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ */
+void reserve_recorders_frames(jack_nframes_t nframes) // {{{2
+{
+    for (uint32_t r=0; r<cs->recorders_size; r++) {
+        if (cs->recorders[r] != 0) recorder_reserve_frames(cs->recorders[r], nframes);
+    }
+} // reserve_recorders_frames() }}}2
+
+/**
+ * Remove recorder from RT thread and finish it
+ *
+ * @private
+ * @param {uint32_t} id Recording id
+ * @returns {int} 0 or errno of failed disk operation
+ */
+int finish_recorder(uint32_t id) // {{{2
+{
+    recorder_t *rec = cs->recorders[id];
+    cs->recorders[id] = 0;
+    publish_rt_snapshot();
+    rt_synchronize();
+
+    return recorder_finish(rec);
+} // finish_recorder() }}}2
+
+/**
+ * Finish all recordings and free recorders list (on client close)
+ *
+ * Call it after detach_all_processors().
+ *
+ * @private
+ */
+void finish_all_recorders() // {{{2
+{
+    for (uint32_t r=0; r<cs->recorders_size; r++) {
+        if (cs->recorders[r] != 0) recorder_finish(cs->recorders[r]);
+    }
+
+    delete [] cs->recorders;
+    cs->recorders = 0;
+    cs->recorders_size = 0;
+    cs->recorders_capacity = 0;
+} // finish_all_recorders() }}}2
+
+/**
+ * Get recorder by recording id argument
+ *
+ * @private
+ * @returns {int32_t} id or -1 if there is no such recording
+ */
+int32_t get_recording_id(Local<Value> val) // {{{2
+{
+    if (!val->IsNumber()) return -1;
+    uint32_t id = val->Uint32Value();
+    if (id >= cs->recorders_size || cs->recorders[id] == 0) return -1;
+    return id;
+} // get_recording_id() }}}2
+
+/**
+ * Start recording own input ports to file
+ *
+ * Samples never get to JS, realtime thread pushes them to lock-free ring
+ * and separate disk thread writes them to file by large sequential batches.
+ * Use getRecordingStatusSync() to watch progress and overruns.
+ *
+ * @public
+ * @param {v8::Array} ports Own input ports names or handles (channels order)
+ * @param {v8::String} path File path
+ * @param {v8::String} [format] "wav" (32-bit float, turns into RF64 if exceeds
+ *   4 GiB), "rf64" or "raw" (interleaved 32-bit float). Default: "wav"
+ * @param {v8::Object} [options]
+ * @param {v8::Number} [options.bufferSeconds] Size of ring buffer in seconds
+ *   of audio, it covers disk stalls. Default: 4
+ * @returns {v8::Integer} recordingId
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   jackConnector.openClientSync('JACK_connector_client_name');
+ *   jackConnector.registerInPortSync('in_l');
+ *   jackConnector.registerInPortSync('in_r');
+ *   jackConnector.activateSync();
+ *   var rec = jackConnector.startRecordingSync(['in_l', 'in_r'], '/tmp/rec.wav');
+ *   setTimeout(function () { jackConnector.stopRecordingSync(rec); }, 60000);
+ */
+Handle<Value> startRecordingSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    if (!args[0]->IsArray() || args[0].As<Array>()->Length() == 0) {
+        ThrowException(Exception::TypeError(String::New(
+            "Ports argument must be non-empty array of own input ports")));
+        return scope.Close(Undefined());
+    }
+    if (!args[1]->IsString()) {
+        ThrowException(Exception::TypeError(String::New("Path must be a string")));
+        return scope.Close(Undefined());
+    }
+
+    recorder_format_t format = RECORDER_FORMAT_WAV;
+    if (args.Length() > 2 && !args[2]->IsUndefined()) {
+        String::AsciiValue format_name(args[2]->ToString());
+        if (strcmp(*format_name, "wav") == 0) format = RECORDER_FORMAT_WAV;
+        else if (strcmp(*format_name, "rf64") == 0) format = RECORDER_FORMAT_RF64;
+        else if (strcmp(*format_name, "raw") == 0) format = RECORDER_FORMAT_RAW;
+        else {
+            ThrowException(Exception::RangeError(String::New("Unknown recording format")));
+            return scope.Close(Undefined());
+        }
+    }
+
+    double buffer_seconds = 4;
+    if (args.Length() > 3 && args[3]->IsObject()) {
+        Local<Value> opt = args[3]->ToObject()->Get(String::NewSymbol("bufferSeconds"));
+        if (!opt->IsUndefined()) {
+            buffer_seconds = opt->NumberValue();
+            if (!(buffer_seconds > 0)) {
+                ThrowException(Exception::RangeError(String::New(
+                    "Incorrect \"bufferSeconds\" option value")));
+                return scope.Close(Undefined());
+            }
+        }
+    }
+
+    // resolve ports to short names before anything is created
+    Local<Array> ports = args[0].As<Array>();
+    uint32_t channels = ports->Length();
+    char **names = new char*[channels];
+    for (uint32_t i=0; i<channels; i++) names[i] = 0;
+
+    for (uint32_t i=0; i<channels; i++) {
+        Local<Value> val = ports->Get(i);
+        const char *short_name = 0;
+        bool not_audio = false;
+        String::AsciiValue name_arg(val->ToString());
+
+        if (val->IsNumber()) {
+            jack_port_t *port = get_port_by_handle(val->Uint32Value());
+            not_audio = port != 0 && !is_audio_port_handle(val->Uint32Value());
+            if (not_audio) port = 0;
+            if (port != 0 && (jack_port_flags(port) & JackPortIsInput))
+                short_name = jack_port_short_name(port);
+        } else if (find_own_port_index(
+            &cs->own_in_ports_hash, cs->own_in_ports_short_names, *name_arg) >= 0) {
+            short_name = *name_arg;
+        }
+
+        if (short_name == 0) {
+            for (uint32_t n=0; n<channels; n++) delete [] names[n];
+            delete [] names;
+            if (not_audio) THROW_ERR("JACK-port is not an audio port");
+            char err[] = "Own input port \"%s\" not found";
+            char err_msg[STR_SIZE + sizeof(err)];
+            snprintf(err_msg, sizeof(err_msg), err, *name_arg);
+            THROW_ERR(err_msg);
+        }
+
+        names[i] = new char[strlen(short_name) + 1];
+        strcpy(names[i], short_name);
+    }
+
+    String::Utf8Value path(args[1]);
+    const char *err = 0;
+    recorder_t *rec = recorder_create(*path, format, channels,
+        jack_get_sample_rate(cs->client), cs->buffer_size, buffer_seconds, &err);
+    if (rec == 0) {
+        for (uint32_t n=0; n<channels; n++) delete [] names[n];
+        delete [] names;
+        THROW_ERR(err);
+    }
+    for (uint32_t i=0; i<channels; i++) rec->port_names[i] = names[i];
+    delete [] names;
+
+    // slot of finished recording is reused
+    uint32_t id = 0;
+    while (id < cs->recorders_size && cs->recorders[id] != 0) id++;
+    if (id == cs->recorders_size) {
+        if (cs->recorders_size >= cs->recorders_capacity) {
+            uint32_t new_capacity = cs->recorders_capacity ? cs->recorders_capacity * 2 : 8;
+            recorder_t **new_recorders = new recorder_t*[new_capacity];
+            for (uint32_t r=0; r<cs->recorders_size; r++) new_recorders[r] = cs->recorders[r];
+            delete [] cs->recorders;
+            cs->recorders = new_recorders;
+            cs->recorders_capacity = new_capacity;
+        }
+        cs->recorders_size++;
+    }
+    cs->recorders[id] = rec;
+    publish_rt_snapshot();
+
+    return scope.Close(Integer::NewFromUnsigned(id));
+} // startRecordingSync() }}}2
+
+/**
+ * Stop recording, write rest of samples and finalize file header
+ *
+ * @public
+ * @param {v8::Integer} recordingId
+ */
+Handle<Value> stopRecordingSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    int32_t id = get_recording_id(args[0]);
+    if (id < 0) THROW_ERR("Unknown recording");
+
+    int err = finish_recorder(id);
+    if (err) {
+        char err_tpl[] = "Recording file write error: %s";
+        char err_msg[STR_SIZE + sizeof(err_tpl)];
+        snprintf(err_msg, sizeof(err_msg), err_tpl, strerror(err));
+        THROW_ERR(err_msg);
+    }
+
+    return scope.Close(Undefined());
+} // stopRecordingSync() }}}2
+
+/**
+ * Get recording progress
+ *
+ * @public
+ * @param {v8::Integer} recordingId
+ * @returns {v8::Object} status
+ *   {frames: Number, bytes: Number, overruns: Number, diskError: String|null}
+ *   "overruns" is count of dropped periods (ring buffer was full)
+ */
+Handle<Value> getRecordingStatusSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    int32_t id = get_recording_id(args[0]);
+    if (id < 0) THROW_ERR("Unknown recording");
+    recorder_t *rec = cs->recorders[id];
+
+    Local<Object> status = Object::New();
+    status->Set(String::NewSymbol("frames"), Number::New((double)rec->frames_written));
+    status->Set(String::NewSymbol("bytes"), Number::New((double)rec->bytes_written));
+    status->Set(String::NewSymbol("overruns"), Integer::NewFromUnsigned(rec->overruns));
+    int disk_error = rec->disk_error;
+    if (disk_error) {
+        status->Set(String::NewSymbol("diskError"), String::New(strerror(disk_error)));
+    } else {
+        status->Set(String::NewSymbol("diskError"), Null());
+    }
+
+    return scope.Close(status);
+} // getRecordingStatusSync() }}}2
+
+// recording }}}1
+
+// playing {{{1
+
+/**
+ * Remove player from RT thread and destroy it
+ *
+ * @private
+ * @param {uint32_t} id Player id
+ */
+void destroy_player(uint32_t id) // {{{2
+{
+    player_t *player = cs->players[id];
+    cs->players[id] = 0;
+    publish_rt_snapshot();
+    rt_synchronize();
+
+    player_destroy(player);
+} // destroy_player() }}}2
+
+/**
+ * Destroy all players and free players list (on client close)
+ *
+ * Call it after detach_all_processors().
+ *
+ * @private
+ */
+void destroy_all_players() // {{{2
+{
+    for (uint32_t p=0; p<cs->players_size; p++) {
+        if (cs->players[p] != 0) player_destroy(cs->players[p]);
+    }
+
+    delete [] cs->players;
+    cs->players = 0;
+    cs->players_size = 0;
+    cs->players_capacity = 0;
+} // destroy_all_players() }}}2
+
+/**
+ * Get player id argument
+ *
+ * @private
+ * @returns {int32_t} id or -1 if there is no such player
+ */
+int32_t get_player_id(Local<Value> val) // {{{2
+{
+    if (!val->IsNumber()) return -1;
+    uint32_t id = val->Uint32Value();
+    if (id >= cs->players_size || cs->players[id] == 0) return -1;
+    return id;
+} // get_player_id() }}}2
+
+/**
+ * Fill time of player command by optional "at" argument
+ *
+ * @private
+ * @param {v8::Value} at JACK frame time (see getFrameTimeSync()) or undefined
+ */
+void set_player_command_time(player_command_t *cmd, Local<Value> at) // {{{2
+{
+    cmd->now = at->IsUndefined() || at->IsNull();
+    cmd->at = cmd->now ? 0 : at->Uint32Value();
+} // set_player_command_time() }}}2
+
+#define SEND_PLAYER_COMMAND(player_id, cmd) \
+        { \
+            if (!player_send(cs->players[player_id], cmd)) \
+                THROW_ERR("Player commands queue is full"); \
+        }
+
+#define NEED_PLAYER_ID(player_id) \
+        int32_t player_id = get_player_id(args[0]); \
+        if (player_id < 0) THROW_ERR("Unknown player");
+
+/**
+ * Create native file player feeding own output ports
+ *
+ * File is mapped to memory and decoded directly in JACK realtime thread,
+ * separate thread locks it in memory ahead of play position, loop start and
+ * seek target (frames that isn't locked yet is played as silence and
+ * counted as underruns, see getPlayerStatusSync()). Player is stopped after
+ * creation, it writes silence to its ports while stopped (unless "mix"
+ * option is set).
+ *
+ * @public
+ * @param {v8::String} path WAV/RF64 file (16/24/32-bit PCM or 32-bit float)
+ *   or raw interleaved 32-bit float samples
+ * @param {v8::Array} ports Own output ports names or handles, file channel
+ *   per port (channels is repeated if there is less channels than ports)
+ * @param {v8::Object} [options]
+ * @param {v8::String} [options.format] "wav" or "raw". Default: "wav"
+ * @param {v8::Number} [options.channels] Channels of raw file. Default: ports count
+ * @param {v8::Boolean} [options.mix] Add to ports buffers instead of
+ *   overwriting them (for many players on the same ports). Default: false
+ * @param {v8::Number} [options.readAheadSeconds] Default: 2
+ * @returns {v8::Integer} playerId
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   jackConnector.openClientSync('JACK_connector_client_name');
+ *   jackConnector.registerOutPortSync('out_l');
+ *   jackConnector.registerOutPortSync('out_r');
+ *   jackConnector.activateSync();
+ *   var player = jackConnector.createPlayerSync('/tmp/jingle.wav', ['out_l', 'out_r']);
+ *   jackConnector.setPlayerLoopSync(player, 0, 48000);
+ *   // start exactly one second later
+ *   jackConnector.startPlayerSync(player, jackConnector.getFrameTimeSync() + 48000);
+ */
+Handle<Value> createPlayerSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    if (!args[0]->IsString()) {
+        ThrowException(Exception::TypeError(String::New("Path must be a string")));
+        return scope.Close(Undefined());
+    }
+    if (!args[1]->IsArray() || args[1].As<Array>()->Length() == 0) {
+        ThrowException(Exception::TypeError(String::New(
+            "Ports argument must be non-empty array of own output ports")));
+        return scope.Close(Undefined());
+    }
+
+    Local<Array> ports = args[1].As<Array>();
+    uint32_t ports_count = ports->Length();
+
+    bool raw = false;
+    bool mix = false;
+    uint32_t raw_channels = ports_count;
+    double read_ahead_seconds = 2;
+
+    if (args.Length() > 2 && args[2]->IsObject()) {
+        Local<Object> options = args[2]->ToObject();
+
+        Local<Value> opt_format = options->Get(String::NewSymbol("format"));
+        if (!opt_format->IsUndefined()) {
+            String::AsciiValue format(opt_format->ToString());
+            if (strcmp(*format, "raw") == 0) raw = true;
+            else if (strcmp(*format, "wav") != 0) {
+                ThrowException(Exception::RangeError(String::New("Unknown player file format")));
+                return scope.Close(Undefined());
+            }
+        }
+
+        Local<Value> opt_channels = options->Get(String::NewSymbol("channels"));
+        if (!opt_channels->IsUndefined()) {
+            raw_channels = opt_channels->Uint32Value();
+            if (raw_channels == 0) {
+                ThrowException(Exception::RangeError(String::New("Incorrect \"channels\" option value")));
+                return scope.Close(Undefined());
+            }
+        }
+
+        mix = options->Get(String::NewSymbol("mix"))->BooleanValue();
+
+        Local<Value> opt_read_ahead = options->Get(String::NewSymbol("readAheadSeconds"));
+        if (!opt_read_ahead->IsUndefined()) {
+            read_ahead_seconds = opt_read_ahead->NumberValue();
+            if (!(read_ahead_seconds > 0)) {
+                ThrowException(Exception::RangeError(String::New(
+                    "Incorrect \"readAheadSeconds\" option value")));
+                return scope.Close(Undefined());
+            }
+        }
+    }
+
+    char **names = new char*[ports_count];
+    for (uint32_t i=0; i<ports_count; i++) names[i] = 0;
+
+    for (uint32_t i=0; i<ports_count; i++) {
+        Local<Value> val = ports->Get(i);
+        const char *short_name = 0;
+        bool not_audio = false;
+        String::AsciiValue name_arg(val->ToString());
+
+        if (val->IsNumber()) {
+            jack_port_t *port = get_port_by_handle(val->Uint32Value());
+            not_audio = port != 0 && !is_audio_port_handle(val->Uint32Value());
+            if (not_audio) port = 0;
+            if (port != 0 && (jack_port_flags(port) & JackPortIsOutput))
+                short_name = jack_port_short_name(port);
+        } else if (find_own_port_index(
+            &cs->own_out_ports_hash, cs->own_out_ports_short_names, *name_arg) >= 0) {
+            short_name = *name_arg;
+        }
+
+        if (short_name == 0) {
+            for (uint32_t n=0; n<ports_count; n++) delete [] names[n];
+            delete [] names;
+            if (not_audio) THROW_ERR("JACK-port is not an audio port");
+            char err[] = "Own output port \"%s\" not found";
+            char err_msg[STR_SIZE + sizeof(err)];
+            snprintf(err_msg, sizeof(err_msg), err, *name_arg);
+            THROW_ERR(err_msg);
+        }
+
+        names[i] = new char[strlen(short_name) + 1];
+        strcpy(names[i], short_name);
+    }
+
+    String::Utf8Value path(args[0]);
+    const char *err = 0;
+    player_t *player = player_create(*path, raw, raw_channels,
+        jack_get_sample_rate(cs->client), cs->buffer_size, read_ahead_seconds, &err);
+    if (player == 0) {
+        for (uint32_t n=0; n<ports_count; n++) delete [] names[n];
+        delete [] names;
+        THROW_ERR(err);
+    }
+    player->ports_count = ports_count;
+    player->port_names = names;
+    player->port_bufs = new jack_default_audio_sample_t*[ports_count];
+    player->mix = mix;
+
+    // slot of destroyed player is reused
+    uint32_t id = 0;
+    while (id < cs->players_size && cs->players[id] != 0) id++;
+    if (id == cs->players_size) {
+        if (cs->players_size >= cs->players_capacity) {
+            uint32_t new_capacity = cs->players_capacity ? cs->players_capacity * 2 : 8;
+            player_t **new_players = new player_t*[new_capacity];
+            for (uint32_t p=0; p<cs->players_size; p++) new_players[p] = cs->players[p];
+            delete [] cs->players;
+            cs->players = new_players;
+            cs->players_capacity = new_capacity;
+        }
+        cs->players_size++;
+    }
+    cs->players[id] = player;
+    publish_rt_snapshot();
+
+    return scope.Close(Integer::NewFromUnsigned(id));
+} // createPlayerSync() }}}2
+
+/**
+ * Start playing from current position
+ *
+ * @public
+ * @param {v8::Integer} playerId
+ * @param {v8::Integer} [at] JACK frame time to start at (see getFrameTimeSync()).
+ *   Default: as soon as possible
+ */
+Handle<Value> startPlayerSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+    NEED_PLAYER_ID(id);
+
+    player_command_t cmd;
+    cmd.type = PLAYER_CMD_START;
+    set_player_command_time(&cmd, args[1]);
+    SEND_PLAYER_COMMAND(id, cmd);
+
+    return scope.Close(Undefined());
+} // startPlayerSync() }}}2
+
+/**
+ * Stop playing (position is kept)
+ *
+ * @public
+ * @param {v8::Integer} playerId
+ * @param {v8::Integer} [at] JACK frame time to stop at. Default: as soon as possible
+ */
+Handle<Value> stopPlayerSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+    NEED_PLAYER_ID(id);
+
+    player_command_t cmd;
+    cmd.type = PLAYER_CMD_STOP;
+    set_player_command_time(&cmd, args[1]);
+    SEND_PLAYER_COMMAND(id, cmd);
+
+    return scope.Close(Undefined());
+} // stopPlayerSync() }}}2
+
+/**
+ * Set play position
+ *
+ * @public
+ * @param {v8::Integer} playerId
+ * @param {v8::Number} frame Position in file frames
+ * @param {v8::Integer} [at] JACK frame time to seek at. Default: as soon as possible
+ */
+Handle<Value> seekPlayerSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+    NEED_PLAYER_ID(id);
+
+    if (!args[1]->IsNumber() || args[1]->NumberValue() < 0) {
+        ThrowException(Exception::TypeError(String::New("Position must be a non-negative number")));
+        return scope.Close(Undefined());
+    }
+
+    player_command_t cmd;
+    cmd.type = PLAYER_CMD_SEEK;
+    cmd.position = (uint64_t)args[1]->NumberValue();
+    set_player_command_time(&cmd, args[2]);
+    SEND_PLAYER_COMMAND(id, cmd);
+
+    return scope.Close(Undefined());
+} // seekPlayerSync() }}}2
+
+/**
+ * Set loop region (or disable looping by false)
+ *
+ * @public
+ * @param {v8::Integer} playerId
+ * @param {v8::Number|v8::Boolean} start Loop start frame or false to disable looping
+ * @param {v8::Number} [end] Loop end frame (exclusive). Default: end of file
+ * @param {v8::Integer} [at] JACK frame time to apply at. Default: as soon as possible
+ */
+Handle<Value> setPlayerLoopSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+    NEED_PLAYER_ID(id);
+
+    player_command_t cmd;
+    cmd.type = PLAYER_CMD_LOOP;
+    if (args[1]->IsBoolean() && !args[1]->BooleanValue()) {
+        cmd.position = 0;
+        cmd.loop_end = 0;
+    } else {
+        cmd.position = (uint64_t)args[1]->NumberValue();
+        cmd.loop_end = args[2]->IsNumber()
+            ? (uint64_t)args[2]->NumberValue() : cs->players[id]->frames;
+    }
+    set_player_command_time(&cmd, args[3]);
+    SEND_PLAYER_COMMAND(id, cmd);
+
+    return scope.Close(Undefined());
+} // setPlayerLoopSync() }}}2
+
+/**
+ * Get player state
+ *
+ * @public
+ * @param {v8::Integer} playerId
+ * @returns {v8::Object} status {position: Number, frames: Number,
+ *   channels: Number, sampleRate: Number, playing: Boolean, ended: Number,
+ *   underruns: Number, lockFailures: Number}
+ *   "ended" is count of reaching end of file, "underruns" is count of cycles
+ *   with silence instead of frames that wasn't locked in memory yet,
+ *   "lockFailures" is count of failed locks (see RLIMIT_MEMLOCK)
+ */
+Handle<Value> getPlayerStatusSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+    NEED_PLAYER_ID(id);
+    player_t *player = cs->players[id];
+
+    Local<Object> status = Object::New();
+    status->Set(String::NewSymbol("position"), Number::New((double)player->position));
+    status->Set(String::NewSymbol("frames"), Number::New((double)player->frames));
+    status->Set(String::NewSymbol("channels"), Integer::NewFromUnsigned(player->channels));
+    status->Set(String::NewSymbol("sampleRate"), Integer::NewFromUnsigned(player->sample_rate));
+    status->Set(String::NewSymbol("playing"), Boolean::New(player->is_playing));
+    status->Set(String::NewSymbol("ended"), Integer::NewFromUnsigned(player->ended));
+    status->Set(String::NewSymbol("underruns"), Integer::NewFromUnsigned(player->underruns));
+    status->Set(String::NewSymbol("lockFailures"), Integer::NewFromUnsigned(player->lock_failures));
+
+    return scope.Close(status);
+} // getPlayerStatusSync() }}}2
+
+/**
+ * Stop player and free its resources
+ *
+ * @public
+ * @param {v8::Integer} playerId
+ */
+Handle<Value> destroyPlayerSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+    NEED_PLAYER_ID(id);
+
+    destroy_player(id);
+
+    return scope.Close(Undefined());
+} // destroyPlayerSync() }}}2
+
+/**
+ * Get current JACK frame time (for sample-accurate player commands)
+ *
+ * @public
+ * @returns {v8::Integer} frameTime
+ */
+Handle<Value> getFrameTimeSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    return scope.Close(Integer::NewFromUnsigned(jack_frame_time(cs->client)));
+} // getFrameTimeSync() }}}2
+
+// playing }}}1
+
+// metering {{{1
+
+/**
+ * Free meters retired from RT snapshot
+ *
+ * @private
+ */
+void rt_free_meters(void *ptr) // {{{2
+{
+    meters_free((meters_t *)ptr);
+} // rt_free_meters() }}}2
+
+/**
+ * Recreate meters for current own ports list and buffer size
+ *
+ * Own input ports go first, then own output ports. Old meters
+ * is freed when new RT snapshot is published.
+ *
+ * @private
+ */
+void reset_meters() // {{{2
+{
+    if (cs->meters == 0) return;
+
+    meters_t *old_meters = cs->meters;
+    cs->meters = meters_create(
+        cs->own_in_ports_size + cs->own_out_ports_size,
+        jack_get_sample_rate(cs->client), cs->buffer_size,
+        old_meters->true_peak, old_meters->hold_seconds,
+        old_meters->falloff, old_meters->rms_window);
+    rt_retire(rt_free_meters, old_meters, false);
+} // reset_meters() }}}2
+
+/**
+ * Enable native level meters of all own audio ports
+ *
+ * Meters is computed in JACK realtime thread after all processing,
+ * so output ports is measured with everything written to them.
+ * Call it again to change options.
+ *
+ * @public
+ * @param {v8::Object} [options]
+ *   {truePeak: Boolean (default false), holdTime: seconds (default 1.5),
+ *   falloff: dB per second (default 20), rmsWindow: seconds (default 0.3)}
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   jackConnector.openClientSync('JACK_connector_client_name');
+ *   jackConnector.registerInPortSync('in_1');
+ *   jackConnector.enableMetersSync({ truePeak: true });
+ *   jackConnector.activateSync();
+ */
+Handle<Value> enableMetersSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    bool true_peak = false;
+    double hold_seconds = 1.5;
+    double falloff = 20;
+    double rms_window = 0.3;
+
+    if (args.Length() > 0 && args[0]->IsObject()) {
+        Local<Object> options = args[0]->ToObject();
+
+        Local<Value> opt_true_peak = options->Get(String::NewSymbol("truePeak"));
+        if (!opt_true_peak->IsUndefined()) true_peak = opt_true_peak->BooleanValue();
+
+        Local<Value> opt_hold = options->Get(String::NewSymbol("holdTime"));
+        if (!opt_hold->IsUndefined()) {
+            if (!opt_hold->IsNumber() || opt_hold->NumberValue() < 0)
+                THROW_ERR("\"holdTime\" option must be a non-negative number");
+            hold_seconds = opt_hold->NumberValue();
+        }
+
+        Local<Value> opt_falloff = options->Get(String::NewSymbol("falloff"));
+        if (!opt_falloff->IsUndefined()) {
+            if (!opt_falloff->IsNumber() || opt_falloff->NumberValue() < 0)
+                THROW_ERR("\"falloff\" option must be a non-negative number");
+            falloff = opt_falloff->NumberValue();
+        }
+
+        Local<Value> opt_rms_window = options->Get(String::NewSymbol("rmsWindow"));
+        if (!opt_rms_window->IsUndefined()) {
+            if (!opt_rms_window->IsNumber() || opt_rms_window->NumberValue() < 0)
+                THROW_ERR("\"rmsWindow\" option must be a non-negative number");
+            rms_window = opt_rms_window->NumberValue();
+        }
+    }
+
+    meters_t *meters = meters_create(
+        cs->own_in_ports_size + cs->own_out_ports_size,
+        jack_get_sample_rate(cs->client), cs->buffer_size,
+        true_peak, hold_seconds, falloff, rms_window);
+
+    rt_retire(rt_free_meters, cs->meters, false);
+    cs->meters = meters;
+    publish_rt_snapshot();
+
+    return scope.Close(Undefined());
+} // enableMetersSync() }}}2
+
+/**
+ * Disable native level meters
+ *
+ * @public
+ */
+Handle<Value> disableMetersSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+
+    rt_retire(rt_free_meters, cs->meters, false);
+    cs->meters = 0;
+    publish_rt_snapshot();
+
+    return scope.Close(Undefined());
+} // disableMetersSync() }}}2
+
+/**
+ * Get last levels of own audio ports
+ *
+ * Reads last snapshot published by JACK realtime thread, never waits for it,
+ * so it may be called at UI rate. Levels is linear amplitude
+ * (20 * log10(level) for dBFS).
+ *
+ * @public
+ * @returns {v8::Object} meters
+ *   {portShortName: {peak: Number, peakHold: Number, rms: Number, truePeak: Number}}
+ * @example
+ *   setInterval(function () {
+ *     var meters = jackConnector.getMetersSync();
+ *     console.log('in_1 peak: %d dBFS', 20 * Math.log(meters.in_1.peak) / Math.LN10);
+ *   }, 33);
+ */
+Handle<Value> getMetersSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    if (cs->meters == 0) THROW_ERR("Meters is not enabled, see enableMetersSync()");
+
+    // meters is recreated only by this thread, so lock isn't needed
+    const meter_values_t *values = meters_read(cs->meters);
+
+    Local<Object> meters = Object::New();
+    for (uint32_t i=0; i<cs->meters->channels_count; i++) {
+        const char *name = i < cs->own_in_ports_size
+            ? cs->own_in_ports_short_names[i]
+            : cs->own_out_ports_short_names[i - cs->own_in_ports_size];
+
+        Local<Object> obj = Object::New();
+        obj->Set(String::NewSymbol("peak"), Number::New(values[i].peak));
+        obj->Set(String::NewSymbol("peakHold"), Number::New(values[i].peak_hold));
+        obj->Set(String::NewSymbol("rms"), Number::New(values[i].rms));
+        obj->Set(String::NewSymbol("truePeak"), Number::New(values[i].true_peak));
+        meters->Set(String::NewSymbol(name), obj);
+    }
+
+    return scope.Close(meters);
+} // getMetersSync() }}}2
+
+// metering }}}1
+
+// spectrum analyzer {{{1
+
+/**
+ * Grow analyzers cycle buffers for new buffer size
+ *
+ * Call it while processors is detached from RT thread.
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ */
+void reserve_analyzers_frames(jack_nframes_t nframes) // {{{2
+{
+    for (uint32_t a=0; a<cs->analyzers_size; a++) {
+        if (cs->analyzers[a] != 0) analyzer_reserve_frames(cs->analyzers[a], nframes);
+    }
+} // reserve_analyzers_frames() }}}2
+
+/**
+ * Remove analyzer from RT thread and destroy it
+ *
+ * @private
+ * @param {uint32_t} id Analyzer id
+ */
+void destroy_analyzer(uint32_t id) // {{{2
+{
+    analyzer_t *analyzer = cs->analyzers[id];
+    cs->analyzers[id] = 0;
+    publish_rt_snapshot();
+    rt_synchronize();
+
+    analyzer_destroy(analyzer);
+} // destroy_analyzer() }}}2
+
+/**
+ * Destroy all analyzers and free analyzers list (on client close)
+ *
+ * Call it after detach_all_processors().
+ *
+ * @private
+ */
+void destroy_all_analyzers() // {{{2
+{
+    for (uint32_t a=0; a<cs->analyzers_size; a++) {
+        if (cs->analyzers[a] != 0) analyzer_destroy(cs->analyzers[a]);
+    }
+
+    delete [] cs->analyzers;
+    cs->analyzers = 0;
+    cs->analyzers_size = 0;
+    cs->analyzers_capacity = 0;
+} // destroy_all_analyzers() }}}2
+
+/**
+ * Get analyzer id argument
+ *
+ * @private
+ * @returns {int32_t} id or -1 if there is no such analyzer
+ */
+int32_t get_analyzer_id(Local<Value> val) // {{{2
+{
+    if (!val->IsNumber()) return -1;
+    uint32_t id = val->Uint32Value();
+    if (id >= cs->analyzers_size || cs->analyzers[id] == 0) return -1;
+    return id;
+} // get_analyzer_id() }}}2
+
+#define NEED_ANALYZER_ID(analyzer_id) \
+        int32_t analyzer_id = get_analyzer_id(args[0]); \
+        if (analyzer_id < 0) THROW_ERR("Unknown analyzer");
+
+/**
+ * Create native FFT spectrum analyzer of own ports
+ *
+ * JACK realtime thread only copies ports buffers to lock-free ring,
+ * FFT is computed by separate analysis thread every "size * (1 - overlap)"
+ * frames. Input ports is analyzed as captured, output ports is analyzed
+ * after everything is written to them.
+ *
+ * @public
+ * @param {v8::Array} ports Own input or output ports names or handles
+ * @param {v8::Object} [options]
+ *   {size: FFT size, power of 2 from 64 to 65536 (default 4096),
+ *   overlap: part of window shared with previous one, 0..0.95 (default 0.5),
+ *   averaging: weight of previous spectrum, 0..0.99 (default 0 - no averaging),
+ *   window: "hann", "blackman" or "rect" (default "hann")}
+ * @returns {v8::Integer} analyzerId
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   jackConnector.openClientSync('JACK_connector_client_name');
+ *   jackConnector.registerInPortSync('in_1');
+ *   var analyzer = jackConnector.createAnalyzerSync(['in_1'], { size: 2048, averaging: 0.7 });
+ *   jackConnector.activateSync();
+ */
+Handle<Value> createAnalyzerSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    if (!args[0]->IsArray() || args[0].As<Array>()->Length() == 0) {
+        ThrowException(Exception::TypeError(String::New(
+            "Ports argument must be non-empty array of own ports")));
+        return scope.Close(Undefined());
+    }
+
+    uint32_t size = 4096;
+    double overlap = 0.5;
+    double averaging = 0;
+    analyzer_window_t window = ANALYZER_WINDOW_HANN;
+
+    if (args.Length() > 1 && args[1]->IsObject()) {
+        Local<Object> options = args[1]->ToObject();
+
+        Local<Value> opt_size = options->Get(String::NewSymbol("size"));
+        if (!opt_size->IsUndefined()) {
+            size = opt_size->Uint32Value();
+            if (!opt_size->IsNumber()
+            || size < ANALYZER_MIN_SIZE || size > ANALYZER_MAX_SIZE
+            || (size & (size - 1)) != 0) {
+                ThrowException(Exception::RangeError(String::New(
+                    "\"size\" option must be power of 2 from 64 to 65536")));
+                return scope.Close(Undefined());
+            }
+        }
+
+        Local<Value> opt_overlap = options->Get(String::NewSymbol("overlap"));
+        if (!opt_overlap->IsUndefined()) {
+            overlap = opt_overlap->NumberValue();
+            if (!(overlap >= 0 && overlap <= 0.95)) {
+                ThrowException(Exception::RangeError(String::New(
+                    "\"overlap\" option must be from 0 to 0.95")));
+                return scope.Close(Undefined());
+            }
+        }
+
+        Local<Value> opt_averaging = options->Get(String::NewSymbol("averaging"));
+        if (!opt_averaging->IsUndefined()) {
+            averaging = opt_averaging->NumberValue();
+            if (!(averaging >= 0 && averaging <= 0.99)) {
+                ThrowException(Exception::RangeError(String::New(
+                    "\"averaging\" option must be from 0 to 0.99")));
+                return scope.Close(Undefined());
+            }
+        }
+
+        Local<Value> opt_window = options->Get(String::NewSymbol("window"));
+        if (!opt_window->IsUndefined()) {
+            String::AsciiValue window_name(opt_window->ToString());
+            if (strcmp(*window_name, "hann") == 0) window = ANALYZER_WINDOW_HANN;
+            else if (strcmp(*window_name, "blackman") == 0) window = ANALYZER_WINDOW_BLACKMAN;
+            else if (strcmp(*window_name, "rect") == 0) window = ANALYZER_WINDOW_RECT;
+            else {
+                ThrowException(Exception::RangeError(String::New("Unknown analyzer window")));
+                return scope.Close(Undefined());
+            }
+        }
+    }
+
+    // resolve ports to short names before anything is created
+    Local<Array> ports = args[0].As<Array>();
+    uint32_t channels = ports->Length();
+    char **names = new char*[channels];
+    bool *outputs = new bool[channels];
+    for (uint32_t i=0; i<channels; i++) names[i] = 0;
+
+    for (uint32_t i=0; i<channels; i++) {
+        Local<Value> val = ports->Get(i);
+        const char *short_name = 0;
+        bool not_audio = false;
+        String::AsciiValue name_arg(val->ToString());
+
+        if (val->IsNumber()) {
+            jack_port_t *port = get_port_by_handle(val->Uint32Value());
+            not_audio = port != 0 && !is_audio_port_handle(val->Uint32Value());
+            if (not_audio) port = 0;
+            if (port != 0) {
+                short_name = jack_port_short_name(port);
+                outputs[i] = (jack_port_flags(port) & JackPortIsOutput) != 0;
+            }
+        } else if (find_own_port_index(
+            &cs->own_in_ports_hash, cs->own_in_ports_short_names, *name_arg) >= 0) {
+            short_name = *name_arg;
+            outputs[i] = false;
+        } else if (find_own_port_index(
+            &cs->own_out_ports_hash, cs->own_out_ports_short_names, *name_arg) >= 0) {
+            short_name = *name_arg;
+            outputs[i] = true;
+        }
+
+        if (short_name == 0) {
+            for (uint32_t n=0; n<channels; n++) delete [] names[n];
+            delete [] names;
+            delete [] outputs;
+            if (not_audio) THROW_ERR("JACK-port is not an audio port");
+            char err[] = "Own port \"%s\" not found";
+            char err_msg[STR_SIZE + sizeof(err)];
+            snprintf(err_msg, sizeof(err_msg), err, *name_arg);
+            THROW_ERR(err_msg);
+        }
+
+        names[i] = new char[strlen(short_name) + 1];
+        strcpy(names[i], short_name);
+    }
+
+    analyzer_t *analyzer = analyzer_create(
+        channels, size, overlap, averaging, window, cs->buffer_size);
+    for (uint32_t i=0; i<channels; i++) {
+        analyzer->port_names[i] = names[i];
+        analyzer->port_outputs[i] = outputs[i];
+    }
+    delete [] names;
+    delete [] outputs;
+
+    // slot of destroyed analyzer is reused
+    uint32_t id = 0;
+    while (id < cs->analyzers_size && cs->analyzers[id] != 0) id++;
+    if (id == cs->analyzers_size) {
+        if (cs->analyzers_size >= cs->analyzers_capacity) {
+            uint32_t new_capacity = cs->analyzers_capacity ? cs->analyzers_capacity * 2 : 8;
+            analyzer_t **new_analyzers = new analyzer_t*[new_capacity];
+            for (uint32_t a=0; a<cs->analyzers_size; a++) new_analyzers[a] = cs->analyzers[a];
+            delete [] cs->analyzers;
+            cs->analyzers = new_analyzers;
+            cs->analyzers_capacity = new_capacity;
+        }
+        cs->analyzers_size++;
+    }
+    cs->analyzers[id] = analyzer;
+    publish_rt_snapshot();
+
+    return scope.Close(Integer::NewFromUnsigned(id));
+} // createAnalyzerSync() }}}2
+
+/**
+ * Get last magnitude spectra of analyzer ports
+ *
+ * Reads last spectra published by analysis thread, never waits for it.
+ * Magnitude is linear amplitude (full scale sine gives 1 in its bin),
+ * bin "k" is frequency "k * sampleRate / size".
+ *
+ * @public
+ * @param {v8::Integer} analyzerId
+ * @returns {v8::Object} frame
+ *   {spectra: [Float32Array of size / 2 + 1 magnitudes, ...] (ports order),
+ *   count: Number (computed spectra, changes when new spectrum is ready),
+ *   overruns: Number (periods dropped, analysis thread was late),
+ *   size: Number, sampleRate: Number}
+ * @example
+ *   setInterval(function () {
+ *     var frame = jackConnector.getAnalyzerFrameSync(analyzer);
+ *     var bins = frame.spectra[0];
+ *     var max = 0;
+ *     for (var k=1; k<bins.length; k++) if (bins[k] > bins[max]) max = k;
+ *     console.log('loudest: %d Hz', max * frame.sampleRate / frame.size);
+ *   }, 50);
+ */
+Handle<Value> getAnalyzerFrameSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+    NEED_ANALYZER_ID(id);
+    analyzer_t *analyzer = cs->analyzers[id];
+
+    // analyzer is destroyed only by this thread, so lock isn't needed
+    uint32_t bins_count = analyzer->bins_count;
+    float *bins = new float[analyzer->channels * bins_count];
+    analyzer_read(analyzer, bins);
+
+    Local<Array> spectra = Array::New(analyzer->channels);
+    for (uint32_t i=0; i<analyzer->channels; i++) {
+        Local<Object> spectrum = new_float32_array(bins_count);
+        memcpy(spectrum->GetIndexedPropertiesExternalArrayData(),
+            bins + i * bins_count, bins_count * sizeof(float));
+        spectra->Set(i, spectrum);
+    }
+    delete [] bins;
+
+    Local<Object> frame = Object::New();
+    frame->Set(String::NewSymbol("spectra"), spectra);
+    frame->Set(String::NewSymbol("count"), Integer::NewFromUnsigned(analyzer->spectra_count));
+    frame->Set(String::NewSymbol("overruns"), Integer::NewFromUnsigned(analyzer->overruns));
+    frame->Set(String::NewSymbol("size"), Integer::NewFromUnsigned(analyzer->size));
+    frame->Set(String::NewSymbol("sampleRate"),
+        Integer::NewFromUnsigned(jack_get_sample_rate(cs->client)));
+
+    return scope.Close(frame);
+} // getAnalyzerFrameSync() }}}2
+
+/**
+ * Stop analyzer and free its resources
+ *
+ * @public
+ * @param {v8::Integer} analyzerId
+ */
+Handle<Value> destroyAnalyzerSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+    NEED_ANALYZER_ID(id);
+
+    destroy_analyzer(id);
+
+    return scope.Close(Undefined());
+} // destroyAnalyzerSync() }}}2
+
+// spectrum analyzer }}}1
+
+// resampling streams {{{1
+
+/**
+ * Grow streams cycle buffers for new buffer size
+ *
+ * Call it while processors is detached from RT thread.
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ */
+void reserve_streams_frames(jack_nframes_t nframes) // {{{2
+{
+    for (uint32_t s=0; s<cs->streams_size; s++) {
+        if (cs->streams[s] != 0) stream_reserve_frames(cs->streams[s], nframes);
+    }
+} // reserve_streams_frames() }}}2
+
+/**
+ * Remove stream from RT thread and destroy it
+ *
+ * @private
+ * @param {uint32_t} id Stream id
+ */
+void destroy_stream(uint32_t id) // {{{2
+{
+    stream_t *stream = cs->streams[id];
+    cs->streams[id] = 0;
+    publish_rt_snapshot();
+    rt_synchronize();
+
+    stream_destroy(stream);
+} // destroy_stream() }}}2
+
+/**
+ * Destroy all streams and free streams list (on client close)
+ *
+ * Call it after detach_all_processors().
+ *
+ * @private
+ */
+void destroy_all_streams() // {{{2
+{
+    for (uint32_t s=0; s<cs->streams_size; s++) {
+        if (cs->streams[s] != 0) stream_destroy(cs->streams[s]);
+    }
+
+    delete [] cs->streams;
+    cs->streams = 0;
+    cs->streams_size = 0;
+    cs->streams_capacity = 0;
+} // destroy_all_streams() }}}2
+
+/**
+ * Get stream id argument
+ *
+ * @private
+ * @returns {int32_t} id or -1 if there is no such stream
+ */
+int32_t get_stream_id(Local<Value> val) // {{{2
+{
+    if (!val->IsNumber()) return -1;
+    uint32_t id = val->Uint32Value();
+    if (id >= cs->streams_size || cs->streams[id] == 0) return -1;
+    return id;
+} // get_stream_id() }}}2
+
+#define NEED_STREAM_ID(stream_id) \
+        int32_t stream_id = get_stream_id(args[0]); \
+        if (stream_id < 0) THROW_ERR("Unknown stream");
+
+/**
+ * Create resampling stream between own ports and source/sink of other clock
+ *
+ * JS (or native source) writes frames of stream sample rate to lock-free
+ * FIFO and JACK realtime thread resamples them to own output ports
+ * ("playback"), or JACK realtime thread resamples own input ports to FIFO
+ * JS reads from ("capture"). Ratio follows FIFO fill, so drift of clocks
+ * is absorbed without underruns. Playback stream outputs silence until
+ * FIFO is filled to "latency" (also after underrun), capture stream gives
+ * nothing to read until it's filled first time. Stream side must write/read
+ * at its own clock (for example one network packet at a time),
+ * not everything that is available.
+ *
+ * @public
+ * @param {v8::String} direction "playback" or "capture"
+ * @param {v8::Array} ports Own output (playback) or input (capture) ports
+ *   names or handles, stream channel per port
+ * @param {v8::Object} [options]
+ * @param {v8::Number} [options.sampleRate] Of stream. Default: JACK sample rate
+ * @param {v8::Number} [options.latency] FIFO fill to keep, in seconds. Default: 0.1
+ * @param {v8::Number} [options.quality] Resampler filter length, 8..128. Default: 32
+ * @returns {v8::Integer} streamId
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   jackConnector.openClientSync('JACK_connector_client_name');
+ *   jackConnector.registerOutPortSync('out_l');
+ *   jackConnector.registerOutPortSync('out_r');
+ *   jackConnector.activateSync();
+ *   var stream = jackConnector.createStreamSync('playback', ['out_l', 'out_r'],
+ *     { sampleRate: 44100, latency: 0.2 });
+ *   socket.on('message', function (msg) {
+ *     jackConnector.writeStreamSync(stream, decode(msg)); // [Float32Array, Float32Array]
+ *   });
+ */
+Handle<Value> createStreamSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    stream_direction_t direction;
+    String::AsciiValue direction_arg(args[0]->ToString());
+    if (strcmp(*direction_arg, "playback") == 0) direction = STREAM_PLAYBACK;
+    else if (strcmp(*direction_arg, "capture") == 0) direction = STREAM_CAPTURE;
+    else {
+        ThrowException(Exception::RangeError(String::New(
+            "Direction must be \"playback\" or \"capture\"")));
+        return scope.Close(Undefined());
+    }
+    bool output = direction == STREAM_PLAYBACK;
+
+    if (!args[1]->IsArray() || args[1].As<Array>()->Length() == 0) {
+        ThrowException(Exception::TypeError(String::New(
+            "Ports argument must be non-empty array of own ports")));
+        return scope.Close(Undefined());
+    }
+
+    jack_nframes_t jack_rate = jack_get_sample_rate(cs->client);
+    jack_nframes_t sample_rate = jack_rate;
+    double latency = 0.1;
+    uint32_t taps = 32;
+
+    if (args.Length() > 2 && args[2]->IsObject()) {
+        Local<Object> options = args[2]->ToObject();
+
+        Local<Value> opt_rate = options->Get(String::NewSymbol("sampleRate"));
+        if (!opt_rate->IsUndefined()) {
+            sample_rate = opt_rate->Uint32Value();
+            // ratio must fit drift correction and resampler filter
+            if (!opt_rate->IsNumber() || sample_rate < jack_rate / 8 || sample_rate > jack_rate * 8) {
+                ThrowException(Exception::RangeError(String::New(
+                    "\"sampleRate\" option must be within 8 times of JACK sample rate")));
+                return scope.Close(Undefined());
+            }
+        }
+
+        Local<Value> opt_latency = options->Get(String::NewSymbol("latency"));
+        if (!opt_latency->IsUndefined()) {
+            latency = opt_latency->NumberValue();
+            if (!(latency > 0 && latency <= 10)) {
+                ThrowException(Exception::RangeError(String::New(
+                    "\"latency\" option must be from 0 to 10 seconds")));
+                return scope.Close(Undefined());
+            }
+        }
+
+        Local<Value> opt_quality = options->Get(String::NewSymbol("quality"));
+        if (!opt_quality->IsUndefined()) {
+            taps = opt_quality->Uint32Value();
+            if (!opt_quality->IsNumber()
+            || taps < RESAMPLER_MIN_TAPS || taps > RESAMPLER_MAX_TAPS || (taps & 1) != 0) {
+                ThrowException(Exception::RangeError(String::New(
+                    "\"quality\" option must be even number from 8 to 128")));
+                return scope.Close(Undefined());
+            }
+        }
+    }
+
+    // resolve ports to short names before anything is created
+    Local<Array> ports = args[1].As<Array>();
+    uint32_t channels = ports->Length();
+    char **names = new char*[channels];
+    for (uint32_t i=0; i<channels; i++) names[i] = 0;
+
+    for (uint32_t i=0; i<channels; i++) {
+        Local<Value> val = ports->Get(i);
+        const char *short_name = 0;
+        bool not_audio = false;
+        String::AsciiValue name_arg(val->ToString());
+
+        if (val->IsNumber()) {
+            jack_port_t *port = get_port_by_handle(val->Uint32Value());
+            not_audio = port != 0 && !is_audio_port_handle(val->Uint32Value());
+            if (not_audio) port = 0;
+            if (port != 0 && ((jack_port_flags(port) & JackPortIsOutput) != 0) == output)
+                short_name = jack_port_short_name(port);
+        } else if (output && find_own_port_index(
+            &cs->own_out_ports_hash, cs->own_out_ports_short_names, *name_arg) >= 0) {
+            short_name = *name_arg;
+        } else if (!output && find_own_port_index(
+            &cs->own_in_ports_hash, cs->own_in_ports_short_names, *name_arg) >= 0) {
+            short_name = *name_arg;
+        }
+
+        if (short_name == 0) {
+            for (uint32_t n=0; n<channels; n++) delete [] names[n];
+            delete [] names;
+            if (not_audio) THROW_ERR("JACK-port is not an audio port");
+            char err[] = "Own %s port \"%s\" not found";
+            char err_msg[STR_SIZE + sizeof(err) + 6];
+            snprintf(err_msg, sizeof(err_msg), err, output ? "output" : "input", *name_arg);
+            THROW_ERR(err_msg);
+        }
+
+        names[i] = new char[strlen(short_name) + 1];
+        strcpy(names[i], short_name);
+    }
+
+    stream_t *stream = stream_create(
+        direction, channels, sample_rate, jack_rate, cs->buffer_size, latency, taps);
+    for (uint32_t i=0; i<channels; i++) stream->port_names[i] = names[i];
+    delete [] names;
+
+    // slot of destroyed stream is reused
+    uint32_t id = 0;
+    while (id < cs->streams_size && cs->streams[id] != 0) id++;
+    if (id == cs->streams_size) {
+        if (cs->streams_size >= cs->streams_capacity) {
+            uint32_t new_capacity = cs->streams_capacity ? cs->streams_capacity * 2 : 8;
+            stream_t **new_streams = new stream_t*[new_capacity];
+            for (uint32_t s=0; s<cs->streams_size; s++) new_streams[s] = cs->streams[s];
+            delete [] cs->streams;
+            cs->streams = new_streams;
+            cs->streams_capacity = new_capacity;
+        }
+        cs->streams_size++;
+    }
+    cs->streams[id] = stream;
+    publish_rt_snapshot();
+
+    return scope.Close(Integer::NewFromUnsigned(id));
+} // createStreamSync() }}}2
+
+/**
+ * Write frames to playback stream
+ *
+ * @public
+ * @param {v8::Integer} streamId
+ * @param {v8::Array} buffers Float32Array of every channel, all of the same length
+ * @returns {v8::Integer} Written frames (less than length of buffers if FIFO is full)
+ */
+Handle<Value> writeStreamSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+    NEED_STREAM_ID(id);
+    stream_t *stream = cs->streams[id];
+
+    if (stream->direction != STREAM_PLAYBACK) THROW_ERR("Stream is not a playback stream");
+    if (!args[1]->IsArray() || args[1].As<Array>()->Length() != stream->channels) {
+        ThrowException(Exception::TypeError(String::New(
+            "Buffers argument must be an array of Float32Array for every channel")));
+        return scope.Close(Undefined());
+    }
+
+    Local<Array> buffers = args[1].As<Array>();
+    const float **bufs = new const float*[stream->channels];
+    uint32_t frames = 0;
+    for (uint32_t c=0; c<stream->channels; c++) {
+        Local<Value> val = buffers->Get(c);
+        uint32_t length = is_float32_array(val)
+            ? val.As<Object>()->GetIndexedPropertiesExternalArrayDataLength() : 0;
+        if (!is_float32_array(val) || (c > 0 && length != frames)) {
+            delete [] bufs;
+            ThrowException(Exception::TypeError(String::New(
+                "Buffers argument must be an array of Float32Array of the same length")));
+            return scope.Close(Undefined());
+        }
+        frames = length;
+        bufs[c] = (const float *)val.As<Object>()->GetIndexedPropertiesExternalArrayData();
+    }
+
+    // stream is destroyed only by this thread, so lock isn't needed
+    uint32_t written = stream_write(stream, bufs, frames);
+    delete [] bufs;
+
+    return scope.Close(Integer::NewFromUnsigned(written));
+} // writeStreamSync() }}}2
+
+/**
+ * Read frames from capture stream
+ *
+ * @public
+ * @param {v8::Integer} streamId
+ * @param {v8::Integer} [frames] Max frames to read. Default: all available
+ * @returns {v8::Array} Float32Array of every channel (empty if nothing to read)
+ */
+Handle<Value> readStreamSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+    NEED_STREAM_ID(id);
+    stream_t *stream = cs->streams[id];
+
+    if (stream->direction != STREAM_CAPTURE) THROW_ERR("Stream is not a capture stream");
+
+    uint32_t frames = stream_available(stream);
+    if (args.Length() > 1 && args[1]->IsNumber() && args[1]->Uint32Value() < frames)
+        frames = args[1]->Uint32Value();
+
+    Local<Array> buffers = Array::New(stream->channels);
+    float **bufs = new float*[stream->channels];
+    for (uint32_t c=0; c<stream->channels; c++) {
+        Local<Object> buffer = new_float32_array(frames);
+        bufs[c] = (float *)buffer->GetIndexedPropertiesExternalArrayData();
+        buffers->Set(c, buffer);
+    }
+    stream_read(stream, bufs, frames);
+    delete [] bufs;
+
+    return scope.Close(buffers);
+} // readStreamSync() }}}2
+
+/**
+ * Get stream status
+ *
+ * @public
+ * @param {v8::Integer} streamId
+ * @returns {v8::Object} status
+ *   {available: Number (frames to write for playback, to read for capture),
+ *   fill: Number (averaged FIFO fill, frames), latency: Number (target fill, frames),
+ *   drift: Number (stream clock relative to JACK clock, 0.0001 is 100 ppm faster),
+ *   buffering: Boolean, underruns: Number, overruns: Number,
+ *   sampleRate: Number}
+ */
+Handle<Value> getStreamStatusSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+    NEED_STREAM_ID(id);
+    stream_t *stream = cs->streams[id];
+
+    // playback consumes faster when stream is faster, capture produces slower
+    double drift = stream->direction == STREAM_PLAYBACK
+        ? stream->correction : -stream->correction;
+
+    Local<Object> status = Object::New();
+    status->Set(String::NewSymbol("available"),
+        Integer::NewFromUnsigned(stream_available(stream)));
+    status->Set(String::NewSymbol("fill"), Number::New(stream->fill));
+    status->Set(String::NewSymbol("latency"), Integer::NewFromUnsigned(stream->target_fill));
+    status->Set(String::NewSymbol("drift"), Number::New(drift));
+    status->Set(String::NewSymbol("buffering"), Boolean::New(stream->is_buffering));
+    status->Set(String::NewSymbol("underruns"), Integer::NewFromUnsigned(stream->underruns));
+    status->Set(String::NewSymbol("overruns"), Integer::NewFromUnsigned(stream->overruns));
+    status->Set(String::NewSymbol("sampleRate"), Integer::NewFromUnsigned(stream->sample_rate));
+
+    return scope.Close(status);
+} // getStreamStatusSync() }}}2
+
+/**
+ * Stop stream and free its resources
+ *
+ * @public
+ * @param {v8::Integer} streamId
+ */
+Handle<Value> destroyStreamSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+    NEED_STREAM_ID(id);
+
+    destroy_stream(id);
+
+    return scope.Close(Undefined());
+} // destroyStreamSync() }}}2
+
+// resampling streams }}}1
+
+// stats {{{1
+
+/**
+ * Convert histogram summary to JS object
+ *
+ * @private
+ */
+Local<Object> stats_summary_to_object(stats_histogram_t *histogram) // {{{2
+{
+    HandleScope scope;
+
+    stats_summary_t summary;
+    stats_summarize(histogram, &summary);
+
+    Local<Object> obj = Object::New();
+    obj->Set(String::NewSymbol("count"), Number::New((double)summary.count));
+    obj->Set(String::NewSymbol("mean"), Number::New(summary.mean));
+    obj->Set(String::NewSymbol("max"), Number::New(summary.max));
+    obj->Set(String::NewSymbol("p50"), Number::New(summary.p50));
+    obj->Set(String::NewSymbol("p90"), Number::New(summary.p90));
+    obj->Set(String::NewSymbol("p99"), Number::New(summary.p99));
+    obj->Set(String::NewSymbol("p999"), Number::New(summary.p999));
+
+    return scope.Close(obj);
+} // stats_summary_to_object() }}}2
+
+/**
+ * Get realtime performance statistics
+ *
+ * Timings is in microseconds: "cycle" is whole JACK process callback,
+ * "callback" is JS "process" callback (with buffers copying), "wait" is
+ * time JACK realtime thread is blocked by JS callback or worker script.
+ * Percentiles is approximate (within 1/8 of value).
+ *
+ * @public
+ * @returns {v8::Object} stats
+ *   {cpuLoad: Number, xruns: Number, maxXrunDelay: Number, cycles: Number,
+ *   skippedCycles: Number, ringBufferOverruns: Number,
+ *   ringBufferUnderruns: Number, workerErrors: Number, midiLostEvents: Number,
+ *   automationDroppedEvents: Number, simd: String, cycle: Timing, callback: Timing, wait: Timing}
+ *   where Timing is {count, mean, max, p50, p90, p99, p999}
+ * @example
+ *   var stats = jackConnector.getStatsSync();
+ *   console.log('DSP load: %d%%, xruns: %d, p99 of cycle: %dus',
+ *     stats.cpuLoad, stats.xruns, stats.cycle.p99);
+ */
+Handle<Value> getStatsSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    Local<Object> stats = Object::New();
+    stats->Set(String::NewSymbol("cpuLoad"), Number::New(jack_cpu_load(cs->client)));
+    stats->Set(String::NewSymbol("xruns"), Integer::NewFromUnsigned(cs->stats_xruns));
+    stats->Set(String::NewSymbol("maxXrunDelay"), Number::New(cs->stats_max_xrun_delay));
+    stats->Set(String::NewSymbol("cycles"), Integer::NewFromUnsigned(cs->stats_cycles));
+    stats->Set(String::NewSymbol("skippedCycles"),
+        Integer::NewFromUnsigned(cs->stats_skipped_cycles));
+    stats->Set(String::NewSymbol("ringBufferOverruns"),
+        Integer::NewFromUnsigned(cs->ringbuffer_overruns));
+    stats->Set(String::NewSymbol("ringBufferUnderruns"),
+        Integer::NewFromUnsigned(cs->ringbuffer_underruns));
+    stats->Set(String::NewSymbol("workerErrors"), Integer::NewFromUnsigned(cs->dsp_worker_errors));
+    stats->Set(String::NewSymbol("midiLostEvents"), Integer::NewFromUnsigned(cs->midi_lost_events));
+    stats->Set(String::NewSymbol("automationDroppedEvents"),
+        Integer::NewFromUnsigned(cs->dsp_automation_dropped));
+    stats->Set(String::NewSymbol("simd"), String::New(dsp_kernels.name));
+    stats->Set(String::NewSymbol("cycle"), stats_summary_to_object(&cs->cycle_stats));
+    stats->Set(String::NewSymbol("callback"), stats_summary_to_object(&cs->callback_stats));
+    stats->Set(String::NewSymbol("wait"), stats_summary_to_object(&cs->wait_stats));
+
+    return scope.Close(stats);
+} // getStatsSync() }}}2
+
+/**
+ * Reset realtime performance statistics (counters and timings)
+ *
+ * @public
+ */
+Handle<Value> resetStatsSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+
+    stats_reset(&cs->cycle_stats);
+    stats_reset(&cs->callback_stats);
+    stats_reset(&cs->wait_stats);
+    cs->stats_cycles = 0;
+    cs->stats_skipped_cycles = 0;
+    cs->stats_xruns = 0;
+    cs->stats_max_xrun_delay = 0;
+    cs->ringbuffer_overruns = 0;
+    cs->ringbuffer_underruns = 0;
+    cs->dsp_worker_errors = 0;
+    cs->midi_lost_events = 0;
+    cs->dsp_automation_dropped = 0;
+
+    return scope.Close(Undefined());
+} // resetStatsSync() }}}2
+
+// stats }}}1
+
+// transport {{{1
+
+/**
+ * Fill JS object of cycle transport
+ *
+ * "process" callback and worker script get the same objects every cycle,
+ * "bbt" object is filled only when there is BBT position.
+ *
+ * @private
+ * @param {v8::Object} transport
+ * @param {v8::Object} bbt Object for "bbt" field
+ * @param {transport_cycle_t} cycle
+ */
+void update_transport_object( // {{{2
+    Handle<Object> transport,
+    Handle<Object> bbt,
+    const transport_cycle_t *cycle)
+{
+    const char *state;
+    switch (cycle->state) {
+        case JackTransportRolling: state = "rolling"; break;
+        case JackTransportLooping: state = "looping"; break;
+        case JackTransportStarting: state = "starting"; break;
+        default: state = "stopped";
+    }
+
+    transport->Set(String::NewSymbol("frameTime"), Integer::NewFromUnsigned(cycle->frame_time));
+    transport->Set(String::NewSymbol("nframes"), Integer::NewFromUnsigned(cycle->nframes));
+    transport->Set(String::NewSymbol("state"), String::NewSymbol(state));
+    transport->Set(String::NewSymbol("frame"), Integer::NewFromUnsigned(cycle->position.frame));
+    transport->Set(String::NewSymbol("frameRate"),
+        Integer::NewFromUnsigned(cycle->position.frame_rate));
+
+    if (cycle->position.valid & JackPositionBBT) {
+        const jack_position_t *pos = &cycle->position;
+        bbt->Set(String::NewSymbol("bar"), Integer::New(pos->bar));
+        bbt->Set(String::NewSymbol("beat"), Integer::New(pos->beat));
+        bbt->Set(String::NewSymbol("tick"), Integer::New(pos->tick));
+        bbt->Set(String::NewSymbol("barStartTick"), Number::New(pos->bar_start_tick));
+        bbt->Set(String::NewSymbol("beatsPerBar"), Number::New(pos->beats_per_bar));
+        bbt->Set(String::NewSymbol("beatType"), Number::New(pos->beat_type));
+        bbt->Set(String::NewSymbol("ticksPerBeat"), Number::New(pos->ticks_per_beat));
+        bbt->Set(String::NewSymbol("bpm"), Number::New(pos->beats_per_minute));
+        transport->Set(String::NewSymbol("bbt"), bbt);
+    } else {
+        transport->Set(String::NewSymbol("bbt"), Null());
+    }
+} // update_transport_object() }}}2
+
+/**
+ * Create JS object of cycle transport (for getTransportSync())
+ *
+ * @private
+ * @param {transport_cycle_t} cycle
+ * @returns {v8::Object} transport
+ */
+Local<Object> new_transport_object(const transport_cycle_t *cycle) // {{{2
+{
+    Local<Object> transport = Object::New();
+    update_transport_object(transport, Object::New(), cycle);
+    return transport;
+} // new_transport_object() }}}2
+
+/**
+ * Timebase callback of JACK (timebase master only)
+ *
+ * @private
+ */
+void jack_timebase( // {{{2
+    jack_transport_state_t state,
+    jack_nframes_t nframes,
+    jack_position_t *pos,
+    int new_pos,
+    void *arg)
+{
+    client_scope_t client_scope((client_state_t *)arg);
+    timebase_fill(&cs->transport, pos);
+} // jack_timebase() }}}2
+
+/**
+ * Get transport state and position
+ *
+ * Position of last JACK cycle is read from snapshot published by realtime
+ * thread (never waits for it), so "frameTime" is frame time of that cycle.
+ * Before first cycle transport is queried directly.
+ *
+ * @public
+ * @returns {v8::Object} transport
+ *   {frameTime: Number, nframes: Number,
+ *   state: "stopped"|"rolling"|"looping"|"starting",
+ *   frame: Number, frameRate: Number,
+ *   bbt: {bar, beat, tick, barStartTick, beatsPerBar, beatType, ticksPerBeat, bpm}
+ *   or null if there is no timebase master}
+ * @example
+ *   var transport = jackConnector.getTransportSync();
+ *   if (transport.bbt) console.log('%d|%d', transport.bbt.bar, transport.bbt.beat);
+ */
+Handle<Value> getTransportSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    transport_cycle_t cycle;
+    if (!cs->client_active || !transport_read(&cs->transport, &cycle)) {
+        cycle.frame_time = jack_frame_time(cs->client);
+        cycle.nframes = cs->buffer_size;
+        cycle.state = jack_transport_query(cs->client, &cycle.position);
+    }
+
+    return scope.Close(new_transport_object(&cycle));
+} // getTransportSync() }}}2
+
+/**
+ * Start JACK transport rolling
+ *
+ * @public
+ */
+Handle<Value> startTransportSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    jack_transport_start(cs->client);
+
+    return scope.Close(Undefined());
+} // startTransportSync() }}}2
+
+/**
+ * Stop JACK transport
+ *
+ * @public
+ */
+Handle<Value> stopTransportSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    jack_transport_stop(cs->client);
+
+    return scope.Close(Undefined());
+} // stopTransportSync() }}}2
+
+/**
+ * Reposition JACK transport (takes effect at start of a next cycle)
+ *
+ * @public
+ * @param {v8::Integer} frame Transport frame
+ * @example
+ *   // back to start
+ *   jackConnector.locateTransportSync(0);
+ */
+Handle<Value> locateTransportSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    if (!args[0]->IsNumber() || args[0]->NumberValue() < 0) {
+        ThrowException(Exception::TypeError(String::New(
+            "Frame must be a non-negative number")));
+        return scope.Close(Undefined());
+    }
+
+    if (jack_transport_locate(cs->client, args[0]->Uint32Value()) != 0)
+        THROW_ERR("Couldn't locate JACK transport");
+
+    return scope.Close(Undefined());
+} // locateTransportSync() }}}2
+
+/**
+ * Become JACK timebase master or change tempo of it
+ *
+ * Bars, beats and ticks is computed from transport frame in JACK realtime
+ * thread. Tempo is passed to realtime thread through lock-free snapshot,
+ * changing it keeps current musical position and applies new tempo
+ * from there.
+ *
+ * @public
+ * @param {v8::Object} [options]
+ *   {bpm: Number (default 120), beatsPerBar: Number (default 4),
+ *   beatType: Number (default 4), ticksPerBeat: Number (default 1920),
+ *   conditional: Boolean - fail if there is other timebase master (default false)}
+ * @example
+ *   jackConnector.setTimebaseMasterSync({ bpm: 96, beatsPerBar: 3 });
+ *   jackConnector.startTransportSync();
+ */
+Handle<Value> setTimebaseMasterSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    timebase_tempo_t tempo;
+    tempo.bpm = TIMEBASE_DEFAULT_BPM;
+    tempo.beats_per_bar = TIMEBASE_DEFAULT_BEATS_PER_BAR;
+    tempo.beat_type = TIMEBASE_DEFAULT_BEAT_TYPE;
+    tempo.ticks_per_beat = TIMEBASE_DEFAULT_TICKS_PER_BEAT;
+    bool conditional = false;
+
+    if (args.Length() > 0 && args[0]->IsObject()) {
+        Local<Object> options = args[0]->ToObject();
+
+        Local<Value> opt_bpm = options->Get(String::NewSymbol("bpm"));
+        if (!opt_bpm->IsUndefined()) {
+            if (!opt_bpm->IsNumber() || !(opt_bpm->NumberValue() > 0))
+                THROW_ERR("\"bpm\" option must be a positive number");
+            tempo.bpm = opt_bpm->NumberValue();
+        }
+
+        Local<Value> opt_beats_per_bar = options->Get(String::NewSymbol("beatsPerBar"));
+        if (!opt_beats_per_bar->IsUndefined()) {
+            if (!opt_beats_per_bar->IsNumber() || !(opt_beats_per_bar->NumberValue() >= 1))
+                THROW_ERR("\"beatsPerBar\" option must be a number not less than 1");
+            tempo.beats_per_bar = opt_beats_per_bar->NumberValue();
+        }
+
+        Local<Value> opt_beat_type = options->Get(String::NewSymbol("beatType"));
+        if (!opt_beat_type->IsUndefined()) {
+            if (!opt_beat_type->IsNumber() || !(opt_beat_type->NumberValue() > 0))
+                THROW_ERR("\"beatType\" option must be a positive number");
+            tempo.beat_type = opt_beat_type->NumberValue();
+        }
+
+        Local<Value> opt_ticks = options->Get(String::NewSymbol("ticksPerBeat"));
+        if (!opt_ticks->IsUndefined()) {
+            if (!opt_ticks->IsNumber() || !(opt_ticks->NumberValue() >= 1))
+                THROW_ERR("\"ticksPerBeat\" option must be a number not less than 1");
+            tempo.ticks_per_beat = opt_ticks->NumberValue();
+        }
+
+        Local<Value> opt_conditional = options->Get(String::NewSymbol("conditional"));
+        if (!opt_conditional->IsUndefined()) conditional = opt_conditional->BooleanValue();
+    }
+
+    timebase_set_tempo(&cs->transport, &tempo);
+
+    if (!cs->timebase_master) {
+        int err = jack_set_timebase_callback(cs->client, conditional ? 1 : 0, jack_timebase, cs);
+        if (err == EBUSY) THROW_ERR("There is other JACK timebase master");
+        if (err != 0) THROW_ERR("Couldn't become JACK timebase master");
+        cs->timebase_master = true;
+    }
+
+    return scope.Close(Undefined());
+} // setTimebaseMasterSync() }}}2
+
+/**
+ * Stop being JACK timebase master
+ *
+ * @public
+ */
+Handle<Value> releaseTimebaseSync(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+    USE_CLIENT_STATE();
+    NEED_JACK_CLIENT_OPENED();
+
+    if (!cs->timebase_master) return scope.Close(Undefined());
+
+    if (jack_release_timebase(cs->client) != 0)
+        THROW_ERR("Couldn't release JACK timebase");
+    cs->timebase_master = false;
+
+    return scope.Close(Undefined());
+} // releaseTimebaseSync() }}}2
+
+// transport }}}1
+
+
+/* System functions */
+
+/**
+ * Get JACK-ports
+ *
+ * @private
+ * @param {bool} withOwn Get ports of this client too
+ * @param {unsigned long} flags Sum of ports filter
+ * @returns {v8::Array} allPortsList Array of full ports names strings
+ * @example Handle<Array> portsList = get_ports(true, 0);
+ * @example Handle<Array> outPortsList = get_ports(false, JackPortIsOutput);
+ */
+Handle<Array> get_ports(bool withOwn, unsigned long flags) // {{{1
+{
+    // cached graph of active client, without requests to JACK server
+    if (port_graph_update(&cs->port_graph)) {
+        Local<Array> portsList = Array::New();
+        uint32_t n = 0;
+        for (uint32_t i=0; i<port_graph_size(&cs->port_graph); i++) {
+            port_graph_entry_t *entry = port_graph_entry(&cs->port_graph, i);
+            if (entry->port == 0 || (entry->flags & flags) != flags) continue;
+            if (!withOwn && entry->own) continue;
+            portsList->Set(n++, String::NewSymbol(entry->name));
+        }
+        return portsList;
+    }
+
+    unsigned int ports_count = 0;
+    const char** jack_ports_list;
+    jack_ports_list = jack_get_ports(cs->client, NULL, NULL, flags);
+    while (jack_ports_list[ports_count]) ports_count++;
+
+    unsigned int parsed_ports_count = 0;
+    if (withOwn) {
+        parsed_ports_count = ports_count;
+    } else {
+        for (unsigned int i=0; i<ports_count; i++) {
+            for (unsigned int n=0; ; n++) {
+                if (n>=STR_SIZE-1) {
+                    parsed_ports_count++;
+                    break;
+                }
+
+                if (cs->client_name[n] == '\0' && jack_ports_list[i][n] == ':') {
+                    break;
+                }
+
+                if (cs->client_name[n] != jack_ports_list[i][n]) {
+                    parsed_ports_count++;
+                    break;
+                }
+            }
+        }
+    }
+
+    Local<Array> allPortsList;
+    if (withOwn) {
+        allPortsList = Array::New(ports_count);
+        for (unsigned int i=0; i<ports_count; i++) {
+            allPortsList->Set(i, String::NewSymbol(jack_ports_list[i]));
+        }
+    } else {
+        allPortsList = Array::New(parsed_ports_count);
         for (unsigned int i=0; i<ports_count; i++) {
             for (unsigned int n=0; ; n++) {
                 if (n>=STR_SIZE-1) {
@@ -788,369 +4313,2640 @@ Handle<Array> get_ports(bool withOwn, unsigned long flags) // {{{1
                     break;
                 }
 
-                if (client_name[n] == '\0' && jack_ports_list[i][n] == ':') {
-                    break;
-                }
+                if (cs->client_name[n] == '\0' && jack_ports_list[i][n] == ':') {
+                    break;
+                }
+
+                if (cs->client_name[n] != jack_ports_list[i][n]) {
+                    allPortsList->Set(i, String::NewSymbol(jack_ports_list[i]));
+                    break;
+                }
+            }
+        }
+    }
+
+    delete jack_ports_list;
+    return allPortsList;
+} // get_ports() }}}1
+
+typedef struct get_own_ports_retval_t {
+    char** names;
+    char** own_names; // without client name
+    uint32_t count;
+};
+
+char* get_port_name_without_client_name(char* port_name) // {{{1
+{
+    char* retval = new char[STR_SIZE];
+    uint16_t i=0, n=0;
+    for (i=0; i<STR_SIZE; i++) {
+        if (port_name[i] == ':') {
+            n = i+1; break;
+        }
+    }
+    for (i=0; n<STR_SIZE; i++, n++) {
+        retval[i] = port_name[n];
+        if (retval[i] == '\0') break;
+    }
+    return retval;
+} // get_port_name_without_client_name() }}}1
+
+get_own_ports_retval_t get_own_ports(unsigned long flags, const char *type) // {{{1
+{
+    const char** jack_ports_list;
+
+    char** ports_names;
+    char** ports_own_names;
+    char** ports_namesTmp;
+
+    jack_ports_list = jack_get_ports(cs->client, NULL, type, flags);
+    const char *skipped_name = cs->unregistering_port ? jack_port_name(cs->unregistering_port) : 0;
+
+    uint32_t i=0, m=0;
+    uint16_t n=0;
+
+    if (jack_ports_list) while (jack_ports_list[i]) i++;
+    ports_namesTmp = new char*[i];
+    i = 0;
+
+    if (jack_ports_list) while (jack_ports_list[i]) {
+        uint8_t found = 1;
+        for (n=0; ; n++) {
+            if (n>=STR_SIZE-1) { found = 0; break; }
+            if (cs->client_name[n] == '\0' && jack_ports_list[i][n] == ':') { break; }
+            if (cs->client_name[n] != jack_ports_list[i][n]) { found = 0; break; }
+        }
+        if (skipped_name != 0 && strcmp(skipped_name, jack_ports_list[i]) == 0) found = 0;
+        if (found == 1) {
+            ports_namesTmp[m] = new char[STR_SIZE];
+            for (n=0; n<STR_SIZE; n++) {
+                ports_namesTmp[m][n] = jack_ports_list[i][n];
+                if (jack_ports_list[i][n] == '\0') break;
+            }
+            m++;
+        }
+        i++;
+    }
+    delete [] jack_ports_list;
+
+    ports_names = new char*[m];
+    ports_own_names = new char*[m];
+    for (i=0; i<m; i++) {
+        ports_names[i] = new char[STR_SIZE];
+        for (n=0; n<STR_SIZE; n++) {
+            ports_names[i][n] = ports_namesTmp[i][n];
+            if (ports_namesTmp[i][n] == '\0') break;
+        }
+        delete [] ports_namesTmp[i];
+        ports_own_names[i] = get_port_name_without_client_name(ports_names[i]);
+    }
+    delete [] ports_namesTmp;
+
+    get_own_ports_retval_t retval;
+    retval.names = ports_names;
+    retval.own_names = ports_own_names;
+    retval.count = m;
+
+    return retval;
+} // get_own_ports() }}}1
+
+/**
+ * Rebuild list of own MIDI ports of one direction
+ *
+ * RT thread has its own copy, see publish_rt_snapshot().
+ *
+ * @private
+ */
+void reset_own_midi_ports( // {{{1
+    unsigned long flags,
+    jack_port_t ***ports,
+    char ***short_names,
+    uint32_t *size)
+{
+    for (uint32_t i=0; i<*size; i++) delete [] (*short_names)[i];
+    delete [] *ports;
+    delete [] *short_names;
+
+    get_own_ports_retval_t retval = get_own_ports(flags, JACK_DEFAULT_MIDI_TYPE);
+    *ports = new jack_port_t*[retval.count];
+    for (uint32_t i=0; i<retval.count; i++) {
+        (*ports)[i] = jack_port_by_name(cs->client, retval.names[i]);
+        delete [] retval.names[i];
+    }
+    delete [] retval.names;
+    *short_names = retval.own_names;
+    *size = retval.count;
+} // reset_own_midi_ports() }}}1
+
+void reset_own_ports_list() // {{{1
+{
+    get_own_ports_retval_t retval;
+    uint32_t i=0;
+
+    // RT thread keeps previous snapshot until new one is published
+
+    // in {{{2
+    retval = get_own_ports(JackPortIsInput, JACK_DEFAULT_AUDIO_TYPE);
+    for (i=0; i<cs->own_in_ports_size; i++) {
+        delete [] cs->own_in_ports[i];
+        delete [] cs->own_in_ports_short_names[i];
+    }
+    delete [] cs->own_in_ports;
+    delete [] cs->own_in_ports_short_names;
+    cs->own_in_ports = retval.names;
+    cs->own_in_ports_short_names = retval.own_names;
+    cs->own_in_ports_size = retval.count;
+    delete [] cs->own_in_jack_ports;
+    cs->own_in_jack_ports = new jack_port_t*[cs->own_in_ports_size];
+    for (i=0; i<cs->own_in_ports_size; i++) {
+        cs->own_in_jack_ports[i] = jack_port_by_name(cs->client, cs->own_in_ports[i]);
+    }
+    build_own_ports_hash(&cs->own_in_ports_hash, cs->own_in_ports_short_names, cs->own_in_ports_size);
+    // in }}}2
+
+    // out {{{2
+    retval = get_own_ports(JackPortIsOutput, JACK_DEFAULT_AUDIO_TYPE);
+    for (i=0; i<cs->own_out_ports_size; i++) {
+        delete [] cs->own_out_ports[i];
+        delete [] cs->own_out_ports_short_names[i];
+    }
+    delete [] cs->own_out_ports;
+    delete [] cs->own_out_ports_short_names;
+    cs->own_out_ports = retval.names;
+    cs->own_out_ports_short_names = retval.own_names;
+    cs->own_out_ports_size = retval.count;
+    delete [] cs->own_out_jack_ports;
+    cs->own_out_jack_ports = new jack_port_t*[cs->own_out_ports_size];
+    for (i=0; i<cs->own_out_ports_size; i++) {
+        cs->own_out_jack_ports[i] = jack_port_by_name(cs->client, cs->own_out_ports[i]);
+    }
+    build_own_ports_hash(&cs->own_out_ports_hash, cs->own_out_ports_short_names, cs->own_out_ports_size);
+    // out }}}2
+
+    // MIDI {{{2
+    reset_own_midi_ports(JackPortIsInput,
+        &cs->own_midi_in_ports, &cs->own_midi_in_short_names, &cs->own_midi_in_size);
+    reset_own_midi_ports(JackPortIsOutput,
+        &cs->own_midi_out_ports, &cs->own_midi_out_short_names, &cs->own_midi_out_size);
+    // MIDI }}}2
+
+    reset_port_handles_indexes();
+    // already started cycle checks it before it uses buffers of previous ports list
+    cs->own_ports_version++;
+
+    if (cs->ringbuffer_mode) reset_ringbuffers();
+    update_dsp_program();
+    reset_meters();
+    publish_rt_snapshot();
+
+    reset_process_pool(cs->buffer_size);
+} // reset_own_ports_list() }}}1
+
+/**
+ * Resize all buffers for new JACK buffer size (in main thread)
+ *
+ * RT thread skips cycles of new size until this is done,
+ * so it never allocates anything by itself.
+ *
+ * @private
+ * @param {jack_nframes_t} nframes New buffer size
+ */
+void apply_buffer_size(jack_nframes_t nframes) // {{{1
+{
+    // processors is never shrunk, they're grown only when RT thread can't push to them
+    if (nframes > cs->buffer_size) {
+        cs->processors_detached = true;
+        publish_rt_snapshot();
+        rt_synchronize();
+        reserve_recorders_frames(nframes);
+        reserve_analyzers_frames(nframes);
+        reserve_streams_frames(nframes);
+        cs->processors_detached = false;
+    }
+
+    cs->buffer_size = nframes;
+    if (cs->ringbuffer_mode) reset_ringbuffers();
+    update_dsp_program();
+    reset_meters();
+    publish_rt_snapshot();
+
+    reset_process_pool(nframes);
+} // apply_buffer_size() }}}1
+
+/**
+ * Check for port connection
+ *
+ * @private
+ * @param {const char} src_port_name Source full port name
+ * @param {const char} dst_port_name Destination full port name
+ * @returns {int} result 0 - not connected, 1 - connected
+ * @example int result = check_port_connection("system:capture_1", "system:playback_1");
+ */
+int check_port_connection(const char *src_port_name, const char *dst_port_name) // {{{1
+{
+    jack_port_t *src_port = jack_port_by_name(cs->client, src_port_name);
+    const char **existing_connections = jack_port_get_all_connections(cs->client, src_port);
+    if (existing_connections) {
+        for (int i=0; existing_connections[i]; i++) {
+            for (int c=0; ; c++) {
+                if (existing_connections[i][c] != dst_port_name[c]) {
+                    break;
+                }
+
+                if (existing_connections[i][c] == '\0') {
+                    delete existing_connections;
+                    return 1; // true
+                }
+            }
+        }
+    }
+    delete existing_connections;
+    return 0; // false
+} // check_port_connection() }}}1
+
+/**
+ * Check port for exists
+ *
+ * @param {char} port_name Full port name to check for exists
+ * @param {unsigned long} flags Filter flags sum
+ * @private
+ * @returns {bool} port_exists
+ * @example bool result = check_port_exists("system:playback_1", 0); // true
+ * @example bool result = check_port_exists("system:playback_1", JackPortIsOutput); // false
+ */
+bool check_port_exists(char *check_port_name, unsigned long flags) // {{{1
+{
+    if (port_graph_update(&cs->port_graph)) {
+        int32_t index = port_graph_find(&cs->port_graph, check_port_name);
+        return index != -1 && (port_graph_entry(&cs->port_graph, index)->flags & flags) == flags;
+    }
+
+    Handle<Array> portsList = get_ports(true, flags);
+    for (uint32_t i=0; i<portsList->Length(); i++) {
+        String::AsciiValue port_name_arg(portsList->Get(i)->ToString());
+        char *port_name = *port_name_arg;
+
+        for (uint16_t n=0; ; n++) {
+            if (port_name[n] == '\0' || check_port_name[n] == '\0' || n>=STR_SIZE-1) {
+                if (port_name[n] == check_port_name[n]) {
+                    return true;
+                } else {
+                    break;
+                }
+            } else if (port_name[n] != check_port_name[n]) {
+                break;
+            }
+        }
+    }
+    return false;
+} // check_port_exists() }}}1
+
+// RT snapshot {{{1
+
+/**
+ * Fill own ports table of RT snapshot
+ *
+ * Arrays is aligned to cache line, buffer pointers is 0 until the cycle.
+ *
+ * @private
+ * @param {port_table_t} table
+ * @param {jack_port_t} ports In order of own ports list
+ * @param {char} short_names
+ * @param {uint32_t} size
+ */
+void new_port_table( // {{{2
+    port_table_t *table,
+    jack_port_t **ports,
+    char **short_names,
+    uint32_t size)
+{
+    uint32_t capacity = size > 0 ? size : 1;
+
+    void *ports_mem = 0;
+    void *bufs = 0;
+    if (posix_memalign(&ports_mem, CACHE_LINE_SIZE, capacity * sizeof(jack_port_t *)) != 0
+    || posix_memalign(&bufs, CACHE_LINE_SIZE,
+        capacity * sizeof(jack_default_audio_sample_t *)) != 0) {
+        perror("posix_memalign");
+        abort();
+    }
+    if (size > 0) memcpy(ports_mem, ports, size * sizeof(jack_port_t *));
+    memset(bufs, 0, capacity * sizeof(jack_default_audio_sample_t *));
+
+    table->short_names = new char*[size];
+    for (uint32_t i=0; i<size; i++) {
+        table->short_names[i] = new char[strlen(short_names[i]) + 1];
+        strcpy(table->short_names[i], short_names[i]);
+    }
+
+    table->ports = (jack_port_t **)ports_mem;
+    table->bufs = (jack_default_audio_sample_t **)bufs;
+    table->size = size;
+} // new_port_table() }}}2
+
+/**
+ * Free own ports table of RT snapshot
+ *
+ * @private
+ * @param {port_table_t} table
+ */
+void free_port_table(port_table_t *table) // {{{2
+{
+    for (uint32_t i=0; i<table->size; i++) delete [] table->short_names[i];
+    delete [] table->short_names;
+    free(table->ports);
+    free(table->bufs);
+} // free_port_table() }}}2
+
+/**
+ * Get JACK port of own port by short name
+ *
+ * @private
+ * @param {char} short_name
+ * @param {bool} output Own output port
+ * @returns {jack_port_t} port or 0 if there is no such own port
+ */
+jack_port_t* find_own_jack_port(const char *short_name, bool output) // {{{2
+{
+    if (output) {
+        int32_t index = find_own_port_index(
+            &cs->own_out_ports_hash, cs->own_out_ports_short_names, short_name);
+        return index < 0 ? 0 : cs->own_out_jack_ports[index];
+    }
+    int32_t index = find_own_port_index(
+        &cs->own_in_ports_hash, cs->own_in_ports_short_names, short_name);
+    return index < 0 ? 0 : cs->own_in_jack_ports[index];
+} // find_own_jack_port() }}}2
+
+/**
+ * Build RT snapshot of current state
+ *
+ * Ports of native processors is resolved here by names, so unregistered
+ * ports is silence (or skipped) until port with the same name is registered.
+ *
+ * @private
+ * @returns {rt_snapshot_t} snapshot
+ */
+rt_snapshot_t* new_rt_snapshot() // {{{2
+{
+    rt_snapshot_t *rt = new rt_snapshot_t();
+    rt->ports_version = cs->own_ports_version;
+
+    new_port_table(&rt->capture,
+        cs->own_in_jack_ports, cs->own_in_ports_short_names, cs->own_in_ports_size);
+    new_port_table(&rt->playback,
+        cs->own_out_jack_ports, cs->own_out_ports_short_names, cs->own_out_ports_size);
+
+    rt->midi_in_ports = new jack_port_t*[cs->own_midi_in_size];
+    rt->midi_in_bufs = new void*[cs->own_midi_in_size];
+    for (uint32_t i=0; i<cs->own_midi_in_size; i++) {
+        rt->midi_in_ports[i] = cs->own_midi_in_ports[i];
+        rt->midi_in_bufs[i] = 0;
+    }
+    rt->midi_in_size = cs->own_midi_in_size;
+    rt->midi_out_ports = new jack_port_t*[cs->own_midi_out_size];
+    rt->midi_out_bufs = new void*[cs->own_midi_out_size];
+    for (uint32_t i=0; i<cs->own_midi_out_size; i++) {
+        rt->midi_out_ports[i] = cs->own_midi_out_ports[i];
+        rt->midi_out_bufs[i] = 0;
+    }
+    rt->midi_out_size = cs->own_midi_out_size;
+
+    rt->ringbuffers = cs->ringbuffer_mode ? cs->ringbuffers : 0;
+    rt->dsp_program = cs->dsp_program;
+    rt->dsp_pool = cs->dsp_pool;
+    rt->meters = cs->meters;
+
+    // all processors is detached at once, see detach_all_processors()
+    if (cs->players_detached) return rt;
+
+    rt->players = new rt_binding_t[cs->players_size];
+    for (uint32_t p=0; p<cs->players_size; p++) {
+        player_t *player = cs->players[p];
+        if (player == 0) continue;
+        rt_binding_t *binding = &rt->players[rt->players_size++];
+        binding->processor = player;
+        binding->ports = new jack_port_t*[player->ports_count];
+        for (uint32_t i=0; i<player->ports_count; i++)
+            binding->ports[i] = find_own_jack_port(player->port_names[i], true);
+    }
+
+    // they're growing for new buffer size, see apply_buffer_size()
+    if (cs->processors_detached) return rt;
+
+    rt->recorders = new rt_binding_t[cs->recorders_size];
+    for (uint32_t r=0; r<cs->recorders_size; r++) {
+        recorder_t *rec = cs->recorders[r];
+        if (rec == 0) continue;
+        rt_binding_t *binding = &rt->recorders[rt->recorders_size++];
+        binding->processor = rec;
+        binding->ports = new jack_port_t*[rec->channels];
+        for (uint32_t i=0; i<rec->channels; i++)
+            binding->ports[i] = find_own_jack_port(rec->port_names[i], false);
+    }
+
+    rt->analyzers = new rt_binding_t[cs->analyzers_size];
+    for (uint32_t a=0; a<cs->analyzers_size; a++) {
+        analyzer_t *analyzer = cs->analyzers[a];
+        if (analyzer == 0) continue;
+        rt_binding_t *binding = &rt->analyzers[rt->analyzers_size++];
+        binding->processor = analyzer;
+        binding->ports = new jack_port_t*[analyzer->channels];
+        for (uint32_t i=0; i<analyzer->channels; i++) {
+            binding->ports[i] = find_own_jack_port(
+                analyzer->port_names[i], analyzer->port_outputs[i]);
+        }
+    }
+
+    rt->streams = new rt_binding_t[cs->streams_size];
+    for (uint32_t s=0; s<cs->streams_size; s++) {
+        stream_t *stream = cs->streams[s];
+        if (stream == 0) continue;
+        rt_binding_t *binding = &rt->streams[rt->streams_size++];
+        binding->processor = stream;
+        binding->ports = new jack_port_t*[stream->channels];
+        for (uint32_t i=0; i<stream->channels; i++) {
+            binding->ports[i] = find_own_jack_port(
+                stream->port_names[i], stream->direction == STREAM_PLAYBACK);
+        }
+    }
+
+    return rt;
+} // new_rt_snapshot() }}}2
+
+/**
+ * Free RT snapshot (processors it refers to is not freed)
+ *
+ * @private
+ * @param {rt_snapshot_t} ptr
+ */
+void free_rt_snapshot(void *ptr) // {{{2
+{
+    rt_snapshot_t *rt = (rt_snapshot_t *)ptr;
+
+    free_port_table(&rt->capture);
+    free_port_table(&rt->playback);
+    delete [] rt->midi_in_ports;
+    delete [] rt->midi_in_bufs;
+    delete [] rt->midi_out_ports;
+    delete [] rt->midi_out_bufs;
+
+    for (uint32_t i=0; i<rt->players_size; i++) delete [] rt->players[i].ports;
+    for (uint32_t i=0; i<rt->recorders_size; i++) delete [] rt->recorders[i].ports;
+    for (uint32_t i=0; i<rt->analyzers_size; i++) delete [] rt->analyzers[i].ports;
+    for (uint32_t i=0; i<rt->streams_size; i++) delete [] rt->streams[i].ports;
+    delete [] rt->players;
+    delete [] rt->recorders;
+    delete [] rt->analyzers;
+    delete [] rt->streams;
+
+    delete rt;
+} // free_rt_snapshot() }}}2
+
+/**
+ * Publish snapshot of current state to RT thread
+ *
+ * Call it after every change of anything RT thread reads. Previous snapshot
+ * and everything retired before is freed when RT thread can't use it anymore.
+ *
+ * @private
+ */
+void publish_rt_snapshot() // {{{2
+{
+    rt_snapshot_t *rt = new_rt_snapshot();
+    rt_snapshot_t *old = cs->rt_snapshot;
+    __sync_synchronize(); // snapshot is filled before it's published
+    cs->rt_snapshot = rt;
+    rt_retire(free_rt_snapshot, old, true);
+
+    uint32_t callback_epoch = rt_section_epoch(&cs->callback_section);
+    uint32_t native_epoch = rt_section_epoch(&cs->native_section);
+    for (rt_garbage_t *garbage = cs->rt_garbage; garbage != 0; garbage = garbage->next) {
+        if (!garbage->pending) continue;
+        garbage->callback_epoch = callback_epoch;
+        garbage->native_epoch = native_epoch;
+        garbage->pending = false;
+    }
+
+    rt_reclaim();
+} // publish_rt_snapshot() }}}2
+
+/**
+ * Free data when next RT snapshot without it is published
+ *
+ * @private
+ * @param {rt_free_t} free_fn
+ * @param {void} ptr Nothing is done for 0
+ * @param {bool} callback_visible "process" callback (or its JS side) may use it
+ */
+void rt_retire(rt_free_t free_fn, void *ptr, bool callback_visible) // {{{2
+{
+    if (ptr == 0) return;
+
+    rt_garbage_t *garbage = new rt_garbage_t();
+    garbage->free = free_fn;
+    garbage->ptr = ptr;
+    garbage->callback_visible = callback_visible;
+    garbage->pending = true;
+    garbage->next = cs->rt_garbage;
+    cs->rt_garbage = garbage;
+} // rt_retire() }}}2
+
+/**
+ * Free retired data RT thread can't use anymore
+ *
+ * Waits for the rest of current cycle, but never for "process" callback
+ * section (it waits for JS thread), its data is freed on next call.
+ *
+ * @private
+ */
+void rt_reclaim() // {{{2
+{
+    rt_garbage_t **link = &cs->rt_garbage;
+    while (*link != 0) {
+        rt_garbage_t *garbage = *link;
+        if (garbage->pending || (garbage->callback_visible && (cs->in_process_callback
+        || !rt_section_passed(&cs->callback_section, garbage->callback_epoch)))) {
+            link = &garbage->next;
+            continue;
+        }
+
+        rt_section_wait(&cs->native_section, garbage->native_epoch);
+        *link = garbage->next;
+        garbage->free(garbage->ptr);
+        delete garbage;
+    }
+} // rt_reclaim() }}}2
+
+/**
+ * Wait until RT thread can't use anything unpublished before
+ *
+ * Only for data that "process" callback section doesn't use.
+ *
+ * @private
+ */
+void rt_synchronize() // {{{2
+{
+    rt_section_wait(&cs->native_section, rt_section_epoch(&cs->native_section));
+} // rt_synchronize() }}}2
+
+/**
+ * Remove all processors from RT thread by one snapshot (on client close)
+ *
+ * RT thread is synchronized once, so all of them can be finished
+ * or destroyed right after it.
+ *
+ * @private
+ */
+void detach_all_processors() // {{{2
+{
+    cs->processors_detached = true;
+    cs->players_detached = true;
+    publish_rt_snapshot();
+    rt_synchronize();
+} // detach_all_processors() }}}2
+
+// RT snapshot }}}1
+
+// own ports registry {{{1
+
+/**
+ * FNV-1a hash of port name
+ *
+ * @private
+ * @param {char} name
+ * @returns {uint32_t} hash
+ */
+inline uint32_t hash_port_name(const char *name) // {{{2
+{
+    uint32_t hash = 2166136261u;
+    for (uint16_t i=0; name[i] != '\0' && i<STR_SIZE; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+} // hash_port_name() }}}2
+
+/**
+ * Rebuild hash table of own ports short names
+ *
+ * @private
+ * @param {own_ports_hash_t} hash Hash table to rebuild
+ * @param {char} short_names Own ports names without client name
+ * @param {uint32_t} size Count of own ports
+ */
+void build_own_ports_hash( // {{{2
+    own_ports_hash_t *hash,
+    char **short_names,
+    uint32_t size)
+{
+    // keep load factor not more than 1/2
+    uint32_t slots_count = 8;
+    while (slots_count < (uint32_t)size * 2) slots_count <<= 1;
+
+    if (hash->slots == 0 || hash->mask + 1 != slots_count) {
+        delete [] hash->slots;
+        hash->slots = new int32_t[slots_count];
+        hash->mask = slots_count - 1;
+    }
+    for (uint32_t i=0; i<slots_count; i++) hash->slots[i] = -1;
+
+    for (uint32_t i=0; i<size; i++) {
+        uint32_t slot = hash_port_name(short_names[i]) & hash->mask;
+        while (hash->slots[slot] != -1) slot = (slot + 1) & hash->mask;
+        hash->slots[slot] = i;
+    }
+} // build_own_ports_hash() }}}2
+
+/**
+ * Find own port index by short name in hash table
+ *
+ * @private
+ * @param {own_ports_hash_t} hash
+ * @param {char} short_names Own ports names without client name
+ * @param {char} short_port_name Own port name without client name
+ * @returns {int32_t} port_index Port index or -1 if not found
+ */
+int32_t find_own_port_index( // {{{2
+    own_ports_hash_t *hash,
+    char **short_names,
+    const char *short_port_name)
+{
+    if (hash->slots == 0) return -1;
+
+    uint32_t slot = hash_port_name(short_port_name) & hash->mask;
+    for (;;) {
+        int32_t index = hash->slots[slot];
+        if (index == -1) return -1; // port not found
+        if (strncmp(short_names[index], short_port_name, STR_SIZE) == 0) return index;
+        slot = (slot + 1) & hash->mask;
+    }
+} // find_own_port_index() }}}2
+
+/**
+ * Get own output port index
+ *
+ * @param {char} short_port_name - Own port name without client name
+ * @private
+ * @returns {int32_t} port_index - Port index or -1 if not found
+ */
+int32_t get_own_out_port_index(char* short_port_name) // {{{2
+{
+    return find_own_port_index(
+        &cs->own_out_ports_hash, cs->own_out_ports_short_names, short_port_name);
+} // get_own_out_port_index() }}}2
+
+/**
+ * Add new stable port handle
+ *
+ * Slot of unregistered port is reused, its generation is part of handle.
+ *
+ * @private
+ * @param {jack_port_t} port Registered own port
+ * @param {bool} output Is it output port
+ * @param {bool} midi Is it MIDI port
+ * @returns {uint32_t} handle
+ */
+uint32_t add_port_handle(jack_port_t *port, bool output, bool midi) // {{{2
+{
+    uint32_t slot;
+    if (cs->port_handles_free >= 0) {
+        slot = cs->port_handles_free;
+        cs->port_handles_free = cs->port_handles[slot].next_free;
+    } else {
+        if (cs->port_handles_size >= cs->port_handles_capacity) {
+            uint32_t capacity = cs->port_handles_capacity ? cs->port_handles_capacity * 2 : 64;
+            port_handle_t *handles = new port_handle_t[capacity];
+            for (uint32_t i=0; i<cs->port_handles_size; i++) handles[i] = cs->port_handles[i];
+            delete [] cs->port_handles;
+            cs->port_handles = handles;
+            cs->port_handles_capacity = capacity;
+        }
+        slot = cs->port_handles_size++;
+        cs->port_handles[slot].generation = 0;
+    }
+
+    port_handle_t *handle = &cs->port_handles[slot];
+    handle->port = port;
+    handle->output = output;
+    handle->midi = midi;
+    handle->index = -1; // will be set in reset_own_ports_list()
+    handle->next_free = -1;
+
+    return (handle->generation << PORT_HANDLE_SLOT_BITS) | slot;
+} // add_port_handle() }}}2
+
+/**
+ * Get slot of port handle
+ *
+ * @private
+ * @param {uint32_t} handle
+ * @returns {port_handle_t} slot Or 0 if handle is unknown or port is unregistered
+ */
+port_handle_t* get_port_handle(uint32_t handle) // {{{2
+{
+    uint32_t slot = handle & ((1u << PORT_HANDLE_SLOT_BITS) - 1);
+    if (slot >= cs->port_handles_size) return 0;
+
+    port_handle_t *port_handle = &cs->port_handles[slot];
+    if (port_handle->port == 0 || port_handle->generation != handle >> PORT_HANDLE_SLOT_BITS)
+        return 0;
+    return port_handle;
+} // get_port_handle() }}}2
+
+/**
+ * Free slot of port handle, the handle is never valid again
+ *
+ * @private
+ * @param {uint32_t} handle Handle of registered port
+ */
+void remove_port_handle(uint32_t handle) // {{{2
+{
+    port_handle_t *port_handle = get_port_handle(handle);
+    if (port_handle == 0) return;
+
+    port_handle->port = 0;
+    port_handle->index = -1;
+    port_handle->generation = (port_handle->generation + 1) & (0xFFFFFFFF >> PORT_HANDLE_SLOT_BITS);
+    port_handle->next_free = cs->port_handles_free;
+    cs->port_handles_free = port_handle - cs->port_handles;
+} // remove_port_handle() }}}2
+
+/**
+ * Find handle of registered port (for unregistering by name only,
+ * it walks all slots)
+ *
+ * @private
+ * @param {jack_port_t} port
+ * @param {uint32_t} handle
+ * @returns {bool} false if port has no handle
+ */
+bool find_port_handle(jack_port_t *port, uint32_t *handle) // {{{2
+{
+    for (uint32_t i=0; i<cs->port_handles_size; i++) {
+        if (cs->port_handles[i].port == port) {
+            *handle = (cs->port_handles[i].generation << PORT_HANDLE_SLOT_BITS) | i;
+            return true;
+        }
+    }
+    return false;
+} // find_port_handle() }}}2
+
+/**
+ * Get registered port by its handle
+ *
+ * @private
+ * @param {uint32_t} handle
+ * @returns {jack_port_t} port Or 0 if handle is unknown or port is unregistered
+ */
+jack_port_t* get_port_by_handle(uint32_t handle) // {{{2
+{
+    port_handle_t *port_handle = get_port_handle(handle);
+    return port_handle == 0 ? 0 : port_handle->port;
+} // get_port_by_handle() }}}2
+
+/**
+ * Check port of handle is audio port (native processors can't use MIDI ports)
+ *
+ * @private
+ * @param {uint32_t} handle Handle of registered port
+ * @returns {bool}
+ */
+bool is_audio_port_handle(uint32_t handle) // {{{2
+{
+    port_handle_t *port_handle = get_port_handle(handle);
+    return port_handle != 0 && !port_handle->midi;
+} // is_audio_port_handle() }}}2
+
+/**
+ * Get own output port index by port handle
+ *
+ * @private
+ * @param {uint32_t} handle
+ * @returns {int32_t} port_index Port index or -1 if not found
+ */
+int32_t get_own_out_port_index_by_handle(uint32_t handle) // {{{2
+{
+    port_handle_t *port_handle = get_port_handle(handle);
+    if (port_handle == 0 || !port_handle->output || port_handle->midi) return -1;
+    return port_handle->index;
+} // get_own_out_port_index_by_handle() }}}2
+
+/**
+ * Update own ports list indexes of port handles
+ *
+ * @private
+ */
+void reset_port_handles_indexes() // {{{2
+{
+    for (uint32_t i=0; i<cs->port_handles_size; i++) {
+        port_handle_t *handle = &cs->port_handles[i];
+        if (handle->port == 0 || handle->midi) continue;
+
+        const char *short_name = jack_port_short_name(handle->port);
+        if (handle->output) {
+            handle->index = find_own_port_index(
+                &cs->own_out_ports_hash, cs->own_out_ports_short_names, short_name);
+        } else {
+            handle->index = find_own_port_index(
+                &cs->own_in_ports_hash, cs->own_in_ports_short_names, short_name);
+        }
+    }
+} // reset_port_handles_indexes() }}}2
+
+/**
+ * Free own ports registry
+ *
+ * @private
+ */
+void free_own_ports_registry() // {{{2
+{
+    delete [] cs->own_in_ports_hash.slots;
+    cs->own_in_ports_hash.slots = 0;
+    delete [] cs->own_out_ports_hash.slots;
+    cs->own_out_ports_hash.slots = 0;
+
+    delete [] cs->port_handles;
+    cs->port_handles = 0;
+    cs->port_handles_size = 0;
+    cs->port_handles_capacity = 0;
+    cs->port_handles_free = -1;
+} // free_own_ports_registry() }}}2
+
+// own ports registry }}}1
+
+// processing {{{1
+
+/**
+ * Create new Float32Array
+ *
+ * @private
+ * @param {uint32_t} length Count of samples
+ * @returns {v8::Object} Float32Array instance, its data is available by
+ *   GetIndexedPropertiesExternalArrayData()
+ */
+Local<Object> new_float32_array(uint32_t length) // {{{2
+{
+    if (float32ArrayConstructor.IsEmpty()) {
+        Local<Value> constructor = Context::GetCurrent()->Global()
+            ->Get(String::NewSymbol("Float32Array"));
+        float32ArrayConstructor = Persistent<Function>::New(
+            Local<Function>::Cast(constructor));
+    }
+
+    const uint8_t argc = 1;
+    Local<Value> argv[argc] = { Integer::NewFromUnsigned(length) };
+    return float32ArrayConstructor->NewInstance(argc, argv);
+} // new_float32_array() }}}2
+
+/**
+ * Check value is Float32Array (or any object with external float data)
+ *
+ * @private
+ * @param {v8::Value} val
+ * @returns {bool}
+ */
+bool is_float32_array(Local<Value> val) // {{{2
+{
+    if (!val->IsObject()) return false;
+    Local<Object> obj = val.As<Object>();
+    return obj->HasIndexedPropertiesInExternalArrayData()
+        && obj->GetIndexedPropertiesExternalArrayDataType() == kExternalFloatArray;
+} // is_float32_array() }}}2
+
+/**
+ * Free pooled capture/playback objects of "process" callback
+ *
+ * @private
+ */
+void free_process_pool() // {{{2
+{
+    for (uint32_t i=0; cs->capturePoolBufs && i<cs->process_pool_in_size; i++) {
+        cs->capturePoolBufs[i].Dispose();
+        cs->capturePoolBufs[i].Clear();
+    }
+    for (uint32_t i=0; cs->playbackPoolBufs && i<cs->process_pool_out_size; i++) {
+        cs->playbackPoolBufs[i].Dispose();
+        cs->playbackPoolBufs[i].Clear();
+    }
+    if (!cs->capturePool.IsEmpty()) {
+        cs->capturePool.Dispose();
+        cs->capturePool.Clear();
+    }
+    if (!cs->playbackPool.IsEmpty()) {
+        cs->playbackPool.Dispose();
+        cs->playbackPool.Clear();
+    }
+    delete [] cs->capturePoolBufs;
+    delete [] cs->playbackPoolBufs;
+    delete [] cs->capture_pool_data;
+    delete [] cs->playback_pool_data;
+    cs->capturePoolBufs = 0;
+    cs->playbackPoolBufs = 0;
+    cs->capture_pool_data = 0;
+    cs->playback_pool_data = 0;
+    delete [] cs->process_pool_silence;
+    delete [] cs->process_pool_in_bufs;
+    delete [] cs->process_pool_out_bufs;
+    cs->process_pool_silence = 0;
+    cs->process_pool_in_bufs = 0;
+    cs->process_pool_out_bufs = 0;
+    cs->capture_frames_data = 0;
+    cs->playback_frames_data = 0;
+    free_midi_pool();
+    cs->process_pool_in_size = 0;
+    cs->process_pool_out_size = 0;
+    cs->process_pool_frames = 0;
+} // free_process_pool() }}}2
+
+/**
+ * Free pooled MIDI buffers of "process" callback
+ *
+ * @private
+ */
+void free_midi_pool() // {{{2
+{
+    for (uint32_t i=0; i<cs->midi_pool_in_size; i++) cs->midiInPoolBufs[i].Dispose();
+    for (uint32_t i=0; i<cs->midi_pool_out_size; i++) cs->midiOutPoolBufs[i].Dispose();
+    if (!cs->midiInPool.IsEmpty()) {
+        cs->midiInPool.Dispose();
+        cs->midiInPool.Clear();
+    }
+    if (!cs->midiOutPool.IsEmpty()) {
+        cs->midiOutPool.Dispose();
+        cs->midiOutPool.Clear();
+    }
+    delete [] cs->midiInPoolBufs;
+    delete [] cs->midiOutPoolBufs;
+    delete [] cs->midi_in_pool_data;
+    delete [] cs->midi_out_pool_data;
+    cs->midiInPoolBufs = 0;
+    cs->midiOutPoolBufs = 0;
+    cs->midi_in_pool_data = 0;
+    cs->midi_out_pool_data = 0;
+    cs->midi_pool_in_size = 0;
+    cs->midi_pool_out_size = 0;
+} // free_midi_pool() }}}2
+
+/**
+ * Build pooled MIDI buffers of "process" callback for current own MIDI ports
+ *
+ * @private
+ */
+void reset_midi_pool() // {{{2
+{
+    HandleScope scope;
+
+    cs->midiInPoolBufs = new Persistent<Object>[cs->own_midi_in_size];
+    cs->midi_in_pool_data = new char*[cs->own_midi_in_size];
+    Local<Object> midi_in = Object::New();
+    for (uint32_t i=0; i<cs->own_midi_in_size; i++) {
+        Local<Object> buf = Local<Object>::New(node::Buffer::New(MIDI_BUFFER_SIZE)->handle_);
+        cs->midiInPoolBufs[i] = Persistent<Object>::New(buf);
+        cs->midi_in_pool_data[i] = node::Buffer::Data(buf);
+        memset(cs->midi_in_pool_data[i], 0, 4);
+        midi_in->Set(String::NewSymbol(cs->own_midi_in_short_names[i]), buf);
+    }
+    cs->midiInPool = Persistent<Object>::New(midi_in);
+    cs->midi_pool_in_size = cs->own_midi_in_size;
+
+    cs->midiOutPoolBufs = new Persistent<Object>[cs->own_midi_out_size];
+    cs->midi_out_pool_data = new char*[cs->own_midi_out_size];
+    Local<Object> midi_out = Object::New();
+    for (uint32_t i=0; i<cs->own_midi_out_size; i++) {
+        Local<Object> buf = Local<Object>::New(node::Buffer::New(MIDI_BUFFER_SIZE)->handle_);
+        cs->midiOutPoolBufs[i] = Persistent<Object>::New(buf);
+        cs->midi_out_pool_data[i] = node::Buffer::Data(buf);
+        memset(cs->midi_out_pool_data[i], 0, 4);
+        midi_out->Set(String::NewSymbol(cs->own_midi_out_short_names[i]), buf);
+    }
+    cs->midiOutPool = Persistent<Object>::New(midi_out);
+    cs->midi_pool_out_size = cs->own_midi_out_size;
+} // reset_midi_pool() }}}2
+
+inline void midi_put_u32(char *p, uint32_t v)
+{
+    p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; p[2] = (v >> 16) & 0xFF; p[3] = v >> 24;
+}
+inline uint32_t midi_get_u32(const char *p)
+{
+    const uint8_t *u = (const uint8_t *)p;
+    return u[0] | (u[1] << 8) | (u[2] << 16) | ((uint32_t)u[3] << 24);
+}
+
+/**
+ * Pack events of MIDI input ports to pooled buffers
+ *
+ * Packed buffer is: events count (uint32 LE), then every event is
+ * frame offset (uint32 LE), size (uint32 LE) and bytes of event.
+ * Call it only while RT thread is waiting (MIDI buffers belongs to cycle).
+ *
+ * @private
+ * @param {void} bufs MIDI buffers of the cycle in order of own MIDI ports,
+ *   0 to pack no events
+ */
+void pack_midi_in(void **bufs) // {{{2
+{
+    for (uint32_t i=0; i<cs->midi_pool_in_size; i++) {
+        char *dst = cs->midi_in_pool_data[i];
+        void *buf = bufs ? bufs[i] : 0;
+        uint32_t count = 0;
+        size_t pos = 4;
+
+        uint32_t events = buf ? jack_midi_get_event_count(buf) : 0;
+        for (uint32_t e=0; e<events; e++) {
+            jack_midi_event_t event;
+            if (jack_midi_event_get(&event, buf, e) != 0) continue;
+            if (pos + 8 + event.size > MIDI_BUFFER_SIZE) {
+                __sync_fetch_and_add(&cs->midi_lost_events, 1);
+                continue;
+            }
+            midi_put_u32(dst + pos, event.time);
+            midi_put_u32(dst + pos + 4, event.size);
+            memcpy(dst + pos + 8, event.buffer, event.size);
+            pos += 8 + event.size;
+            count++;
+        }
+
+        midi_put_u32(dst, count);
+    }
+} // pack_midi_in() }}}2
+
+/**
+ * Write events packed by "process" callback to MIDI output ports
+ *
+ * Events must be in order of frame offset, incorrect events is dropped
+ * (and counted as lost, see getStatsSync()). Pooled buffers is emptied
+ * even if events is not written.
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ * @param {void} bufs MIDI buffers of the cycle in order of own MIDI ports,
+ *   0 to drop events
+ */
+void unpack_midi_out(jack_nframes_t nframes, void **bufs) // {{{2
+{
+    for (uint32_t i=0; i<cs->midi_pool_out_size; i++) {
+        char *src = cs->midi_out_pool_data[i];
+        void *buf = bufs ? bufs[i] : 0;
+        uint32_t count = midi_get_u32(src);
+        size_t pos = 4;
+
+        for (uint32_t e=0; buf && e<count; e++) {
+            if (pos + 8 > MIDI_BUFFER_SIZE) {
+                __sync_fetch_and_add(&cs->midi_lost_events, count - e);
+                break;
+            }
+            uint32_t time = midi_get_u32(src + pos);
+            uint32_t size = midi_get_u32(src + pos + 4);
+            if (size == 0 || size > MIDI_BUFFER_SIZE - pos - 8) {
+                __sync_fetch_and_add(&cs->midi_lost_events, count - e);
+                break;
+            }
+            if (time >= nframes || jack_midi_event_write(
+                buf, time, (jack_midi_data_t *)(src + pos + 8), size) != 0) {
+                __sync_fetch_and_add(&cs->midi_lost_events, 1);
+            }
+            pos += 8 + size;
+        }
+
+        midi_put_u32(src, 0);
+    }
+} // unpack_midi_out() }}}2
+
+/**
+ * Build capture/playback objects of "process" callback for current own ports
+ *
+ * They're created once per ports list (or buffer size) change and reused
+ * every cycle, so steady-state "process" callback allocates nothing.
+ *
+ * @private
+ * @param {jack_nframes_t} nframes Buffer size
+ */
+void reset_process_pool(jack_nframes_t nframes) // {{{2
+{
+    HandleScope scope;
+
+    free_process_pool();
+    reset_midi_pool();
+
+    // doesn't depend on ports list or buffer size, created once
+    if (cs->transportPool.IsEmpty()) {
+        cs->transportPool = Persistent<Object>::New(Object::New());
+        cs->transportBbtPool = Persistent<Object>::New(Object::New());
+    }
+
+    if (cs->process_layout != PROCESS_LAYOUT_PORTS) {
+        reset_process_frames_pool(nframes);
+        return;
+    }
+
+    cs->capturePoolBufs = new Persistent<Object>[cs->own_in_ports_size];
+    cs->capture_pool_data = new jack_default_audio_sample_t*[cs->own_in_ports_size];
+    Local<Object> capture = Object::New();
+    for (uint32_t i=0; i<cs->own_in_ports_size; i++) {
+        Local<Object> buf = new_float32_array(nframes);
+        cs->capturePoolBufs[i] = Persistent<Object>::New(buf);
+        cs->capture_pool_data[i] = (jack_default_audio_sample_t *)
+            buf->GetIndexedPropertiesExternalArrayData();
+        capture->Set(String::NewSymbol(cs->own_in_ports_short_names[i]), buf);
+    }
+    cs->capturePool = Persistent<Object>::New(capture);
+    cs->process_pool_in_size = cs->own_in_ports_size;
+
+    cs->playbackPoolBufs = new Persistent<Object>[cs->own_out_ports_size];
+    cs->playback_pool_data = new jack_default_audio_sample_t*[cs->own_out_ports_size];
+    Local<Object> playback = Object::New();
+    for (uint32_t i=0; i<cs->own_out_ports_size; i++) {
+        Local<Object> buf = new_float32_array(nframes);
+        cs->playbackPoolBufs[i] = Persistent<Object>::New(buf);
+        cs->playback_pool_data[i] = (jack_default_audio_sample_t *)
+            buf->GetIndexedPropertiesExternalArrayData();
+        playback->Set(String::NewSymbol(cs->own_out_ports_short_names[i]), buf);
+    }
+    cs->playbackPool = Persistent<Object>::New(playback);
+    cs->process_pool_out_size = cs->own_out_ports_size;
+
+    cs->process_pool_frames = nframes;
+} // reset_process_pool() }}}2
+
+/**
+ * Build single-array capture/playback pool for interleaved or planar layout
+ *
+ * In planar layout capture_pool_data/playback_pool_data points to channels
+ * inside of pooled arrays, so it's filled same way as ports layout.
+ *
+ * @private
+ * @param {jack_nframes_t} nframes Buffer size
+ */
+void reset_process_frames_pool(jack_nframes_t nframes) // {{{2
+{
+    HandleScope scope;
+
+    Local<Object> capture = new_float32_array(nframes * cs->own_in_ports_size);
+    Local<Object> playback = new_float32_array(nframes * cs->own_out_ports_size);
+    cs->capturePool = Persistent<Object>::New(capture);
+    cs->playbackPool = Persistent<Object>::New(playback);
+    cs->capture_frames_data = (jack_default_audio_sample_t *)
+        capture->GetIndexedPropertiesExternalArrayData();
+    cs->playback_frames_data = (jack_default_audio_sample_t *)
+        playback->GetIndexedPropertiesExternalArrayData();
+
+    cs->capture_pool_data = new jack_default_audio_sample_t*[cs->own_in_ports_size];
+    for (uint32_t i=0; i<cs->own_in_ports_size; i++) {
+        cs->capture_pool_data[i] = cs->capture_frames_data + i * nframes;
+    }
+    cs->playback_pool_data = new jack_default_audio_sample_t*[cs->own_out_ports_size];
+    for (uint32_t i=0; i<cs->own_out_ports_size; i++) {
+        cs->playback_pool_data[i] = cs->playback_frames_data + i * nframes;
+    }
+
+    cs->process_pool_silence = new jack_default_audio_sample_t[nframes];
+    memset(cs->process_pool_silence, 0, nframes * sizeof(jack_default_audio_sample_t));
+    cs->process_pool_in_bufs = new jack_default_audio_sample_t*[cs->own_in_ports_size];
+    cs->process_pool_out_bufs = new jack_default_audio_sample_t*[cs->own_out_ports_size];
+
+    cs->process_pool_in_size = cs->own_in_ports_size;
+    cs->process_pool_out_size = cs->own_out_ports_size;
+    cs->process_pool_frames = nframes;
+} // reset_process_frames_pool() }}}2
+
+/**
+ * Fill pooled capture array of interleaved layout
+ *
+ * @private
+ */
+void interleave_capture( // {{{2
+    jack_nframes_t nframes,
+    jack_default_audio_sample_t **in)
+{
+    // buffers is 0 if own ports list is changed after the cycle is started
+    for (uint32_t i=0; i<cs->process_pool_in_size; i++) {
+        cs->process_pool_in_bufs[i] = in ? in[i] : cs->process_pool_silence;
+    }
+    dsp_kernels.interleave(
+        cs->capture_frames_data, cs->process_pool_in_bufs, cs->process_pool_in_size, nframes);
+} // interleave_capture() }}}2
+
+/**
+ * Write interleaved or planar playback array to playback buffers
+ *
+ * @private
+ */
+void write_playback_frames( // {{{2
+    jack_nframes_t nframes,
+    jack_default_audio_sample_t *frames,
+    jack_default_audio_sample_t **out)
+{
+    if (cs->process_layout == PROCESS_LAYOUT_PLANAR) {
+        for (uint32_t i=0; i<cs->process_pool_out_size; i++) {
+            if (out[i]) dsp_kernels.copy(out[i], frames + i * nframes, nframes);
+        }
+        return;
+    }
+
+    // missing buffers is deinterleaved to scratch (it's never read)
+    for (uint32_t i=0; i<cs->process_pool_out_size; i++) {
+        cs->process_pool_out_bufs[i] = out[i] ? out[i] : cs->process_pool_silence;
+    }
+    dsp_kernels.deinterleave(
+        cs->process_pool_out_bufs, frames, cs->process_pool_out_size, nframes);
+    memset(cs->process_pool_silence, 0, nframes * sizeof(jack_default_audio_sample_t));
+} // write_playback_frames() }}}2
+
+/**
+ * Call "process" callback with interleaved or planar layout
+ *
+ * @private
+ * @see call_process_callback()
+ */
+Local<Value> call_process_callback_frames( // {{{2
+    uint16_t nframes,
+    jack_default_audio_sample_t **in,
+    jack_default_audio_sample_t **out,
+    uint32_t ports_version,
+    const transport_cycle_t *cycle)
+{
+    size_t buf_size = nframes * sizeof(jack_default_audio_sample_t);
+
+    if (cs->process_layout == PROCESS_LAYOUT_INTERLEAVED) {
+        interleave_capture(nframes, in);
+    } else {
+        for (uint32_t i=0; i<cs->process_pool_in_size; i++) {
+            if (in) dsp_kernels.copy(cs->capture_pool_data[i], in[i], nframes);
+            else memset(cs->capture_pool_data[i], 0, buf_size);
+        }
+    }
+    memset(cs->playback_frames_data, 0, buf_size * cs->process_pool_out_size);
+
+    update_transport_object(cs->transportPool, cs->transportBbtPool, cycle);
+
+    const uint8_t argc = 7;
+    Local<Value> argv[argc] = {
+        Local<Value>::New( Null() ),
+        Local<Integer>::New( Integer::NewFromUnsigned( nframes ) ),
+        Local<Object>::New( cs->capturePool ),
+        Local<Object>::New( cs->playbackPool ),
+        Local<Object>::New( cs->midiInPool ),
+        Local<Object>::New( cs->midiOutPool ),
+        Local<Object>::New( cs->transportPool )
+    };
+    Local<Value> retval =
+        cs->processCallback->Call(Context::GetCurrent()->Global(), argc, argv);
+
+    // own ports list is changed by callback, pooled array belongs to new one
+    if (out == 0 || ports_version != cs->own_ports_version) return Local<Value>();
+
+    if (retval->IsNull() || retval->IsUndefined()) return Local<Value>();
+
+    if (!is_float32_array(retval)) {
+        return Exception::TypeError(String::New(
+            "Returned value of \"process\" callback must be a Float32Array"
+            " or null or undefined"));
+    }
+
+    Local<Object> buffer = retval.As<Object>();
+    if ((uint32_t)buffer->GetIndexedPropertiesExternalArrayDataLength()
+    != nframes * cs->process_pool_out_size) {
+        return Exception::RangeError(String::New(
+            "Incorrect buffer size of returned value"
+            " of \"process\" callback"));
+    }
+
+    write_playback_frames(nframes, (jack_default_audio_sample_t *)
+        buffer->GetIndexedPropertiesExternalArrayData(), out);
+
+    return Local<Value>();
+} // call_process_callback_frames() }}}2
+
+
+/**
+ * Call "process" callback and write returned buffers to playback buffers
+ *
+ * Buffers belongs to own ports list of "ports_version", if the list is
+ * changed before or during the callback capture is silence and returned
+ * buffers is dropped (pooled objects is rebuilt for new list).
+ *
+ * @private
+ * @param {uint16_t} nframes Buffer size
+ * @param {jack_default_audio_sample_t} in Capture buffers in order of own input ports
+ * @param {jack_default_audio_sample_t} out Playback buffers in order of own output ports
+ * @param {void} midi_in MIDI input buffers or 0 (only when RT thread is waiting)
+ * @param {void} midi_out MIDI output buffers or 0 (only when RT thread is waiting)
+ * @param {uint32_t} ports_version Own ports list buffers belongs to
+ * @param {transport_cycle_t} cycle Transport of the cycle
+ * @returns {v8::Value} err Exception or empty handle if there is no error
+ */
+Local<Value> call_process_callback_ports(
+    uint16_t nframes,
+    jack_default_audio_sample_t **in,
+    jack_default_audio_sample_t **out,
+    uint32_t ports_version,
+    const transport_cycle_t *cycle);
+Local<Value> call_process_callback( // {{{2
+    uint16_t nframes,
+    jack_default_audio_sample_t **in,
+    jack_default_audio_sample_t **out,
+    void **midi_in,
+    void **midi_out,
+    uint32_t ports_version,
+    const transport_cycle_t *cycle)
+{
+    if (cs->process_pool_frames != nframes) reset_process_pool(nframes);
+
+    if (ports_version != cs->own_ports_version) {
+        in = 0;
+        out = 0;
+        midi_in = 0;
+        midi_out = 0;
+    }
+
+    // retired buffers is not freed until callback returns
+    cs->in_process_callback = true;
+
+    pack_midi_in(midi_in);
+
+    Local<Value> retval;
+    if (cs->process_layout != PROCESS_LAYOUT_PORTS)
+        retval = call_process_callback_frames(nframes, in, out, ports_version, cycle);
+    else
+        retval = call_process_callback_ports(nframes, in, out, ports_version, cycle);
+
+    if (ports_version != cs->own_ports_version) midi_out = 0;
+    unpack_midi_out(nframes, midi_out);
+
+    cs->in_process_callback = false;
+
+    return retval;
+} // call_process_callback() }}}2
+
+/**
+ * Call "process" callback with ports layout
+ *
+ * @private
+ * @see call_process_callback()
+ */
+Local<Value> call_process_callback_ports( // {{{2
+    uint16_t nframes,
+    jack_default_audio_sample_t **in,
+    jack_default_audio_sample_t **out,
+    uint32_t ports_version,
+    const transport_cycle_t *cycle)
+{
+    size_t buf_size = nframes * sizeof(jack_default_audio_sample_t);
+
+    // buffers is 0 if own ports list is changed after the cycle is started
+    for (uint32_t i=0; i<cs->process_pool_in_size; i++) {
+        if (in) dsp_kernels.copy(cs->capture_pool_data[i], in[i], nframes);
+        else memset(cs->capture_pool_data[i], 0, buf_size);
+    }
+    for (uint32_t i=0; i<cs->process_pool_out_size; i++) {
+        memset(cs->playback_pool_data[i], 0, buf_size);
+    }
+
+    update_transport_object(cs->transportPool, cs->transportBbtPool, cycle);
+
+    const uint8_t argc = 7;
+    Local<Value> argv[argc] = {
+        Local<Value>::New( Null() ),
+        Local<Integer>::New( Integer::NewFromUnsigned( nframes ) ),
+        Local<Object>::New( cs->capturePool ),
+        Local<Object>::New( cs->playbackPool ),
+        Local<Object>::New( cs->midiInPool ),
+        Local<Object>::New( cs->midiOutPool ),
+        Local<Object>::New( cs->transportPool )
+    };
+    Local<Value> retval =
+        cs->processCallback->Call(Context::GetCurrent()->Global(), argc, argv);
+
+    // own ports list is changed by callback, pooled object belongs to new one
+    if (out == 0 || ports_version != cs->own_ports_version) return Local<Value>();
+
+    if (!retval->IsNull() && !retval->IsUndefined() && !retval->IsObject()) {
+        return Exception::TypeError(String::New(
+            "Returned value of \"process\" callback must be an object"
+            " of port{String}:buffer{Float32Array|Array.<Number|Float>} values"
+            " or null or undefined"));
+    }
+
+    // pooled playback object, no need to walk through its keys
+    if (retval->StrictEquals(cs->playbackPool)) {
+        for (uint32_t i=0; i<cs->process_pool_out_size; i++) {
+            dsp_kernels.copy(out[i], cs->playback_pool_data[i], nframes);
+        }
+        return Local<Value>();
+    }
+
+    if (retval->IsObject()) {
+        Local<Object> obj = retval.As<Object>();
+        Local<Array> keys = obj->GetOwnPropertyNames();
+        for (uint16_t i=0; i<keys->Length(); i++) {
+            Local<Value> key = keys->Get(i);
+            if (!key->IsString() && !key->IsNumber()) {
+                return Exception::TypeError(String::New(
+                    "Incorrect key type in returned value of \"process\""
+                    " callback, must be a string (own port name)"
+                    " or a number (port handle)"));
+            }
+            String::AsciiValue port_name(key->ToString());
+
+            int32_t port_index = -1;
+            if (key->IsString())
+                port_index = get_own_out_port_index(*port_name);
+            if (port_index == -1) {
+                // integer keys may be port handles
+                Local<Uint32> handle = key->ToArrayIndex();
+                if (!handle.IsEmpty())
+                    port_index = get_own_out_port_index_by_handle(handle->Value());
+            }
+            if (port_index == -1) {
+                char err[] = "Port \"%s\" not found";
+                char err_msg[STR_SIZE + sizeof(err)];
+                sprintf(err_msg, err, *port_name);
+                return Exception::Error(String::New(err_msg));
+            }
+
+            Local<Value> val = obj->Get(key);
+
+            // pooled buffer of this port, nothing to check
+            if ((uint32_t)port_index < cs->process_pool_out_size
+            && val->StrictEquals(cs->playbackPoolBufs[port_index])) {
+                dsp_kernels.copy(out[port_index], cs->playback_pool_data[port_index], nframes);
+                continue;
+            }
+
+            // Float32Array, just copy whole buffer
+            if (is_float32_array(val)) {
+                Local<Object> buffer = val.As<Object>();
+                if (buffer->GetIndexedPropertiesExternalArrayDataLength() != nframes) {
+                    return Exception::RangeError(String::New(
+                        "Incorrect buffer size of returned value"
+                        " of \"process\" callback"));
+                }
+                dsp_kernels.copy(out[port_index], (jack_default_audio_sample_t *)
+                    buffer->GetIndexedPropertiesExternalArrayData(), nframes);
+                continue;
+            }
+
+            if (!val->IsArray()) {
+                return Exception::TypeError(String::New(
+                    "Incorrect buffer type of returned value of \"process\""
+                    " callback, must be a Float32Array or an Array<Float|Number>"));
+            }
+            Local<Array> buffer = val.As<Array>();
+
+            if (buffer->Length() != nframes) {
+                return Exception::RangeError(String::New(
+                    "Incorrect buffer size of returned value"
+                    " of \"process\" callback"));
+            }
+
+            for (uint16_t sample_i=0; sample_i<nframes; sample_i++) {
+                Local<Value> sample = buffer->Get(sample_i);
+                if (!sample->IsNumber()) {
+                    return Exception::TypeError(String::New(
+                        "Incorrect sample type of returned value"
+                        " of \"process\" callback"
+                        ", must be a {Number|Float}"));
+                }
+                out[port_index][sample_i] = sample->ToNumber()->Value();
+            }
+        } // for (ports)
+    } // if we has something to output from callback
+
+    return Local<Value>();
+} // call_process_callback_ports() }}}2
+
+#define UV_PROCESS_STOP() \
+        { \
+            scope.Close(Undefined()); \
+            delete task; \
+            cs->baton = NULL; \
+            uv_sem_post(&cs->semaphore); \
+            rt_reclaim(); \
+            return; \
+        }
+#define UV_PROCESS_EXCEPTION(err) \
+        { \
+            const uint8_t argc = 1; \
+            Local<Value> argv[argc] = { \
+                Local<Value>::New( err ), \
+            }; \
+            cs->processCallback->Call(Context::GetCurrent()->Global(), argc, argv); \
+            UV_PROCESS_STOP(); \
+        }
+
+void uv_process(uv_work_t* task, int status) // {{{2
+{
+    HandleScope scope;
+    client_scope_t client_scope((client_state_t *)task->data);
+
+    jack_nframes_t nframes = cs->baton_nframes;
+
+    // callback is replaced by worker script after the cycle is queued
+    if (!cs->hasProcessCallback) UV_PROCESS_STOP();
+
+    uint64_t started = uv_hrtime();
+    // RT thread waits, so transport and snapshot of the cycle can't be changed
+    rt_snapshot_t *rt = cs->cycle_snapshot;
+    Local<Value> err = call_process_callback(
+        nframes, rt->capture.bufs, rt->playback.bufs, rt->midi_in_bufs, rt->midi_out_bufs,
+        rt->ports_version, &cs->transport.cycle);
+    stats_record(&cs->callback_stats, uv_hrtime() - started);
+    if (!err.IsEmpty()) UV_PROCESS_EXCEPTION(err);
+
+    UV_PROCESS_STOP();
+} // uv_process() }}}2
+
+// ring buffer mode {{{2
+
+/**
+ * Free ring buffers of ring buffer process mode
+ *
+ * @private
+ * @param {ringbuffers_t} ptr
+ */
+void free_ringbuffers(void *ptr) // {{{3
+{
+    ringbuffers_t *rb = (ringbuffers_t *)ptr;
+
+    for (uint32_t i=0; i<rb->in_size; i++) {
+        jack_ringbuffer_free(rb->capture_rb[i]);
+        delete [] rb->capture_rb_buf[i];
+    }
+    for (uint32_t i=0; i<rb->out_size; i++) {
+        jack_ringbuffer_free(rb->playback_rb[i]);
+        delete [] rb->playback_rb_buf[i];
+    }
+    delete [] rb->capture_rb;
+    delete [] rb->capture_rb_buf;
+    delete [] rb->playback_rb;
+    delete [] rb->playback_rb_buf;
+    jack_ringbuffer_free(rb->transport_rb);
+    delete rb;
+} // free_ringbuffers() }}}3
+
+/**
+ * (Re)allocate ring buffers for current own ports list and buffer size
+ *
+ * Playback ring buffers is filled by silence for "ringbuffer_periods" periods,
+ * it is a lookahead that callback must keep. Old ring buffers is freed
+ * when new RT snapshot is published.
+ *
+ * @private
+ */
+void reset_ringbuffers() // {{{3
+{
+    void uv_ringbuffer_process(uv_async_t* handle, int status);
+
+    if (!cs->ringbuffer_inited) {
+        uv_async_init(uv_default_loop(), &cs->ringbuffer_async, uv_ringbuffer_process);
+        cs->ringbuffer_async.data = cs;
+        // do not keep event loop alive only by this handle
+        uv_unref((uv_handle_t *)&cs->ringbuffer_async);
+        cs->ringbuffer_inited = true;
+    }
+
+    rt_retire(free_ringbuffers, cs->ringbuffers, true);
+
+    ringbuffers_t *rb = new ringbuffers_t();
+    rb->period_frames = cs->buffer_size;
+    rb->ports_version = cs->own_ports_version;
+    size_t period_size = rb->period_frames * sizeof(jack_default_audio_sample_t);
+    // one more period to have space for period that is writing right now
+    size_t rb_size = period_size * (cs->ringbuffer_periods + 1);
+
+    rb->capture_rb = new jack_ringbuffer_t*[cs->own_in_ports_size];
+    rb->capture_rb_buf = new jack_default_audio_sample_t*[cs->own_in_ports_size];
+    for (uint32_t i=0; i<cs->own_in_ports_size; i++) {
+        rb->capture_rb[i] = jack_ringbuffer_create(rb_size);
+        jack_ringbuffer_mlock(rb->capture_rb[i]);
+        rb->capture_rb_buf[i] = new jack_default_audio_sample_t[rb->period_frames];
+    }
+    rb->in_size = cs->own_in_ports_size;
+
+    rb->playback_rb = new jack_ringbuffer_t*[cs->own_out_ports_size];
+    rb->playback_rb_buf = new jack_default_audio_sample_t*[cs->own_out_ports_size];
+    for (uint32_t i=0; i<cs->own_out_ports_size; i++) {
+        rb->playback_rb[i] = jack_ringbuffer_create(rb_size);
+        jack_ringbuffer_mlock(rb->playback_rb[i]);
+        rb->playback_rb_buf[i] = new jack_default_audio_sample_t[rb->period_frames];
+        memset(rb->playback_rb_buf[i], 0, period_size);
+        for (uint16_t n=0; n<cs->ringbuffer_periods; n++) {
+            jack_ringbuffer_write(rb->playback_rb[i], (char *)rb->playback_rb_buf[i], period_size);
+        }
+    }
+    rb->out_size = cs->own_out_ports_size;
+
+    // same count of periods as capture ring buffers, so they overrun together
+    rb->transport_rb = jack_ringbuffer_create(
+        sizeof(transport_cycle_t) * (cs->ringbuffer_periods + 1));
+    jack_ringbuffer_mlock(rb->transport_rb);
+
+    cs->ringbuffers = rb;
+    cs->ringbuffer_pending = 0;
+} // reset_ringbuffers() }}}3
+
+/**
+ * Drain captured periods from ring buffers through "process" callback
+ *
+ * Called in main event loop, uv_async_send() coalesces wakeups so it handles
+ * all pending periods at once.
+ *
+ * @private
+ */
+void uv_ringbuffer_process(uv_async_t* handle, int status) // {{{3
+{
+    HandleScope scope;
+    client_scope_t client_scope((client_state_t *)handle->data);
+
+    while (cs->ringbuffer_pending > 0) {
+        // callback may unbind itself or change own ports list (ring buffers is replaced)
+        if (!cs->ringbuffer_mode || !cs->hasProcessCallback) break;
+        ringbuffers_t *rb = cs->ringbuffers;
+        size_t period_size = rb->period_frames * sizeof(jack_default_audio_sample_t);
+
+        // playback lookahead is full, callback will be called on next wakeup
+        bool full = false;
+        for (uint32_t i=0; i<rb->out_size; i++) {
+            if (jack_ringbuffer_read_space(rb->playback_rb[i])
+            >= period_size * cs->ringbuffer_periods) full = true;
+        }
+        if (full) break;
 
-                if (client_name[n] != jack_ports_list[i][n]) {
-                    allPortsList->Set(i, String::NewSymbol(jack_ports_list[i]));
-                    break;
-                }
+        for (uint32_t i=0; i<rb->in_size; i++) {
+            if (jack_ringbuffer_read_space(rb->capture_rb[i]) < period_size) {
+                memset(rb->capture_rb_buf[i], 0, period_size);
+            } else {
+                jack_ringbuffer_read(rb->capture_rb[i], (char *)rb->capture_rb_buf[i], period_size);
             }
         }
-    }
+        for (uint32_t i=0; i<rb->out_size; i++) {
+            memset(rb->playback_rb_buf[i], 0, period_size);
+        }
 
-    delete jack_ports_list;
-    return allPortsList;
-} // get_ports() }}}1
+        transport_cycle_t cycle;
+        if (jack_ringbuffer_read_space(rb->transport_rb) < sizeof(transport_cycle_t)) {
+            if (!transport_read(&cs->transport, &cycle)) memset(&cycle, 0, sizeof(cycle));
+        } else {
+            jack_ringbuffer_read(rb->transport_rb, (char *)&cycle, sizeof(cycle));
+        }
 
-typedef struct get_own_ports_retval_t {
-    char** names;
-    char** own_names; // without client name
-    uint8_t count;
-};
+        uint64_t started = uv_hrtime();
+        Local<Value> err = call_process_callback(
+            rb->period_frames, rb->capture_rb_buf, rb->playback_rb_buf, 0, 0,
+            rb->ports_version, &cycle);
+        stats_record(&cs->callback_stats, uv_hrtime() - started);
+        if (!err.IsEmpty()) {
+            const uint8_t argc = 1;
+            Local<Value> argv[argc] = { Local<Value>::New( err ) };
+            cs->processCallback->Call(Context::GetCurrent()->Global(), argc, argv);
+        }
 
-char* get_port_name_without_client_name(char* port_name) // {{{1
+        // retired ring buffers (and pending counter of them) is left as is
+        if (rb != cs->ringbuffers) break;
+
+        for (uint32_t i=0; i<rb->out_size; i++) {
+            jack_ringbuffer_write(rb->playback_rb[i], (char *)rb->playback_rb_buf[i], period_size);
+        }
+
+        __sync_fetch_and_sub(&cs->ringbuffer_pending, 1);
+    }
+
+    rt_reclaim();
+} // uv_ringbuffer_process() }}}3
+
+/**
+ * Realtime part of ring buffer process mode, never waits for JS
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ * @param {rt_snapshot_t} rt Snapshot of the cycle, port buffers is filled
+ */
+void jack_process_ringbuffer(jack_nframes_t nframes, rt_snapshot_t *rt) // {{{3
 {
-    char* retval = new char[STR_SIZE];
-    uint16_t i=0, n=0;
-    for (i=0; i<STR_SIZE; i++) {
-        if (port_name[i] == ':') {
-            n = i+1; break;
+    ringbuffers_t *rb = rt->ringbuffers;
+    size_t period_size = nframes * sizeof(jack_default_audio_sample_t);
+    bool period_matches = nframes == rb->period_frames;
+
+    // ring buffers is built for the same own ports list as snapshot
+    bool overrun = false;
+    for (uint32_t i=0; i<rb->in_size; i++) {
+        if (!period_matches || jack_ringbuffer_write_space(rb->capture_rb[i]) < period_size) {
+            overrun = true;
+            continue;
         }
+        jack_ringbuffer_write(rb->capture_rb[i], (char *)rt->capture.bufs[i], period_size);
     }
-    for (i=0; n<STR_SIZE; i++, n++) {
-        retval[i] = port_name[n];
-        if (retval[i] == '\0') break;
+    if (overrun) __sync_fetch_and_add(&cs->ringbuffer_overruns, 1);
+
+    if (period_matches && jack_ringbuffer_write_space(rb->transport_rb) >= sizeof(transport_cycle_t)) {
+        jack_ringbuffer_write(rb->transport_rb,
+            (const char *)&cs->transport.cycle, sizeof(transport_cycle_t));
     }
-    return retval;
-} // get_port_name_without_client_name() }}}1
 
-get_own_ports_retval_t get_own_ports(unsigned long flags) // {{{1
+    bool underrun = false;
+    for (uint32_t i=0; i<rb->out_size; i++) {
+        char *out = (char *)rt->playback.bufs[i];
+        if (!period_matches || jack_ringbuffer_read_space(rb->playback_rb[i]) < period_size) {
+            memset(out, 0, period_size);
+            underrun = true;
+            continue;
+        }
+        jack_ringbuffer_read(rb->playback_rb[i], out, period_size);
+    }
+    if (underrun) __sync_fetch_and_add(&cs->ringbuffer_underruns, 1);
+
+    // do not let pending periods grow when callback is late
+    if (period_matches && cs->ringbuffer_pending <= cs->ringbuffer_periods)
+        __sync_fetch_and_add(&cs->ringbuffer_pending, 1);
+    uv_async_send(&cs->ringbuffer_async);
+} // jack_process_ringbuffer() }}}3
+
+// ring buffer mode }}}2
+
+// DSP worker mode {{{2
+
+/**
+ * Format exception of worker script
+ *
+ * @private
+ * @param {v8::TryCatch} try_catch
+ * @param {char} dst Buffer of STR_SIZE for the message or 0 to post it
+ *   as "workerError" notification (only first exception of "process" is posted)
+ */
+void dsp_worker_report_exception(TryCatch &try_catch, char *dst) // {{{3
 {
-    const char** jack_ports_list;
+    String::Utf8Value exception(try_catch.Exception());
+    Local<Message> message = try_catch.Message();
 
-    char** ports_names;
-    char** ports_own_names;
-    char** ports_namesTmp = new char*[MAX_PORTS];
+    char err_msg[STR_SIZE];
+    if (message.IsEmpty()) {
+        snprintf(err_msg, STR_SIZE, "%s", *exception);
+    } else {
+        snprintf(err_msg, STR_SIZE, "%s:%d: %s",
+            cs->dsp_worker_script_path, message->GetLineNumber(), *exception);
+    }
+
+    if (dst) {
+        strncpy(dst, err_msg, STR_SIZE);
+        dst[STR_SIZE-1] = '\0';
+    } else {
+        post_notification(NOTIFY_WORKER_ERROR, err_msg, 0, 0, 0);
+    }
+} // dsp_worker_report_exception() }}}3
 
-    jack_ports_list = jack_get_ports(::client, NULL, NULL, flags);
+/**
+ * Create capture/playback objects of worker script for own ports of snapshot
+ *
+ * Buffers is external float arrays, on every cycle they're pointed to JACK
+ * ports buffers, so samples is not copied at all.
+ *
+ * @private
+ */
+void dsp_worker_reset_views( // {{{3
+    rt_snapshot_t *rt,
+    Persistent<Object> &capture,
+    Persistent<Object> &playback,
+    Persistent<Object> *&capture_views,
+    uint32_t &capture_views_size,
+    Persistent<Object> *&playback_views,
+    uint32_t &playback_views_size)
+{
+    HandleScope scope;
 
-    uint16_t i=0, n=0, m=0;
+    for (uint32_t i=0; i<capture_views_size; i++) capture_views[i].Dispose();
+    for (uint32_t i=0; i<playback_views_size; i++) playback_views[i].Dispose();
+    delete [] capture_views;
+    delete [] playback_views;
+    if (!capture.IsEmpty()) capture.Dispose();
+    if (!playback.IsEmpty()) playback.Dispose();
+
+    capture_views = new Persistent<Object>[rt->capture.size];
+    Local<Object> capture_obj = Object::New();
+    for (uint32_t i=0; i<rt->capture.size; i++) {
+        Local<Object> view = Object::New();
+        capture_views[i] = Persistent<Object>::New(view);
+        capture_obj->Set(String::New(rt->capture.short_names[i]), view);
+    }
+    capture = Persistent<Object>::New(capture_obj);
+    capture_views_size = rt->capture.size;
+
+    playback_views = new Persistent<Object>[rt->playback.size];
+    Local<Object> playback_obj = Object::New();
+    for (uint32_t i=0; i<rt->playback.size; i++) {
+        Local<Object> view = Object::New();
+        playback_views[i] = Persistent<Object>::New(view);
+        playback_obj->Set(String::New(rt->playback.short_names[i]), view);
+    }
+    playback = Persistent<Object>::New(playback_obj);
+    playback_views_size = rt->playback.size;
+} // dsp_worker_reset_views() }}}3
 
-    while (jack_ports_list[i]) {
-        if (i >= MAX_PORTS) break;
-        uint8_t found = 1;
-        for (n=0; ; n++) {
-            if (n>=STR_SIZE-1) { found = 0; break; }
-            if (client_name[n] == '\0' && jack_ports_list[i][n] == ':') { break; }
-            if (client_name[n] != jack_ports_list[i][n]) { found = 0; break; }
+/**
+ * Worker thread, owns its own V8 isolate
+ *
+ * @private
+ */
+void* dsp_worker_main(void *arg) // {{{3
+{
+    client_scope_t client_scope((client_state_t *)arg);
+    Isolate *isolate = Isolate::New();
+    {
+        Isolate::Scope isolate_scope(isolate);
+        HandleScope scope;
+
+        Persistent<Context> context = Context::New();
+        Context::Scope context_scope(context);
+
+        Persistent<Function> processFn;
+        Persistent<Object> capture;
+        Persistent<Object> playback;
+        Persistent<Object> transport = Persistent<Object>::New(Object::New());
+        Persistent<Object> bbt = Persistent<Object>::New(Object::New());
+        Persistent<Object> *capture_views = 0;
+        Persistent<Object> *playback_views = 0;
+        uint32_t capture_views_size = 0;
+        uint32_t playback_views_size = 0;
+        uint32_t views_ports_version = 0;
+        jack_nframes_t views_nframes = 0;
+
+        // init {{{4
+        {
+            TryCatch try_catch;
+            Local<Script> script = Script::Compile(
+                String::New(cs->dsp_worker_source), String::New(cs->dsp_worker_script_path));
+            if (!script.IsEmpty()) script->Run();
+
+            if (try_catch.HasCaught()) {
+                dsp_worker_report_exception(try_catch, cs->dsp_worker_error);
+                cs->dsp_worker_failed = true;
+            } else {
+                Local<Value> fn = context->Global()->Get(String::NewSymbol("process"));
+                if (fn->IsFunction()) {
+                    processFn = Persistent<Function>::New(Local<Function>::Cast(fn));
+                } else {
+                    snprintf(cs->dsp_worker_error, STR_SIZE,
+                        "Worker script must define global \"process\" function");
+                    cs->dsp_worker_failed = true;
+                }
+            }
         }
-        if (found == 1) {
-            ports_namesTmp[m] = new char[STR_SIZE];
-            for (n=0; n<STR_SIZE; n++) {
-                ports_namesTmp[m][n] = jack_ports_list[i][n];
-                if (jack_ports_list[i][n] == '\0') break;
+        uv_sem_post(&cs->dsp_worker_done);
+        // init }}}4
+
+        while (!cs->dsp_worker_failed) {
+            uv_sem_wait(&cs->dsp_worker_request);
+            if (cs->dsp_worker_stop) break;
+
+            HandleScope cycle_scope;
+            jack_nframes_t nframes = cs->dsp_worker_nframes;
+
+            // snapshot can't be freed during the cycle because RT thread
+            // waits for worker, JS thread may change own ports list meanwhile
+            rt_snapshot_t *rt = cs->dsp_worker_snapshot;
+            if (views_ports_version != rt->ports_version || capture.IsEmpty()) {
+                dsp_worker_reset_views(rt, capture, playback,
+                    capture_views, capture_views_size,
+                    playback_views, playback_views_size);
+                views_ports_version = rt->ports_version;
+                views_nframes = 0;
             }
-            m++;
+
+            for (uint32_t i=0; i<capture_views_size; i++) {
+                capture_views[i]->SetIndexedPropertiesToExternalArrayData(
+                    rt->capture.bufs[i], kExternalFloatArray, nframes);
+            }
+            for (uint32_t i=0; i<playback_views_size; i++) {
+                memset(rt->playback.bufs[i], 0, nframes * sizeof(jack_default_audio_sample_t));
+                playback_views[i]->SetIndexedPropertiesToExternalArrayData(
+                    rt->playback.bufs[i], kExternalFloatArray, nframes);
+            }
+            if (views_nframes != nframes) {
+                Local<Integer> length = Integer::NewFromUnsigned(nframes);
+                for (uint32_t i=0; i<capture_views_size; i++)
+                    capture_views[i]->Set(String::NewSymbol("length"), length);
+                for (uint32_t i=0; i<playback_views_size; i++)
+                    playback_views[i]->Set(String::NewSymbol("length"), length);
+                views_nframes = nframes;
+            }
+
+            update_transport_object(transport, bbt, &cs->transport.cycle);
+
+            TryCatch try_catch;
+            const uint8_t argc = 4;
+            Local<Value> argv[argc] = {
+                Integer::NewFromUnsigned(nframes),
+                Local<Object>::New(capture),
+                Local<Object>::New(playback),
+                Local<Object>::New(transport)
+            };
+            processFn->Call(context->Global(), argc, argv);
+            if (try_catch.HasCaught()) {
+                // script that throws every cycle would flood notifications
+                if (__sync_fetch_and_add(&cs->dsp_worker_errors, 1) == 0)
+                    dsp_worker_report_exception(try_catch, 0);
+            }
+
+            uv_sem_post(&cs->dsp_worker_done);
         }
-        i++;
+
+        for (uint32_t i=0; i<capture_views_size; i++) capture_views[i].Dispose();
+        for (uint32_t i=0; i<playback_views_size; i++) playback_views[i].Dispose();
+        delete [] capture_views;
+        delete [] playback_views;
+        if (!capture.IsEmpty()) capture.Dispose();
+        if (!playback.IsEmpty()) playback.Dispose();
+        transport.Dispose();
+        bbt.Dispose();
+        if (!processFn.IsEmpty()) processFn.Dispose();
+        context.Dispose();
     }
-    delete [] jack_ports_list;
+    isolate->Dispose();
 
-    ports_names = new char*[m];
-    ports_own_names = new char*[m];
-    for (i=0; i<m; i++) {
-        ports_names[i] = new char[STR_SIZE];
-        for (n=0; n<STR_SIZE; n++) {
-            ports_names[i][n] = ports_namesTmp[i][n];
-            if (ports_namesTmp[i][n] == '\0') break;
-        }
-        delete [] ports_namesTmp[i];
-        ports_own_names[i] = get_port_name_without_client_name(ports_names[i]);
+    return 0;
+} // dsp_worker_main() }}}3
+
+/**
+ * Read worker script and start worker thread
+ *
+ * @private
+ * @param {char} script_path Path to worker script
+ * @returns {bool} success, see dsp_worker_error if it's false
+ */
+bool start_dsp_worker(const char *script_path) // {{{3
+{
+    FILE *f = fopen(script_path, "rb");
+    if (!f) {
+        snprintf(cs->dsp_worker_error, STR_SIZE, "Couldn't open worker script \"%s\"", script_path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    if (size < 0) {
+        fclose(f);
+        snprintf(cs->dsp_worker_error, STR_SIZE, "Couldn't read worker script \"%s\"", script_path);
+        return false;
+    }
+    fseek(f, 0, SEEK_SET);
+    cs->dsp_worker_source = new char[size + 1];
+    size_t read = fread(cs->dsp_worker_source, 1, size, f);
+    fclose(f);
+    if (read != (size_t)size) {
+        delete [] cs->dsp_worker_source;
+        cs->dsp_worker_source = 0;
+        snprintf(cs->dsp_worker_error, STR_SIZE, "Couldn't read worker script \"%s\"", script_path);
+        return false;
+    }
+    cs->dsp_worker_source[size] = '\0';
+    strncpy(cs->dsp_worker_script_path, script_path, STR_SIZE);
+    cs->dsp_worker_script_path[STR_SIZE-1] = '\0';
+
+    uv_sem_init(&cs->dsp_worker_request, 0);
+    uv_sem_init(&cs->dsp_worker_done, 0);
+    cs->dsp_worker_stop = false;
+    cs->dsp_worker_failed = false;
+    cs->dsp_worker_errors = 0;
+
+    if (jack_client_create_thread(cs->client, &cs->dsp_worker_thread,
+        jack_client_real_time_priority(cs->client), jack_is_realtime(cs->client),
+        dsp_worker_main, cs) != 0) {
+        snprintf(cs->dsp_worker_error, STR_SIZE, "Couldn't create worker thread");
+        cs->dsp_worker_failed = true;
+    } else {
+        // wait for script evaluation
+        uv_sem_wait(&cs->dsp_worker_done);
+        if (cs->dsp_worker_failed) pthread_join(cs->dsp_worker_thread, NULL);
     }
-    delete [] ports_namesTmp;
 
-    get_own_ports_retval_t retval;
-    retval.names = ports_names;
-    retval.own_names = ports_own_names;
-    retval.count = m;
+    if (cs->dsp_worker_failed) {
+        uv_sem_destroy(&cs->dsp_worker_request);
+        uv_sem_destroy(&cs->dsp_worker_done);
+        delete [] cs->dsp_worker_source;
+        cs->dsp_worker_source = 0;
+        return false;
+    }
 
-    return retval;
-} // get_own_ports() }}}1
+    cs->dsp_worker_mode = true;
+    return true;
+} // start_dsp_worker() }}}3
 
-void reset_own_ports_list() // {{{1
+/**
+ * Stop worker thread
+ *
+ * @private
+ */
+void stop_dsp_worker() // {{{3
 {
-    get_own_ports_retval_t retval;
-    uint8_t i=0;
+    if (!cs->dsp_worker_mode) return;
 
-    // in {{{2
-    retval = get_own_ports(JackPortIsInput);
-    for (i=0; i<own_in_ports_size; i++) {
-        delete [] own_in_ports[i];
-        delete [] own_in_ports_short_names[i];
-    }
-    delete [] own_in_ports;
-    delete [] own_in_ports_short_names;
-    own_in_ports = retval.names;
-    own_in_ports_short_names = retval.own_names;
-    own_in_ports_size = retval.count;
-    // in }}}2
+    // wait for current cycle, RT thread waits for worker in native section
+    cs->dsp_worker_mode = false;
+    rt_synchronize();
+    cs->dsp_worker_stop = true;
+    uv_sem_post(&cs->dsp_worker_request);
+    pthread_join(cs->dsp_worker_thread, NULL);
 
-    // out {{{2
-    retval = get_own_ports(JackPortIsOutput);
-    for (i=0; i<own_out_ports_size; i++) {
-        delete [] own_out_ports[i];
-        delete [] own_out_ports_short_names[i];
-    }
-    delete [] own_out_ports;
-    delete [] own_out_ports_short_names;
-    own_out_ports = retval.names;
-    own_out_ports_short_names = retval.own_names;
-    own_out_ports_size = retval.count;
-    // out }}}2
-} // reset_own_ports_list() }}}1
+    uv_sem_destroy(&cs->dsp_worker_request);
+    uv_sem_destroy(&cs->dsp_worker_done);
+    delete [] cs->dsp_worker_source;
+    cs->dsp_worker_source = 0;
+} // stop_dsp_worker() }}}3
+
+/**
+ * Realtime part of DSP worker mode
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ * @param {rt_snapshot_t} rt Snapshot of the cycle, port buffers is filled
+ */
+void jack_process_worker(jack_nframes_t nframes, rt_snapshot_t *rt) // {{{3
+{
+    cs->dsp_worker_snapshot = rt;
+    cs->dsp_worker_nframes = nframes;
+    uint64_t started = uv_hrtime();
+    uv_sem_post(&cs->dsp_worker_request);
+    uv_sem_wait(&cs->dsp_worker_done);
+    stats_record(&cs->wait_stats, uv_hrtime() - started);
+} // jack_process_worker() }}}3
+
+// DSP worker mode }}}2
+
+/**
+ * Get buffers of own ports of snapshot for the cycle
+ *
+ * @private
+ */
+inline void get_port_table_bufs(port_table_t *table, jack_nframes_t nframes) // {{{2
+{
+    for (uint32_t i=0; i<table->size; i++) {
+        table->bufs[i] = (jack_default_audio_sample_t *)
+            jack_port_get_buffer(table->ports[i], nframes);
+    }
+} // get_port_table_bufs() }}}2
+
+/**
+ * Realtime part of default process mode, waits for JS callback
+ *
+ * Output buffers is silence and MIDI output buffers is cleared before
+ * the callback, so cycle that callback can't write is silent.
+ * Call it in "process" callback section. Ports is touched in native
+ * section only, so JS thread may wait for it before unregistering a port.
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ * @returns {rt_snapshot_t} Snapshot the callback got buffers of
+ */
+rt_snapshot_t* jack_process_callback(jack_nframes_t nframes) // {{{2
+{
+    if (cs->baton) {
+        uv_sem_wait(&cs->semaphore);
+        uv_sem_destroy(&cs->semaphore);
+    }
+
+    rt_section_enter(&cs->native_section);
+    rt_snapshot_t *rt = cs->rt_snapshot;
+    get_port_table_bufs(&rt->capture, nframes);
+    get_port_table_bufs(&rt->playback, nframes);
+    for (uint32_t i=0; i<rt->playback.size; i++) {
+        memset(rt->playback.bufs[i], 0, nframes * sizeof(jack_default_audio_sample_t));
+    }
+    for (uint32_t i=0; i<rt->midi_in_size; i++) {
+        rt->midi_in_bufs[i] = jack_port_get_buffer(rt->midi_in_ports[i], nframes);
+    }
+    for (uint32_t i=0; i<rt->midi_out_size; i++) {
+        rt->midi_out_bufs[i] = jack_port_get_buffer(rt->midi_out_ports[i], nframes);
+        jack_midi_clear_buffer(rt->midi_out_bufs[i]);
+    }
+    rt_section_leave(&cs->native_section);
+
+    // buffer size is changed and pool is not resized yet (see apply_buffer_size()),
+    // output silence instead of allocating in JS callback while RT thread waits
+    if (nframes != cs->process_pool_frames) {
+        __sync_fetch_and_add(&cs->stats_skipped_cycles, 1);
+        return rt;
+    }
+
+    cs->baton = new uv_work_t();
+
+    if (uv_sem_init(&cs->semaphore, 0) < 0) { perror("uv_sem_init"); return rt; }
+
+    cs->cycle_snapshot = rt;
+    cs->baton->data = cs;
+    cs->baton_nframes = nframes;
+    uint64_t started = uv_hrtime();
+    uv_queue_work(uv_default_loop(), cs->baton, uv_work_plug, uv_process);
+    uv_sem_wait(&cs->semaphore);
+    stats_record(&cs->wait_stats, uv_hrtime() - started);
+    uv_sem_destroy(&cs->semaphore);
+
+    return rt;
+} // jack_process_callback() }}}2
+
+/**
+ * Run native DSP graph, it overwrites own output ports it's connected to
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ * @param {rt_snapshot_t} rt Snapshot of the cycle, port buffers is filled
+ */
+void jack_process_dsp_graph(jack_nframes_t nframes, rt_snapshot_t *rt) // {{{2
+{
+    uint32_t dropped = dsp_program_schedule(rt->dsp_program, cs->dsp_automation_queue);
+    if (dropped > 0) __sync_fetch_and_add(&cs->dsp_automation_dropped, dropped);
+    if (rt->dsp_pool != 0) {
+        dsp_pool_run(rt->dsp_pool, rt->dsp_program, nframes,
+            jack_last_frame_time(cs->client),
+            rt->capture.bufs, rt->playback.bufs);
+    } else {
+        dsp_program_run(rt->dsp_program, nframes, jack_last_frame_time(cs->client),
+            rt->capture.bufs, rt->playback.bufs);
+    }
+} // jack_process_dsp_graph() }}}2
+
+
+/**
+ * Get buffers of own ports of native processor binding
+ *
+ * @private
+ * @param {rt_binding_t} binding
+ * @param {uint32_t} count Channels count
+ * @param {jack_default_audio_sample_t} bufs Buffers of processor channels (0 for missing ports)
+ * @param {jack_nframes_t} nframes
+ */
+inline void get_binding_bufs( // {{{2
+    rt_binding_t *binding,
+    uint32_t count,
+    jack_default_audio_sample_t **bufs,
+    jack_nframes_t nframes)
+{
+    for (uint32_t i=0; i<count; i++) {
+        bufs[i] = binding->ports[i] == 0 ? 0 : (jack_default_audio_sample_t *)
+            jack_port_get_buffer(binding->ports[i], nframes);
+    }
+} // get_binding_bufs() }}}2
+
+/**
+ * Render native file players to own output ports
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ * @param {rt_snapshot_t} rt Snapshot of the cycle
+ */
+void jack_process_players(jack_nframes_t nframes, rt_snapshot_t *rt) // {{{2
+{
+    jack_nframes_t cycle_start = jack_last_frame_time(cs->client);
+
+    for (uint32_t p=0; p<rt->players_size; p++) {
+        player_t *player = (player_t *)rt->players[p].processor;
+        get_binding_bufs(&rt->players[p], player->ports_count, player->port_bufs, nframes);
+        player_render(player, player->port_bufs, cycle_start, nframes);
+    }
+} // jack_process_players() }}}2
+
+/**
+ * Push own input ports buffers to native recorders
+ *
+ * Unregistered ports is recorded as silence.
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ * @param {rt_snapshot_t} rt Snapshot of the cycle
+ */
+void jack_process_recorders(jack_nframes_t nframes, rt_snapshot_t *rt) // {{{2
+{
+    for (uint32_t r=0; r<rt->recorders_size; r++) {
+        recorder_t *rec = (recorder_t *)rt->recorders[r].processor;
+        get_binding_bufs(&rt->recorders[r], rec->channels, rec->channel_bufs, nframes);
+        recorder_push(rec, rec->channel_bufs, nframes);
+    }
+} // jack_process_recorders() }}}2
+
+/**
+ * Resample between native streams FIFOs and own ports
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ * @param {rt_snapshot_t} rt Snapshot of the cycle
+ */
+void jack_process_streams(jack_nframes_t nframes, rt_snapshot_t *rt) // {{{2
+{
+    for (uint32_t s=0; s<rt->streams_size; s++) {
+        stream_t *stream = (stream_t *)rt->streams[s].processor;
+        get_binding_bufs(&rt->streams[s], stream->channels, stream->port_bufs, nframes);
+        stream_process(stream, stream->port_bufs, nframes);
+    }
+} // jack_process_streams() }}}2
+
+/**
+ * Push own ports buffers to native spectrum analyzers
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ * @param {rt_snapshot_t} rt Snapshot of the cycle
+ */
+void jack_process_analyzers(jack_nframes_t nframes, rt_snapshot_t *rt) // {{{2
+{
+    for (uint32_t a=0; a<rt->analyzers_size; a++) {
+        analyzer_t *analyzer = (analyzer_t *)rt->analyzers[a].processor;
+        get_binding_bufs(&rt->analyzers[a], analyzer->channels, analyzer->channel_bufs, nframes);
+        analyzer_push(analyzer, analyzer->channel_bufs, nframes);
+    }
+} // jack_process_analyzers() }}}2
+
+/**
+ * Measure own ports buffers after all processing of cycle
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ * @param {rt_snapshot_t} rt Snapshot of the cycle, port buffers is filled
+ */
+void jack_process_meters(jack_nframes_t nframes, rt_snapshot_t *rt) // {{{2
+{
+    meters_t *meters = rt->meters;
+    meters_begin(meters, nframes);
+    for (uint32_t i=0; i<rt->capture.size; i++) {
+        meters_process(meters, i, rt->capture.bufs[i], nframes);
+    }
+    for (uint32_t i=0; i<rt->playback.size; i++) {
+        meters_process(meters, rt->capture.size + i, rt->playback.bufs[i], nframes);
+    }
+    meters_publish(meters);
+} // jack_process_meters() }}}2
+
+/**
+ * Clear MIDI output ports buffers (JACK requires it every cycle)
+ *
+ * @private
+ * @param {jack_nframes_t} nframes
+ * @param {rt_snapshot_t} rt Snapshot of the cycle
+ * @param {rt_snapshot_t} cleared Snapshot "process" callback already cleared
+ *   MIDI output ports of (its ports is skipped, callback may write to them) or 0
+ */
+void jack_process_midi_clear( // {{{2
+    jack_nframes_t nframes,
+    rt_snapshot_t *rt,
+    rt_snapshot_t *cleared)
+{
+    for (uint32_t i=0; i<rt->midi_out_size; i++) {
+        bool skip = false;
+        if (cleared != 0) {
+            for (uint32_t c=0; c<cleared->midi_out_size && !skip; c++)
+                skip = cleared->midi_out_ports[c] == rt->midi_out_ports[i];
+        }
+        if (!skip) jack_midi_clear_buffer(jack_port_get_buffer(rt->midi_out_ports[i], nframes));
+    }
+} // jack_process_midi_clear() }}}2
+
+/**
+ * JACK process callback
+ *
+ * Everything is read from published RT snapshot (see publish_rt_snapshot()),
+ * so it never locks. "process" callback waits for JS thread in its own
+ * section, the rest of the cycle never waits for JS thread, so JS thread
+ * may wait for it to free unpublished data.
+ *
+ * @private
+ */
+int jack_process(jack_nframes_t nframes, void *arg) // {{{2
+{
+    client_scope_t client_scope((client_state_t *)arg);
+    if (!cs->process) return 0;
+
+    uint64_t started = uv_hrtime();
+    __sync_fetch_and_add(&cs->stats_cycles, 1);
+
+    transport_capture(&cs->transport, cs->client, nframes);
+
+    rt_snapshot_t *rt = 0;
+    bool callback = cs->hasProcessCallback && !cs->ringbuffer_mode && !cs->dsp_worker_mode;
+    if (callback) {
+        rt_section_enter(&cs->callback_section);
+        rt_snapshot_t *callback_rt = jack_process_callback(nframes);
+
+        // callback snapshot is still alive here, MIDI output ports
+        // registered while JS callback was running is cleared too
+        rt_section_enter(&cs->native_section);
+        rt = cs->rt_snapshot;
+        if (rt != callback_rt) jack_process_midi_clear(nframes, rt, callback_rt);
+        rt_section_leave(&cs->callback_section);
+    } else {
+        rt_section_enter(&cs->native_section);
+        rt = cs->rt_snapshot;
+        if (rt->midi_out_size > 0) jack_process_midi_clear(nframes, rt, 0);
+    }
+
+    get_port_table_bufs(&rt->capture, nframes);
+    get_port_table_bufs(&rt->playback, nframes);
+
+    if (cs->dsp_worker_mode) jack_process_worker(nframes, rt);
+    else if (cs->hasProcessCallback && rt->ringbuffers != 0) jack_process_ringbuffer(nframes, rt);
+
+    if (rt->dsp_program != 0) jack_process_dsp_graph(nframes, rt);
+    if (rt->players_size > 0) jack_process_players(nframes, rt);
+    if (rt->streams_size > 0) jack_process_streams(nframes, rt);
+    if (rt->recorders_size > 0) jack_process_recorders(nframes, rt);
+
+    if (rt->analyzers_size > 0) jack_process_analyzers(nframes, rt);
+    if (rt->meters != 0) jack_process_meters(nframes, rt);
+
+    rt_section_leave(&cs->native_section);
+
+    stats_record(&cs->cycle_stats, uv_hrtime() - started);
+
+    return 0;
+} // jack_process() }}}2
 
 /**
- * Check for port connection
+ * Count xruns and remember worst delay
  *
  * @private
- * @param {const char} src_port_name Source full port name
- * @param {const char} dst_port_name Destination full port name
- * @returns {int} result 0 - not connected, 1 - connected
- * @example int result = check_port_connection("system:capture_1", "system:playback_1");
  */
-int check_port_connection(const char *src_port_name, const char *dst_port_name) // {{{1
+int jack_xrun(void *arg) // {{{2
 {
-    jack_port_t *src_port = jack_port_by_name(client, src_port_name);
-    const char **existing_connections = jack_port_get_all_connections(client, src_port);
-    if (existing_connections) {
-        for (int i=0; existing_connections[i]; i++) {
-            for (int c=0; ; c++) {
-                if (existing_connections[i][c] != dst_port_name[c]) {
-                    break;
-                }
+    client_scope_t client_scope((client_state_t *)arg);
+    __sync_fetch_and_add(&cs->stats_xruns, 1);
+    float delay = jack_get_xrun_delayed_usecs(cs->client);
+    if (delay > cs->stats_max_xrun_delay) cs->stats_max_xrun_delay = delay;
+    post_notification(NOTIFY_XRUN, 0, 0, 0, delay);
+    return 0;
+} // jack_xrun() }}}2
 
-                if (existing_connections[i][c] == '\0') {
-                    delete existing_connections;
-                    return 1; // true
-                }
-            }
-        }
-    }
-    delete existing_connections;
-    return 0; // false
-} // check_port_connection() }}}1
+// processing }}}1
+
+// notifications {{{1
 
 /**
- * Check port for exists
+ * Put notification to queue and wake up main event loop
+ *
+ * Called from JACK threads. Only the first event after drain
+ * sends wakeup, so burst of events is handled by single wakeup.
  *
- * @param {char} port_name Full port name to check for exists
- * @param {unsigned long} flags Filter flags sum
  * @private
- * @returns {bool} port_exists
- * @example bool result = check_port_exists("system:playback_1", 0); // true
- * @example bool result = check_port_exists("system:playback_1", JackPortIsOutput); // false
  */
-bool check_port_exists(char *check_port_name, unsigned long flags) // {{{1
+void post_notification( // {{{2
+    notify_type_t type,
+    const char *name,
+    const char *other,
+    uint32_t value,
+    float delay)
 {
-    Handle<Array> portsList = get_ports(true, flags);
-    for (uint8_t i=0; i<portsList->Length(); i++) {
-        String::AsciiValue port_name_arg(portsList->Get(i)->ToString());
-        char *port_name = *port_name_arg;
+    if (!cs->hasNotifyCallback) return;
 
-        for (uint16_t n=0; ; n++) {
-            if (port_name[n] == '\0' || check_port_name[n] == '\0' || n>=STR_SIZE-1) {
-                if (port_name[n] == check_port_name[n]) {
-                    return true;
-                } else {
-                    break;
-                }
-            } else if (port_name[n] != check_port_name[n]) {
-                break;
-            }
-        }
-    }
-    return false;
-} // check_port_exists() }}}1
+    notify_push(&cs->notify_queue, type, name, other, value, delay);
+    wake_notifications();
+} // post_notification() }}}2
 
 /**
- * Get own output port index
+ * Wake up main event loop to drain notifications (any thread)
  *
- * @param {char} short_port_name - Own port name without client name
  * @private
- * @returns {int16_t} port_index - Port index or -1 if not found
  */
-int16_t get_own_out_port_index(char* short_port_name) // {{{1
+void wake_notifications() // {{{2
 {
-    for (uint8_t n=0; n<own_out_ports_size; n++) {
-        for (uint16_t m=0; m<STR_SIZE; m++) {
-            if (
-                short_port_name[m] == '\0' ||
-                own_out_ports_short_names[n][m] == '\0'
-            ) {
-                if (short_port_name[m] == own_out_ports_short_names[n][m]) {
-                    return n; // index of port
-                } else {
-                    break; // go to next port
-                }
-            } else if (short_port_name[m] != own_out_ports_short_names[n][m]) {
-                break; // go to next port
-            }
-        } // for (char of port name)
-    } // for (ports)
-
-    return -1; // port not found
-} // check_own_out_port_exists() }}}1
-
-// processing {{{1
-
-#define UV_PROCESS_STOP() \
-        { \
-            scope.Close(Undefined()); \
-            delete task; \
-            baton = NULL; \
-            uv_sem_post(&semaphore); \
-            return; \
-        }
-#define UV_PROCESS_EXCEPTION(err) \
-        { \
-            const uint8_t argc = 1; \
-            Local<Value> argv[argc] = { \
-                Local<Value>::New( err ), \
-            }; \
-            processCallback->Call(Context::GetCurrent()->Global(), argc, argv); \
-            UV_PROCESS_STOP(); \
-        }
+    if (__sync_bool_compare_and_swap(&cs->notify_wakeup_pending, 0, 1))
+        uv_async_send(&cs->notify_async);
+} // wake_notifications() }}}2
 
-void uv_process(uv_work_t* task, int status) // {{{2
+void jack_client_registration(const char *name, int registered, void *arg) // {{{2
 {
-    HandleScope scope;
+    client_scope_t client_scope((client_state_t *)arg);
+    post_notification(
+        registered ? NOTIFY_CLIENT_REGISTERED : NOTIFY_CLIENT_UNREGISTERED,
+        name, 0, 0, 0);
+} // jack_client_registration() }}}2
 
-    uint16_t nframes = *((uint16_t*)(&task->data));
+void jack_port_registration(jack_port_id_t id, int registered, void *arg) // {{{2
+{
+    client_scope_t client_scope((client_state_t *)arg);
+    port_graph_on_registration(&cs->port_graph, id, registered);
+
+    if (!cs->hasNotifyCallback) return;
+    jack_port_t *port = jack_port_by_id(cs->client, id);
+    post_notification(
+        registered ? NOTIFY_PORT_REGISTERED : NOTIFY_PORT_UNREGISTERED,
+        port ? jack_port_name(port) : 0, 0, 0, 0);
+} // jack_port_registration() }}}2
+
+// declared as returning int by older JACK headers and void by newer ones
+int jack_port_rename(jack_port_id_t id, const char *old_name, const char *new_name, void *arg) // {{{2
+{
+    client_scope_t client_scope((client_state_t *)arg);
+    port_graph_on_rename(&cs->port_graph, id);
+    post_notification(NOTIFY_PORT_RENAMED, new_name, old_name, 0, 0);
+    return 0;
+} // jack_port_rename() }}}2
 
-    Local<Object> capture = Object::New();
-    for (uint8_t i=0; i<own_in_ports_size; i++) {
-        Local<Array> portBuf = Array::New(nframes);
-        for (uint16_t n=0; n<nframes; n++) {
-            Local<Number> sample = Number::New( capture_buf[i][n] );
-            portBuf->Set(n, sample);
-        }
-        capture->Set(
-            String::NewSymbol(own_in_ports_short_names[i]),
-            portBuf
-        );
+void jack_port_connect(jack_port_id_t a, jack_port_id_t b, int connected, void *arg) // {{{2
+{
+    client_scope_t client_scope((client_state_t *)arg);
+    port_graph_on_connect(&cs->port_graph, a, b, connected);
+
+    if (!cs->hasNotifyCallback) return;
+    jack_port_t *src = jack_port_by_id(cs->client, a);
+    jack_port_t *dst = jack_port_by_id(cs->client, b);
+    if (src && (jack_port_flags(src) & JackPortIsInput)) {
+        jack_port_t *tmp = src; src = dst; dst = tmp;
     }
+    post_notification(
+        connected ? NOTIFY_CONNECTED : NOTIFY_DISCONNECTED,
+        src ? jack_port_name(src) : 0, dst ? jack_port_name(dst) : 0, 0, 0);
+} // jack_port_connect() }}}2
 
-    const uint8_t argc = 3;
-    Local<Value> argv[argc] = {
-        Local<Value>::New( Null() ),
-        Local<Number>::New( Number::New( nframes ) ),
-        Local<Object>::New( capture )
-    };
-    Local<Value> retval =
-        processCallback->Call(Context::GetCurrent()->Global(), argc, argv);
-
-    if (!retval->IsNull() && !retval->IsUndefined() && !retval->IsObject()) {
-        UV_PROCESS_EXCEPTION(
-            Exception::TypeError(String::New(
-                "Returned value of \"process\" callback must be an object"
-                " of port{String}:buffer{Array.<Number|Float>} values"
-                " or null or undefined"))
-        );
-    }
+int jack_graph_order(void *arg) // {{{2
+{
+    client_scope_t client_scope((client_state_t *)arg);
+    port_graph_on_graph_order(&cs->port_graph);
+    return 0;
+} // jack_graph_order() }}}2
 
-    if (retval->IsObject()) {
-        Local<Object> obj = retval.As<Object>();
-        Local<Array> keys = obj->GetOwnPropertyNames();
-        for (uint16_t i=0; i<keys->Length(); i++) {
-            Local<Value> key = keys->Get(i);
-            if (!key->IsString()) {
-                UV_PROCESS_EXCEPTION(
-                    Exception::TypeError(String::New(
-                        "Incorrect key type in returned value of \"process\""
-                        " callback, must be a string (own port name)"))
-                );
-            }
-            String::AsciiValue port_name(key->ToString());
+int jack_sample_rate(jack_nframes_t nframes, void *arg) // {{{2
+{
+    client_scope_t client_scope((client_state_t *)arg);
+    post_notification(NOTIFY_SAMPLE_RATE, 0, 0, nframes, 0);
+    return 0;
+} // jack_sample_rate() }}}2
 
-            int16_t port_index = get_own_out_port_index(*port_name);
-            if (port_index == -1) {
-                char err[] = "Port \"%s\" not found";
-                char err_msg[STR_SIZE + sizeof(err)];
-                sprintf(err_msg, err, *port_name);
-                UV_PROCESS_EXCEPTION(Exception::Error(String::New(err_msg)));
-            }
+/**
+ * Buffer size is about to change
+ *
+ * Buffers is resized by main thread (they're shared with JS),
+ * JS notification is delivered after that.
+ *
+ * @private
+ */
+int jack_buffer_size(jack_nframes_t nframes, void *arg) // {{{2
+{
+    client_scope_t client_scope((client_state_t *)arg);
+    cs->buffer_size_pending = nframes;
+    __sync_synchronize();
+    post_notification(NOTIFY_BUFFER_SIZE, 0, 0, nframes, 0);
+    wake_notifications(); // even if there is no notifications callback
+    return 0;
+} // jack_buffer_size() }}}2
 
-            Local<Value> val = obj->Get(key);
-            if (!val->IsArray()) {
-                UV_PROCESS_EXCEPTION(
-                    Exception::TypeError(String::New(
-                        "Incorrect buffer type of returned value of \"process\""
-                        " callback, must be an Array<Float|Number>"))
-                );
-            }
-            Local<Array> buffer = val.As<Array>();
+/**
+ * Init wakeup of main event loop for notifications, once per client state
+ *
+ * @private
+ */
+void init_notifications() // {{{2
+{
+    void uv_notify_process(uv_async_t* handle, int status);
 
-            if (buffer->Length() != nframes) {
-                UV_PROCESS_EXCEPTION(
-                    Exception::RangeError(String::New(
-                        "Incorrect buffer size of returned value"
-                        " of \"process\" callback"))
-                );
-            }
+    if (cs->notify_inited) return;
 
-            for (uint16_t sample_i=0; sample_i<nframes; sample_i++) {
-                Local<Value> sample = buffer->Get(sample_i);
-                if (!sample->IsNumber()) {
-                    UV_PROCESS_EXCEPTION(
-                        Exception::TypeError(String::New(
-                            "Incorrect sample type of returned value"
-                            " of \"process\" callback"
-                            ", must be a {Number|Float}"))
-                    );
-                }
-                playback_buf[port_index][sample_i] = sample->ToNumber()->Value();
-            }
-        } // for (ports)
-    } // if we has something to output from callback
+    uv_async_init(uv_default_loop(), &cs->notify_async, uv_notify_process);
+    cs->notify_async.data = cs;
+    // do not keep event loop alive only by this handle
+    uv_unref((uv_handle_t *)&cs->notify_async);
+    cs->notify_inited = true;
+} // init_notifications() }}}2
 
-    UV_PROCESS_STOP();
-} // uv_process() }}}2
+/**
+ * Set JACK notifications callbacks, call it before activation
+ *
+ * @private
+ */
+void set_notification_callbacks() // {{{2
+{
+    jack_set_client_registration_callback(cs->client, jack_client_registration, cs);
+    jack_set_port_registration_callback(cs->client, jack_port_registration, cs);
+    jack_set_port_rename_callback(cs->client, (JackPortRenameCallback)jack_port_rename, cs);
+    jack_set_port_connect_callback(cs->client, jack_port_connect, cs);
+    jack_set_graph_order_callback(cs->client, jack_graph_order, cs);
+    jack_set_sample_rate_callback(cs->client, jack_sample_rate, cs);
+    jack_set_buffer_size_callback(cs->client, jack_buffer_size, cs);
+} // set_notification_callbacks() }}}2
 
-int jack_process(jack_nframes_t nframes, void *arg) // {{{2
+/**
+ * Drain notifications queue to JS callback by one call
+ *
+ * Sample rate and buffer size changes is reduced to last value,
+ * xruns is reduced to one event with count and max delay.
+ *
+ * @private
+ */
+void uv_notify_process(uv_async_t* handle, int status) // {{{2
 {
-    if (!process) return 0;
-    if (!hasProcessCallback) return 0;
+    HandleScope scope;
+    client_scope_t client_scope((client_state_t *)handle->data);
+
+    cs->notify_wakeup_pending = 0;
+    __sync_synchronize();
+
+    // resize buffers before JS is notified about new buffer size
+    jack_nframes_t buffer_size = __sync_lock_test_and_set(&cs->buffer_size_pending, 0);
+    if (buffer_size != 0 && buffer_size != cs->buffer_size && cs->client != 0)
+        apply_buffer_size(buffer_size);
+
+    Local<Array> events = Array::New();
+    Local<Object> sample_rate_event;
+    Local<Object> buffer_size_event;
+    Local<Object> xrun_event;
+    uint32_t xruns = 0;
+    float xrun_max_delay = 0;
+    notify_event_t event;
+    uint32_t n = 0;
+
+    for (; n<NOTIFY_QUEUE_SIZE && notify_pop(&cs->notify_queue, &event); n++) {
+        Local<Object> obj;
+
+        switch (event.type) {
+            case NOTIFY_SAMPLE_RATE:
+                if (sample_rate_event.IsEmpty()) {
+                    sample_rate_event = Object::New();
+                    sample_rate_event->Set(String::NewSymbol("type"), String::NewSymbol("sampleRate"));
+                    events->Set(events->Length(), sample_rate_event);
+                }
+                sample_rate_event->Set(String::NewSymbol("sampleRate"),
+                    Integer::NewFromUnsigned(event.value));
+                continue;
+            case NOTIFY_BUFFER_SIZE:
+                if (buffer_size_event.IsEmpty()) {
+                    buffer_size_event = Object::New();
+                    buffer_size_event->Set(String::NewSymbol("type"), String::NewSymbol("bufferSize"));
+                    events->Set(events->Length(), buffer_size_event);
+                }
+                buffer_size_event->Set(String::NewSymbol("bufferSize"),
+                    Integer::NewFromUnsigned(event.value));
+                continue;
+            case NOTIFY_XRUN:
+                if (xrun_event.IsEmpty()) {
+                    xrun_event = Object::New();
+                    xrun_event->Set(String::NewSymbol("type"), String::NewSymbol("xrun"));
+                    events->Set(events->Length(), xrun_event);
+                }
+                xruns++;
+                if (event.delay > xrun_max_delay) xrun_max_delay = event.delay;
+                continue;
+            default:
+                break;
+        }
 
-    if (baton) {
-        uv_sem_wait(&semaphore);
-        uv_sem_destroy(&semaphore);
+        obj = Object::New();
+        switch (event.type) {
+            case NOTIFY_CLIENT_REGISTERED:
+            case NOTIFY_CLIENT_UNREGISTERED:
+                obj->Set(String::NewSymbol("type"), String::NewSymbol(
+                    event.type == NOTIFY_CLIENT_REGISTERED
+                    ? "clientRegistered" : "clientUnregistered"));
+                obj->Set(String::NewSymbol("client"), String::New(event.name));
+                break;
+            case NOTIFY_PORT_REGISTERED:
+            case NOTIFY_PORT_UNREGISTERED:
+                obj->Set(String::NewSymbol("type"), String::NewSymbol(
+                    event.type == NOTIFY_PORT_REGISTERED
+                    ? "portRegistered" : "portUnregistered"));
+                obj->Set(String::NewSymbol("port"), String::New(event.name));
+                break;
+            case NOTIFY_PORT_RENAMED:
+                obj->Set(String::NewSymbol("type"), String::NewSymbol("portRenamed"));
+                obj->Set(String::NewSymbol("port"), String::New(event.name));
+                obj->Set(String::NewSymbol("oldName"), String::New(event.other));
+                break;
+            case NOTIFY_WORKER_ERROR:
+                obj->Set(String::NewSymbol("type"), String::NewSymbol("workerError"));
+                obj->Set(String::NewSymbol("message"), String::New(event.name));
+                break;
+            default: // NOTIFY_CONNECTED, NOTIFY_DISCONNECTED
+                obj->Set(String::NewSymbol("type"), String::NewSymbol(
+                    event.type == NOTIFY_CONNECTED ? "connected" : "disconnected"));
+                obj->Set(String::NewSymbol("source"), String::New(event.name));
+                obj->Set(String::NewSymbol("destination"), String::New(event.other));
+        }
+        events->Set(events->Length(), obj);
     }
 
-    baton = new uv_work_t();
-
-    if (uv_sem_init(&semaphore, 0) < 0) { perror("uv_sem_init"); return 1; }
+    // queue is refilled while draining, handle the rest on next loop iteration
+    if (n == NOTIFY_QUEUE_SIZE
+    && __sync_bool_compare_and_swap(&cs->notify_wakeup_pending, 0, 1)) {
+        uv_async_send(&cs->notify_async);
+    }
 
-    for (uint8_t i=0; i<own_in_ports_size; i++) {
-        capture_buf[i] = (jack_default_audio_sample_t *)
-            jack_port_get_buffer(capture_ports[i], nframes);
+    if (!xrun_event.IsEmpty()) {
+        xrun_event->Set(String::NewSymbol("count"), Integer::NewFromUnsigned(xruns));
+        xrun_event->Set(String::NewSymbol("maxDelay"), Number::New(xrun_max_delay));
     }
 
-    for (uint8_t i=0; i<own_out_ports_size; i++) {
-        playback_buf[i] = (jack_default_audio_sample_t *)
-            jack_port_get_buffer(playback_ports[i], nframes);
+    uint32_t lost = notify_take_lost(&cs->notify_queue);
+    if (lost > 0) {
+        Local<Object> obj = Object::New();
+        obj->Set(String::NewSymbol("type"), String::NewSymbol("overflow"));
+        obj->Set(String::NewSymbol("lost"), Integer::NewFromUnsigned(lost));
+        events->Set(events->Length(), obj);
     }
 
-    baton->data = (void*)(uint16_t)nframes;
-    uv_queue_work(uv_default_loop(), baton, uv_work_plug, uv_process);
-    uv_sem_wait(&semaphore);
-    uv_sem_destroy(&semaphore);
+    if (!cs->hasNotifyCallback || events->Length() == 0) return;
 
-    return 0;
-} // jack_process() }}}2
+    const uint8_t argc = 1;
+    Local<Value> argv[argc] = { events };
+    TryCatch try_catch;
+    cs->notifyCallback->Call(Context::GetCurrent()->Global(), argc, argv);
+    if (try_catch.HasCaught()) node::FatalException(try_catch);
+} // uv_notify_process() }}}2
 
-// processing }}}1
+// notifications }}}1
 
 /**
  * Get JACK sample rate
@@ -1165,9 +6961,10 @@ int jack_process(jack_nframes_t nframes, void *arg) // {{{2
 Handle<Value> getSampleRateSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
     Local<Number> val = Local<Number>::New(
-        Number::New( jack_get_sample_rate(client) )
+        Number::New( jack_get_sample_rate(cs->client) )
     );
     return scope.Close(val);
 } // getSampleRateSync() }}}1
@@ -1185,15 +6982,138 @@ Handle<Value> getSampleRateSync(const Arguments &args) // {{{1
 Handle<Value> getBufferSizeSync(const Arguments &args) // {{{1
 {
     HandleScope scope;
+    USE_CLIENT_STATE();
     NEED_JACK_CLIENT_OPENED();
     Local<Number> val = Local<Number>::New(
-        Number::New( jack_get_buffer_size(client) )
+        Number::New( jack_get_buffer_size(cs->client) )
     );
     return scope.Close(val);
 } // getBufferSizeSync() }}}1
 
+// client state {{{1
+
+/**
+ * Allocate state of new JACK-client
+ *
+ * @private
+ * @returns {client_state_t} state
+ */
+client_state_t* new_client_state() // {{{2
+{
+    client_state_t *state = new client_state_t();
+
+    state->rt_snapshot = new rt_snapshot_t(); // empty one
+    state->port_handles_free = -1;
+    port_graph_init(&state->port_graph);
+    notify_queue_init(&state->notify_queue);
+    state->ringbuffer_periods = DEFAULT_RINGBUFFER_PERIODS;
+    state->dsp_automation_queue = jack_ringbuffer_create(
+        DSP_AUTOMATION_QUEUE_SIZE * sizeof(dsp_automation_event_t));
+    jack_ringbuffer_mlock(state->dsp_automation_queue);
+
+    return state;
+} // new_client_state() }}}2
+
+void client_state_handle_closed(uv_handle_t *handle) // {{{2
+{
+    client_state_t *state = (client_state_t *)handle->data;
+    if (--state->handles_closing == 0) delete state;
+} // client_state_handle_closed() }}}2
+
+/**
+ * Free state of closed JACK-client
+ *
+ * State is deleted after its async handles is closed.
+ *
+ * @private
+ * @param {client_state_t} state
+ */
+void free_client_state(client_state_t *state) // {{{2
+{
+    if (state->hasNotifyCallback) state->notifyCallback.Dispose();
+    if (!state->processCallback.IsEmpty()) state->processCallback.Dispose();
+
+    {
+        // RT thread is stopped, nothing is waited for
+        client_scope_t client_scope(state);
+        rt_reclaim();
+        free_rt_snapshot(state->rt_snapshot);
+        state->rt_snapshot = 0;
+    }
+
+    dsp_graph_destroy(&state->dsp_graph);
+    jack_ringbuffer_free(state->dsp_automation_queue);
+    port_graph_destroy(&state->port_graph);
+    notify_queue_destroy(&state->notify_queue);
+    delete [] state->dsp_worker_source;
+
+    state->handles_closing = 0;
+    if (state->ringbuffer_inited) state->handles_closing++;
+    if (state->notify_inited) state->handles_closing++;
+    if (state->handles_closing == 0) {
+        delete state;
+        return;
+    }
+
+    if (state->ringbuffer_inited)
+        uv_close((uv_handle_t *)&state->ringbuffer_async, client_state_handle_closed);
+    if (state->notify_inited)
+        uv_close((uv_handle_t *)&state->notify_async, client_state_handle_closed);
+} // free_client_state() }}}2
+
+/**
+ * Get state that method is called for
+ *
+ * @private
+ * @returns {client_state_t} state State of JackClient instance or default one
+ */
+client_state_t* get_client_state(const Arguments &args) // {{{2
+{
+    if (jackClientTemplate->HasInstance(args.This()))
+        return node::ObjectWrap::Unwrap<JackClient>(args.This())->state;
+    return default_client_state;
+} // get_client_state() }}}2
+
+// client state }}}1
+
+// JackClient {{{1
+
+JackClient::JackClient() : state(new_client_state()) // {{{2
+{
+    state->wrap = this;
+} // JackClient::JackClient() }}}2
+
+JackClient::~JackClient() // {{{2
+{
+    free_client_state(state);
+} // JackClient::~JackClient() }}}2
+
+/**
+ * Create additional JACK-client object, it's opened by openClientSync()
+ *
+ * @public
+ * @example
+ *   var jackConnector = require('jack-connector');
+ *   var client = new jackConnector.JackClient();
+ */
+Handle<Value> JackClient::New(const Arguments &args) // {{{2
+{
+    HandleScope scope;
+
+    if (!args.IsConstructCall()) THROW_ERR("Use \"new\" to create JackClient");
+
+    JackClient *obj = new JackClient();
+    obj->Wrap(args.This());
+
+    return args.This();
+} // JackClient::New() }}}2
+
+// JackClient }}}1
+
 void init(Handle<Object> target) // {{{1
 {
+    default_client_state = new_client_state();
+    dsp_kernels_init();
 
     target->Set( String::NewSymbol("getVersion"),
                  FunctionTemplate::New(getVersion)->GetFunction() );
@@ -1217,6 +7137,12 @@ void init(Handle<Object> target) // {{{1
     target->Set( String::NewSymbol("registerOutPortSync"),
                  FunctionTemplate::New(registerOutPortSync)->GetFunction() );
 
+    target->Set( String::NewSymbol("registerMidiInPortSync"),
+                 FunctionTemplate::New(registerMidiInPortSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("registerMidiOutPortSync"),
+                 FunctionTemplate::New(registerMidiOutPortSync)->GetFunction() );
+
     target->Set( String::NewSymbol("unregisterPortSync"),
                  FunctionTemplate::New(unregisterPortSync)->GetFunction() );
 
@@ -1228,6 +7154,12 @@ void init(Handle<Object> target) // {{{1
     target->Set( String::NewSymbol("disconnectPortSync"),
                  FunctionTemplate::New(disconnectPortSync)->GetFunction() );
 
+    target->Set( String::NewSymbol("connectPorts"),
+                 FunctionTemplate::New(connectPorts)->GetFunction() );
+
+    target->Set( String::NewSymbol("disconnectPorts"),
+                 FunctionTemplate::New(disconnectPorts)->GetFunction() );
+
     // get ports
 
     target->Set( String::NewSymbol("getAllPortsSync"),
@@ -1250,11 +7182,142 @@ void init(Handle<Object> target) // {{{1
     target->Set( String::NewSymbol("inPortExistsSync"),
                  FunctionTemplate::New(inPortExistsSync)->GetFunction() );
 
+    target->Set( String::NewSymbol("getPortConnectionsSync"),
+                 FunctionTemplate::New(getPortConnectionsSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("bindNotificationsSync"),
+                 FunctionTemplate::New(bindNotificationsSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("unbindNotificationsSync"),
+                 FunctionTemplate::New(unbindNotificationsSync)->GetFunction() );
+
     // sound process
 
     target->Set( String::NewSymbol("bindProcessSync"),
                  FunctionTemplate::New(bindProcessSync)->GetFunction() );
 
+    // native DSP graph
+
+    target->Set( String::NewSymbol("addDspNodeSync"),
+                 FunctionTemplate::New(addDspNodeSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("removeDspNodeSync"),
+                 FunctionTemplate::New(removeDspNodeSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("setDspNodeParamSync"),
+                 FunctionTemplate::New(setDspNodeParamSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("automateDspNodeSync"),
+                 FunctionTemplate::New(automateDspNodeSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("connectDspSync"),
+                 FunctionTemplate::New(connectDspSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("disconnectDspSync"),
+                 FunctionTemplate::New(disconnectDspSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("clearDspGraphSync"),
+                 FunctionTemplate::New(clearDspGraphSync)->GetFunction() );
+    target->Set( String::NewSymbol("setDspThreadsSync"),
+                 FunctionTemplate::New(setDspThreadsSync)->GetFunction() );
+
+    // recording
+
+    target->Set( String::NewSymbol("startRecordingSync"),
+                 FunctionTemplate::New(startRecordingSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("stopRecordingSync"),
+                 FunctionTemplate::New(stopRecordingSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("getRecordingStatusSync"),
+                 FunctionTemplate::New(getRecordingStatusSync)->GetFunction() );
+
+    // playing
+
+    target->Set( String::NewSymbol("createPlayerSync"),
+                 FunctionTemplate::New(createPlayerSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("startPlayerSync"),
+                 FunctionTemplate::New(startPlayerSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("stopPlayerSync"),
+                 FunctionTemplate::New(stopPlayerSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("seekPlayerSync"),
+                 FunctionTemplate::New(seekPlayerSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("setPlayerLoopSync"),
+                 FunctionTemplate::New(setPlayerLoopSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("getPlayerStatusSync"),
+                 FunctionTemplate::New(getPlayerStatusSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("destroyPlayerSync"),
+                 FunctionTemplate::New(destroyPlayerSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("getFrameTimeSync"),
+                 FunctionTemplate::New(getFrameTimeSync)->GetFunction() );
+
+    // metering
+
+    target->Set( String::NewSymbol("enableMetersSync"),
+                 FunctionTemplate::New(enableMetersSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("disableMetersSync"),
+                 FunctionTemplate::New(disableMetersSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("getMetersSync"),
+                 FunctionTemplate::New(getMetersSync)->GetFunction() );
+
+    // spectrum analyzer
+
+    target->Set( String::NewSymbol("createAnalyzerSync"),
+                 FunctionTemplate::New(createAnalyzerSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("getAnalyzerFrameSync"),
+                 FunctionTemplate::New(getAnalyzerFrameSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("destroyAnalyzerSync"),
+                 FunctionTemplate::New(destroyAnalyzerSync)->GetFunction() );
+    target->Set( String::NewSymbol("createStreamSync"),
+                 FunctionTemplate::New(createStreamSync)->GetFunction() );
+    target->Set( String::NewSymbol("writeStreamSync"),
+                 FunctionTemplate::New(writeStreamSync)->GetFunction() );
+    target->Set( String::NewSymbol("readStreamSync"),
+                 FunctionTemplate::New(readStreamSync)->GetFunction() );
+    target->Set( String::NewSymbol("getStreamStatusSync"),
+                 FunctionTemplate::New(getStreamStatusSync)->GetFunction() );
+    target->Set( String::NewSymbol("destroyStreamSync"),
+                 FunctionTemplate::New(destroyStreamSync)->GetFunction() );
+
+    // stats
+
+    target->Set( String::NewSymbol("getStatsSync"),
+                 FunctionTemplate::New(getStatsSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("resetStatsSync"),
+                 FunctionTemplate::New(resetStatsSync)->GetFunction() );
+
+    // transport
+
+    target->Set( String::NewSymbol("getTransportSync"),
+                 FunctionTemplate::New(getTransportSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("startTransportSync"),
+                 FunctionTemplate::New(startTransportSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("stopTransportSync"),
+                 FunctionTemplate::New(stopTransportSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("locateTransportSync"),
+                 FunctionTemplate::New(locateTransportSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("setTimebaseMasterSync"),
+                 FunctionTemplate::New(setTimebaseMasterSync)->GetFunction() );
+
+    target->Set( String::NewSymbol("releaseTimebaseSync"),
+                 FunctionTemplate::New(releaseTimebaseSync)->GetFunction() );
+
     // activating client
 
     target->Set( String::NewSymbol("checkActiveSync"),
@@ -1274,6 +7337,25 @@ void init(Handle<Object> target) // {{{1
     target->Set( String::NewSymbol("getBufferSizeSync"),
                  FunctionTemplate::New(getBufferSizeSync)->GetFunction() );
 
+    // additional clients
+
+    Local<FunctionTemplate> tpl = FunctionTemplate::New(JackClient::New);
+    tpl->SetClassName(String::NewSymbol("JackClient"));
+    tpl->InstanceTemplate()->SetInternalFieldCount(1);
+    jackClientTemplate = Persistent<FunctionTemplate>::New(tpl);
+
+    // same methods as module has, they works with client of "this"
+    Local<Function> constructor = tpl->GetFunction();
+    Local<Object> prototype = constructor->Get(String::NewSymbol("prototype"))->ToObject();
+    Local<Array> names = target->GetOwnPropertyNames();
+    for (uint32_t i=0; i<names->Length(); i++) {
+        Local<Value> name = names->Get(i);
+        if (name->StrictEquals(String::NewSymbol("getVersion"))) continue;
+        prototype->Set(name, target->Get(name));
+    }
+
+    target->Set( String::NewSymbol("JackClient"), constructor );
+
 } // init() }}}1
 
 NODE_MODULE(jack_connector, init);
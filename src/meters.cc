@@ -0,0 +1,252 @@
+/**
+ * JACK Connector
+ * Level meters of own ports computed in JACK realtime thread
+ *
+ * Sample peak and sum of squares use vectorized kernels, true-peak is
+ * peak of signal interpolated by 4x polyphase FIR (ITU-R BS.1770 style).
+ * Values is published through two snapshots with sequence numbers,
+ * so reader never blocks RT thread and RT thread never waits for reader.
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "meters.h"
+#include "dsp_kernels.h"
+#include <math.h>
+#include <string.h>
+
+#define METER_HISTORY (METER_PHASE_TAPS - 1)
+#define METER_READ_TRIES 16
+
+/**
+ * Windowed-sinc interpolator with cutoff at Nyquist of source rate
+ *
+ * @param {float} fir Phase-major coefficients
+ */
+static void build_interpolator(float *fir) // {{{1
+{
+    const uint32_t size = METER_OVERSAMPLING * METER_PHASE_TAPS;
+    const double center = (size - 1) / 2.0;
+    double h[METER_OVERSAMPLING * METER_PHASE_TAPS];
+    double sum = 0;
+
+    for (uint32_t k=0; k<size; k++) {
+        double x = (k - center) / METER_OVERSAMPLING;
+        double sinc = x == 0 ? 1 : sin(M_PI * x) / (M_PI * x);
+        // Blackman window
+        double w = 0.42 - 0.5 * cos(2 * M_PI * k / (size - 1))
+            + 0.08 * cos(4 * M_PI * k / (size - 1));
+        h[k] = sinc * w;
+        sum += h[k];
+    }
+
+    // every phase has unity gain at DC
+    for (uint32_t p=0; p<METER_OVERSAMPLING; p++) {
+        for (uint32_t j=0; j<METER_PHASE_TAPS; j++) {
+            fir[p * METER_PHASE_TAPS + j] = h[p + METER_OVERSAMPLING * j] * METER_OVERSAMPLING / sum;
+        }
+    }
+} // build_interpolator() }}}1
+
+/**
+ * Allocate meters of channels
+ *
+ * @param {uint32_t} channels_count
+ * @param {jack_nframes_t} sample_rate
+ * @param {jack_nframes_t} max_frames Max buffer size of JACK cycle
+ * @param {bool} true_peak Compute true-peak (costs 48 multiplications per sample)
+ * @param {float} hold_seconds Peak hold time
+ * @param {float} falloff Peak falloff in dB per second
+ * @param {float} rms_window RMS averaging time in seconds
+ * @returns {meters_t} meters
+ */
+meters_t* meters_create( // {{{1
+    uint32_t channels_count,
+    jack_nframes_t sample_rate,
+    jack_nframes_t max_frames,
+    bool true_peak,
+    float hold_seconds,
+    float falloff,
+    float rms_window)
+{
+    meters_t *meters = new meters_t();
+    meters->channels_count = channels_count;
+    meters->sample_rate = sample_rate;
+    meters->max_frames = max_frames;
+    meters->true_peak = true_peak;
+    meters->hold_seconds = hold_seconds;
+    meters->falloff = falloff;
+    meters->rms_window = rms_window;
+
+    meters->channels = new meter_channel_t[channels_count];
+    memset(meters->channels, 0, channels_count * sizeof(meter_channel_t));
+
+    if (true_peak) {
+        build_interpolator(meters->fir);
+        meters->scratch = new jack_default_audio_sample_t[METER_HISTORY + max_frames];
+    }
+
+    for (uint32_t i=0; i<2; i++) {
+        meters->snapshots[i].sequence = 0;
+        meters->snapshots[i].values = new meter_values_t[channels_count];
+        memset(meters->snapshots[i].values, 0, channels_count * sizeof(meter_values_t));
+    }
+    meters->published = 0;
+    meters->read_buf = new meter_values_t[channels_count];
+
+    return meters;
+} // meters_create() }}}1
+
+void meters_free(meters_t *meters) // {{{1
+{
+    if (meters == 0) return;
+
+    delete [] meters->channels;
+    delete [] meters->scratch;
+    delete [] meters->snapshots[0].values;
+    delete [] meters->snapshots[1].values;
+    delete [] meters->read_buf;
+    delete meters;
+} // meters_free() }}}1
+
+// RT thread {{{1
+
+/**
+ * Start new cycle, snapshot that isn't published is written
+ *
+ * @param {meters_t} meters
+ * @param {jack_nframes_t} nframes
+ */
+void meters_begin(meters_t *meters, jack_nframes_t nframes) // {{{2
+{
+    float seconds = (float)nframes / meters->sample_rate;
+    meters->falloff_gain = powf(10, -meters->falloff * seconds / 20);
+    meters->rms_coef = meters->rms_window > 0 ? 1 - expf(-seconds / meters->rms_window) : 1;
+    meters->hold_frames = meters->hold_seconds * meters->sample_rate;
+
+    meters->writing = meters->published ^ 1;
+    meters->snapshots[meters->writing].sequence++; // odd
+    __sync_synchronize();
+} // meters_begin() }}}2
+
+/**
+ * Peak of 4x oversampled signal, history of channel is updated
+ *
+ * @private
+ */
+static float true_peak( // {{{2
+    meters_t *meters,
+    meter_channel_t *channel,
+    const jack_default_audio_sample_t *buf,
+    jack_nframes_t nframes)
+{
+    jack_default_audio_sample_t *x = meters->scratch;
+    memcpy(x, channel->history, METER_HISTORY * sizeof(jack_default_audio_sample_t));
+    if (buf) {
+        memcpy(x + METER_HISTORY, buf, nframes * sizeof(jack_default_audio_sample_t));
+    } else {
+        memset(x + METER_HISTORY, 0, nframes * sizeof(jack_default_audio_sample_t));
+    }
+
+    float peak = 0;
+    for (jack_nframes_t n=0; n<nframes; n++) {
+        const jack_default_audio_sample_t *s = x + METER_HISTORY + n;
+        for (uint32_t p=0; p<METER_OVERSAMPLING; p++) {
+            const float *h = meters->fir + p * METER_PHASE_TAPS;
+            float y = 0;
+            for (uint32_t j=0; j<METER_PHASE_TAPS; j++) y += h[j] * s[-(int32_t)j];
+            y = fabsf(y);
+            if (y > peak) peak = y;
+        }
+    }
+
+    memcpy(channel->history, x + nframes, METER_HISTORY * sizeof(jack_default_audio_sample_t));
+    return peak;
+} // true_peak() }}}2
+
+/**
+ * Measure one channel of cycle
+ *
+ * @param {meters_t} meters
+ * @param {uint32_t} index Channel index
+ * @param {jack_default_audio_sample_t} buf Port buffer or 0 for silence
+ * @param {jack_nframes_t} nframes
+ */
+void meters_process( // {{{2
+    meters_t *meters,
+    uint32_t index,
+    const jack_default_audio_sample_t *buf,
+    jack_nframes_t nframes)
+{
+    if (index >= meters->channels_count || nframes > meters->max_frames) return;
+
+    meter_channel_t *channel = &meters->channels[index];
+    float peak = buf ? dsp_kernels.peak(buf, nframes) : 0;
+    float sum_squares = buf ? dsp_kernels.sum_squares(buf, nframes) : 0;
+
+    channel->peak *= meters->falloff_gain;
+    if (peak > channel->peak) channel->peak = peak;
+
+    if (peak >= channel->peak_hold) {
+        channel->peak_hold = peak;
+        channel->hold_left = meters->hold_frames;
+    } else if (channel->hold_left > nframes) {
+        channel->hold_left -= nframes;
+    } else {
+        channel->hold_left = 0;
+        channel->peak_hold = channel->peak;
+    }
+
+    channel->mean_square += meters->rms_coef * (sum_squares / nframes - channel->mean_square);
+
+    if (meters->true_peak) {
+        float tp = true_peak(meters, channel, buf, nframes);
+        if (peak > tp) tp = peak;
+        channel->true_peak *= meters->falloff_gain;
+        if (tp > channel->true_peak) channel->true_peak = tp;
+    }
+
+    meter_values_t *values = &meters->snapshots[meters->writing].values[index];
+    values->peak = channel->peak;
+    values->peak_hold = channel->peak_hold;
+    values->rms = sqrtf(channel->mean_square);
+    values->true_peak = channel->true_peak;
+} // meters_process() }}}2
+
+void meters_publish(meters_t *meters) // {{{2
+{
+    __sync_synchronize();
+    meters->snapshots[meters->writing].sequence++; // even
+    meters->published = meters->writing;
+} // meters_publish() }}}2
+
+// RT thread }}}1
+
+/**
+ * Copy last published snapshot
+ *
+ * Copy is retried if RT thread started to rewrite it meanwhile
+ * (reader was slower than whole JACK cycle).
+ *
+ * @param {meters_t} meters
+ * @returns {meter_values_t} values Values of all channels
+ */
+const meter_values_t* meters_read(meters_t *meters) // {{{1
+{
+    size_t size = meters->channels_count * sizeof(meter_values_t);
+
+    for (uint32_t i=0; i<METER_READ_TRIES; i++) {
+        meter_snapshot_t *snapshot = &meters->snapshots[meters->published];
+        uint32_t sequence = snapshot->sequence;
+        if (sequence & 1) continue;
+        __sync_synchronize();
+        memcpy(meters->read_buf, snapshot->values, size);
+        __sync_synchronize();
+        if (snapshot->sequence == sequence) break;
+    }
+
+    return meters->read_buf;
+} // meters_read() }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
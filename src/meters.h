@@ -0,0 +1,91 @@
+/**
+ * JACK Connector
+ * Level meters of own ports computed in JACK realtime thread
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef METERS_H
+#define METERS_H
+
+#include <jack/jack.h>
+#include <stdint.h>
+
+#define METER_OVERSAMPLING 4
+#define METER_PHASE_TAPS 12 // taps of every phase of true-peak interpolator
+
+// values of one channel, linear amplitude
+typedef struct {
+    float peak; // sample peak with falloff
+    float peak_hold; // max of peak, held for hold time
+    float rms; // exponentially averaged over RMS window
+    float true_peak; // peak of 4x oversampled signal with falloff (0 if disabled)
+} meter_values_t;
+
+// RT thread only
+typedef struct {
+    float peak;
+    float peak_hold;
+    uint32_t hold_left; // frames
+    float mean_square;
+    float true_peak;
+    jack_default_audio_sample_t history[METER_PHASE_TAPS - 1];
+} meter_channel_t;
+
+typedef struct {
+    volatile uint32_t sequence; // odd while RT thread writes it
+    meter_values_t *values;
+} meter_snapshot_t;
+
+typedef struct {
+    uint32_t channels_count;
+    jack_nframes_t sample_rate;
+    jack_nframes_t max_frames;
+    bool true_peak;
+    float hold_seconds;
+    float falloff; // dB per second
+    float rms_window; // seconds
+
+    meter_channel_t *channels;
+    float fir[METER_OVERSAMPLING * METER_PHASE_TAPS]; // interpolator, phase-major
+    jack_default_audio_sample_t *scratch; // history + cycle frames
+
+    // coefficients of current cycle
+    float falloff_gain;
+    float rms_coef;
+    uint32_t hold_frames;
+
+    // RT thread writes one snapshot while JS thread reads another one
+    meter_snapshot_t snapshots[2];
+    volatile uint32_t published; // index of last complete snapshot
+    uint32_t writing;
+
+    meter_values_t *read_buf; // JS thread copy of snapshot
+} meters_t;
+
+meters_t* meters_create(
+    uint32_t channels_count,
+    jack_nframes_t sample_rate,
+    jack_nframes_t max_frames,
+    bool true_peak,
+    float hold_seconds,
+    float falloff,
+    float rms_window);
+void meters_free(meters_t *meters);
+
+// RT thread: meters_begin(), meters_process() for every channel, meters_publish()
+void meters_begin(meters_t *meters, jack_nframes_t nframes);
+void meters_process(
+    meters_t *meters,
+    uint32_t index,
+    const jack_default_audio_sample_t *buf, // 0 is silence
+    jack_nframes_t nframes);
+void meters_publish(meters_t *meters);
+
+// JS thread, never waits for RT thread, returns meters->read_buf
+const meter_values_t* meters_read(meters_t *meters);
+
+#endif // METERS_H
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,103 @@
+/**
+ * JACK Connector
+ * Lock-free queue of JACK notifications for main event loop
+ *
+ * Bounded multi-producer queue with sequence number in every slot
+ * (notifications may come from JACK notification thread and from
+ * RT thread), consumer is JS thread only.
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "notify_queue.h"
+#include <string.h>
+
+static void copy_name(char *dst, const char *src)
+{
+    if (src == 0) {
+        dst[0] = '\0';
+        return;
+    }
+    size_t len = strnlen(src, NOTIFY_NAME_SIZE - 1);
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+void notify_queue_init(notify_queue_t *queue) // {{{1
+{
+    queue->slots = new notify_slot_t[NOTIFY_QUEUE_SIZE];
+    for (uint32_t i=0; i<NOTIFY_QUEUE_SIZE; i++) queue->slots[i].sequence = i;
+} // notify_queue_init() }}}1
+
+void notify_queue_destroy(notify_queue_t *queue) // {{{1
+{
+    delete [] queue->slots;
+    queue->slots = 0;
+} // notify_queue_destroy() }}}1
+
+void notify_queue_clear(notify_queue_t *queue) // {{{1
+{
+    notify_event_t event;
+    while (notify_pop(queue, &event)) {}
+    notify_take_lost(queue);
+} // notify_queue_clear() }}}1
+
+bool notify_push( // {{{1
+    notify_queue_t *queue,
+    notify_type_t type,
+    const char *name,
+    const char *other,
+    uint32_t value,
+    float delay)
+{
+    notify_slot_t *slot;
+    uint32_t pos = queue->enqueue_pos;
+
+    for (;;) {
+        slot = &queue->slots[pos & (NOTIFY_QUEUE_SIZE - 1)];
+        int32_t diff = (int32_t)(slot->sequence - pos);
+        if (diff == 0) {
+            // slot is free, take it
+            if (__sync_bool_compare_and_swap(&queue->enqueue_pos, pos, pos + 1)) break;
+            pos = queue->enqueue_pos;
+        } else if (diff < 0) {
+            // queue is full, consumer is too slow
+            __sync_fetch_and_add(&queue->lost, 1);
+            return false;
+        } else {
+            // other producer took this slot
+            pos = queue->enqueue_pos;
+        }
+    }
+
+    slot->event.type = type;
+    slot->event.value = value;
+    slot->event.delay = delay;
+    copy_name(slot->event.name, name);
+    copy_name(slot->event.other, other);
+
+    __sync_synchronize();
+    slot->sequence = pos + 1; // publish
+    return true;
+} // notify_push() }}}1
+
+bool notify_pop(notify_queue_t *queue, notify_event_t *event) // {{{1
+{
+    notify_slot_t *slot = &queue->slots[queue->dequeue_pos & (NOTIFY_QUEUE_SIZE - 1)];
+    if ((int32_t)(slot->sequence - (queue->dequeue_pos + 1)) != 0) return false;
+
+    __sync_synchronize();
+    memcpy(event, &slot->event, sizeof(notify_event_t));
+    __sync_synchronize();
+    slot->sequence = queue->dequeue_pos + NOTIFY_QUEUE_SIZE; // free for next lap
+    queue->dequeue_pos++;
+    return true;
+} // notify_pop() }}}1
+
+uint32_t notify_take_lost(notify_queue_t *queue) // {{{1
+{
+    return __sync_lock_test_and_set(&queue->lost, 0);
+} // notify_take_lost() }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,69 @@
+/**
+ * JACK Connector
+ * Lock-free queue of JACK notifications for main event loop
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef NOTIFY_QUEUE_H
+#define NOTIFY_QUEUE_H
+
+#include <stdint.h>
+
+#define NOTIFY_NAME_SIZE 320 // enough for full port name of JACK2
+#define NOTIFY_QUEUE_SIZE 1024 // power of 2
+
+typedef enum {
+    NOTIFY_CLIENT_REGISTERED = 0,
+    NOTIFY_CLIENT_UNREGISTERED,
+    NOTIFY_PORT_REGISTERED,
+    NOTIFY_PORT_UNREGISTERED,
+    NOTIFY_PORT_RENAMED,
+    NOTIFY_CONNECTED,
+    NOTIFY_DISCONNECTED,
+    NOTIFY_SAMPLE_RATE,
+    NOTIFY_BUFFER_SIZE,
+    NOTIFY_XRUN,
+    NOTIFY_WORKER_ERROR
+} notify_type_t;
+
+typedef struct {
+    notify_type_t type;
+    uint32_t value; // sample rate or buffer size
+    float delay; // xrun delay in microseconds
+    char name[NOTIFY_NAME_SIZE]; // client name, port name, source port name or error message
+    char other[NOTIFY_NAME_SIZE]; // destination port name or old port name
+} notify_event_t;
+
+typedef struct {
+    volatile uint32_t sequence;
+    notify_event_t event;
+} notify_slot_t;
+
+typedef struct {
+    notify_slot_t *slots;
+    volatile uint32_t enqueue_pos;
+    uint32_t dequeue_pos;
+    volatile uint32_t lost;
+} notify_queue_t;
+
+void notify_queue_init(notify_queue_t *queue); // queue must be zeroed
+void notify_queue_destroy(notify_queue_t *queue);
+void notify_queue_clear(notify_queue_t *queue); // consumer side
+
+// any thread, never blocks, false if queue is full (event is counted as lost)
+bool notify_push(
+    notify_queue_t *queue,
+    notify_type_t type,
+    const char *name,
+    const char *other,
+    uint32_t value,
+    float delay);
+
+bool notify_pop(notify_queue_t *queue, notify_event_t *event); // single consumer
+uint32_t notify_take_lost(notify_queue_t *queue); // count of lost events since previous call
+
+#endif // NOTIFY_QUEUE_H
+
+// vim:set ts=4 sts=4 sw=4 et:
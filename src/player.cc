@@ -0,0 +1,589 @@
+/**
+ * JACK Connector
+ * Memory-mapped file player feeding own output ports from JACK realtime thread
+ *
+ * File is mapped to memory and RT thread decodes frames right from the map,
+ * so seeking and looping is free and sample-accurate. Read-ahead thread locks
+ * blocks of the map in front of play position, loop start and seek target
+ * in memory (mlock), RT thread decodes locked blocks only and writes silence
+ * (counted as underrun) for the rest, so it never hits page faults.
+ * Commands from JS come through lock-free ring and is applied at exact frame
+ * of JACK frame time.
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "player.h"
+#include "dsp_kernels.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PLAYER_COMMANDS_QUEUE_SIZE 64
+#define PLAYER_LOCK_BLOCK_SIZE (256 * 1024) // bytes, rounded up to page size
+#define PLAYER_LOCK_WINDOWS 4 // play position, loop start, loop cue, seek cue
+
+// file parsing {{{1
+
+inline uint16_t get_le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+inline uint32_t get_le32(const uint8_t *p)
+{
+    return get_le16(p) | ((uint32_t)get_le16(p + 2) << 16);
+}
+inline uint64_t get_le64(const uint8_t *p)
+{
+    return get_le32(p) | ((uint64_t)get_le32(p + 4) << 32);
+}
+
+/**
+ * Find format and data of WAV or RF64 file
+ *
+ * @private
+ * @returns {char} err Error message or 0
+ */
+const char* player_parse_wav(player_t *player) // {{{2
+{
+    const uint8_t *map = player->map;
+    size_t size = player->map_size;
+
+    if (size < 12 || memcmp(map + 8, "WAVE", 4) != 0)
+        return "Unknown file format, WAV or RF64 expected";
+    bool rf64 = memcmp(map, "RF64", 4) == 0;
+    if (!rf64 && memcmp(map, "RIFF", 4) != 0)
+        return "Unknown file format, WAV or RF64 expected";
+
+    uint64_t ds64_data_size = 0;
+    bool has_fmt = false;
+    uint16_t format_tag = 0, bits = 0;
+
+    for (size_t pos = 12; pos + 8 <= size; ) {
+        const uint8_t *chunk = map + pos;
+        uint64_t chunk_size = get_le32(chunk + 4);
+
+        if (memcmp(chunk, "ds64", 4) == 0 && chunk_size >= 24 && pos + 8 + 24 <= size) {
+            ds64_data_size = get_le64(chunk + 16);
+        } else if (memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16 && pos + 8 + 16 <= size) {
+            format_tag = get_le16(chunk + 8);
+            player->channels = get_le16(chunk + 10);
+            player->sample_rate = get_le32(chunk + 12);
+            bits = get_le16(chunk + 22);
+            // WAVE_FORMAT_EXTENSIBLE, subformat GUID starts with format tag
+            if (format_tag == 0xFFFE && chunk_size >= 40 && pos + 8 + 40 <= size)
+                format_tag = get_le16(chunk + 32);
+            has_fmt = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!has_fmt) return "WAV file has no format chunk before data";
+            if (rf64 && chunk_size == 0xFFFFFFFF) chunk_size = ds64_data_size;
+            // unfinished recording has no data size
+            // (64-bit size of ds64 is compared without overflow)
+            if (chunk_size == 0 || chunk_size > size - pos - 8) chunk_size = size - pos - 8;
+            player->data = chunk + 8;
+
+            if (format_tag == 1 && bits == 16) player->sample_format = PLAYER_SAMPLE_PCM16;
+            else if (format_tag == 1 && bits == 24) player->sample_format = PLAYER_SAMPLE_PCM24;
+            else if (format_tag == 1 && bits == 32) player->sample_format = PLAYER_SAMPLE_PCM32;
+            else if (format_tag == 3 && bits == 32) player->sample_format = PLAYER_SAMPLE_FLOAT32;
+            else return "Unsupported WAV sample format";
+
+            if (player->channels == 0) return "WAV file has no channels";
+            player->frame_size = player->channels * (bits / 8);
+            player->frames = chunk_size / player->frame_size;
+            return 0;
+        }
+
+        // chunk is out of file, there is no data chunk after it
+        if (chunk_size + (chunk_size & 1) > size - pos - 8) break;
+        pos += 8 + chunk_size + (chunk_size & 1);
+    }
+
+    return "WAV file has no data chunk";
+} // player_parse_wav() }}}2
+
+// file parsing }}}1
+
+// read-ahead thread {{{1
+
+// block of the map locked by read-ahead thread
+typedef struct {
+    uint32_t block;
+    bool published; // RT thread can see it
+    uint32_t stamp; // renders count when it was hidden from RT thread
+} player_lock_t;
+
+/**
+ * Get blocks range of frames range (inclusive)
+ *
+ * @private
+ * @returns {bool} false if range is empty
+ */
+bool player_blocks_range( // {{{2
+    player_t *player,
+    uint64_t from,
+    uint64_t frames,
+    uint32_t *first,
+    uint32_t *last)
+{
+    if (from >= player->frames) return false;
+    uint64_t to = player->frames - from < frames ? player->frames : from + frames;
+    if (from >= to) return false;
+
+    size_t offset = player->data - player->map;
+    *first = (offset + from * player->frame_size) / player->block_size;
+    *last = (offset + to * player->frame_size - 1) / player->block_size;
+    return true;
+} // player_blocks_range() }}}2
+
+inline size_t player_block_bytes(player_t *player, uint32_t block)
+{
+    size_t size = player->map_size - block * player->block_size;
+    return size < player->block_size ? size : player->block_size;
+}
+
+void player_read_ahead_main(void *arg) // {{{2
+{
+    player_t *player = (player_t *)arg;
+
+    // enough for all windows with blocks waiting for RT thread to be unlocked
+    uint32_t window_blocks
+        = (player->read_ahead_frames * player->frame_size) / player->block_size + 2;
+    uint32_t locks_capacity = PLAYER_LOCK_WINDOWS * window_blocks * 2;
+    player_lock_t *locks = new player_lock_t[locks_capacity];
+    uint32_t locks_size = 0;
+
+    for (;;) {
+        uint64_t starts[PLAYER_LOCK_WINDOWS] = {
+            player->position,
+            player->loop_start,
+            player->loop_cue,
+            player->cue
+        };
+        uint32_t first[PLAYER_LOCK_WINDOWS], last[PLAYER_LOCK_WINDOWS];
+        bool active[PLAYER_LOCK_WINDOWS];
+        for (uint32_t w=0; w<PLAYER_LOCK_WINDOWS; w++) {
+            active[w] = (w != 1 || player->loop_end != 0) && player_blocks_range(
+                player, starts[w], player->read_ahead_frames, &first[w], &last[w]);
+        }
+
+        // hide blocks out of windows, unlock them after RT thread is done with them
+        uint32_t renders = player->renders;
+        bool pending = false;
+        for (uint32_t i=locks_size; i-- > 0; ) {
+            player_lock_t *lock = &locks[i];
+            bool wanted = false;
+            for (uint32_t w=0; w<PLAYER_LOCK_WINDOWS && !wanted; w++)
+                wanted = active[w] && lock->block >= first[w] && lock->block <= last[w];
+
+            if (wanted) {
+                if (!lock->published) {
+                    player->block_locked[lock->block] = 1;
+                    lock->published = true;
+                }
+            } else if (lock->published) {
+                player->block_locked[lock->block] = 0;
+                __sync_synchronize();
+                lock->published = false;
+                lock->stamp = player->renders;
+                pending = true;
+            } else if (renders != lock->stamp) {
+                munlock(player->map + lock->block * player->block_size,
+                    player_block_bytes(player, lock->block));
+                locks[i] = locks[--locks_size];
+            } else {
+                pending = true;
+            }
+        }
+        player->unlock_pending = pending;
+
+        for (uint32_t w=0; w<PLAYER_LOCK_WINDOWS; w++) {
+            if (!active[w]) continue;
+            for (uint32_t b=first[w]; b<=last[w]; b++) {
+                if (player->block_locked[b]) continue;
+                bool held = false;
+                for (uint32_t i=0; i<locks_size && !held; i++) held = locks[i].block == b;
+                if (held) continue;
+
+                uint8_t *begin = player->map + b * player->block_size;
+                size_t size = player_block_bytes(player, b);
+                madvise(begin, size, MADV_WILLNEED);
+                if (locks_size == locks_capacity || mlock(begin, size) != 0) {
+                    __sync_fetch_and_add(&player->lock_failures, 1);
+                    continue;
+                }
+                locks[locks_size].block = b;
+                locks[locks_size].published = true;
+                locks_size++;
+                __sync_synchronize();
+                player->block_locked[b] = 1;
+            }
+        }
+
+        uv_sem_wait(&player->wakeup);
+        if (player->stop) break;
+    }
+
+    // map is unmapped after, it unlocks the rest
+    delete [] locks;
+} // player_read_ahead_main() }}}2
+
+// read-ahead thread }}}1
+
+/**
+ * Open and map file, start read-ahead thread
+ *
+ * Read-ahead windows is locked in memory, so RLIMIT_MEMLOCK should allow
+ * few read-ahead sizes for every player (as it usually does for JACK).
+ *
+ * @param {char} path
+ * @param {bool} raw File is interleaved 32-bit float samples without header
+ * @param {uint32_t} raw_channels Channels count of raw file
+ * @param {jack_nframes_t} raw_sample_rate Sample rate of raw file
+ * @param {jack_nframes_t} max_frames Max buffer size of JACK cycle
+ * @param {double} read_ahead_seconds
+ * @param {char} err Error message if player couldn't be created
+ * @returns {player_t} player or 0
+ */
+player_t* player_create( // {{{1
+    const char *path,
+    bool raw,
+    uint32_t raw_channels,
+    jack_nframes_t raw_sample_rate,
+    jack_nframes_t max_frames,
+    double read_ahead_seconds,
+    const char **err)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        *err = "Couldn't open file for playing";
+        return 0;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        *err = "File has no audio data";
+        return 0;
+    }
+
+    void *map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        *err = "Couldn't map file to memory";
+        return 0;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    player_t *player = new player_t();
+    player->fd = fd;
+    player->map = (uint8_t *)map;
+    player->map_size = st.st_size;
+
+    if (raw) {
+        player->data = player->map;
+        player->channels = raw_channels;
+        player->sample_rate = raw_sample_rate;
+        player->sample_format = PLAYER_SAMPLE_FLOAT32;
+        player->frame_size = raw_channels * sizeof(float);
+        player->frames = player->map_size / player->frame_size;
+    } else {
+        *err = player_parse_wav(player);
+        if (*err == 0 && player->frames == 0) *err = "File has no audio data";
+        if (*err) {
+            munmap(map, st.st_size);
+            close(fd);
+            delete player;
+            return 0;
+        }
+    }
+
+    player->ports_count = 0;
+    player->port_names = 0;
+    player->port_bufs = 0;
+    player->mix = false;
+
+    player->commands = jack_ringbuffer_create(
+        PLAYER_COMMANDS_QUEUE_SIZE * sizeof(player_command_t));
+    jack_ringbuffer_mlock(player->commands);
+
+    player->playing = false;
+    player->loop_start = 0;
+    player->loop_end = 0;
+    player->max_frames = max_frames;
+    player->scratch = new jack_default_audio_sample_t[player->channels * max_frames];
+    player->scratch_bufs = new jack_default_audio_sample_t*[player->channels];
+    for (uint32_t i=0; i<player->channels; i++) {
+        player->scratch_bufs[i] = player->scratch + i * max_frames;
+    }
+    player->position = 0;
+    player->is_playing = false;
+    player->ended = 0;
+    player->underrun = false;
+    player->underruns = 0;
+    player->renders = 0;
+
+    player->stop = false;
+    player->cue = 0;
+    player->loop_cue = 0;
+    player->read_ahead_frames = (uint64_t)(read_ahead_seconds * player->sample_rate);
+    if (player->read_ahead_frames < 4 * (uint64_t)max_frames)
+        player->read_ahead_frames = 4 * (uint64_t)max_frames;
+
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    player->block_size = (PLAYER_LOCK_BLOCK_SIZE + page_size - 1) / page_size * page_size;
+    player->blocks = (player->map_size + player->block_size - 1) / player->block_size;
+    player->block_locked = new uint8_t[player->blocks];
+    memset((void *)player->block_locked, 0, player->blocks);
+    player->unlock_pending = false;
+    player->lock_failures = 0;
+
+    uv_sem_init(&player->wakeup, 0);
+    uv_thread_create(&player->thread, player_read_ahead_main, player);
+
+    return player;
+} // player_create() }}}1
+
+/**
+ * Queue command for RT thread (call it from JS thread only)
+ *
+ * @returns {bool} false if commands queue is full
+ */
+bool player_send(player_t *player, player_command_t cmd) // {{{1
+{
+    if (jack_ringbuffer_write_space(player->commands) < sizeof(player_command_t))
+        return false;
+
+    if (cmd.type == PLAYER_CMD_SEEK) player->cue = cmd.position;
+    if (cmd.type == PLAYER_CMD_LOOP) player->loop_cue = cmd.position;
+    jack_ringbuffer_write(player->commands, (const char *)&cmd, sizeof(player_command_t));
+    uv_sem_post(&player->wakeup);
+
+    return true;
+} // player_send() }}}1
+
+// rendering (RT thread) {{{1
+
+void player_apply(player_t *player, player_command_t *cmd) // {{{2
+{
+    switch (cmd->type) {
+    case PLAYER_CMD_START:
+        player->playing = true;
+        break;
+    case PLAYER_CMD_STOP:
+        player->playing = false;
+        break;
+    case PLAYER_CMD_SEEK:
+        player->position = cmd->position < player->frames ? cmd->position : player->frames;
+        break;
+    case PLAYER_CMD_LOOP: {
+        uint64_t loop_end = cmd->loop_end < player->frames ? cmd->loop_end : player->frames;
+        if (loop_end <= cmd->position) {
+            player->loop_end = 0;
+        } else {
+            player->loop_start = cmd->position;
+            player->loop_end = loop_end;
+        }
+        break;
+    }
+    }
+} // player_apply() }}}2
+
+/**
+ * Decode frames at play position to planar scratch buffers
+ *
+ * @private
+ */
+void player_decode(player_t *player, jack_nframes_t n) // {{{2
+{
+    const uint8_t *src = player->data + player->position * player->frame_size;
+    uint32_t channels = player->channels;
+
+    switch (player->sample_format) {
+    case PLAYER_SAMPLE_FLOAT32:
+        dsp_kernels.deinterleave(
+            player->scratch_bufs, (const jack_default_audio_sample_t *)src, channels, n);
+        break;
+    case PLAYER_SAMPLE_PCM16:
+        for (uint32_t c=0; c<channels; c++) {
+            const uint8_t *in = src + c * 2;
+            jack_default_audio_sample_t *out = player->scratch_bufs[c];
+            for (jack_nframes_t i=0; i<n; i++, in += player->frame_size)
+                out[i] = (int16_t)get_le16(in) * (1.0f / 32768);
+        }
+        break;
+    case PLAYER_SAMPLE_PCM24:
+        for (uint32_t c=0; c<channels; c++) {
+            const uint8_t *in = src + c * 3;
+            jack_default_audio_sample_t *out = player->scratch_bufs[c];
+            for (jack_nframes_t i=0; i<n; i++, in += player->frame_size) {
+                int32_t sample = (int32_t)(((uint32_t)in[0] << 8)
+                    | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 24)) >> 8;
+                out[i] = sample * (1.0f / 8388608);
+            }
+        }
+        break;
+    case PLAYER_SAMPLE_PCM32:
+        for (uint32_t c=0; c<channels; c++) {
+            const uint8_t *in = src + c * 4;
+            jack_default_audio_sample_t *out = player->scratch_bufs[c];
+            for (jack_nframes_t i=0; i<n; i++, in += player->frame_size)
+                out[i] = (int32_t)get_le32(in) * (1.0f / 2147483648.0f);
+        }
+        break;
+    }
+} // player_decode() }}}2
+
+/**
+ * Check that frames at play position is locked in memory
+ *
+ * @private
+ */
+bool player_resident(player_t *player, jack_nframes_t n) // {{{2
+{
+    uint32_t first, last;
+    if (!player_blocks_range(player, player->position, n, &first, &last)) return false;
+
+    for (uint32_t b=first; b<=last; b++) {
+        if (!player->block_locked[b]) return false;
+    }
+    __sync_synchronize();
+    return true;
+} // player_resident() }}}2
+
+/**
+ * Render part of cycle without commands inside
+ *
+ * @private
+ */
+void player_render_segment( // {{{2
+    player_t *player,
+    jack_default_audio_sample_t **port_bufs,
+    jack_nframes_t offset,
+    jack_nframes_t n)
+{
+    while (n > 0) {
+        jack_nframes_t chunk = n < player->max_frames ? n : player->max_frames;
+
+        if (player->playing) {
+            uint64_t end = player->loop_end ? player->loop_end : player->frames;
+            if (player->position >= end) {
+                if (player->loop_end) {
+                    player->position = player->loop_start;
+                } else {
+                    player->playing = false;
+                    __sync_fetch_and_add(&player->ended, 1);
+                }
+                continue;
+            }
+            if (end - player->position < chunk) chunk = end - player->position;
+
+            if (player_resident(player, chunk)) {
+                player_decode(player, chunk);
+                for (uint32_t p=0; p<player->ports_count; p++) {
+                    jack_default_audio_sample_t *out = port_bufs[p];
+                    if (out == 0) continue;
+                    // less channels than ports, repeat them (mono to stereo)
+                    jack_default_audio_sample_t *in = player->scratch_bufs[p % player->channels];
+                    if (player->mix) dsp_kernels.mix(out + offset, in, chunk);
+                    else dsp_kernels.copy(out + offset, in, chunk);
+                }
+            } else {
+                // not read yet, keep time going with silence
+                player->underrun = true;
+                if (!player->mix) {
+                    for (uint32_t p=0; p<player->ports_count; p++) {
+                        if (port_bufs[p] == 0) continue;
+                        memset(port_bufs[p] + offset, 0, chunk * sizeof(jack_default_audio_sample_t));
+                    }
+                }
+            }
+            player->position += chunk;
+        } else if (!player->mix) {
+            for (uint32_t p=0; p<player->ports_count; p++) {
+                if (port_bufs[p] == 0) continue;
+                memset(port_bufs[p] + offset, 0, chunk * sizeof(jack_default_audio_sample_t));
+            }
+        }
+
+        offset += chunk;
+        n -= chunk;
+    }
+} // player_render_segment() }}}2
+
+/**
+ * Render one cycle to own output ports buffers (call it from RT thread only)
+ *
+ * @param {player_t} player
+ * @param {jack_default_audio_sample_t} port_bufs Buffers of player ports, 0 to skip
+ * @param {jack_nframes_t} cycle_start JACK frame time of first frame of the cycle
+ * @param {jack_nframes_t} nframes
+ */
+void player_render( // {{{2
+    player_t *player,
+    jack_default_audio_sample_t **port_bufs,
+    jack_nframes_t cycle_start,
+    jack_nframes_t nframes)
+{
+    jack_nframes_t offset = 0;
+
+    while (offset < nframes) {
+        jack_nframes_t segment_end = nframes;
+
+        player_command_t cmd;
+        if (jack_ringbuffer_peek(player->commands, (char *)&cmd, sizeof(cmd)) == sizeof(cmd)) {
+            // frame time wraps around, so compare difference
+            int32_t delta = (int32_t)(cmd.at - (cycle_start + offset));
+            if (cmd.now || delta <= 0) {
+                player_apply(player, &cmd);
+                jack_ringbuffer_read_advance(player->commands, sizeof(cmd));
+                continue;
+            }
+            if ((uint32_t)delta < nframes - offset) segment_end = offset + delta;
+        }
+
+        player_render_segment(player, port_bufs, offset, segment_end - offset);
+        offset = segment_end;
+    }
+
+    if (player->underrun) {
+        __sync_fetch_and_add(&player->underruns, 1);
+        player->underrun = false;
+    }
+    player->is_playing = player->playing;
+    __sync_synchronize();
+    player->renders++;
+    if (player->playing || player->unlock_pending) uv_sem_post(&player->wakeup);
+} // player_render() }}}2
+
+// rendering }}}1
+
+/**
+ * Stop read-ahead thread, unmap file and free player
+ *
+ * Player must be removed from RT thread before.
+ */
+void player_destroy(player_t *player) // {{{1
+{
+    player->stop = true;
+    uv_sem_post(&player->wakeup);
+    uv_thread_join(&player->thread);
+    uv_sem_destroy(&player->wakeup);
+
+    munmap(player->map, player->map_size);
+    close(player->fd);
+
+    jack_ringbuffer_free(player->commands);
+    for (uint32_t i=0; i<player->ports_count; i++) delete [] player->port_names[i];
+    delete [] player->port_names;
+    delete [] player->port_bufs;
+    delete [] player->scratch;
+    delete [] player->scratch_bufs;
+    delete [] player->block_locked;
+    delete player;
+} // player_destroy() }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
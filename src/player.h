@@ -0,0 +1,109 @@
+/**
+ * JACK Connector
+ * Memory-mapped file player feeding own output ports from JACK realtime thread
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef PLAYER_H
+#define PLAYER_H
+
+#include <jack/jack.h>
+#include <jack/ringbuffer.h>
+#include <stdint.h>
+#include <uv.h>
+
+typedef enum {
+    PLAYER_SAMPLE_PCM16 = 0,
+    PLAYER_SAMPLE_PCM24,
+    PLAYER_SAMPLE_PCM32,
+    PLAYER_SAMPLE_FLOAT32
+} player_sample_format_t;
+
+typedef enum {
+    PLAYER_CMD_START = 0,
+    PLAYER_CMD_STOP,
+    PLAYER_CMD_SEEK,
+    PLAYER_CMD_LOOP
+} player_command_type_t;
+
+// command from JS thread, applied by RT thread at exact frame
+typedef struct {
+    player_command_type_t type;
+    jack_nframes_t at; // JACK frame time, applied as soon as possible if "now" is set
+    bool now;
+    uint64_t position; // SEEK: frame, LOOP: loop start
+    uint64_t loop_end; // LOOP: loop end frame (0 to disable looping)
+} player_command_t;
+
+typedef struct {
+    // file (read only after creation)
+    int fd;
+    uint8_t *map;
+    size_t map_size;
+    const uint8_t *data; // first frame inside of map
+    uint64_t frames;
+    uint32_t channels;
+    uint32_t frame_size; // bytes
+    player_sample_format_t sample_format;
+    jack_nframes_t sample_rate;
+
+    // set by owner (JS thread), RT thread gets ports resolved by names
+    uint32_t ports_count;
+    char **port_names; // own output ports short names
+    jack_default_audio_sample_t **port_bufs; // storage for RT thread
+    bool mix; // add to port buffers instead of overwriting them
+
+    jack_ringbuffer_t *commands;
+
+    // RT thread state
+    bool playing;
+    volatile uint64_t loop_start;
+    volatile uint64_t loop_end; // 0 if looping is disabled
+    jack_default_audio_sample_t *scratch; // planar, channels * max_frames
+    jack_default_audio_sample_t **scratch_bufs;
+    jack_nframes_t max_frames;
+    volatile uint64_t position;
+    volatile bool is_playing;
+    volatile uint32_t ended; // count of reaching end of file
+    bool underrun; // in current cycle
+    volatile uint32_t underruns; // cycles with frames that wasn't locked in memory
+    volatile uint32_t renders; // count of rendered cycles
+
+    // read-ahead thread locks blocks of the map, RT thread decodes locked blocks only
+    uv_thread_t thread;
+    uv_sem_t wakeup;
+    volatile bool stop;
+    volatile uint64_t cue; // position JS is going to seek to
+    volatile uint64_t loop_cue; // loop start JS has set
+    uint64_t read_ahead_frames;
+    size_t block_size; // bytes, multiple of page size
+    uint32_t blocks;
+    volatile uint8_t *block_locked; // per block of the map, set by read-ahead thread
+    volatile bool unlock_pending; // RT thread should wake read-ahead thread
+    volatile uint32_t lock_failures;
+} player_t;
+
+player_t* player_create(
+    const char *path,
+    bool raw,
+    uint32_t raw_channels,
+    jack_nframes_t raw_sample_rate,
+    jack_nframes_t max_frames,
+    double read_ahead_seconds,
+    const char **err);
+bool player_send(player_t *player, player_command_t cmd);
+void player_render(
+    player_t *player,
+    jack_default_audio_sample_t **port_bufs,
+    jack_nframes_t cycle_start,
+    jack_nframes_t nframes);
+void player_destroy(player_t *player);
+
+// finds format and data of WAV/RF64 in "map" of "map_size", returns error or 0
+const char* player_parse_wav(player_t *player);
+
+#endif // PLAYER_H
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,436 @@
+/**
+ * JACK Connector
+ * Cached mirror of JACK ports graph, kept in sync by JACK notifications
+ *
+ * JACK notification thread only appends small events to the log under lock
+ * (it must not wait for server requests), the mirror itself is touched
+ * by JS thread only: pending events is applied right before every query.
+ * Full snapshot is taken on activation (notifications is delivered to
+ * active clients only) or when log is overflowed.
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "port_graph.h"
+#include <string.h>
+#include <uv.h>
+
+#define PORT_GRAPH_MAX_EVENTS 4096
+
+// notifications (JACK thread) {{{1
+
+static void push_event(port_graph_t *graph, port_graph_event_type_t type, jack_port_id_t a, jack_port_id_t b) // {{{2
+{
+    uv_mutex_lock(&graph->events_lock);
+    if (graph->events_count < PORT_GRAPH_MAX_EVENTS) {
+        graph->events[graph->events_count].type = type;
+        graph->events[graph->events_count].a = a;
+        graph->events[graph->events_count].b = b;
+        graph->events_count++;
+    } else {
+        graph->events_overflow = true;
+    }
+    uv_mutex_unlock(&graph->events_lock);
+    __sync_fetch_and_add(&graph->version, 1);
+} // push_event() }}}2
+
+void port_graph_on_registration(port_graph_t *graph, jack_port_id_t id, bool registered)
+{
+    push_event(graph, registered ? PORT_GRAPH_REGISTER : PORT_GRAPH_UNREGISTER, id, 0);
+}
+
+void port_graph_on_rename(port_graph_t *graph, jack_port_id_t id)
+{
+    push_event(graph, PORT_GRAPH_RENAME, id, 0);
+}
+
+void port_graph_on_connect(port_graph_t *graph, jack_port_id_t a, jack_port_id_t b, bool connected)
+{
+    push_event(graph, connected ? PORT_GRAPH_CONNECT : PORT_GRAPH_DISCONNECT, a, b);
+}
+
+void port_graph_on_graph_order(port_graph_t *graph)
+{
+    __sync_fetch_and_add(&graph->version, 1);
+}
+
+// notifications }}}1
+
+// hash tables {{{1
+
+static inline uint32_t hash_name(const char *name) // {{{2
+{
+    uint32_t hash = 2166136261u;
+    for (uint32_t i=0; name[i] != '\0'; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+} // hash_name() }}}2
+
+static inline uint32_t hash_port(jack_port_t *port) // {{{2
+{
+    uint64_t x = (uint64_t)(uintptr_t)port;
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return (uint32_t)x;
+} // hash_port() }}}2
+
+static void slots_insert(port_graph_t *graph, int32_t *slots, uint32_t hash, uint32_t index) // {{{2
+{
+    uint32_t slot = hash & graph->slots_mask;
+    while (slots[slot] >= 0) slot = (slot + 1) & graph->slots_mask;
+    slots[slot] = index;
+} // slots_insert() }}}2
+
+static void slots_remove(port_graph_t *graph, int32_t *slots, uint32_t hash, uint32_t index) // {{{2
+{
+    for (uint32_t slot = hash & graph->slots_mask; slots[slot] != -1; slot = (slot + 1) & graph->slots_mask) {
+        if (slots[slot] == (int32_t)index) {
+            slots[slot] = -2;
+            return;
+        }
+    }
+} // slots_remove() }}}2
+
+/**
+ * Compact entries and rebuild both hash tables
+ *
+ * Load factor (with removed slots) is kept not more than 1/2.
+ *
+ * @private
+ */
+static void rebuild_slots(port_graph_t *graph, uint32_t reserve) // {{{2
+{
+    uint32_t n = 0;
+    for (uint32_t i=0; i<graph->entries_size; i++) {
+        if (graph->entries[i].port == 0) continue;
+        if (n != i) graph->entries[n] = graph->entries[i];
+        n++;
+    }
+    graph->entries_size = n;
+
+    uint32_t slots_count = 64;
+    while (slots_count < (n + reserve) * 2) slots_count <<= 1;
+
+    delete [] graph->name_slots;
+    delete [] graph->port_slots;
+    graph->name_slots = new int32_t[slots_count];
+    graph->port_slots = new int32_t[slots_count];
+    graph->slots_mask = slots_count - 1;
+    graph->slots_removed = 0;
+    for (uint32_t i=0; i<slots_count; i++) {
+        graph->name_slots[i] = -1;
+        graph->port_slots[i] = -1;
+    }
+
+    for (uint32_t i=0; i<graph->entries_size; i++) {
+        slots_insert(graph, graph->name_slots, hash_name(graph->entries[i].name), i);
+        slots_insert(graph, graph->port_slots, hash_port(graph->entries[i].port), i);
+    }
+} // rebuild_slots() }}}2
+
+// hash tables }}}1
+
+// mirror {{{1
+
+static char* copy_name(const char *name)
+{
+    size_t len = strlen(name);
+    char *copy = new char[len + 1];
+    memcpy(copy, name, len + 1);
+    return copy;
+}
+
+static void add_entry(port_graph_t *graph, jack_port_t *port) // {{{2
+{
+    if (port == 0 || port_graph_find_port(graph, port) != -1) return;
+
+    if ((graph->entries_live + graph->slots_removed + 1) * 2 > graph->slots_mask + 1) rebuild_slots(graph, 1);
+
+    if (graph->entries_size == graph->entries_capacity) {
+        uint32_t capacity = graph->entries_capacity ? graph->entries_capacity * 2 : 64;
+        port_graph_entry_t *grown = new port_graph_entry_t[capacity];
+        if (graph->entries_size > 0) memcpy(grown, graph->entries, graph->entries_size * sizeof(port_graph_entry_t));
+        delete [] graph->entries;
+        graph->entries = grown;
+        graph->entries_capacity = capacity;
+    }
+
+    port_graph_entry_t *entry = &graph->entries[graph->entries_size];
+    entry->port = port;
+    entry->name = copy_name(jack_port_name(port));
+    entry->flags = jack_port_flags(port);
+    entry->own = jack_port_is_mine(graph->client, port);
+    entry->connections = 0;
+    entry->connections_count = 0;
+    entry->connections_capacity = 0;
+
+    slots_insert(graph, graph->name_slots, hash_name(entry->name), graph->entries_size);
+    slots_insert(graph, graph->port_slots, hash_port(port), graph->entries_size);
+    graph->entries_size++;
+    graph->entries_live++;
+} // add_entry() }}}2
+
+static void link_port(port_graph_entry_t *entry, jack_port_t *other) // {{{2
+{
+    for (uint32_t i=0; i<entry->connections_count; i++) {
+        if (entry->connections[i] == other) return;
+    }
+
+    if (entry->connections_count == entry->connections_capacity) {
+        uint32_t capacity = entry->connections_capacity ? entry->connections_capacity * 2 : 4;
+        jack_port_t **grown = new jack_port_t*[capacity];
+        for (uint32_t i=0; i<entry->connections_count; i++) grown[i] = entry->connections[i];
+        delete [] entry->connections;
+        entry->connections = grown;
+        entry->connections_capacity = capacity;
+    }
+
+    entry->connections[entry->connections_count++] = other;
+} // link_port() }}}2
+
+static void unlink_port(port_graph_entry_t *entry, jack_port_t *other) // {{{2
+{
+    for (uint32_t i=0; i<entry->connections_count; i++) {
+        if (entry->connections[i] == other) {
+            entry->connections[i] = entry->connections[--entry->connections_count];
+            return;
+        }
+    }
+} // unlink_port() }}}2
+
+static void remove_entry(port_graph_t *graph, int32_t index) // {{{2
+{
+    if (index < 0) return;
+    port_graph_entry_t *entry = &graph->entries[index];
+
+    for (uint32_t i=0; i<entry->connections_count; i++) {
+        int32_t other = port_graph_find_port(graph, entry->connections[i]);
+        if (other != -1) unlink_port(&graph->entries[other], entry->port);
+    }
+
+    slots_remove(graph, graph->name_slots, hash_name(entry->name), index);
+    slots_remove(graph, graph->port_slots, hash_port(entry->port), index);
+    graph->slots_removed++;
+    graph->entries_live--;
+
+    delete [] entry->name;
+    delete [] entry->connections;
+    entry->port = 0;
+    entry->name = 0;
+    entry->connections = 0;
+    entry->connections_count = 0;
+    entry->connections_capacity = 0;
+} // remove_entry() }}}2
+
+static void rename_entry(port_graph_t *graph, int32_t index) // {{{2
+{
+    if (index < 0) return;
+    port_graph_entry_t *entry = &graph->entries[index];
+
+    slots_remove(graph, graph->name_slots, hash_name(entry->name), index);
+    graph->slots_removed++;
+    delete [] entry->name;
+    entry->name = copy_name(jack_port_name(entry->port));
+    slots_insert(graph, graph->name_slots, hash_name(entry->name), index);
+
+    if ((graph->entries_live + graph->slots_removed) * 2 > graph->slots_mask + 1) rebuild_slots(graph, 0);
+} // rename_entry() }}}2
+
+static void set_connection(port_graph_t *graph, jack_port_id_t a, jack_port_id_t b, bool connect) // {{{2
+{
+    jack_port_t *port_a = jack_port_by_id(graph->client, a);
+    jack_port_t *port_b = jack_port_by_id(graph->client, b);
+    int32_t index_a = port_graph_find_port(graph, port_a);
+    int32_t index_b = port_graph_find_port(graph, port_b);
+    if (index_a == -1 || index_b == -1) return;
+
+    if (connect) {
+        link_port(&graph->entries[index_a], port_b);
+        link_port(&graph->entries[index_b], port_a);
+    } else {
+        unlink_port(&graph->entries[index_a], port_b);
+        unlink_port(&graph->entries[index_b], port_a);
+    }
+} // set_connection() }}}2
+
+static void free_entries(port_graph_t *graph) // {{{2
+{
+    for (uint32_t i=0; i<graph->entries_size; i++) {
+        delete [] graph->entries[i].name;
+        delete [] graph->entries[i].connections;
+    }
+    delete [] graph->entries;
+    delete [] graph->name_slots;
+    delete [] graph->port_slots;
+    graph->entries = 0;
+    graph->entries_size = 0;
+    graph->entries_capacity = 0;
+    graph->entries_live = 0;
+    graph->name_slots = 0;
+    graph->port_slots = 0;
+    graph->slots_mask = 0;
+    graph->slots_removed = 0;
+} // free_entries() }}}2
+
+// mirror }}}1
+
+void port_graph_init(port_graph_t *graph) // {{{1
+{
+    uv_mutex_init(&graph->events_lock);
+    graph->events = new port_graph_event_t[PORT_GRAPH_MAX_EVENTS];
+    graph->applying = new port_graph_event_t[PORT_GRAPH_MAX_EVENTS];
+} // port_graph_init() }}}1
+
+void port_graph_destroy(port_graph_t *graph) // {{{1
+{
+    free_entries(graph);
+    delete [] graph->events;
+    delete [] graph->applying;
+    graph->events = 0;
+    graph->applying = 0;
+    uv_mutex_destroy(&graph->events_lock);
+} // port_graph_destroy() }}}1
+
+void port_graph_set_client(port_graph_t *graph, jack_client_t *client) // {{{1
+{
+    graph->client = client;
+} // port_graph_set_client() }}}1
+
+/**
+ * Take full snapshot of ports and connections
+ *
+ * Log is cleared before snapshot and applied after it, so notifications
+ * delivered while snapshot is taken is not lost (applying is idempotent).
+ *
+ * @returns {bool} success
+ */
+bool port_graph_sync(port_graph_t *graph) // {{{1
+{
+    uv_mutex_lock(&graph->events_lock);
+    graph->events_count = 0;
+    graph->events_overflow = false;
+    uv_mutex_unlock(&graph->events_lock);
+
+    free_entries(graph);
+    graph->synced = false;
+    rebuild_slots(graph, 0);
+
+    const char **names = jack_get_ports(graph->client, NULL, NULL, 0);
+    if (names == 0) return false;
+    for (uint32_t i=0; names[i]; i++) {
+        add_entry(graph, jack_port_by_name(graph->client, names[i]));
+    }
+    jack_free(names);
+
+    for (uint32_t i=0; i<graph->entries_size; i++) {
+        if (!(graph->entries[i].flags & JackPortIsOutput)) continue;
+        const char **connections = jack_port_get_all_connections(graph->client, graph->entries[i].port);
+        if (connections == 0) continue;
+        for (uint32_t n=0; connections[n]; n++) {
+            int32_t other = port_graph_find(graph, connections[n]);
+            if (other == -1) continue;
+            link_port(&graph->entries[i], graph->entries[other].port);
+            link_port(&graph->entries[other], graph->entries[i].port);
+        }
+        jack_free(connections);
+    }
+
+    graph->synced = true;
+    __sync_fetch_and_add(&graph->version, 1);
+    return port_graph_update(graph);
+} // port_graph_sync() }}}1
+
+void port_graph_reset(port_graph_t *graph) // {{{1
+{
+    graph->synced = false;
+    free_entries(graph);
+
+    uv_mutex_lock(&graph->events_lock);
+    graph->events_count = 0;
+    graph->events_overflow = false;
+    uv_mutex_unlock(&graph->events_lock);
+} // port_graph_reset() }}}1
+
+bool port_graph_update(port_graph_t *graph) // {{{1
+{
+    if (!graph->synced) return false;
+
+    for (;;) {
+        uv_mutex_lock(&graph->events_lock);
+        if (graph->events_overflow) {
+            uv_mutex_unlock(&graph->events_lock);
+            return port_graph_sync(graph);
+        }
+        // swap logs, so notification thread doesn't wait for applying
+        port_graph_event_t *pending = graph->events;
+        uint32_t count = graph->events_count;
+        graph->events = graph->applying;
+        graph->events_count = 0;
+        graph->applying = pending;
+        uv_mutex_unlock(&graph->events_lock);
+
+        if (count == 0) return true;
+
+        for (uint32_t i=0; i<count; i++) {
+            switch (pending[i].type) {
+                case PORT_GRAPH_REGISTER:
+                    add_entry(graph, jack_port_by_id(graph->client, pending[i].a));
+                    break;
+                case PORT_GRAPH_UNREGISTER:
+                    remove_entry(graph, port_graph_find_port(graph, jack_port_by_id(graph->client, pending[i].a)));
+                    break;
+                case PORT_GRAPH_RENAME:
+                    rename_entry(graph, port_graph_find_port(graph, jack_port_by_id(graph->client, pending[i].a)));
+                    break;
+                case PORT_GRAPH_CONNECT:
+                case PORT_GRAPH_DISCONNECT:
+                    set_connection(graph, pending[i].a, pending[i].b,
+                        pending[i].type == PORT_GRAPH_CONNECT);
+                    break;
+            }
+        }
+    }
+} // port_graph_update() }}}1
+
+int32_t port_graph_find(port_graph_t *graph, const char *name) // {{{1
+{
+    if (graph->name_slots == 0) return -1;
+    for (uint32_t slot = hash_name(name) & graph->slots_mask; graph->name_slots[slot] != -1;
+         slot = (slot + 1) & graph->slots_mask) {
+        int32_t index = graph->name_slots[slot];
+        if (index >= 0 && strcmp(graph->entries[index].name, name) == 0) return index;
+    }
+    return -1;
+} // port_graph_find() }}}1
+
+int32_t port_graph_find_port(port_graph_t *graph, jack_port_t *port) // {{{1
+{
+    if (port == 0 || graph->port_slots == 0) return -1;
+    for (uint32_t slot = hash_port(port) & graph->slots_mask; graph->port_slots[slot] != -1;
+         slot = (slot + 1) & graph->slots_mask) {
+        int32_t index = graph->port_slots[slot];
+        if (index >= 0 && graph->entries[index].port == port) return index;
+    }
+    return -1;
+} // port_graph_find_port() }}}1
+
+port_graph_entry_t* port_graph_entry(port_graph_t *graph, uint32_t index) // {{{1
+{
+    return &graph->entries[index];
+} // port_graph_entry() }}}1
+
+uint32_t port_graph_size(port_graph_t *graph) // {{{1
+{
+    return graph->entries_size;
+} // port_graph_size() }}}1
+
+uint32_t port_graph_version(port_graph_t *graph) // {{{1
+{
+    return graph->version;
+} // port_graph_version() }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
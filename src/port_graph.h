@@ -0,0 +1,89 @@
+/**
+ * JACK Connector
+ * Cached mirror of JACK ports graph, kept in sync by JACK notifications
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef PORT_GRAPH_H
+#define PORT_GRAPH_H
+
+#include <jack/jack.h>
+#include <stdint.h>
+#include <uv.h>
+
+typedef struct {
+    jack_port_t *port; // 0 for removed entry
+    char *name;
+    unsigned long flags;
+    bool own;
+    jack_port_t **connections;
+    uint32_t connections_count;
+    uint32_t connections_capacity;
+} port_graph_entry_t;
+
+typedef enum {
+    PORT_GRAPH_REGISTER = 0,
+    PORT_GRAPH_UNREGISTER,
+    PORT_GRAPH_RENAME,
+    PORT_GRAPH_CONNECT,
+    PORT_GRAPH_DISCONNECT
+} port_graph_event_type_t;
+
+typedef struct {
+    port_graph_event_type_t type;
+    jack_port_id_t a;
+    jack_port_id_t b;
+} port_graph_event_t;
+
+typedef struct {
+    jack_client_t *client;
+    bool synced;
+
+    // events log, shared with JACK notification thread
+    uv_mutex_t events_lock;
+    port_graph_event_t *events;
+    port_graph_event_t *applying; // JS thread applies it while "events" is filled
+    uint32_t events_count;
+    bool events_overflow;
+    volatile uint32_t version;
+
+    // mirror (JS thread only)
+    port_graph_entry_t *entries;
+    uint32_t entries_size;
+    uint32_t entries_capacity;
+    uint32_t entries_live;
+
+    // open-addressing hash tables, slot is index of entry, -1 empty, -2 removed
+    int32_t *name_slots;
+    int32_t *port_slots;
+    uint32_t slots_mask;
+    uint32_t slots_removed;
+} port_graph_t;
+
+void port_graph_init(port_graph_t *graph); // graph must be zeroed
+void port_graph_destroy(port_graph_t *graph);
+void port_graph_set_client(port_graph_t *graph, jack_client_t *client);
+
+// JACK notification thread, called by JACK callbacks of client
+void port_graph_on_registration(port_graph_t *graph, jack_port_id_t id, bool registered);
+void port_graph_on_rename(port_graph_t *graph, jack_port_id_t id);
+void port_graph_on_connect(port_graph_t *graph, jack_port_id_t a, jack_port_id_t b, bool connected);
+void port_graph_on_graph_order(port_graph_t *graph);
+
+bool port_graph_sync(port_graph_t *graph); // full snapshot, after activation
+void port_graph_reset(port_graph_t *graph); // drop snapshot (client is deactivated or closed)
+
+// JS thread only, apply pending notifications, false if there is no snapshot
+bool port_graph_update(port_graph_t *graph);
+
+int32_t port_graph_find(port_graph_t *graph, const char *name);
+int32_t port_graph_find_port(port_graph_t *graph, jack_port_t *port);
+port_graph_entry_t* port_graph_entry(port_graph_t *graph, uint32_t index);
+uint32_t port_graph_size(port_graph_t *graph); // count of entries including removed
+uint32_t port_graph_version(port_graph_t *graph); // incremented by every graph change
+
+#endif // PORT_GRAPH_H
+
+// vim:set ts=4 sts=4 sw=4 et:
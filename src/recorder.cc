@@ -0,0 +1,326 @@
+/**
+ * JACK Connector
+ * Streaming recorder, RT thread pushes frames to ring, disk thread writes them
+ *
+ * RT thread only interleaves own input ports buffers to lock-free ring and
+ * wakes disk thread, it never touches file. Disk thread collects frames to
+ * large batches and writes them sequentially, header is finalized on finish.
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "recorder.h"
+#include "dsp_kernels.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RECORDER_HEADER_SIZE 92
+#define RECORDER_WRITE_BATCH_SIZE (1 << 20)
+#define RECORDER_WAV_MAX_RIFF_SIZE 0xFFFFFFFFULL
+
+// WAV/RF64 header {{{1
+
+inline void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF;
+}
+inline void put_le32(uint8_t *p, uint32_t v)
+{
+    put_le16(p, v & 0xFFFF); put_le16(p + 2, v >> 16);
+}
+inline void put_le64(uint8_t *p, uint64_t v)
+{
+    put_le32(p, v & 0xFFFFFFFF); put_le32(p + 4, v >> 32);
+}
+
+/**
+ * Build header of 32-bit float WAV or RF64 file
+ *
+ * WAV header has "JUNK" chunk of the same size as "ds64" chunk of RF64, so
+ * it can be turned into RF64 in place when data exceeds 4 GiB
+ * (see EBU Tech 3306).
+ *
+ * @private
+ */
+void recorder_build_header( // {{{2
+    uint8_t *h,
+    recorder_t *rec,
+    bool rf64,
+    uint64_t data_bytes,
+    uint64_t frames)
+{
+    uint32_t block_align = rec->channels * sizeof(jack_default_audio_sample_t);
+    uint64_t riff_size = RECORDER_HEADER_SIZE - 8 + data_bytes;
+
+    memset(h, 0, RECORDER_HEADER_SIZE);
+
+    memcpy(h, rf64 ? "RF64" : "RIFF", 4);
+    put_le32(h + 4, rf64 ? 0xFFFFFFFF : (uint32_t)riff_size);
+    memcpy(h + 8, "WAVE", 4);
+
+    memcpy(h + 12, rf64 ? "ds64" : "JUNK", 4);
+    put_le32(h + 16, 28);
+    if (rf64) {
+        put_le64(h + 20, riff_size);
+        put_le64(h + 28, data_bytes);
+        put_le64(h + 36, frames);
+        put_le32(h + 44, 0); // table length
+    }
+
+    memcpy(h + 48, "fmt ", 4);
+    put_le32(h + 52, 16);
+    put_le16(h + 56, 3); // WAVE_FORMAT_IEEE_FLOAT
+    put_le16(h + 58, rec->channels);
+    put_le32(h + 60, rec->sample_rate);
+    put_le32(h + 64, rec->sample_rate * block_align);
+    put_le16(h + 68, block_align);
+    put_le16(h + 70, sizeof(jack_default_audio_sample_t) * 8);
+
+    memcpy(h + 72, "fact", 4);
+    put_le32(h + 76, 4);
+    put_le32(h + 80, rf64 ? 0xFFFFFFFF : (uint32_t)frames);
+
+    memcpy(h + 84, "data", 4);
+    put_le32(h + 88, rf64 ? 0xFFFFFFFF : (uint32_t)data_bytes);
+} // recorder_build_header() }}}2
+
+// WAV/RF64 header }}}1
+
+// disk thread {{{1
+
+/**
+ * Write whole buffer to file
+ *
+ * @private
+ * @returns {int} 0 or errno
+ */
+int recorder_write_all(int fd, const char *buf, size_t size) // {{{2
+{
+    while (size > 0) {
+        ssize_t written = write(fd, buf, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return errno;
+        }
+        buf += written;
+        size -= written;
+    }
+    return 0;
+} // recorder_write_all() }}}2
+
+/**
+ * Write collected frames to file
+ *
+ * @private
+ * @param {recorder_t} rec
+ * @param {bool} final Write everything, even if it's less than one batch
+ */
+void recorder_drain(recorder_t *rec, bool final) // {{{2
+{
+    size_t frame_size = rec->channels * sizeof(jack_default_audio_sample_t);
+
+    for (;;) {
+        size_t available = jack_ringbuffer_read_space(rec->ring);
+        if (available < rec->write_buf_size && !(final && available >= frame_size))
+            return;
+
+        size_t size = available < rec->write_buf_size ? available : rec->write_buf_size;
+        size -= size % frame_size;
+        jack_ringbuffer_read(rec->ring, rec->write_buf, size);
+
+        // keep draining after error, RT thread shouldn't see overruns because of it
+        if (rec->disk_error) continue;
+
+        int err = recorder_write_all(rec->fd, rec->write_buf, size);
+        if (err) {
+            rec->disk_error = err;
+            continue;
+        }
+        rec->bytes_written += size;
+        rec->frames_written += size / frame_size;
+    }
+} // recorder_drain() }}}2
+
+void recorder_disk_main(void *arg) // {{{2
+{
+    recorder_t *rec = (recorder_t *)arg;
+
+    for (;;) {
+        uv_sem_wait(&rec->wakeup);
+        if (rec->stop) break;
+        recorder_drain(rec, false);
+    }
+
+    recorder_drain(rec, true);
+} // recorder_disk_main() }}}2
+
+// disk thread }}}1
+
+/**
+ * Open file and start disk thread
+ *
+ * @param {char} path
+ * @param {recorder_format_t} format
+ * @param {uint32_t} channels
+ * @param {jack_nframes_t} sample_rate
+ * @param {jack_nframes_t} max_frames Max buffer size of JACK cycle
+ * @param {double} buffer_seconds Ring size in seconds of audio
+ * @param {char} err Error message if recorder couldn't be created
+ * @returns {recorder_t} recorder or 0
+ */
+recorder_t* recorder_create( // {{{1
+    const char *path,
+    recorder_format_t format,
+    uint32_t channels,
+    jack_nframes_t sample_rate,
+    jack_nframes_t max_frames,
+    double buffer_seconds,
+    const char **err)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        *err = "Couldn't open file for recording";
+        return 0;
+    }
+
+    recorder_t *rec = new recorder_t();
+    rec->format = format;
+    rec->fd = fd;
+    rec->channels = channels;
+    rec->sample_rate = sample_rate;
+    rec->port_names = new char*[channels];
+    for (uint32_t i=0; i<channels; i++) rec->port_names[i] = 0;
+
+    if (format != RECORDER_FORMAT_RAW) {
+        uint8_t header[RECORDER_HEADER_SIZE];
+        recorder_build_header(header, rec, format == RECORDER_FORMAT_RF64, 0, 0);
+        if (recorder_write_all(fd, (const char *)header, RECORDER_HEADER_SIZE) != 0) {
+            close(fd);
+            delete [] rec->port_names;
+            delete rec;
+            *err = "Couldn't write header of recording file";
+            return 0;
+        }
+    }
+
+    size_t frame_size = channels * sizeof(jack_default_audio_sample_t);
+    size_t ring_size = (size_t)(buffer_seconds * sample_rate) * frame_size;
+    size_t min_ring_size = 4 * (size_t)max_frames * frame_size + RECORDER_WRITE_BATCH_SIZE;
+    if (ring_size < min_ring_size) ring_size = min_ring_size;
+    rec->ring = jack_ringbuffer_create(ring_size);
+    jack_ringbuffer_mlock(rec->ring);
+
+    rec->max_frames = max_frames;
+    rec->frame_buf = new jack_default_audio_sample_t[max_frames * channels];
+    rec->channel_bufs = new jack_default_audio_sample_t*[channels];
+    rec->silence = new jack_default_audio_sample_t[max_frames];
+    memset(rec->silence, 0, max_frames * sizeof(jack_default_audio_sample_t));
+    rec->overruns = 0;
+
+    rec->write_buf_size = RECORDER_WRITE_BATCH_SIZE - RECORDER_WRITE_BATCH_SIZE % frame_size;
+    if (rec->write_buf_size == 0) rec->write_buf_size = frame_size;
+    rec->write_buf = new char[rec->write_buf_size];
+    rec->stop = false;
+    rec->frames_written = 0;
+    rec->bytes_written = 0;
+    rec->disk_error = 0;
+
+    uv_sem_init(&rec->wakeup, 0);
+    uv_thread_create(&rec->thread, recorder_disk_main, rec);
+
+    return rec;
+} // recorder_create() }}}1
+
+/**
+ * Grow cycle buffers for new JACK buffer size
+ *
+ * Call it while recorder is detached from RT thread.
+ *
+ * @param {recorder_t} rec
+ * @param {jack_nframes_t} max_frames New max buffer size of JACK cycle
+ */
+void recorder_reserve_frames(recorder_t *rec, jack_nframes_t max_frames) // {{{1
+{
+    if (max_frames <= rec->max_frames) return;
+
+    delete [] rec->frame_buf;
+    delete [] rec->silence;
+    rec->frame_buf = new jack_default_audio_sample_t[max_frames * rec->channels];
+    rec->silence = new jack_default_audio_sample_t[max_frames];
+    memset(rec->silence, 0, max_frames * sizeof(jack_default_audio_sample_t));
+    rec->max_frames = max_frames;
+} // recorder_reserve_frames() }}}1
+
+/**
+ * Push one cycle of frames (call it from RT thread only)
+ *
+ * @param {recorder_t} rec
+ * @param {jack_default_audio_sample_t} bufs Channels buffers, 0 is silence
+ *   (it's modified, rec->channel_bufs may be used as storage)
+ * @param {jack_nframes_t} nframes
+ */
+void recorder_push( // {{{1
+    recorder_t *rec,
+    jack_default_audio_sample_t **bufs,
+    jack_nframes_t nframes)
+{
+    size_t size = nframes * rec->channels * sizeof(jack_default_audio_sample_t);
+
+    if (nframes > rec->max_frames || jack_ringbuffer_write_space(rec->ring) < size) {
+        __sync_fetch_and_add(&rec->overruns, 1);
+        return;
+    }
+
+    for (uint32_t i=0; i<rec->channels; i++) {
+        if (bufs[i] == 0) bufs[i] = rec->silence;
+    }
+    dsp_kernels.interleave(rec->frame_buf, bufs, rec->channels, nframes);
+    jack_ringbuffer_write(rec->ring, (const char *)rec->frame_buf, size);
+
+    uv_sem_post(&rec->wakeup);
+} // recorder_push() }}}1
+
+/**
+ * Stop disk thread, write rest of frames, finalize header and free recorder
+ *
+ * Recorder must be removed from RT thread before.
+ *
+ * @param {recorder_t} rec
+ * @returns {int} 0 or errno of failed disk operation
+ */
+int recorder_finish(recorder_t *rec) // {{{1
+{
+    rec->stop = true;
+    uv_sem_post(&rec->wakeup);
+    uv_thread_join(&rec->thread);
+    uv_sem_destroy(&rec->wakeup);
+
+    int err = rec->disk_error;
+
+    if (rec->format != RECORDER_FORMAT_RAW && !err) {
+        bool rf64 = rec->format == RECORDER_FORMAT_RF64
+            || RECORDER_HEADER_SIZE - 8 + rec->bytes_written > RECORDER_WAV_MAX_RIFF_SIZE;
+        uint8_t header[RECORDER_HEADER_SIZE];
+        recorder_build_header(header, rec, rf64, rec->bytes_written, rec->frames_written);
+        if (pwrite(rec->fd, header, RECORDER_HEADER_SIZE, 0) != RECORDER_HEADER_SIZE)
+            err = errno ? errno : EIO;
+    }
+
+    if (close(rec->fd) != 0 && !err) err = errno;
+
+    jack_ringbuffer_free(rec->ring);
+    for (uint32_t i=0; i<rec->channels; i++) delete [] rec->port_names[i];
+    delete [] rec->port_names;
+    delete [] rec->frame_buf;
+    delete [] rec->channel_bufs;
+    delete [] rec->silence;
+    delete [] rec->write_buf;
+    delete rec;
+
+    return err;
+} // recorder_finish() }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,68 @@
+/**
+ * JACK Connector
+ * Streaming recorder, RT thread pushes frames to ring, disk thread writes them
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <jack/jack.h>
+#include <jack/ringbuffer.h>
+#include <stdint.h>
+#include <uv.h>
+
+typedef enum {
+    RECORDER_FORMAT_WAV = 0, // 32-bit float WAV, turns into RF64 if exceeds 4 GiB
+    RECORDER_FORMAT_RF64, // 32-bit float RF64 from the start
+    RECORDER_FORMAT_RAW // interleaved 32-bit float samples without header
+} recorder_format_t;
+
+typedef struct {
+    recorder_format_t format;
+    int fd;
+    uint32_t channels;
+    jack_nframes_t sample_rate;
+
+    // set and read by owner (JS thread), RT thread gets ports resolved by names
+    char **port_names; // own input ports short names
+
+    // RT thread side
+    jack_ringbuffer_t *ring; // interleaved frames
+    jack_default_audio_sample_t *frame_buf; // interleaving scratch
+    jack_default_audio_sample_t **channel_bufs;
+    jack_default_audio_sample_t *silence;
+    jack_nframes_t max_frames;
+    volatile uint32_t overruns; // periods dropped because ring is full
+
+    // disk thread side
+    uv_thread_t thread;
+    uv_sem_t wakeup;
+    volatile bool stop;
+    char *write_buf; // batch of frames for single sequential write
+    size_t write_buf_size;
+    volatile uint64_t frames_written;
+    volatile uint64_t bytes_written;
+    volatile int disk_error; // errno of failed write, writing stops after it
+} recorder_t;
+
+recorder_t* recorder_create(
+    const char *path,
+    recorder_format_t format,
+    uint32_t channels,
+    jack_nframes_t sample_rate,
+    jack_nframes_t max_frames,
+    double buffer_seconds,
+    const char **err);
+void recorder_push(
+    recorder_t *rec,
+    jack_default_audio_sample_t **bufs,
+    jack_nframes_t nframes);
+void recorder_reserve_frames(recorder_t *rec, jack_nframes_t max_frames);
+int recorder_finish(recorder_t *rec);
+
+#endif // RECORDER_H
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,159 @@
+/**
+ * JACK Connector
+ * Polyphase windowed sinc resampler with variable ratio
+ *
+ * Filter is precomputed for RESAMPLER_PHASES fractional positions between
+ * input frames, coefficients of exact position is interpolated linearly
+ * between two nearest rows. So ratio may be changed at any output frame
+ * without recomputing filter (drift correction changes it every cycle).
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "resampler.h"
+#include <math.h>
+#include <string.h>
+
+/**
+ * Blackman windowed sinc at distance "d" input frames from output frame
+ *
+ * @private
+ */
+static double resampler_kernel(double d, uint32_t taps, double cutoff) // {{{1
+{
+    double half = taps / 2.0;
+    if (d <= -half || d >= half) return 0;
+
+    double x = M_PI * cutoff * d;
+    double sinc = x == 0 ? 1 : sin(x) / x;
+    double w = M_PI * d / half;
+    double window = 0.42 + 0.5 * cos(w) + 0.08 * cos(2 * w);
+    return cutoff * sinc * window;
+} // resampler_kernel() }}}1
+
+/**
+ * Create resampler
+ *
+ * @param {uint32_t} channels
+ * @param {uint32_t} taps Filter length (RESAMPLER_MIN_TAPS..RESAMPLER_MAX_TAPS, even)
+ * @param {double} cutoff Part of input Nyquist frequency, lower it for downsampling
+ * @returns {resampler_t} rs
+ */
+resampler_t* resampler_create(uint32_t channels, uint32_t taps, double cutoff) // {{{1
+{
+    resampler_t *rs = new resampler_t();
+    rs->channels = channels;
+    rs->taps = taps;
+    rs->filter = new float[(RESAMPLER_PHASES + 1) * taps];
+    rs->coefs = new float[taps];
+    rs->history = new float[channels * taps * 2];
+
+    // row "q" is output frame "q / RESAMPLER_PHASES" frames after center of window,
+    // every row is normalized so DC gain is exactly 1
+    for (uint32_t q=0; q<=RESAMPLER_PHASES; q++) {
+        float *row = rs->filter + q * taps;
+        double p = (double)q / RESAMPLER_PHASES;
+        double sum = 0;
+        for (uint32_t i=0; i<taps; i++) {
+            row[i] = resampler_kernel(i + 1.0 - taps / 2.0 - p, taps, cutoff);
+            sum += row[i];
+        }
+        for (uint32_t i=0; i<taps; i++) row[i] /= sum;
+    }
+
+    resampler_reset(rs);
+    return rs;
+} // resampler_create() }}}1
+
+void resampler_reset(resampler_t *rs) // {{{1
+{
+    memset(rs->history, 0, rs->channels * rs->taps * 2 * sizeof(float));
+    rs->history_pos = 0;
+    rs->phase = 0;
+} // resampler_reset() }}}1
+
+/**
+ * Count of input frames resampler_run() consumes to produce output frames
+ *
+ * @param {resampler_t} rs
+ * @param {uint32_t} out_frames
+ * @param {double} step Input frames per output frame
+ * @returns {uint32_t} frames
+ */
+uint32_t resampler_input_frames(resampler_t *rs, uint32_t out_frames, double step) // {{{1
+{
+    return (uint32_t)floor(rs->phase + out_frames * step);
+} // resampler_input_frames() }}}1
+
+/**
+ * Resample interleaved frames
+ *
+ * Stops when all input frames is consumed or all output frames is produced,
+ * whichever comes first. Position between calls is kept, so input may be
+ * given in blocks of any size.
+ *
+ * @param {resampler_t} rs
+ * @param {float} in Interleaved input frames
+ * @param {uint32_t} in_frames
+ * @param {float} out Interleaved output frames
+ * @param {uint32_t} out_frames Max output frames
+ * @param {double} step Input frames per output frame
+ * @returns {uint32_t} Produced output frames
+ */
+uint32_t resampler_run( // {{{1
+    resampler_t *rs,
+    const float *in,
+    uint32_t in_frames,
+    float *out,
+    uint32_t out_frames,
+    double step)
+{
+    uint32_t taps = rs->taps;
+    uint32_t channels = rs->channels;
+    uint32_t used = 0, produced = 0;
+
+    for (;;) {
+        while (rs->phase >= 1) {
+            if (used == in_frames) return produced;
+            for (uint32_t c=0; c<channels; c++) {
+                float *history = rs->history + c * taps * 2;
+                history[rs->history_pos] = in[used * channels + c];
+                history[rs->history_pos + taps] = in[used * channels + c];
+            }
+            if (++rs->history_pos == taps) rs->history_pos = 0;
+            used++;
+            rs->phase -= 1;
+        }
+        if (produced == out_frames) return produced;
+
+        double pos = rs->phase * RESAMPLER_PHASES;
+        uint32_t q = (uint32_t)pos;
+        if (q >= RESAMPLER_PHASES) q = RESAMPLER_PHASES - 1;
+        float frac = (float)(pos - q);
+        const float *row = rs->filter + q * taps;
+        const float *next_row = row + taps;
+        for (uint32_t i=0; i<taps; i++) rs->coefs[i] = row[i] + frac * (next_row[i] - row[i]);
+
+        for (uint32_t c=0; c<channels; c++) {
+            const float *window = rs->history + c * taps * 2 + rs->history_pos;
+            float sum = 0;
+            for (uint32_t i=0; i<taps; i++) sum += window[i] * rs->coefs[i];
+            out[produced * channels + c] = sum;
+        }
+
+        produced++;
+        rs->phase += step;
+    }
+} // resampler_run() }}}1
+
+void resampler_destroy(resampler_t *rs) // {{{1
+{
+    if (rs == 0) return;
+    delete [] rs->filter;
+    delete [] rs->coefs;
+    delete [] rs->history;
+    delete rs;
+} // resampler_destroy() }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,47 @@
+/**
+ * JACK Connector
+ * Polyphase windowed sinc resampler with variable ratio
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <stdint.h>
+
+#define RESAMPLER_PHASES 256 // filter table rows, coefficients is interpolated between them
+#define RESAMPLER_MIN_TAPS 8
+#define RESAMPLER_MAX_TAPS 128
+
+typedef struct {
+    uint32_t channels;
+    uint32_t taps; // filter length, even
+    float *filter; // RESAMPLER_PHASES + 1 rows of "taps" coefficients
+    float *coefs; // "taps" coefficients of current output frame
+
+    // last "taps" input frames of every channel, every sample is written twice
+    // ("taps" apart) so window is always contiguous
+    float *history; // channels rows of 2 * taps samples
+    uint32_t history_pos; // oldest frame of window
+
+    double phase; // position of next output frame, input frame is needed while >= 1
+} resampler_t;
+
+// cutoff is part of input Nyquist frequency (0..1)
+resampler_t* resampler_create(uint32_t channels, uint32_t taps, double cutoff);
+void resampler_reset(resampler_t *rs);
+uint32_t resampler_input_frames(resampler_t *rs, uint32_t out_frames, double step);
+uint32_t resampler_run( // interleaved frames, step is input frames per output frame
+    resampler_t *rs,
+    const float *in,
+    uint32_t in_frames,
+    float *out,
+    uint32_t out_frames,
+    double step);
+void resampler_destroy(resampler_t *rs);
+
+#endif // RESAMPLER_H
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,81 @@
+/**
+ * JACK Connector
+ * Read-side sections of realtime thread for lock-free publishing
+ *
+ * RT thread counts sections it enters and leaves. Publishing thread swaps
+ * pointer to new data, takes epoch (count of entered sections) and frees
+ * old data when as many sections is left: only sections entered before
+ * the swap could read old pointer. So RT thread never locks and never
+ * waits for publishing thread.
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "rt_section.h"
+#include <unistd.h>
+
+#define RT_SECTION_WAIT_USECS 100
+
+/**
+ * Enter section, call it before reading published pointers
+ *
+ * @param {rt_section_t} section
+ */
+void rt_section_enter(rt_section_t *section) // {{{1
+{
+    // full barrier, pointers is read after the section is counted
+    __sync_fetch_and_add(&section->entered, 1);
+} // rt_section_enter() }}}1
+
+/**
+ * Leave section, pointers read in it must not be used after this
+ *
+ * @param {rt_section_t} section
+ */
+void rt_section_leave(rt_section_t *section) // {{{1
+{
+    __sync_fetch_and_add(&section->left, 1);
+} // rt_section_leave() }}}1
+
+/**
+ * Get epoch of previously published data
+ *
+ * Call it after new pointers is published.
+ *
+ * @param {rt_section_t} section
+ * @returns {uint32_t} epoch
+ */
+uint32_t rt_section_epoch(rt_section_t *section) // {{{1
+{
+    __sync_synchronize();
+    return section->entered;
+} // rt_section_epoch() }}}1
+
+/**
+ * Check that sections that could read data of epoch is left
+ *
+ * @param {rt_section_t} section
+ * @param {uint32_t} epoch
+ * @returns {bool}
+ */
+bool rt_section_passed(rt_section_t *section, uint32_t epoch) // {{{1
+{
+    __sync_synchronize();
+    return (int32_t)(section->left - epoch) >= 0;
+} // rt_section_passed() }}}1
+
+/**
+ * Wait until sections that could read data of epoch is left
+ *
+ * Section must not wait for calling thread.
+ *
+ * @param {rt_section_t} section
+ * @param {uint32_t} epoch
+ */
+void rt_section_wait(rt_section_t *section, uint32_t epoch) // {{{1
+{
+    while (!rt_section_passed(section, epoch)) usleep(RT_SECTION_WAIT_USECS);
+} // rt_section_wait() }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,30 @@
+/**
+ * JACK Connector
+ * Read-side sections of realtime thread for lock-free publishing
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef RT_SECTION_H
+#define RT_SECTION_H
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t entered;
+    volatile uint32_t left;
+} rt_section_t;
+
+// RT thread, around code that reads published pointers
+void rt_section_enter(rt_section_t *section);
+void rt_section_leave(rt_section_t *section);
+
+// publishing thread, after new pointers is published
+uint32_t rt_section_epoch(rt_section_t *section);
+bool rt_section_passed(rt_section_t *section, uint32_t epoch); // never waits
+void rt_section_wait(rt_section_t *section, uint32_t epoch);
+
+#endif // RT_SECTION_H
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,114 @@
+/**
+ * JACK Connector
+ * Lock-free timing histograms for realtime instrumentation
+ *
+ * Recording is few atomic increments (safe for RT thread, any count of
+ * writers), percentiles is calculated on snapshot of buckets, so they're
+ * approximate (within 1/8 of value) and may be slightly inconsistent with
+ * counters if read while recording.
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "stats.h"
+#include <string.h>
+
+/**
+ * @private
+ */
+inline uint32_t stats_bucket_index(uint64_t ns) // {{{1
+{
+    if (ns < STATS_SUB_BUCKETS) return ns;
+    if (ns > 0xFFFFFFFFULL) return STATS_HISTOGRAM_BUCKETS - 1;
+
+    uint32_t msb = 31 - __builtin_clz((uint32_t)ns);
+    uint32_t sub = (ns >> (msb - STATS_SUB_BUCKETS_BITS)) & (STATS_SUB_BUCKETS - 1);
+    return (msb - STATS_SUB_BUCKETS_BITS + 1) * STATS_SUB_BUCKETS + sub;
+} // stats_bucket_index() }}}1
+
+/**
+ * Middle value of bucket in nanoseconds
+ *
+ * @private
+ */
+inline double stats_bucket_value(uint32_t index) // {{{1
+{
+    if (index < STATS_SUB_BUCKETS) return index;
+
+    uint32_t shift = index / STATS_SUB_BUCKETS - 1;
+    uint32_t sub = index % STATS_SUB_BUCKETS;
+    double lower = (double)((uint64_t)(STATS_SUB_BUCKETS + sub) << shift);
+    return lower + (double)((uint64_t)1 << shift) / 2;
+} // stats_bucket_value() }}}1
+
+/**
+ * Record one value (RT-safe)
+ *
+ * @param {stats_histogram_t} histogram
+ * @param {uint64_t} ns Duration in nanoseconds
+ */
+void stats_record(stats_histogram_t *histogram, uint64_t ns) // {{{1
+{
+    __sync_fetch_and_add(&histogram->buckets[stats_bucket_index(ns)], 1);
+    __sync_fetch_and_add(&histogram->count, 1);
+    __sync_fetch_and_add(&histogram->sum, ns);
+
+    uint64_t max = histogram->max;
+    while (ns > max) {
+        uint64_t prev = __sync_val_compare_and_swap(&histogram->max, max, ns);
+        if (prev == max) break;
+        max = prev;
+    }
+} // stats_record() }}}1
+
+/**
+ * Calculate count, mean, max and percentiles (in microseconds)
+ *
+ * @param {stats_histogram_t} histogram
+ * @param {stats_summary_t} summary
+ */
+void stats_summarize(stats_histogram_t *histogram, stats_summary_t *summary) // {{{1
+{
+    uint32_t buckets[STATS_HISTOGRAM_BUCKETS];
+    uint64_t total = 0;
+    for (uint32_t i=0; i<STATS_HISTOGRAM_BUCKETS; i++) {
+        buckets[i] = histogram->buckets[i];
+        total += buckets[i];
+    }
+
+    memset(summary, 0, sizeof(stats_summary_t));
+    summary->count = histogram->count;
+    if (summary->count == 0 || total == 0) return;
+
+    summary->mean = (double)histogram->sum / summary->count / 1000;
+    summary->max = (double)histogram->max / 1000;
+
+    const double ranks[] = { 0.5, 0.9, 0.99, 0.999 };
+    double *values[] = { &summary->p50, &summary->p90, &summary->p99, &summary->p999 };
+    uint64_t seen = 0;
+    uint32_t r = 0;
+    for (uint32_t i=0; i<STATS_HISTOGRAM_BUCKETS && r<4; i++) {
+        seen += buckets[i];
+        while (r < 4 && seen >= ranks[r] * total) {
+            double value = stats_bucket_value(i) / 1000;
+            // bucket middle may be above actual max
+            *values[r++] = value < summary->max ? value : summary->max;
+        }
+    }
+} // stats_summarize() }}}1
+
+/**
+ * Clear histogram (values recorded at the same time may be lost)
+ *
+ * @param {stats_histogram_t} histogram
+ */
+void stats_reset(stats_histogram_t *histogram) // {{{1
+{
+    for (uint32_t i=0; i<STATS_HISTOGRAM_BUCKETS; i++) histogram->buckets[i] = 0;
+    histogram->count = 0;
+    histogram->sum = 0;
+    histogram->max = 0;
+} // stats_reset() }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
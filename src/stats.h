@@ -0,0 +1,43 @@
+/**
+ * JACK Connector
+ * Lock-free timing histograms for realtime instrumentation
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+// log-linear buckets: 8 per power of two, up to 2^32 nanoseconds
+#define STATS_SUB_BUCKETS_BITS 3
+#define STATS_SUB_BUCKETS (1 << STATS_SUB_BUCKETS_BITS)
+#define STATS_HISTOGRAM_BUCKETS ((32 - STATS_SUB_BUCKETS_BITS + 1) * STATS_SUB_BUCKETS)
+
+typedef struct {
+    volatile uint32_t buckets[STATS_HISTOGRAM_BUCKETS];
+    volatile uint64_t count;
+    volatile uint64_t sum; // nanoseconds
+    volatile uint64_t max; // nanoseconds
+} stats_histogram_t;
+
+// summary in microseconds
+typedef struct {
+    uint64_t count;
+    double mean;
+    double max;
+    double p50;
+    double p90;
+    double p99;
+    double p999;
+} stats_summary_t;
+
+void stats_record(stats_histogram_t *histogram, uint64_t ns);
+void stats_summarize(stats_histogram_t *histogram, stats_summary_t *summary);
+void stats_reset(stats_histogram_t *histogram);
+
+#endif // STATS_H
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,329 @@
+/**
+ * JACK Connector
+ * Resampling bridge between JACK ports and stream of other sample rate/clock
+ *
+ * Stream and JACK side is connected by lock-free FIFO of interleaved frames
+ * of stream sample rate. RT thread resamples between FIFO and own ports with
+ * ratio of nominal sample rates corrected by drift tracking: averaged FIFO
+ * fill is kept at target latency by PI controller, so difference of clocks
+ * is absorbed by slightly changing ratio instead of underruns/overruns.
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "stream.h"
+#include <math.h>
+#include <string.h>
+
+#define STREAM_FILL_AVERAGING 1.0 // seconds
+#define STREAM_KP 0.1 // correction per second of fill error
+#define STREAM_KI 0.0025 // Kp^2 / 4, critically damped
+#define STREAM_CUTOFF 0.9 // part of lower Nyquist frequency
+
+/**
+ * Create stream
+ *
+ * @param {stream_direction_t} direction
+ * @param {uint32_t} channels
+ * @param {jack_nframes_t} sample_rate Stream sample rate
+ * @param {jack_nframes_t} jack_rate JACK sample rate
+ * @param {jack_nframes_t} max_frames Max buffer size
+ * @param {double} latency_seconds FIFO fill drift control keeps
+ * @param {uint32_t} taps Resampler filter length
+ * @returns {stream_t} stream
+ */
+stream_t* stream_create( // {{{1
+    stream_direction_t direction,
+    uint32_t channels,
+    jack_nframes_t sample_rate,
+    jack_nframes_t jack_rate,
+    jack_nframes_t max_frames,
+    double latency_seconds,
+    uint32_t taps)
+{
+    stream_t *stream = new stream_t();
+    stream->direction = direction;
+    stream->channels = channels;
+    stream->sample_rate = sample_rate;
+    stream->jack_rate = jack_rate;
+    stream->frame_size = channels * sizeof(float);
+    stream->port_names = new char*[channels];
+    stream->port_bufs = new jack_default_audio_sample_t*[channels];
+    for (uint32_t c=0; c<channels; c++) {
+        stream->port_names[c] = 0;
+        stream->port_bufs[c] = 0;
+    }
+    stream->step = direction == STREAM_PLAYBACK
+        ? (double)sample_rate / jack_rate
+        : (double)jack_rate / sample_rate;
+
+    // at least two periods, so one cycle never empties the FIFO
+    stream->target_fill = (uint32_t)(latency_seconds * sample_rate);
+    uint32_t period = (uint32_t)ceil((double)max_frames * sample_rate / jack_rate);
+    if (stream->target_fill < period * 2) stream->target_fill = period * 2;
+    stream->fifo = jack_ringbuffer_create(
+        (stream->target_fill * 2 + sample_rate / 4) * stream->frame_size);
+    jack_ringbuffer_mlock(stream->fifo);
+
+    double cutoff = STREAM_CUTOFF * (stream->step > 1 ? 1 / stream->step : 1);
+    stream->resampler = resampler_create(channels, taps, cutoff);
+
+    stream->buffering = true;
+    stream->is_buffering = true;
+    stream_reserve_frames(stream, max_frames);
+    return stream;
+} // stream_create() }}}1
+
+/**
+ * Grow RT thread buffers for new buffer size
+ *
+ * @param {stream_t} stream
+ * @param {jack_nframes_t} max_frames
+ */
+void stream_reserve_frames(stream_t *stream, jack_nframes_t max_frames) // {{{1
+{
+    if (max_frames <= stream->max_frames) return;
+
+    if (stream->direction == STREAM_PLAYBACK) {
+        stream->in_capacity = (uint32_t)ceil(
+            max_frames * stream->step * (1 + STREAM_MAX_CORRECTION)) + 2;
+        stream->out_capacity = max_frames;
+    } else {
+        stream->in_capacity = max_frames;
+        stream->out_capacity = (uint32_t)ceil(
+            max_frames / (stream->step * (1 - STREAM_MAX_CORRECTION))) + 2;
+    }
+
+    delete [] stream->in_buf;
+    delete [] stream->out_buf;
+    stream->in_buf = new float[stream->in_capacity * stream->channels];
+    stream->out_buf = new float[stream->out_capacity * stream->channels];
+    stream->max_frames = max_frames;
+} // stream_reserve_frames() }}}1
+
+// RT thread {{{1
+
+/**
+ * Update drift correction by FIFO fill of current cycle
+ *
+ * @private
+ */
+static void stream_track_drift(stream_t *stream, uint32_t fill, jack_nframes_t nframes) // {{{2
+{
+    double dt = (double)nframes / stream->jack_rate;
+    stream->fill_average += (fill - stream->fill_average) * dt / (dt + STREAM_FILL_AVERAGING);
+
+    // error in seconds of stream, positive if FIFO is fuller than target
+    double error = (stream->fill_average - stream->target_fill) / stream->sample_rate;
+
+    stream->integral += STREAM_KI * error * dt;
+    if (stream->integral > STREAM_MAX_CORRECTION) stream->integral = STREAM_MAX_CORRECTION;
+    else if (stream->integral < -STREAM_MAX_CORRECTION) stream->integral = -STREAM_MAX_CORRECTION;
+
+    double correction = STREAM_KP * error + stream->integral;
+    if (correction > STREAM_MAX_CORRECTION) correction = STREAM_MAX_CORRECTION;
+    else if (correction < -STREAM_MAX_CORRECTION) correction = -STREAM_MAX_CORRECTION;
+
+    stream->correction = correction;
+    stream->fill = stream->fill_average;
+} // stream_track_drift() }}}2
+
+/**
+ * FIFO -> resampler -> own output ports
+ *
+ * @private
+ */
+static void stream_playback(stream_t *stream, jack_default_audio_sample_t **port_bufs, jack_nframes_t nframes) // {{{2
+{
+    uint32_t channels = stream->channels;
+    uint32_t fill = jack_ringbuffer_read_space(stream->fifo) / stream->frame_size;
+
+    if (stream->buffering) {
+        if (fill < stream->target_fill) {
+            for (uint32_t c=0; c<channels; c++) {
+                if (port_bufs[c] != 0)
+                    memset(port_bufs[c], 0, nframes * sizeof(jack_default_audio_sample_t));
+            }
+            return;
+        }
+        stream->buffering = false;
+        stream->is_buffering = false;
+        stream->fill_average = fill;
+    }
+
+    stream_track_drift(stream, fill, nframes);
+    double step = stream->step * (1 + stream->correction);
+
+    uint32_t need = resampler_input_frames(stream->resampler, nframes, step);
+    if (need > stream->in_capacity) need = stream->in_capacity;
+    uint32_t got = need < fill ? need : fill;
+    jack_ringbuffer_read(stream->fifo, (char *)stream->in_buf, got * stream->frame_size);
+    if (got < need) {
+        // FIFO became empty, pad with silence and wait for target fill again
+        memset(stream->in_buf + got * channels, 0, (need - got) * stream->frame_size);
+        stream->underruns++;
+        stream->buffering = true;
+        stream->is_buffering = true;
+    }
+
+    resampler_run(stream->resampler, stream->in_buf, need, stream->out_buf, nframes, step);
+
+    for (uint32_t c=0; c<channels; c++) {
+        jack_default_audio_sample_t *out = port_bufs[c];
+        if (out == 0) continue;
+        for (jack_nframes_t n=0; n<nframes; n++) out[n] = stream->out_buf[n * channels + c];
+    }
+} // stream_playback() }}}2
+
+/**
+ * Own input ports -> resampler -> FIFO
+ *
+ * @private
+ */
+static void stream_capture(stream_t *stream, jack_default_audio_sample_t **port_bufs, jack_nframes_t nframes) // {{{2
+{
+    uint32_t channels = stream->channels;
+
+    for (uint32_t c=0; c<channels; c++) {
+        jack_default_audio_sample_t *in = port_bufs[c];
+        for (jack_nframes_t n=0; n<nframes; n++) {
+            stream->in_buf[n * channels + c] = in == 0 ? 0 : in[n];
+        }
+    }
+
+    uint32_t fill = jack_ringbuffer_read_space(stream->fifo) / stream->frame_size;
+    if (stream->buffering && fill >= stream->target_fill) {
+        stream->buffering = false;
+        stream->is_buffering = false;
+        stream->fill_average = fill;
+    }
+    if (!stream->buffering) stream_track_drift(stream, fill, nframes);
+    double step = stream->step * (1 + stream->correction);
+
+    uint32_t produced = resampler_run(stream->resampler,
+        stream->in_buf, nframes, stream->out_buf, stream->out_capacity, step);
+
+    if (jack_ringbuffer_write_space(stream->fifo) < produced * stream->frame_size) {
+        stream->overruns++;
+        return;
+    }
+    jack_ringbuffer_write(stream->fifo, (const char *)stream->out_buf, produced * stream->frame_size);
+} // stream_capture() }}}2
+
+/**
+ * Process one cycle
+ *
+ * @param {stream_t} stream
+ * @param {jack_default_audio_sample_t} port_bufs Buffer of every channel (0 for silence)
+ * @param {jack_nframes_t} nframes
+ */
+void stream_process( // {{{2
+    stream_t *stream,
+    jack_default_audio_sample_t **port_bufs,
+    jack_nframes_t nframes)
+{
+    if (nframes > stream->max_frames) return;
+    if (stream->direction == STREAM_PLAYBACK) stream_playback(stream, port_bufs, nframes);
+    else stream_capture(stream, port_bufs, nframes);
+} // stream_process() }}}2
+
+// RT thread }}}1
+
+// FIFO {{{1
+
+/**
+ * Write planar frames to playback stream
+ *
+ * @param {stream_t} stream
+ * @param {float} bufs Buffer of every channel (0 for silence)
+ * @param {uint32_t} frames
+ * @returns {uint32_t} Written frames (less than "frames" if FIFO is full)
+ */
+uint32_t stream_write(stream_t *stream, const float **bufs, uint32_t frames) // {{{2
+{
+    uint32_t space = jack_ringbuffer_write_space(stream->fifo) / stream->frame_size;
+    if (frames > space) frames = space;
+
+    // samples never cross end of ring, its size is power of 2
+    jack_ringbuffer_data_t vec[2];
+    jack_ringbuffer_get_write_vector(stream->fifo, vec);
+    uint32_t first = vec[0].len / sizeof(float);
+    float *a = (float *)vec[0].buf;
+    float *b = (float *)vec[1].buf;
+
+    for (uint32_t n=0, s=0; n<frames; n++) {
+        for (uint32_t c=0; c<stream->channels; c++, s++) {
+            float sample = bufs[c] == 0 ? 0 : bufs[c][n];
+            if (s < first) a[s] = sample;
+            else b[s - first] = sample;
+        }
+    }
+
+    jack_ringbuffer_write_advance(stream->fifo, frames * stream->frame_size);
+    return frames;
+} // stream_write() }}}2
+
+/**
+ * Read planar frames from capture stream
+ *
+ * Nothing is read until FIFO is filled to target latency first time.
+ *
+ * @param {stream_t} stream
+ * @param {float} bufs Buffer of every channel
+ * @param {uint32_t} frames Max frames
+ * @returns {uint32_t} Read frames
+ */
+uint32_t stream_read(stream_t *stream, float **bufs, uint32_t frames) // {{{2
+{
+    if (stream->is_buffering) return 0;
+
+    uint32_t fill = jack_ringbuffer_read_space(stream->fifo) / stream->frame_size;
+    if (frames > fill) frames = fill;
+
+    jack_ringbuffer_data_t vec[2];
+    jack_ringbuffer_get_read_vector(stream->fifo, vec);
+    uint32_t first = vec[0].len / sizeof(float);
+    const float *a = (const float *)vec[0].buf;
+    const float *b = (const float *)vec[1].buf;
+
+    for (uint32_t n=0, s=0; n<frames; n++) {
+        for (uint32_t c=0; c<stream->channels; c++, s++) {
+            bufs[c][n] = s < first ? a[s] : b[s - first];
+        }
+    }
+
+    jack_ringbuffer_read_advance(stream->fifo, frames * stream->frame_size);
+    return frames;
+} // stream_read() }}}2
+
+/**
+ * Frames available for stream owner
+ *
+ * @param {stream_t} stream
+ * @returns {uint32_t} Space to write (playback) or frames to read (capture)
+ */
+uint32_t stream_available(stream_t *stream) // {{{2
+{
+    if (stream->direction == STREAM_PLAYBACK)
+        return jack_ringbuffer_write_space(stream->fifo) / stream->frame_size;
+    if (stream->is_buffering) return 0;
+    return jack_ringbuffer_read_space(stream->fifo) / stream->frame_size;
+} // stream_available() }}}2
+
+// FIFO }}}1
+
+void stream_destroy(stream_t *stream) // {{{1
+{
+    if (stream == 0) return;
+    for (uint32_t c=0; c<stream->channels; c++) delete [] stream->port_names[c];
+    delete [] stream->port_names;
+    delete [] stream->port_bufs;
+    jack_ringbuffer_free(stream->fifo);
+    resampler_destroy(stream->resampler);
+    delete [] stream->in_buf;
+    delete [] stream->out_buf;
+    delete stream;
+} // stream_destroy() }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
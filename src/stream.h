@@ -0,0 +1,81 @@
+/**
+ * JACK Connector
+ * Resampling bridge between JACK ports and stream of other sample rate/clock
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <jack/jack.h>
+#include <jack/ringbuffer.h>
+#include <stdint.h>
+#include "resampler.h"
+
+#define STREAM_MAX_CORRECTION 0.005 // max drift correction of ratio (5000 ppm)
+
+typedef enum {
+    STREAM_PLAYBACK = 0, // FIFO -> own output ports
+    STREAM_CAPTURE // own input ports -> FIFO
+} stream_direction_t;
+
+typedef struct {
+    stream_direction_t direction;
+    uint32_t channels;
+    jack_nframes_t sample_rate; // of stream
+    jack_nframes_t jack_rate;
+    double step; // nominal input frames per output frame
+
+    // set by owner (JS thread), RT thread gets ports resolved by names
+    char **port_names; // own ports short names
+    jack_default_audio_sample_t **port_bufs; // storage for RT thread
+
+    // interleaved frames of stream sample rate, single writer and single reader
+    jack_ringbuffer_t *fifo;
+    uint32_t frame_size; // bytes
+    uint32_t target_fill; // frames in FIFO drift control keeps (latency)
+
+    // RT thread state
+    resampler_t *resampler;
+    float *in_buf; // interleaved resampler input
+    float *out_buf; // interleaved resampler output
+    uint32_t in_capacity; // frames
+    uint32_t out_capacity;
+    jack_nframes_t max_frames;
+    bool buffering; // playback waits until FIFO is filled to target
+    double fill_average; // frames
+    double integral;
+    volatile float correction; // current drift correction of ratio
+    volatile float fill; // averaged FIFO fill in frames
+    volatile uint32_t underruns; // playback: FIFO became empty
+    volatile uint32_t overruns; // capture: FIFO was full, output is dropped
+    volatile bool is_buffering;
+} stream_t;
+
+stream_t* stream_create(
+    stream_direction_t direction,
+    uint32_t channels,
+    jack_nframes_t sample_rate,
+    jack_nframes_t jack_rate,
+    jack_nframes_t max_frames,
+    double latency_seconds,
+    uint32_t taps);
+void stream_reserve_frames(stream_t *stream, jack_nframes_t max_frames);
+void stream_process( // call it from RT thread only
+    stream_t *stream,
+    jack_default_audio_sample_t **port_bufs,
+    jack_nframes_t nframes);
+
+// planar buffers, playback stream only, single writer thread (JS or native source)
+uint32_t stream_write(stream_t *stream, const float **bufs, uint32_t frames);
+// planar buffers, capture stream only, single reader thread
+uint32_t stream_read(stream_t *stream, float **bufs, uint32_t frames);
+uint32_t stream_available(stream_t *stream); // frames to read or space to write
+
+void stream_destroy(stream_t *stream);
+
+#endif // STREAM_H
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,167 @@
+/**
+ * JACK Connector
+ * Transport position of cycles and timebase master
+ *
+ * RT thread queries transport once per cycle and publishes it through
+ * two snapshots with sequence numbers (same way as level meters), so JS
+ * thread reads position of last cycle without waiting for RT thread.
+ * Tempo of timebase master goes the other way: JS thread publishes it,
+ * RT thread picks it up on next timebase callback or keeps previous tempo
+ * if snapshot is being rewritten right now.
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "transport.h"
+#include <math.h>
+#include <string.h>
+
+#define TRANSPORT_READ_TRIES 16
+
+void transport_init(transport_t *transport) // {{{1
+{
+    memset(transport, 0, sizeof(transport_t));
+
+    timebase_tempo_t tempo;
+    tempo.bpm = TIMEBASE_DEFAULT_BPM;
+    tempo.beats_per_bar = TIMEBASE_DEFAULT_BEATS_PER_BAR;
+    tempo.beat_type = TIMEBASE_DEFAULT_BEAT_TYPE;
+    tempo.ticks_per_beat = TIMEBASE_DEFAULT_TICKS_PER_BEAT;
+    transport->tempo = tempo;
+    transport->tempos[0].tempo = tempo;
+    transport->tempos[1].tempo = tempo;
+} // transport_init() }}}1
+
+/**
+ * Query transport of current cycle and publish it
+ *
+ * @param {transport_t} transport
+ * @param {jack_client_t} client
+ * @param {jack_nframes_t} nframes
+ */
+void transport_capture( // {{{1
+    transport_t *transport,
+    jack_client_t *client,
+    jack_nframes_t nframes)
+{
+    transport_cycle_t *cycle = &transport->cycle;
+    cycle->frame_time = jack_last_frame_time(client);
+    cycle->nframes = nframes;
+    cycle->state = jack_transport_query(client, &cycle->position);
+
+    transport_snapshot_t *snapshot = &transport->snapshots[transport->published ^ 1];
+    snapshot->sequence++; // odd
+    __sync_synchronize();
+    snapshot->cycle = *cycle;
+    __sync_synchronize();
+    snapshot->sequence++; // even
+    transport->published ^= 1;
+    transport->captured = true;
+} // transport_capture() }}}1
+
+/**
+ * Copy transport of last published cycle
+ *
+ * @param {transport_t} transport
+ * @param {transport_cycle_t} dst
+ * @returns {bool} false if there was no cycle yet
+ */
+bool transport_read(transport_t *transport, transport_cycle_t *dst) // {{{1
+{
+    if (!transport->captured) return false;
+
+    for (uint32_t i=0; i<TRANSPORT_READ_TRIES; i++) {
+        transport_snapshot_t *snapshot = &transport->snapshots[transport->published];
+        uint32_t sequence = snapshot->sequence;
+        if (sequence & 1) continue;
+        __sync_synchronize();
+        *dst = snapshot->cycle;
+        __sync_synchronize();
+        if (snapshot->sequence == sequence) break;
+    }
+
+    return true;
+} // transport_read() }}}1
+
+// timebase {{{1
+
+/**
+ * Publish new tempo for timebase callback
+ *
+ * @param {transport_t} transport
+ * @param {timebase_tempo_t} tempo
+ */
+void timebase_set_tempo(transport_t *transport, const timebase_tempo_t *tempo) // {{{2
+{
+    uint32_t index = transport->tempo_published ^ 1;
+    timebase_snapshot_t *snapshot = &transport->tempos[index];
+    snapshot->sequence++; // odd
+    __sync_synchronize();
+    snapshot->tempo = *tempo;
+    __sync_synchronize();
+    snapshot->sequence++; // even
+    transport->tempo_published = index;
+    __sync_fetch_and_add(&transport->tempo_version, 1);
+} // timebase_set_tempo() }}}2
+
+/**
+ * Absolute tick of frame by current tempo
+ *
+ * @private
+ */
+static double timebase_ticks_at(transport_t *transport, jack_nframes_t frame, jack_nframes_t rate) // {{{2
+{
+    double ticks_per_frame = transport->tempo.bpm * transport->tempo.ticks_per_beat / (60.0 * rate);
+    double ticks = transport->anchor_tick
+        + ((double)frame - (double)transport->anchor_frame) * ticks_per_frame;
+    return ticks < 0 ? 0 : ticks;
+} // timebase_ticks_at() }}}2
+
+/**
+ * Fill BBT fields of position (timebase master)
+ *
+ * @param {transport_t} transport
+ * @param {jack_position_t} pos Position to fill, "frame" and "frame_rate" is set
+ */
+void timebase_fill(transport_t *transport, jack_position_t *pos) // {{{2
+{
+    jack_nframes_t rate = pos->frame_rate ? pos->frame_rate : 48000;
+
+    uint32_t version = transport->tempo_version;
+    if (version != transport->tempo_applied) {
+        timebase_snapshot_t *snapshot = &transport->tempos[transport->tempo_published];
+        uint32_t sequence = snapshot->sequence;
+        if (!(sequence & 1)) {
+            __sync_synchronize();
+            timebase_tempo_t tempo = snapshot->tempo;
+            __sync_synchronize();
+            // JS thread is rewriting it, try again next cycle
+            if (snapshot->sequence == sequence) {
+                transport->anchor_tick = timebase_ticks_at(transport, pos->frame, rate);
+                transport->anchor_frame = pos->frame;
+                transport->tempo = tempo;
+                transport->tempo_applied = version;
+            }
+        }
+    }
+
+    const timebase_tempo_t *tempo = &transport->tempo;
+    double abs_tick = timebase_ticks_at(transport, pos->frame, rate);
+    double abs_beat = floor(abs_tick / tempo->ticks_per_beat);
+    double bar = floor(abs_beat / tempo->beats_per_bar);
+
+    pos->valid = JackPositionBBT;
+    pos->bar = (int32_t)bar + 1;
+    pos->beat = (int32_t)(abs_beat - bar * tempo->beats_per_bar) + 1;
+    pos->tick = (int32_t)(abs_tick - abs_beat * tempo->ticks_per_beat);
+    pos->bar_start_tick = bar * tempo->beats_per_bar * tempo->ticks_per_beat;
+    pos->beats_per_bar = tempo->beats_per_bar;
+    pos->beat_type = tempo->beat_type;
+    pos->ticks_per_beat = tempo->ticks_per_beat;
+    pos->beats_per_minute = tempo->bpm;
+} // timebase_fill() }}}2
+
+// timebase }}}1
+
+// vim:set ts=4 sts=4 sw=4 et:
@@ -0,0 +1,84 @@
+/**
+ * JACK Connector
+ * Transport position of cycles and timebase master
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <jack/jack.h>
+#include <jack/transport.h>
+#include <stdint.h>
+
+#define TIMEBASE_DEFAULT_BPM 120
+#define TIMEBASE_DEFAULT_BEATS_PER_BAR 4
+#define TIMEBASE_DEFAULT_BEAT_TYPE 4
+#define TIMEBASE_DEFAULT_TICKS_PER_BEAT 1920
+
+// transport of one JACK cycle
+typedef struct {
+    jack_nframes_t frame_time; // JACK frame time of first frame of cycle
+    jack_nframes_t nframes;
+    jack_transport_state_t state;
+    jack_position_t position;
+} transport_cycle_t;
+
+typedef struct {
+    volatile uint32_t sequence; // odd while RT thread writes it
+    transport_cycle_t cycle;
+} transport_snapshot_t;
+
+typedef struct {
+    double bpm;
+    float beats_per_bar;
+    float beat_type;
+    double ticks_per_beat;
+} timebase_tempo_t;
+
+typedef struct {
+    volatile uint32_t sequence; // odd while JS thread writes it
+    timebase_tempo_t tempo;
+} timebase_snapshot_t;
+
+typedef struct {
+    // current cycle, read it only from RT thread or thread RT thread waits for
+    transport_cycle_t cycle;
+
+    // RT thread writes one snapshot while any thread reads another one
+    transport_snapshot_t snapshots[2];
+    volatile uint32_t published;
+    volatile bool captured; // at least one cycle is published
+
+    // timebase master tempo, JS thread writes, RT thread reads
+    timebase_snapshot_t tempos[2];
+    volatile uint32_t tempo_published;
+    volatile uint32_t tempo_version;
+
+    // RT thread only, ticks is counted from anchor so tempo change
+    // doesn't move current musical position
+    timebase_tempo_t tempo;
+    uint32_t tempo_applied; // version of "tempo"
+    double anchor_tick;
+    jack_nframes_t anchor_frame;
+} transport_t;
+
+void transport_init(transport_t *transport);
+
+// RT thread, call it once at start of every cycle
+void transport_capture(transport_t *transport, jack_client_t *client, jack_nframes_t nframes);
+
+// any thread, never waits for RT thread, false if no cycle is published yet
+bool transport_read(transport_t *transport, transport_cycle_t *dst);
+
+// JS thread (single writer)
+void timebase_set_tempo(transport_t *transport, const timebase_tempo_t *tempo);
+
+// RT thread, JACK timebase callback body
+void timebase_fill(transport_t *transport, jack_position_t *pos);
+
+#endif // TRANSPORT_H
+
+// vim:set ts=4 sts=4 sw=4 et:
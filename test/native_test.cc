@@ -0,0 +1,479 @@
+/**
+ * JACK Connector
+ * Tests of native parts that doesn't need JACK server
+ * (kernels versions, DSP graph, analyzer, WAV/RF64 parsing)
+ *
+ * Run it by "npm test" after build, failed checks is printed to stderr.
+ *
+ * @author Viacheslav Lotsmanov (unclechu) <lotsmanov89@gmail.com>
+ * @license MIT
+ */
+
+#include "analyzer.h"
+#include "dsp_graph.h"
+#include "dsp_kernels.h"
+#include "player.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_LENGTH 67 // covers tails of every vector width
+#define MAX_OFFSET 8 // unaligned pointers
+
+uint32_t failures = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            failures++; \
+            fprintf(stderr, "%s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__); \
+            fprintf(stderr, "\n"); \
+        } \
+    } while (0)
+
+bool near(float a, float b, float tolerance)
+{
+    float scale = fabsf(a) > 1 ? fabsf(a) : 1;
+    return fabsf(a - b) <= tolerance * scale;
+}
+
+// kernels {{{1
+
+/**
+ * Fill buffer with values that has no exact sums
+ */
+void fill_samples(dsp_sample_t *buf, uint32_t n, uint32_t seed) // {{{2
+{
+    for (uint32_t i=0; i<n; i++) buf[i] = sinf(0.37f * (i + 1) * (seed + 1)) * 1.3f;
+} // fill_samples() }}}2
+
+/**
+ * Compare every kernel of version with scalar one
+ */
+void test_kernels_version(const char *name) // {{{2
+{
+    dsp_kernels_t ref, k;
+    dsp_kernels_get("scalar", &ref);
+    if (!dsp_kernels_get(name, &k)) {
+        printf("kernels: %s is not supported by CPU, skipped\n", name);
+        return;
+    }
+
+    // extra space for offsets and for guard samples after the end
+    static dsp_sample_t src_mem[MAX_LENGTH * 4 + MAX_OFFSET + 8];
+    static dsp_sample_t gains_mem[MAX_LENGTH + MAX_OFFSET];
+    static dsp_sample_t a_mem[MAX_LENGTH * 4 + MAX_OFFSET + 8];
+    static dsp_sample_t b_mem[MAX_LENGTH * 4 + MAX_OFFSET + 8];
+
+    for (uint32_t offset=0; offset<MAX_OFFSET; offset++)
+    for (uint32_t n=0; n<=MAX_LENGTH; n++) {
+        dsp_sample_t *src = src_mem + offset;
+        dsp_sample_t *gains = gains_mem + offset;
+        dsp_sample_t *a = a_mem + offset;
+        dsp_sample_t *b = b_mem + (MAX_OFFSET - 1 - offset);
+        fill_samples(src_mem, sizeof(src_mem) / sizeof(dsp_sample_t), n);
+        fill_samples(gains_mem, sizeof(gains_mem) / sizeof(dsp_sample_t), n + 7);
+
+#define SAME_BUFS(op, len) \
+        for (uint32_t i=0; i<(len) + 4; i++) { \
+            if (!near(a[i], b[i], 1e-6f)) { \
+                CHECK(false, "%s %s: n=%u offset=%u sample %u: %f != %f", \
+                    name, op, n, offset, i, b[i], a[i]); \
+                break; \
+            } \
+        }
+#define RESET_BUFS() \
+        do { \
+            fill_samples(a_mem, sizeof(a_mem) / sizeof(dsp_sample_t), n + 3); \
+            fill_samples(b_mem, sizeof(b_mem) / sizeof(dsp_sample_t), n + 3); \
+            memcpy(b, a, (MAX_LENGTH * 4 + 8) * sizeof(dsp_sample_t)); \
+        } while (0)
+
+        RESET_BUFS();
+        ref.copy(a, src, n);
+        k.copy(b, src, n);
+        SAME_BUFS("copy", n);
+
+        RESET_BUFS();
+        ref.gain(a, src, 0.7f, n);
+        k.gain(b, src, 0.7f, n);
+        SAME_BUFS("gain", n);
+
+        RESET_BUFS();
+        ref.gain_ramp(a, src, 0.2f, 0.013f, n);
+        k.gain_ramp(b, src, 0.2f, 0.013f, n);
+        SAME_BUFS("gain_ramp", n);
+
+        RESET_BUFS();
+        ref.gain_curve(a, src, gains, n);
+        k.gain_curve(b, src, gains, n);
+        SAME_BUFS("gain_curve", n);
+
+        RESET_BUFS();
+        ref.mix(a, src, n);
+        k.mix(b, src, n);
+        SAME_BUFS("mix", n);
+
+        RESET_BUFS();
+        ref.mix_gain(a, src, -0.3f, n);
+        k.mix_gain(b, src, -0.3f, n);
+        SAME_BUFS("mix_gain", n);
+
+        RESET_BUFS();
+        ref.clip(a, src, 0.9f, n);
+        k.clip(b, src, 0.9f, n);
+        SAME_BUFS("clip", n);
+
+        // in place
+        RESET_BUFS();
+        ref.gain(a, a, 1.5f, n);
+        k.gain(b, b, 1.5f, n);
+        SAME_BUFS("gain in place", n);
+
+        CHECK(near(ref.peak(src, n), k.peak(src, n), 1e-6f),
+            "%s peak: n=%u offset=%u", name, n, offset);
+        CHECK(near(ref.sum_squares(src, n), k.sum_squares(src, n), 1e-5f),
+            "%s sum_squares: n=%u offset=%u", name, n, offset);
+
+        for (uint32_t channels=1; channels<=4; channels++) {
+            dsp_sample_t *planar[4];
+            for (uint32_t c=0; c<channels; c++) planar[c] = src + c * n;
+
+            RESET_BUFS();
+            ref.interleave(a, planar, channels, n);
+            k.interleave(b, planar, channels, n);
+            SAME_BUFS("interleave", n * channels);
+
+            dsp_sample_t *planar_a[4], *planar_b[4];
+            for (uint32_t c=0; c<channels; c++) {
+                planar_a[c] = a + c * n;
+                planar_b[c] = b + c * n;
+            }
+            RESET_BUFS();
+            ref.deinterleave(planar_a, src, channels, n);
+            k.deinterleave(planar_b, src, channels, n);
+            SAME_BUFS("deinterleave", n * channels);
+        }
+
+#undef SAME_BUFS
+#undef RESET_BUFS
+    }
+
+    printf("kernels: %s is checked\n", name);
+} // test_kernels_version() }}}2
+
+// kernels }}}1
+
+// DSP graph {{{1
+
+int32_t resolve_test_port(bool output, const char *short_name) // {{{2
+{
+    if (!output && strcmp(short_name, "in") == 0) return 0;
+    if (output && strcmp(short_name, "out") == 0) return 0;
+    return -1;
+} // resolve_test_port() }}}2
+
+void test_dsp_graph_compile() // {{{2
+{
+    dsp_graph_t graph;
+    memset(&graph, 0, sizeof(graph));
+    dsp_program_t *program = 0;
+
+    CHECK(dsp_graph_compile(&graph, resolve_test_port, 1, 64, &program) == 0 && program == 0,
+        "empty graph should compile to no program");
+
+    int32_t gain = dsp_graph_add_node(&graph, DSP_NODE_GAIN, 0.5f, 0);
+    dsp_source_t src = { -1, 0, (char *)"in" };
+    dsp_destination_t dst = { gain, 0 };
+    CHECK(dsp_graph_connect(&graph, src, dst), "connect input to gain");
+    dsp_source_t gain_out = { gain, 0, 0 };
+    dsp_destination_t port_out = { -1, (char *)"out" };
+    CHECK(dsp_graph_connect(&graph, gain_out, port_out), "connect gain to output");
+
+    const char *err = dsp_graph_compile(&graph, resolve_test_port, 1, 64, &program);
+    CHECK(err == 0 && program != 0, "graph should compile: %s", err ? err : "no program");
+    if (program != 0) {
+        jack_default_audio_sample_t in[64], out[64];
+        fill_samples(in, 64, 1);
+        jack_default_audio_sample_t *capture[1] = { in };
+        jack_default_audio_sample_t *playback[1] = { out };
+        dsp_program_run(program, 64, 0, capture, playback);
+        for (uint32_t i=0; i<64; i++) {
+            if (!near(out[i], in[i] * 0.5f, 1e-6f)) {
+                CHECK(false, "gain node sample %u: %f != %f", i, out[i], in[i] * 0.5f);
+                break;
+            }
+        }
+        dsp_program_free(program);
+    }
+
+    // node feeding itself
+    dsp_destination_t loop = { gain, 0 };
+    dsp_graph_connect(&graph, gain_out, loop);
+    err = dsp_graph_compile(&graph, resolve_test_port, 1, 64, &program);
+    CHECK(err != 0 && program == 0, "graph with cycle should not compile");
+
+    dsp_graph_destroy(&graph);
+    printf("dsp graph: compile is checked\n");
+} // test_dsp_graph_compile() }}}2
+
+void test_dsp_graph_automation() // {{{2
+{
+    dsp_graph_t graph;
+    memset(&graph, 0, sizeof(graph));
+
+    int32_t constant = dsp_graph_add_node(&graph, DSP_NODE_CONSTANT, 0, 0);
+    dsp_source_t src = { constant, 0, 0 };
+    dsp_destination_t dst = { -1, (char *)"out" };
+    dsp_graph_connect(&graph, src, dst);
+
+    const jack_nframes_t nframes = 256, cycle_start = 1000;
+    dsp_program_t *program = 0;
+    const char *err = dsp_graph_compile(&graph, resolve_test_port, 1, nframes, &program);
+    CHECK(err == 0 && program != 0, "constant graph should compile");
+    if (program == 0) {
+        dsp_graph_destroy(&graph);
+        return;
+    }
+
+    jack_ringbuffer_t *queue = jack_ringbuffer_create(
+        DSP_AUTOMATION_QUEUE_SIZE * sizeof(dsp_automation_event_t));
+    dsp_automation_event_t set = { (uint32_t)constant, DSP_AUTOMATION_SET, cycle_start + 10, 0, 1 };
+    dsp_automation_event_t ramp = {
+        (uint32_t)constant, DSP_AUTOMATION_LINEAR, cycle_start + 100, 100, 2 };
+    // posted out of time order, scheduling sorts them
+    dsp_automation_post(queue, &ramp);
+    dsp_automation_post(queue, &set);
+    CHECK(dsp_program_schedule(program, queue) == 0, "no events should be dropped");
+
+    jack_default_audio_sample_t in[nframes], out[nframes];
+    memset(in, 0, sizeof(in));
+    jack_default_audio_sample_t *capture[1] = { in };
+    jack_default_audio_sample_t *playback[1] = { out };
+    dsp_program_run(program, nframes, cycle_start, capture, playback);
+
+    for (uint32_t i=0; i<nframes; i++) {
+        float expected = 2;
+        if (i < 10) expected = 0;
+        else if (i < 100) expected = 1;
+        else if (i < 200) expected = 1 + (i - 100) * 0.01f;
+        if (!near(out[i], expected, 1e-4f)) {
+            CHECK(false, "automation sample %u: %f != %f", i, out[i], expected);
+            break;
+        }
+    }
+
+    // cancel holds current value from its time on
+    dsp_automation_event_t ramp_down = {
+        (uint32_t)constant, DSP_AUTOMATION_LINEAR, cycle_start + nframes + 50, 100, 0 };
+    dsp_automation_event_t cancel = {
+        (uint32_t)constant, DSP_AUTOMATION_CANCEL, cycle_start + nframes + 20, 0, 0 };
+    dsp_automation_post(queue, &ramp_down);
+    dsp_automation_post(queue, &cancel);
+    dsp_program_schedule(program, queue);
+    dsp_program_run(program, nframes, cycle_start + nframes, capture, playback);
+    for (uint32_t i=0; i<nframes; i++) {
+        if (!near(out[i], 2, 1e-6f)) {
+            CHECK(false, "canceled ramp sample %u: %f != 2", i, out[i]);
+            break;
+        }
+    }
+
+    jack_ringbuffer_free(queue);
+    dsp_program_free(program);
+    dsp_graph_destroy(&graph);
+    printf("dsp graph: automation is checked\n");
+} // test_dsp_graph_automation() }}}2
+
+// DSP graph }}}1
+
+// analyzer {{{1
+
+void test_analyzer_sine() // {{{2
+{
+    const uint32_t size = 1024, bin = 32;
+    const jack_nframes_t nframes = 256;
+    analyzer_t *analyzer = analyzer_create(1, size, 0, 0, ANALYZER_WINDOW_HANN, nframes);
+
+    jack_default_audio_sample_t buf[nframes];
+    jack_default_audio_sample_t *bufs[1] = { buf };
+    uint32_t frame = 0;
+    for (uint32_t cycle=0; cycle<size * 2 / nframes; cycle++) {
+        for (uint32_t i=0; i<nframes; i++, frame++)
+            buf[i] = sin(2 * M_PI * bin * frame / size);
+        analyzer_push(analyzer, bufs, nframes);
+    }
+    for (uint32_t i=0; i<1000 && analyzer->spectra_count == 0; i++) usleep(1000);
+    CHECK(analyzer->spectra_count > 0, "analyzer should compute spectrum");
+
+    float bins[size / 2 + 1];
+    analyzer_read(analyzer, bins);
+    CHECK(near(bins[bin], 1, 1e-3f), "full scale sine magnitude %f != 1", bins[bin]);
+    // Hann window spreads sine to neighbour bins only
+    CHECK(near(bins[bin - 1], 0.5f, 1e-3f) && near(bins[bin + 1], 0.5f, 1e-3f),
+        "Hann neighbour bins %f, %f != 0.5", bins[bin - 1], bins[bin + 1]);
+    for (uint32_t i=0; i<=size / 2; i++) {
+        if (i + 1 >= bin && i <= bin + 1) continue;
+        if (bins[i] > 1e-3f) {
+            CHECK(false, "leakage to bin %u: %f", i, bins[i]);
+            break;
+        }
+    }
+
+    analyzer_destroy(analyzer);
+    printf("analyzer: sine magnitude is checked\n");
+} // test_analyzer_sine() }}}2
+
+// analyzer }}}1
+
+// WAV/RF64 parsing {{{1
+
+void put_le16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+void put_le32(uint8_t *p, uint32_t v) { put_le16(p, v); put_le16(p + 2, v >> 16); }
+void put_le64(uint8_t *p, uint64_t v) { put_le32(p, v); put_le32(p + 4, v >> 32); }
+
+/**
+ * Write header of file with format chunk, returns size of it
+ */
+size_t put_wav_header( // {{{2
+    uint8_t *buf,
+    bool rf64,
+    uint64_t ds64_data_size,
+    uint16_t format_tag,
+    uint16_t channels,
+    uint16_t bits)
+{
+    size_t pos = 0;
+    memcpy(buf, rf64 ? "RF64" : "RIFF", 4);
+    put_le32(buf + 4, 0xFFFFFFFF);
+    memcpy(buf + 8, "WAVE", 4);
+    pos = 12;
+
+    if (rf64) {
+        memcpy(buf + pos, "ds64", 4);
+        put_le32(buf + pos + 4, 28);
+        put_le64(buf + pos + 8, 0); // riff size
+        put_le64(buf + pos + 16, ds64_data_size);
+        put_le64(buf + pos + 24, 0); // sample count
+        put_le32(buf + pos + 32, 0); // table length
+        pos += 8 + 28;
+    }
+
+    memcpy(buf + pos, "fmt ", 4);
+    put_le32(buf + pos + 4, 16);
+    put_le16(buf + pos + 8, format_tag);
+    put_le16(buf + pos + 10, channels);
+    put_le32(buf + pos + 12, 48000);
+    put_le32(buf + pos + 16, 48000 * channels * bits / 8);
+    put_le16(buf + pos + 20, channels * bits / 8);
+    put_le16(buf + pos + 22, bits);
+    pos += 8 + 16;
+
+    return pos;
+} // put_wav_header() }}}2
+
+const char* parse_wav(uint8_t *buf, size_t size, player_t *player) // {{{2
+{
+    memset(player, 0, sizeof(player_t));
+    player->map = buf;
+    player->map_size = size;
+    return player_parse_wav(player);
+} // parse_wav() }}}2
+
+void test_wav_parsing() // {{{2
+{
+    static uint8_t buf[4096];
+    player_t player;
+    const char *err;
+
+    // 16-bit stereo WAV with odd sized chunk before data
+    memset(buf, 0, sizeof(buf));
+    size_t pos = put_wav_header(buf, false, 0, 1, 2, 16);
+    memcpy(buf + pos, "LIST", 4);
+    put_le32(buf + pos + 4, 3);
+    pos += 8 + 4; // padded
+    memcpy(buf + pos, "data", 4);
+    put_le32(buf + pos + 4, 400);
+    err = parse_wav(buf, pos + 8 + 400, &player);
+    CHECK(err == 0, "WAV: %s", err);
+    CHECK(player.channels == 2 && player.sample_rate == 48000
+        && player.sample_format == PLAYER_SAMPLE_PCM16, "WAV format");
+    CHECK(player.frames == 100 && player.data == buf + pos + 8, "WAV data");
+
+    // unfinished recording, data size is bigger than file
+    err = parse_wav(buf, pos + 8 + 200, &player);
+    CHECK(err == 0 && player.frames == 50, "unfinished WAV frames %llu",
+        (unsigned long long)player.frames);
+
+    // RF64 float with data size in ds64 chunk
+    memset(buf, 0, sizeof(buf));
+    pos = put_wav_header(buf, true, 800, 3, 1, 32);
+    memcpy(buf + pos, "data", 4);
+    put_le32(buf + pos + 4, 0xFFFFFFFF);
+    err = parse_wav(buf, pos + 8 + 1000, &player);
+    CHECK(err == 0, "RF64: %s", err);
+    CHECK(player.sample_format == PLAYER_SAMPLE_FLOAT32 && player.frames == 200,
+        "RF64 frames %llu", (unsigned long long)player.frames);
+
+    // ds64 data size that would wrap around is limited to file
+    pos = put_wav_header(buf, true, 0xFFFFFFFFFFFFFFF0ull, 3, 1, 32);
+    memcpy(buf + pos, "data", 4);
+    put_le32(buf + pos + 4, 0xFFFFFFFF);
+    err = parse_wav(buf, pos + 8 + 1000, &player);
+    CHECK(err == 0 && player.frames == 250, "RF64 huge data size frames %llu",
+        (unsigned long long)player.frames);
+
+    // chunk out of file
+    memset(buf, 0, sizeof(buf));
+    pos = put_wav_header(buf, false, 0, 1, 2, 16);
+    memcpy(buf + pos, "JUNK", 4);
+    put_le32(buf + pos + 4, 0xFFFFFFF0);
+    err = parse_wav(buf, pos + 100, &player);
+    CHECK(err != 0, "chunk out of file should fail");
+
+    // WAVE_FORMAT_EXTENSIBLE 24-bit
+    memset(buf, 0, sizeof(buf));
+    memcpy(buf, "RIFF", 4);
+    memcpy(buf + 8, "WAVE", 4);
+    memcpy(buf + 12, "fmt ", 4);
+    put_le32(buf + 16, 40);
+    put_le16(buf + 20, 0xFFFE);
+    put_le16(buf + 22, 2);
+    put_le32(buf + 24, 44100);
+    put_le16(buf + 34, 24);
+    put_le16(buf + 44, 1); // subformat PCM
+    memcpy(buf + 60, "data", 4);
+    put_le32(buf + 64, 60);
+    err = parse_wav(buf, 68 + 60, &player);
+    CHECK(err == 0 && player.sample_format == PLAYER_SAMPLE_PCM24 && player.frames == 10,
+        "extensible WAV: %s", err ? err : "wrong format");
+
+    // not a WAV
+    memset(buf, 0, sizeof(buf));
+    CHECK(parse_wav(buf, 64, &player) != 0, "unknown format should fail");
+    CHECK(parse_wav(buf, 4, &player) != 0, "short file should fail");
+
+    printf("player: WAV/RF64 parsing is checked\n");
+} // test_wav_parsing() }}}2
+
+// WAV/RF64 parsing }}}1
+
+int main() // {{{1
+{
+    dsp_kernels_init();
+
+    test_kernels_version("sse");
+    test_kernels_version("avx");
+    test_dsp_graph_compile();
+    test_dsp_graph_automation();
+    test_analyzer_sine();
+    test_wav_parsing();
+
+    if (failures > 0) fprintf(stderr, "%u checks failed\n", failures);
+    else printf("all checks passed\n");
+    return failures > 0 ? 1 : 0;
+} // main() }}}1
+
+// vim:set ts=4 sts=4 sw=4 et: